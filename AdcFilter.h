@@ -0,0 +1,87 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Filtro para lecturas del ADC del ESP32: mediana de las últimas N muestras
+// (elimina picos aislados) seguida de un EMA (suaviza el ruido restante).
+// Además acumula min/max/media/desviación de la salida filtrada por ventana;
+// la tarea de envío consume la ventana con takeWindow().
+//
+// C++ puro, sin heap ni Arduino: se puede probar en host con trazas grabadas.
+template <size_t N>
+class AdcFilter {
+  static_assert(N % 2 == 1, "la mediana usa un N impar");
+
+ public:
+  struct Window {
+    uint32_t count;
+    float min;
+    float max;
+    float mean;
+    float stddev;
+  };
+
+  explicit AdcFilter(float alpha) : alpha_(alpha) {}
+
+  // Agrega una muestra cruda y devuelve el valor filtrado
+  float push(uint16_t raw) {
+    ring_[head_] = raw;
+    head_ = (head_ + 1) % N;
+    if (filled_ < N) filled_++;
+
+    float med = median();
+    ema_ = primed_ ? ema_ + alpha_ * (med - ema_) : med;
+    primed_ = true;
+
+    // Welford: media y varianza en una pasada, estable numéricamente
+    count_++;
+    float delta = ema_ - mean_;
+    mean_ += delta / count_;
+    m2_ += delta * (ema_ - mean_);
+    if (count_ == 1 || ema_ < min_) min_ = ema_;
+    if (count_ == 1 || ema_ > max_) max_ = ema_;
+    return ema_;
+  }
+
+  float value() const { return ema_; }
+  bool primed() const { return primed_; }
+
+  // Devuelve la ventana acumulada desde la última llamada y la reinicia
+  Window takeWindow() {
+    Window w = {count_, min_, max_, mean_, count_ > 1 ? sqrtf(m2_ / (count_ - 1)) : 0.0f};
+    count_ = 0;
+    mean_ = m2_ = min_ = max_ = 0.0f;
+    return w;
+  }
+
+ private:
+  // Inserción sobre una copia: N es chico (3..9)
+  float median() const {
+    uint16_t v[N];
+    for (size_t i = 0; i < filled_; i++) {
+      uint16_t x = ring_[i];
+      size_t j = i;
+      while (j > 0 && v[j - 1] > x) {
+        v[j] = v[j - 1];
+        j--;
+      }
+      v[j] = x;
+    }
+    return filled_ % 2 ? v[filled_ / 2] : (v[filled_ / 2 - 1] + v[filled_ / 2]) * 0.5f;
+  }
+
+  float alpha_;
+  uint16_t ring_[N] = {};
+  size_t head_ = 0;
+  size_t filled_ = 0;
+  float ema_ = 0.0f;
+  bool primed_ = false;
+
+  uint32_t count_ = 0;
+  float mean_ = 0.0f;
+  float m2_ = 0.0f;
+  float min_ = 0.0f;
+  float max_ = 0.0f;
+};
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Despacho de mensajes de control sin heap para los nodos.
+//
+// Cada nodo recibe también las lecturas de los demás (broadcast mientras no
+// hay root), así que clasificar no debe costar un parseo JSON completo:
+//   1. controlClassify() mira el primer byte ('#' = SensorFrame, '{' = JSON)
+//      y busca "type" sin parsear el resto.
+//   2. El nombre del tipo se mapea a ControlType con un hash perfecto
+//      calculado en compilación (tabla de 16 slots, verificada con static_assert).
+//   3. Los campos se leen en sitio (controlUint/controlFloat/controlUintArray)
+//      y las respuestas se escriben en un buffer fijo con ControlWriter.
+//
+// C++ puro sin Arduino: bench_dispatch.cpp lo mide en el host.
+
+enum ControlType : uint8_t {
+  CTRL_DATA = 0,       // lectura de sensor (JSON o SensorFrame) u otro mensaje
+  CTRL_ROOT,
+  CTRL_PING,
+  CTRL_PONG,
+  CTRL_TOPO_REQ,
+  CTRL_TOPO,
+  CTRL_TRACE,
+  CTRL_TRACE_REPLY,
+  CTRL_REPORT_CFG,
+  CTRL_REPORT_CFG_ACK,
+  CTRL_POWER,          // telemetría de energía de los nodos con NODE_SLEEP_MODE
+  CTRL_JOIN,           // primera unión tras el arranque (MeshRejoin.h)
+};
+
+#define CONTROL_HASH_SLOTS 16
+
+namespace controldispatch {
+
+// Ningún par de nombres comparte slot; si se agrega un tipo y colisiona,
+// el static_assert de abajo falla y hay que ajustar los coeficientes.
+constexpr uint8_t hash(const char *s, size_t len) {
+  return len < 2 ? 0 : (uint8_t)((2 * (uint8_t)s[1] + (uint8_t)s[len - 1] + len) & (CONTROL_HASH_SLOTS - 1));
+}
+
+struct Slot {
+  const char *name;
+  uint8_t len;
+  ControlType type;
+};
+
+constexpr Slot kSlots[CONTROL_HASH_SLOTS] = {
+    {"JOIN", 4, CTRL_JOIN},
+    {"TOPO", 4, CTRL_TOPO},
+    {nullptr, 0, CTRL_DATA},
+    {"REPORT_CFG_ACK", 14, CTRL_REPORT_CFG_ACK},
+    {nullptr, 0, CTRL_DATA},
+    {"POWER", 5, CTRL_POWER},
+    {"ROOT", 4, CTRL_ROOT},
+    {"TOPO_REQ", 8, CTRL_TOPO_REQ},
+    {"TRACE_REPLY", 11, CTRL_TRACE_REPLY},
+    {"PONG", 4, CTRL_PONG},
+    {nullptr, 0, CTRL_DATA},
+    {"REPORT_CFG", 10, CTRL_REPORT_CFG},
+    {nullptr, 0, CTRL_DATA},
+    {"PING", 4, CTRL_PING},
+    {"TRACE", 5, CTRL_TRACE},
+    {nullptr, 0, CTRL_DATA},
+};
+
+constexpr bool slotsValid(size_t i = 0) {
+  return i == CONTROL_HASH_SLOTS ||
+         ((!kSlots[i].name || hash(kSlots[i].name, kSlots[i].len) == i) && slotsValid(i + 1));
+}
+static_assert(slotsValid(), "kSlots no coincide con hash()");
+
+inline const char *skipSpaces(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+  return p;
+}
+
+}  // namespace controldispatch
+
+// Tipo a partir del nombre exacto ("PING", ...); CTRL_DATA si no es de control
+inline ControlType controlTypeOf(const char *name, size_t len) {
+  const controldispatch::Slot &s = controldispatch::kSlots[controldispatch::hash(name, len)];
+  return (s.name && s.len == len && memcmp(s.name, name, len) == 0) ? s.type : CTRL_DATA;
+}
+
+inline const char *controlTypeName(ControlType type) {
+  for (const auto &s : controldispatch::kSlots) {
+    if (s.name && s.type == type) return s.name;
+  }
+  return "DATA";
+}
+
+// Valor crudo de "key" en un objeto JSON plano: puntero al primer carácter
+// tras los ':' o nullptr. Tolera espacios (json.dumps de Python los agrega).
+// No entra en objetos anidados; los mensajes de control no los usan.
+inline const char *controlField(const char *msg, size_t len, const char *key) {
+  using controldispatch::skipSpaces;
+  const char *end = msg + len;
+  size_t klen = strlen(key);
+  for (const char *p = msg; p + klen + 2 < end; p++) {
+    if (*p != '"' || memcmp(p + 1, key, klen) != 0 || p[klen + 1] != '"') continue;
+    const char *v = skipSpaces(p + klen + 2, end);
+    if (v < end && *v == ':') return skipSpaces(v + 1, end);
+  }
+  return nullptr;
+}
+
+// Clasifica sin parseo completo: sólo los objetos JSON con un "type" conocido
+// son control. Las SensorFrame ('#') y las lecturas JSON salen en el primer paso.
+inline ControlType controlClassify(const char *msg, size_t len) {
+  if (len < 2 || msg[0] != '{') return CTRL_DATA;
+  const char *v = controlField(msg, len, "type");
+  if (!v || *v != '"') return CTRL_DATA;
+  const char *name = v + 1;
+  const char *close = (const char *)memchr(name, '"', msg + len - name);
+  return close ? controlTypeOf(name, close - name) : CTRL_DATA;
+}
+
+// Campos numéricos; def si falta o no es un número
+inline uint32_t controlUint(const char *msg, size_t len, const char *key, uint32_t def = 0) {
+  const char *v = controlField(msg, len, key);
+  if (!v || *v < '0' || *v > '9') return def;
+  return (uint32_t)strtoul(v, nullptr, 10);
+}
+
+inline bool controlHas(const char *msg, size_t len, const char *key) {
+  const char *v = controlField(msg, len, key);
+  return v && *v != 'n';  // null cuenta como ausente
+}
+
+inline float controlFloat(const char *msg, size_t len, const char *key, float def = 0.0f) {
+  const char *v = controlField(msg, len, key);
+  if (!v) return def;
+  char *endp;
+  float f = strtof(v, &endp);
+  return endp == v ? def : f;
+}
+
+// Arreglo de enteros ("hops": [1,2,3]); devuelve cuántos se copiaron en out
+inline size_t controlUintArray(const char *msg, size_t len, const char *key, uint32_t *out, size_t max) {
+  using controldispatch::skipSpaces;
+  const char *end = msg + len;
+  const char *p = controlField(msg, len, key);
+  if (!p || *p != '[') return 0;
+  size_t n = 0;
+  p++;
+  while (n < max) {
+    p = skipSpaces(p, end);
+    if (p >= end || *p < '0' || *p > '9') break;
+    char *next;
+    out[n++] = (uint32_t)strtoul(p, &next, 10);
+    p = skipSpaces(next, end);
+    if (p >= end || *p != ',') break;
+    p++;
+  }
+  return n;
+}
+
+// Escritura acotada de JSON en un buffer del llamador. Si algo no entra,
+// ok() pasa a false y el texto queda truncado pero terminado en '\0'.
+class ControlWriter {
+ public:
+  ControlWriter(char *buf, size_t cap) : buf_(buf), cap_(cap) { buf_[0] = '\0'; }
+
+  ControlWriter &raw(const char *s) { return printf("%s", s); }
+
+  __attribute__((format(printf, 2, 3))) ControlWriter &printf(const char *fmt, ...) {
+    if (!ok_) return *this;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf_ + len_, cap_ - len_, fmt, ap);
+    va_end(ap);
+    if (n < 0 || len_ + n >= cap_) {
+      ok_ = false;
+      buf_[len_] = '\0';
+    } else {
+      len_ += n;
+    }
+    return *this;
+  }
+
+  // "key":[a,b,c] a partir de cualquier contenedor iterable de enteros
+  template <typename Ids>
+  ControlWriter &uintArray(const char *key, const Ids &ids) {
+    printf("\"%s\":[", key);
+    bool first = true;
+    for (uint32_t id : ids) {
+      printf(first ? "%u" : ",%u", (unsigned)id);
+      first = false;
+    }
+    return raw("]");
+  }
+
+  const char *c_str() const { return buf_; }
+  size_t length() const { return len_; }
+  bool ok() const { return ok_; }
+
+ private:
+  char *buf_;
+  size_t cap_;
+  size_t len_ = 0;
+  bool ok_ = true;
+};
+
+// Arreglo fijo como contenedor iterable para ControlWriter::uintArray
+struct UintSpan {
+  const uint32_t *ids;
+  size_t n;
+  const uint32_t *begin() const { return ids; }
+  const uint32_t *end() const { return ids + n; }
+};
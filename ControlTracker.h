@@ -0,0 +1,373 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ControlDispatch.h"
+
+// Seguimiento en la gateway de los pedidos de control que van al mesh (PING,
+// TRACE, TOPO_REQ, REPORT_CFG). Antes mqttCallback() los reenviaba sin
+// registro: nadie avisaba si un nodo no contestaba, dos clics seguidos
+// inundaban el mesh dos veces y un TOPO_REQ con "flood" devolvía una
+// respuesta suelta por nodo.
+//
+// - Cada pedido abierto es una entrada de una tabla de direccionamiento
+//   abierto con sondeo lineal (como SeqTable), con clave (tipo, destino, seq)
+//   y borrado por corrimiento hacia atrás, sin marcas de borrado.
+// - Guarda cuándo salió, cuántos nodos deben contestar (1 en unicast, los
+//   del árbol en broadcast) y quiénes contestaron. Al completarse, o a los
+//   CONTROL_TIMEOUT_MS, sale un único CTRL_RESULT: "ok", "partial" o "timeout".
+// - Una respuesta repetida de un nodo no cuenta: los pares (pedido, nodo) van
+//   a otra tabla abierta, compartida por todos los pedidos, así un broadcast
+//   con cientos de respuestas descarta repetidos igual que un unicast. El
+//   CTRL_RESULT sólo lista los primeros CONTROL_RESPONDERS_MAX.
+// - El mismo pedido otra vez mientras está abierto no se reenvía al mesh.
+// - Límite por destino con GCRA (un cubo de fichas en un solo uint32_t):
+//   CONTROL_RATE_BURST pedidos seguidos y luego uno cada
+//   CONTROL_RATE_INTERVAL_MS. El broadcast es el destino 0.
+//
+// Todo corre en la tarea MQTT: los pedidos llegan por mqttCallback() y las
+// respuestas por el carril de control, así que no hace falta sincronizar.
+//
+// C++ puro sin Arduino: bench_tracker.cpp lo prueba en el host.
+
+#ifndef CONTROL_TIMEOUT_MS
+#define CONTROL_TIMEOUT_MS 5000
+#endif
+#ifndef CONTROL_RATE_BURST
+#define CONTROL_RATE_BURST 4
+#endif
+#ifndef CONTROL_RATE_INTERVAL_MS
+#define CONTROL_RATE_INTERVAL_MS 500  // 2 pedidos/s sostenidos por destino
+#endif
+#ifndef CONTROL_RESPONDERS_MAX
+#define CONTROL_RESPONDERS_MAX 8  // ids publicados por pedido; el resto sólo se cuenta
+#endif
+#ifndef CONTROL_RESPONDER_SLOTS
+#define CONTROL_RESPONDER_SLOTS 256  // pares (pedido, nodo) para descartar repetidos, 8 bytes c/u
+#endif
+// Peor caso: cabecera con ids y contadores de 10 dígitos + los ids
+#define CONTROL_RESULT_JSON_MAX (CONTROL_RESPONDERS_MAX * 11 + 256)
+
+enum ControlVerdict : uint8_t {
+  CONTROL_TRACKED = 0,   // nuevo: se reenvía al mesh
+  CONTROL_UNTRACKED,     // sin respuesta esperada o tabla llena: se reenvía sin seguir
+  CONTROL_DUPLICATE,     // ya abierto: no se reenvía
+  CONTROL_RATE_LIMITED,  // el destino agotó su cupo: no se reenvía
+};
+
+enum ControlStatus : uint8_t {
+  CONTROL_DONE = 0,  // contestaron todos los esperados
+  CONTROL_PARTIAL,   // venció con algunas respuestas
+  CONTROL_TIMEOUT,   // venció sin ninguna
+  CONTROL_LIMITED,   // rechazado por el límite del destino
+};
+
+inline const char *controlStatusName(uint8_t status) {
+  static const char *const names[] = {"ok", "partial", "timeout", "rate_limited"};
+  return status <= CONTROL_LIMITED ? names[status] : "?";
+}
+
+// Pedido que corresponde a una respuesta; CTRL_DATA si no es respuesta
+inline ControlType controlRequestOf(ControlType reply) {
+  switch (reply) {
+    case CTRL_PONG: return CTRL_PING;
+    case CTRL_TRACE_REPLY: return CTRL_TRACE;
+    case CTRL_TOPO: return CTRL_TOPO_REQ;
+    case CTRL_REPORT_CFG_ACK: return CTRL_REPORT_CFG;
+    default: return CTRL_DATA;
+  }
+}
+
+// Respuestas que espera un pedido a target (0 = broadcast) con nodes nodos
+// en el árbol. PING y TRACE sólo los contesta el destino, así que en
+// broadcast no esperan ninguna; 0 = no se sigue
+inline uint16_t controlExpected(ControlType type, uint32_t target, size_t nodes) {
+  if (type != CTRL_PING && type != CTRL_TRACE && type != CTRL_TOPO_REQ && type != CTRL_REPORT_CFG) return 0;
+  if (target) return 1;
+  if (type == CTRL_PING || type == CTRL_TRACE) return 0;
+  return nodes < 0xffff ? (uint16_t)nodes : 0xffff;
+}
+
+struct ControlRequest {
+  uint32_t id;      // único mientras está abierto: clave de sus respondedores
+  uint32_t target;  // 0 = broadcast
+  uint32_t seq;
+  uint32_t sentMs;
+  uint32_t firstMs;  // primera y última respuesta, desde sentMs
+  uint32_t lastMs;
+  uint8_t type;  // ControlType del pedido; CTRL_DATA = libre
+  uint8_t count;  // entradas válidas en responders
+  uint16_t expected;
+  uint16_t answered;
+  uint16_t duplicates;  // pedidos repetidos absorbidos
+  uint32_t responders[CONTROL_RESPONDERS_MAX];
+};
+
+struct ControlTrackerStats {
+  uint32_t tracked;    // pedidos registrados
+  uint32_t done;       // completos
+  uint32_t partial;    // vencidos con respuestas
+  uint32_t timeouts;   // vencidos sin respuestas
+  uint32_t duplicates; // pedidos repetidos no reenviados
+  uint32_t limited;    // rechazados por el límite del destino
+  uint32_t untracked;  // reenviados sin seguir por tabla llena
+  uint32_t orphans;    // respuestas sin pedido abierto (tardías o de otro cliente)
+  uint32_t repeated;   // respuestas repetidas de un mismo nodo, no contadas
+  uint32_t unchecked;  // respuestas contadas sin descartar repetidos (tabla de respondedores llena)
+};
+
+// SLOTS pedidos abiertos a la vez, TARGETS destinos con límite y RESPONDERS
+// respuestas distintas entre todos los abiertos; potencias de 2 con holgura
+// (el sondeo lineal se alarga cerca del lleno)
+template <size_t SLOTS, size_t TARGETS, size_t RESPONDERS = CONTROL_RESPONDER_SLOTS>
+class ControlTracker {
+  static_assert(SLOTS && (SLOTS & (SLOTS - 1)) == 0, "SLOTS debe ser potencia de 2");
+  static_assert(TARGETS && (TARGETS & (TARGETS - 1)) == 0, "TARGETS debe ser potencia de 2");
+  static_assert(RESPONDERS && (RESPONDERS & (RESPONDERS - 1)) == 0, "RESPONDERS debe ser potencia de 2");
+
+ public:
+  // Registra un pedido que va a salir al mesh. Un repetido no consume cupo
+  ControlVerdict request(ControlType type, uint32_t target, uint32_t seq, uint16_t expected, uint32_t now) {
+    if (!expected) return CONTROL_UNTRACKED;
+    size_t i;
+    if (findRequest(type, target, seq, i)) {
+      slots_[i].duplicates++;
+      stats_.duplicates++;
+      return CONTROL_DUPLICATE;
+    }
+    if (!allow(target, now)) {
+      stats_.limited++;
+      return CONTROL_RATE_LIMITED;
+    }
+    if (used_ == SLOTS - 1) {  // siempre queda un libre para cortar el sondeo
+      stats_.untracked++;
+      return CONTROL_UNTRACKED;
+    }
+    ControlRequest &r = slots_[i];
+    memset(&r, 0, sizeof(r));
+    if (!++nextId_) nextId_ = 1;  // 0 marca un par libre
+    r.id = nextId_;
+    r.type = type;
+    r.target = target;
+    r.seq = seq;
+    r.sentMs = now;
+    r.expected = expected;
+    used_++;
+    stats_.tracked++;
+    return CONTROL_TRACKED;
+  }
+
+  // Respuesta de from. Se busca el pedido a from y si no, el broadcast con
+  // la misma seq. Al completarse llama a emit(const ControlRequest&,
+  // ControlStatus) y lo cierra. false si no había pedido abierto
+  template <typename Emit>
+  bool reply(ControlType replyType, uint32_t from, uint32_t seq, uint32_t now, Emit emit) {
+    ControlType type = controlRequestOf(replyType);
+    size_t i;
+    if (type == CTRL_DATA || (!findRequest(type, from, seq, i) && !findRequest(type, 0, seq, i))) {
+      stats_.orphans++;
+      return false;
+    }
+    ControlRequest &r = slots_[i];
+    if (!addResponder(r, from)) {  // el mismo nodo otra vez
+      stats_.repeated++;
+      return true;
+    }
+    uint32_t elapsed = now - r.sentMs;
+    if (!r.answered++) r.firstMs = elapsed;
+    r.lastMs = elapsed;
+    if (r.answered >= r.expected) {
+      stats_.done++;
+      emit(r, CONTROL_DONE);
+      remove(i);
+    }
+    return true;
+  }
+
+  // Cierra los vencidos con emit(r, CONTROL_PARTIAL o CONTROL_TIMEOUT).
+  // Recorre toda la tabla; devuelve cuántos cerró
+  template <typename Emit>
+  size_t expire(uint32_t now, Emit emit) {
+    size_t closed = 0;
+    for (size_t i = 0; i < SLOTS && used_;) {
+      ControlRequest &r = slots_[i];
+      if (r.type == CTRL_DATA || now - r.sentMs < CONTROL_TIMEOUT_MS) {
+        i++;
+        continue;
+      }
+      ControlStatus status = r.answered ? CONTROL_PARTIAL : CONTROL_TIMEOUT;
+      (status == CONTROL_PARTIAL ? stats_.partial : stats_.timeouts)++;
+      emit(r, status);
+      remove(i);  // puede traer otra entrada a i: se vuelve a mirar
+      closed++;
+    }
+    return closed;
+  }
+
+  size_t size() const { return used_; }
+  size_t capacity() const { return SLOTS - 1; }
+  const ControlTrackerStats &stats() const { return stats_; }
+
+ private:
+  // Fibonacci sobre los tres campos de la clave, como slotOf() en SeqTable
+  static size_t slotOf(uint8_t type, uint32_t target, uint32_t seq) {
+    uint32_t k = target ^ (seq * 0x9E3779B1u) ^ ((uint32_t)type << 24);
+    return (size_t)((k * 2654435761u) >> 7) & (SLOTS - 1);
+  }
+
+  static size_t slotOf(const ControlRequest &r) { return slotOf(r.type, r.target, r.seq); }
+
+  // true con i en el pedido; false con i en el libre donde iría
+  bool findRequest(ControlType type, uint32_t target, uint32_t seq, size_t &i) const {
+    for (i = slotOf(type, target, seq);; i = (i + 1) & (SLOTS - 1)) {
+      const ControlRequest &r = slots_[i];
+      if (r.type == CTRL_DATA) return false;
+      if (r.type == type && r.target == target && r.seq == seq) return true;
+    }
+  }
+
+  // Borrado por corrimiento: las entradas siguientes del racimo que pueden
+  // ocupar el hueco se mueven, así ninguna búsqueda corta antes de tiempo
+  void remove(size_t i) {
+    dropResponders(slots_[i]);
+    used_--;
+    for (size_t j = (i + 1) & (SLOTS - 1);; j = (j + 1) & (SLOTS - 1)) {
+      if (slots_[j].type == CTRL_DATA) break;
+      size_t home = slotOf(slots_[j]);
+      // j se queda si su posición ideal está en (i, j], cíclicamente
+      if (((j - home) & (SLOTS - 1)) < ((j - i) & (SLOTS - 1))) continue;
+      slots_[i] = slots_[j];
+      i = j;
+    }
+    slots_[i].type = CTRL_DATA;
+  }
+
+  // ---------- Respondedores ----------
+
+  // Par (pedido, nodo) que ya contestó; req 0 = libre
+  struct Responder {
+    uint32_t req;
+    uint32_t node;
+  };
+
+  static size_t responderSlotOf(uint32_t req, uint32_t node) {
+    uint32_t k = node ^ (req * 0x9E3779B1u);
+    return (size_t)((k * 2654435761u) >> 7) & (RESPONDERS - 1);
+  }
+
+  // false si from ya había contestado. Con la tabla de pares llena se cuenta
+  // igual y sólo se descartan los repetidos de la lista publicada
+  bool addResponder(ControlRequest &r, uint32_t from) {
+    size_t i;
+    for (i = responderSlotOf(r.id, from);; i = (i + 1) & (RESPONDERS - 1)) {
+      const Responder &p = responders_[i];
+      if (!p.req) break;
+      if (p.req == r.id && p.node == from) return false;
+    }
+    if (respondersUsed_ < RESPONDERS - 1) {
+      responders_[i].req = r.id;
+      responders_[i].node = from;
+      respondersUsed_++;
+    } else {
+      for (uint8_t k = 0; k < r.count; k++) {
+        if (r.responders[k] == from) return false;
+      }
+      stats_.unchecked++;
+    }
+    if (r.count < CONTROL_RESPONDERS_MAX) r.responders[r.count++] = from;
+    return true;
+  }
+
+  // Libera los pares del pedido que se cierra. Recorre la tabla, pero corta
+  // al encontrar tantos como respuestas tuvo; sin respuestas no recorre nada
+  void dropResponders(const ControlRequest &r) {
+    size_t left = r.answered;
+    for (size_t i = 0; i < RESPONDERS && left && respondersUsed_;) {
+      if (responders_[i].req != r.id) {
+        i++;
+        continue;
+      }
+      removeResponder(i);  // puede traer otro par a i: se vuelve a mirar
+      left--;
+    }
+  }
+
+  // Mismo corrimiento que remove()
+  void removeResponder(size_t i) {
+    respondersUsed_--;
+    for (size_t j = (i + 1) & (RESPONDERS - 1);; j = (j + 1) & (RESPONDERS - 1)) {
+      if (!responders_[j].req) break;
+      size_t home = responderSlotOf(responders_[j].req, responders_[j].node);
+      if (((j - home) & (RESPONDERS - 1)) < ((j - i) & (RESPONDERS - 1))) continue;
+      responders_[i] = responders_[j];
+      i = j;
+    }
+    responders_[i].req = 0;
+  }
+
+  // GCRA: tat es el instante teórico del próximo pedido al ritmo sostenido;
+  // se admite si no se adelanta más de BURST - 1 intervalos. Un destino con
+  // tat vencido tiene el cupo lleno y su lugar se puede reutilizar
+  struct Bucket {
+    uint32_t target;
+    uint32_t tat;
+    bool used;
+  };
+
+  bool allow(uint32_t target, uint32_t now) {
+    const uint32_t slack = (CONTROL_RATE_BURST - 1) * CONTROL_RATE_INTERVAL_MS;
+    Bucket *reuse = nullptr;
+    Bucket *b = nullptr;
+    size_t i = (size_t)((target * 2654435761u) >> 7) & (TARGETS - 1);
+    for (size_t probes = 0; probes < TARGETS; probes++, i = (i + 1) & (TARGETS - 1)) {
+      Bucket &c = buckets_[i];
+      if (!c.used) {
+        if (!reuse) reuse = &c;
+        break;
+      }
+      if (c.target == target) {
+        b = &c;
+        break;
+      }
+      if (!reuse && (int32_t)(now - c.tat) >= 0) reuse = &c;
+    }
+    if (!b) {
+      if (!reuse) return true;  // tabla llena de destinos activos: sin límite
+      b = reuse;
+      b->used = true;
+      b->target = target;
+      b->tat = now;
+    }
+    uint32_t tat = (int32_t)(now - b->tat) > 0 ? now : b->tat;
+    if ((int32_t)(tat - now) > (int32_t)slack) return false;
+    b->tat = tat + CONTROL_RATE_INTERVAL_MS;
+    return true;
+  }
+
+  ControlRequest slots_[SLOTS] = {};
+  Bucket buckets_[TARGETS] = {};
+  Responder responders_[RESPONDERS] = {};
+  size_t used_ = 0;
+  size_t respondersUsed_ = 0;
+  uint32_t nextId_ = 0;
+  ControlTrackerStats stats_ = {};
+};
+
+// {"type":"CTRL_RESULT","from":gw,"req":"PING","to":id,"seq":s,"status":"ok",
+//  "expected":n,"answered":k,"dups":d,"rtt_ms":[primera,última],"age_ms":a,
+//  "nodes":[ids...]}; "truncated":true si contestaron más de los guardados
+inline size_t controlResultJson(const ControlRequest &r, ControlStatus status, uint32_t from, uint32_t now,
+                                char *buf, size_t cap) {
+  ControlWriter w(buf, cap);
+  w.printf("{\"type\":\"CTRL_RESULT\",\"from\":%u,\"req\":\"%s\",\"to\":%u,\"seq\":%u,\"status\":\"%s\",",
+           (unsigned)from, controlTypeName((ControlType)r.type), (unsigned)r.target, (unsigned)r.seq,
+           controlStatusName(status));
+  w.printf("\"expected\":%u,\"answered\":%u,\"dups\":%u,\"rtt_ms\":[%u,%u],\"age_ms\":%u,", (unsigned)r.expected,
+           (unsigned)r.answered, (unsigned)r.duplicates, (unsigned)r.firstMs, (unsigned)r.lastMs,
+           (unsigned)(now - r.sentMs));
+  if (r.answered > r.count) w.raw("\"truncated\":true,");
+  w.uintArray("nodes", UintSpan{r.responders, r.count}).raw("}");
+  return w.ok() ? w.length() : 0;
+}
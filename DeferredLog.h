@@ -0,0 +1,511 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <type_traits>
+
+// Log diferido con niveles resueltos en compilación.
+//
+//   LOG_E / LOG_W / LOG_I / LOG_D (fmt, args...)
+//
+// - Los niveles por encima de LOG_LEVEL no generan código: la macro queda
+//   vacía y los argumentos ni se evalúan. Por defecto INFO, así los volcados
+//   de payload por mensaje (DEBUG) desaparecen del binario.
+// - En el momento de loguear no se formatea nada: se guarda el puntero al
+//   formato (debe ser un literal) y los argumentos en binario (enteros,
+//   double, cadenas copiadas) en un slot de un anillo MPSC sin locks. Una
+//   tarea de prioridad baja los formatea y los escribe en el UART, así un
+//   printf a 115200 baudios ya no frena mesh.update() ni la tarea MQTT.
+// - Con el anillo lleno el mensaje se descarta y se cuenta; nunca bloquea.
+// - Un buffer sin '\0' final se pasa con logSpan(p, n), no con "%.*s".
+//
+// C++ puro sin Arduino: bench_log.cpp lo mide en el host.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#ifndef LOG_SLOTS
+#define LOG_SLOTS 32  // potencia de 2
+#endif
+#ifndef LOG_ARGS_MAX
+#define LOG_ARGS_MAX 104  // bytes de argumentos por mensaje (slot de 128 bytes)
+#endif
+#ifndef LOG_LINE_MAX
+#define LOG_LINE_MAX 256
+#endif
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#ifndef LOG_CLOCK_MS
+#define LOG_CLOCK_MS() millis()
+#endif
+#ifndef LOG_SINK
+#define LOG_SINK(buf, len) Serial.write((const uint8_t *)(buf), (len))
+#endif
+#else
+#include <chrono>
+#ifndef LOG_CLOCK_MS
+#define LOG_CLOCK_MS() \
+  (uint32_t) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+#endif
+#ifndef LOG_SINK
+#define LOG_SINK(buf, len) fwrite((buf), 1, (len), stdout)
+#endif
+#endif
+
+// Cadena acotada (no necesita '\0'): LOG_D("%s", logSpan(payload, len))
+struct LogSpan {
+  const char *p;
+  size_t n;
+};
+inline LogSpan logSpan(const char *p, size_t n) { return LogSpan{p, n}; }
+
+namespace deferredlog {
+
+// Etiquetas de tipo de cada argumento en el slot
+enum Tag : uint8_t { TAG_I32 = 1, TAG_U32, TAG_I64, TAG_U64, TAG_F64, TAG_STR, TAG_PTR };
+
+struct Record {
+  std::atomic<uint32_t> seq;
+  const char *fmt;
+  uint32_t ms;
+  uint8_t level;
+  uint8_t len;
+  bool truncated;
+  uint8_t args[LOG_ARGS_MAX];
+};
+
+struct Stats {
+  uint32_t logged;   // mensajes encolados
+  uint32_t dropped;  // descartados con el anillo lleno
+  uint32_t written;  // líneas escritas por el drenaje
+};
+
+// Cola acotada de Vyukov: varios productores (núcleos, tareas, callbacks
+// WiFi) y un solo consumidor, la tarea de log
+class Ring {
+ public:
+  static_assert((LOG_SLOTS & (LOG_SLOTS - 1)) == 0, "LOG_SLOTS debe ser potencia de 2");
+
+  Ring() {
+    for (uint32_t i = 0; i < LOG_SLOTS; i++) slots_[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  Record *claim() {
+    uint32_t pos = enqueue_.load(std::memory_order_relaxed);
+    for (;;) {
+      Record &r = slots_[pos & (LOG_SLOTS - 1)];
+      int32_t dif = (int32_t)(r.seq.load(std::memory_order_acquire) - pos);
+      if (dif == 0) {
+        if (enqueue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) return &r;
+      } else if (dif < 0) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+      } else {
+        pos = enqueue_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void commit(Record *r) {
+    logged_.fetch_add(1, std::memory_order_relaxed);
+    uint32_t pos = r->seq.load(std::memory_order_relaxed);
+    r->seq.store(pos + 1, std::memory_order_release);
+  }
+
+  // Sólo el consumidor
+  Record *front() {
+    Record &r = slots_[dequeue_ & (LOG_SLOTS - 1)];
+    return r.seq.load(std::memory_order_acquire) == dequeue_ + 1 ? &r : nullptr;
+  }
+
+  void release(Record *r) {
+    r->seq.store(dequeue_ + LOG_SLOTS, std::memory_order_release);
+    dequeue_++;
+    written_++;
+  }
+
+  Stats stats() const {
+    return Stats{logged_.load(std::memory_order_relaxed), dropped_.load(std::memory_order_relaxed), written_};
+  }
+  uint32_t droppedUnreported = 0;  // del consumidor: avisar una vez por racha
+
+ private:
+  Record slots_[LOG_SLOTS];
+  alignas(64) std::atomic<uint32_t> enqueue_{0};
+  alignas(64) uint32_t dequeue_ = 0;
+  std::atomic<uint32_t> logged_{0};
+  std::atomic<uint32_t> dropped_{0};
+  uint32_t written_ = 0;
+};
+
+inline Ring &ring() {
+  static Ring r;
+  return r;
+}
+
+// ---------- Codificación binaria de argumentos ----------
+
+struct Writer {
+  Record *r;
+  bool put(Tag tag, const void *v, size_t n) {
+    if (r->truncated || r->len + 1 + n > LOG_ARGS_MAX) {
+      r->truncated = true;
+      return false;
+    }
+    r->args[r->len++] = tag;
+    memcpy(r->args + r->len, v, n);
+    r->len += n;
+    return true;
+  }
+  void str(const char *s, size_t n) {
+    if (r->truncated || r->len + 2 > LOG_ARGS_MAX) {
+      r->truncated = true;
+      return;
+    }
+    size_t room = LOG_ARGS_MAX - r->len - 2;
+    if (n > room) {
+      n = room;
+      r->truncated = true;
+    }
+    if (n > 255) n = 255;
+    r->args[r->len++] = TAG_STR;
+    r->args[r->len++] = (uint8_t)n;
+    memcpy(r->args + r->len, s, n);
+    r->len += n;
+  }
+};
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type encode(Writer &w, T v) {
+  if (sizeof(T) <= 4) {
+    if (std::is_signed<T>::value) {
+      int32_t x = (int32_t)v;
+      w.put(TAG_I32, &x, 4);
+    } else {
+      uint32_t x = (uint32_t)v;
+      w.put(TAG_U32, &x, 4);
+    }
+  } else if (std::is_signed<T>::value) {
+    int64_t x = (int64_t)v;
+    w.put(TAG_I64, &x, 8);
+  } else {
+    uint64_t x = (uint64_t)v;
+    w.put(TAG_U64, &x, 8);
+  }
+}
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type encode(Writer &w, T v) {
+  double x = v;
+  w.put(TAG_F64, &x, 8);
+}
+inline void encode(Writer &w, const char *s) {
+  if (s) {
+    w.str(s, strlen(s));
+  } else {
+    w.str("(null)", 6);
+  }
+}
+inline void encode(Writer &w, char *s) { encode(w, (const char *)s); }
+inline void encode(Writer &w, LogSpan s) { w.str(s.p, s.n); }
+#ifdef ARDUINO
+inline void encode(Writer &w, const String &s) { w.str(s.c_str(), s.length()); }
+#endif
+inline void encode(Writer &w, const void *p) { w.put(TAG_PTR, &p, sizeof(p)); }
+
+inline void encodeAll(Writer &) {}
+template <typename T, typename... Rest>
+void encodeAll(Writer &w, const T &v, const Rest &...rest) {
+  encode(w, v);
+  encodeAll(w, rest...);
+}
+
+template <typename... Args>
+void log(uint8_t level, const char *fmt, const Args &...args) {
+  Record *r = ring().claim();
+  if (!r) return;
+  r->fmt = fmt;
+  r->ms = LOG_CLOCK_MS();
+  r->level = level;
+  r->len = 0;
+  r->truncated = false;
+  Writer w{r};
+  encodeAll(w, args...);
+  ring().commit(r);
+}
+
+// ---------- Formateo (sólo en la tarea de log) ----------
+
+struct Reader {
+  const uint8_t *p;
+  const uint8_t *end;
+  uint8_t tag() const { return p < end ? *p : 0; }
+  template <typename T>
+  T take() {
+    T v;
+    memcpy(&v, p + 1, sizeof(T));
+    p += 1 + sizeof(T);
+    return v;
+  }
+  int64_t takeInt() {
+    switch (tag()) {
+      case TAG_I32: return take<int32_t>();
+      case TAG_U32: return take<uint32_t>();
+      case TAG_I64: return take<int64_t>();
+      case TAG_U64: return (int64_t)take<uint64_t>();
+      case TAG_F64: return (int64_t)take<double>();
+      default: return 0;
+    }
+  }
+};
+
+// Un especificador con sus '*' ya resueltos
+template <typename T>
+int emit(char *out, size_t room, const char *spec, int stars, const int *star, T v) {
+  if (stars == 2) return snprintf(out, room, spec, star[0], star[1], v);
+  if (stars == 1) return snprintf(out, room, spec, star[0], v);
+  return snprintf(out, room, spec, v);
+}
+
+// Formatea un registro como printf, pero tomando el tipo de cada argumento
+// de su etiqueta y no de los modificadores del formato: un %d con un
+// argumento de 64 bits o un %s con un número no leen memoria de más.
+inline size_t format(const Record &r, char *out, size_t cap) {
+  static const char kLevel[] = "?EWID";
+  Reader in{r.args, r.args + r.len};
+  size_t n = (size_t)snprintf(out, cap, "%6u.%03u %c ", (unsigned)(r.ms / 1000), (unsigned)(r.ms % 1000),
+                              kLevel[r.level < 5 ? r.level : 0]);
+  auto room = [&]() { return n < cap ? cap - n : 0; };
+  auto advance = [&](int w) {
+    if (w > 0) n += (size_t)w;
+  };
+
+  for (const char *f = r.fmt; *f && room() > 1; f++) {
+    if (*f != '%') {
+      out[n++] = *f;
+      continue;
+    }
+    if (f[1] == '%') {
+      out[n++] = '%';
+      f++;
+      continue;
+    }
+    // %[flags][width][.precision][length]conv -> spec sin length
+    char spec[24];
+    size_t s = 0;
+    spec[s++] = '%';
+    const char *q = f + 1;
+    int star[2] = {0, 0};
+    int stars = 0;
+    while (*q && strchr("-+ #0123456789.*", *q)) {
+      if (*q == '*' && stars < 2) star[stars++] = (int)in.takeInt();
+      if (s < sizeof(spec) - 4) spec[s++] = *q;
+      q++;
+    }
+    while (*q && strchr("hlLqjzt", *q)) q++;
+    char conv = *q;
+    if (!conv) break;
+    f = q;
+
+    uint8_t tag = in.tag();
+    bool isInt = tag == TAG_I32 || tag == TAG_U32 || tag == TAG_I64 || tag == TAG_U64;
+    if (conv == 's' && tag == TAG_STR) {
+      // En el slot la cadena no lleva '\0'
+      char str[256];
+      uint8_t len = in.p[1];
+      memcpy(str, in.p + 2, len);
+      str[len] = '\0';
+      in.p += 2 + len;
+      spec[s++] = 's';
+      spec[s] = '\0';
+      advance(emit(out + n, room(), spec, stars, star, (const char *)str));
+      continue;
+    }
+    if (strchr("diouxXc", conv) && isInt) {
+      bool wide = tag == TAG_I64 || tag == TAG_U64;
+      if (wide) {
+        spec[s++] = 'l';
+        spec[s++] = 'l';
+      }
+      spec[s++] = conv;
+      spec[s] = '\0';
+      int64_t v = in.takeInt();
+      advance(wide ? emit(out + n, room(), spec, stars, star, (long long)v) : emit(out + n, room(), spec, stars, star, (int)v));
+      continue;
+    }
+    if (strchr("fFeEgGaA", conv) && tag == TAG_F64) {
+      spec[s++] = conv;
+      spec[s] = '\0';
+      advance(emit(out + n, room(), spec, stars, star, in.take<double>()));
+      continue;
+    }
+    if (conv == 'p' && tag == TAG_PTR) {
+      advance(snprintf(out + n, room(), "%p", in.take<const void *>()));
+      continue;
+    }
+    // Tipo distinto del que pide el formato: se muestra el valor tal cual
+    switch (tag) {
+      case TAG_F64: advance(snprintf(out + n, room(), "%g", in.take<double>())); break;
+      case TAG_STR: {
+        uint8_t len = in.p[1];
+        advance(snprintf(out + n, room(), "%.*s", (int)len, (const char *)in.p + 2));
+        in.p += 2 + len;
+        break;
+      }
+      case TAG_PTR: advance(snprintf(out + n, room(), "%p", in.take<const void *>())); break;
+      case 0: advance(snprintf(out + n, room(), "<?>")); break;
+      default: advance(snprintf(out + n, room(), "%lld", (long long)in.takeInt())); break;
+    }
+  }
+  if (n >= cap) n = cap - 1;
+  if (r.truncated && n + 4 < cap) {
+    memcpy(out + n, " ...", 4);
+    n += 4;
+  }
+  // Una línea por mensaje: el '\n' final del formato es opcional
+  if (n == 0 || out[n - 1] != '\n') {
+    if (n >= cap - 1) n = cap - 2;
+    out[n++] = '\n';
+  }
+  out[n] = '\0';
+  return n;
+}
+
+}  // namespace deferredlog
+
+// Escribe hasta max mensajes pendientes; devuelve cuántos escribió
+inline size_t logDrain(size_t max) {
+  deferredlog::Ring &ring = deferredlog::ring();
+  char line[LOG_LINE_MAX];
+  size_t done = 0;
+  uint32_t dropped = ring.stats().dropped;
+  if (dropped != ring.droppedUnreported) {
+    int n = snprintf(line, sizeof(line), "[LOG] %u mensajes descartados (anillo lleno)\n",
+                     (unsigned)(dropped - ring.droppedUnreported));
+    LOG_SINK(line, (size_t)n);
+    ring.droppedUnreported = dropped;
+  }
+  while (done < max) {
+    deferredlog::Record *r = ring.front();
+    if (!r) break;
+    size_t n = deferredlog::format(*r, line, sizeof(line));
+    ring.release(r);
+    LOG_SINK(line, n);
+    done++;
+  }
+  return done;
+}
+
+inline deferredlog::Stats logStats() { return deferredlog::ring().stats(); }
+
+// Nivel apagado: rama muerta, sin código ni evaluación de argumentos, pero
+// las variables que sólo se loguean no quedan "sin usar"
+namespace deferredlog {
+template <typename... Args>
+inline void discard(const Args &...) {}
+}  // namespace deferredlog
+#define LOG_DISABLED(...)                               \
+  do {                                                  \
+    if (false) deferredlog::discard(__VA_ARGS__);       \
+  } while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(...) deferredlog::log(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_E(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(...) deferredlog::log(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_W(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(...) deferredlog::log(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_I(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(...) deferredlog::log(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_D(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+// Tarea de drenaje en el ESP32: prioridad mínima, en el núcleo 0 junto a la
+// pila WiFi, para que el UART sólo use tiempo que sobra
+#if defined(ESP_PLATFORM)
+#ifndef LOG_TASK_CORE
+#define LOG_TASK_CORE 0
+#endif
+#ifndef LOG_TASK_PRIORITY
+#define LOG_TASK_PRIORITY 0
+#endif
+#define LOG_TASK_STACK 3072
+#define LOG_TASK_PERIOD_MS 20
+
+// El anillo admite un solo consumidor: mientras logTask corre nadie más
+// llama a logDrain(). logEnd() la detiene entre dos tandas, nunca con un slot
+// a medio escribir.
+namespace deferredlog {
+struct LogTaskState {
+  TaskHandle_t handle = nullptr;
+  std::atomic<bool> stop{false};
+  std::atomic<bool> stopped{false};
+};
+inline LogTaskState &logTaskState() {
+  static LogTaskState t;
+  return t;
+}
+}  // namespace deferredlog
+
+inline void logTask(void *) {
+  deferredlog::LogTaskState &t = deferredlog::logTaskState();
+  while (!t.stop.load(std::memory_order_acquire)) {
+    if (!logDrain(LOG_SLOTS)) vTaskDelay(pdMS_TO_TICKS(LOG_TASK_PERIOD_MS));
+  }
+  t.stopped.store(true, std::memory_order_release);
+  vTaskDelete(nullptr);
+}
+
+inline bool logBegin() {
+  deferredlog::LogTaskState &t = deferredlog::logTaskState();
+  if (t.handle) return true;
+  t.stop.store(false);
+  t.stopped.store(false);
+  return xTaskCreatePinnedToCore(logTask, "log", LOG_TASK_STACK, nullptr, LOG_TASK_PRIORITY, &t.handle,
+                                 LOG_TASK_CORE) == pdPASS;
+}
+
+// Detiene logTask y espera a que termine su tanda; desde aquí el que drena es
+// el llamador (logFlush)
+inline void logEnd() {
+  deferredlog::LogTaskState &t = deferredlog::logTaskState();
+  if (!t.handle) return;
+  t.stop.store(true, std::memory_order_release);
+  while (!t.stopped.load(std::memory_order_acquire)) vTaskDelay(1);
+  t.handle = nullptr;
+}
+#else
+// Fuera del ESP32 drena quien llame a logDrain() (gateway_linux.cpp,
+// sim/sim_mesh.cpp); ese hilo tiene que terminar antes de logFlush()
+inline bool logBegin() { return true; }
+inline void logEnd() {}
+#endif
+
+// Vacía todo en el contexto del llamador (antes de un deep sleep o reinicio).
+// Primero detiene logTask: dos consumidores sobre el anillo repetirían o
+// perderían mensajes.
+inline void logFlush() {
+  logEnd();
+  while (logDrain(LOG_SLOTS)) {
+  }
+}
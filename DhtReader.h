@@ -0,0 +1,131 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Lector DHT22 no bloqueante. Reemplaza a DHT::readTemperature()/readHumidity(),
+// que hacen bit-banging con interrupciones deshabilitadas durante ~5 ms.
+//
+// La transacción avanza como máquina de estados desde poll():
+//   IDLE    -> baja la línea (pulso de inicio) y vuelve
+//   START   -> tras DHT_START_LOW_US libera la línea y habilita la ISR
+//   CAPTURE -> la ISR registra cada flanco (micros + nivel); al vencer
+//              DHT_CAPTURE_US se decodifican los 40 bits y se valida el checksum
+//
+// Una sola transacción entrega temperatura y humedad; se guarda el último
+// valor válido con su antigüedad. poll() nunca espera: sólo compara tiempos
+// o decodifica ~90 flancos ya capturados.
+
+#ifndef DHT_READ_INTERVAL_MS
+#define DHT_READ_INTERVAL_MS 2500  // el DHT22 admite como mucho una lectura cada 2 s
+#endif
+#define DHT_WARMUP_MS 2000  // tiempo de arranque del sensor
+// Desde begin() hasta la primera lectura válida: arranque, transacción y margen
+#define DHT_FIRST_READ_MS (DHT_WARMUP_MS + 100)
+#define DHT_START_LOW_US 1100
+#define DHT_CAPTURE_US 6000
+#define DHT_MAX_EDGES 96
+#define DHT_BIT_THRESHOLD_US 48    // alto ~26 us = 0, ~70 us = 1
+
+class DhtReader {
+ public:
+  explicit DhtReader(uint8_t pin) : pin_(pin) {}
+
+  void begin() {
+    pinMode(pin_, INPUT_PULLUP);
+    nextReadMs_ = millis() + DHT_WARMUP_MS;
+  }
+
+  void poll() {
+    switch (state_) {
+      case IDLE:
+        if ((long)(millis() - nextReadMs_) < 0) return;
+        nextReadMs_ = millis() + DHT_READ_INTERVAL_MS;
+        pinMode(pin_, OUTPUT);
+        digitalWrite(pin_, LOW);
+        stateUs_ = micros();
+        state_ = START;
+        return;
+
+      case START:
+        if (micros() - stateUs_ < DHT_START_LOW_US) return;
+        edgeCount_ = 0;
+        pinMode(pin_, INPUT_PULLUP);
+        attachInterruptArg(pin_, onEdge, this, CHANGE);
+        stateUs_ = micros();
+        state_ = CAPTURE;
+        return;
+
+      case CAPTURE:
+        if (micros() - stateUs_ < DHT_CAPTURE_US) return;
+        detachInterrupt(pin_);
+        state_ = IDLE;
+        if (decode()) {
+          reads_++;
+          valid_ = true;
+          lastGoodMs_ = millis();
+        } else {
+          errors_++;
+        }
+        return;
+    }
+  }
+
+  bool valid() const { return valid_; }
+  float temperature() const { return temperature_; }
+  float humidity() const { return humidity_; }
+  uint32_t ageMs() const { return millis() - lastGoodMs_; }
+  uint32_t reads() const { return reads_; }
+  uint32_t errors() const { return errors_; }
+
+ private:
+  enum State { IDLE, START, CAPTURE };
+
+  static void IRAM_ATTR onEdge(void *arg) {
+    DhtReader *self = static_cast<DhtReader *>(arg);
+    uint8_t i = self->edgeCount_;
+    if (i >= DHT_MAX_EDGES) return;
+    self->edgeUs_[i] = micros();
+    self->edgeLevel_[i] = digitalRead(self->pin_);
+    self->edgeCount_ = i + 1;
+  }
+
+  // Los pulsos en alto son: respuesta (80 us) y luego un pulso por bit,
+  // así que los últimos 40 pulsos completos son los datos.
+  bool decode() {
+    uint16_t highs[DHT_MAX_EDGES / 2];
+    uint8_t n = 0;
+    for (uint8_t i = 0; i + 1 < edgeCount_; i++) {
+      if (edgeLevel_[i] == HIGH && edgeLevel_[i + 1] == LOW) {
+        highs[n++] = edgeUs_[i + 1] - edgeUs_[i];
+      }
+    }
+    if (n < 40) return false;
+
+    uint8_t data[5] = {0, 0, 0, 0, 0};
+    for (uint8_t b = 0; b < 40; b++) {
+      if (highs[n - 40 + b] > DHT_BIT_THRESHOLD_US) data[b / 8] |= 0x80 >> (b % 8);
+    }
+    if ((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4]) return false;
+
+    humidity_ = ((data[0] << 8) | data[1]) * 0.1f;
+    temperature_ = (((data[2] & 0x7F) << 8) | data[3]) * 0.1f;
+    if (data[2] & 0x80) temperature_ = -temperature_;
+    return true;
+  }
+
+  uint8_t pin_;
+  State state_ = IDLE;
+  uint32_t stateUs_ = 0;
+  uint32_t nextReadMs_ = 0;
+
+  volatile uint32_t edgeUs_[DHT_MAX_EDGES];
+  volatile uint8_t edgeLevel_[DHT_MAX_EDGES];
+  volatile uint8_t edgeCount_ = 0;
+
+  bool valid_ = false;
+  float temperature_ = NAN;
+  float humidity_ = NAN;
+  uint32_t lastGoodMs_ = 0;
+  uint32_t reads_ = 0;
+  uint32_t errors_ = 0;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Buffer circular de tamaño fijo para tramas de sensores (store-and-forward).
+// Toda la memoria vive dentro de la instancia: no usa heap ni depende de
+// Arduino, así que puede compilarse también en el host.
+//
+// Cuando se llena descarta la trama más antigua y lo cuenta como overflow,
+// de modo que tras un corte largo se conservan las lecturas más recientes.
+template <size_t Capacity, size_t PayloadMax>
+class FrameStore {
+ public:
+  struct Frame {
+    uint32_t nodeId;
+    uint32_t rxMs;  // millis() del gateway al recibir la trama
+    uint16_t len;
+    char payload[PayloadMax + 1];
+  };
+
+  struct Stats {
+    uint32_t stored;     // tramas aceptadas
+    uint32_t drained;    // tramas entregadas con pop()
+    uint32_t overflow;   // tramas antiguas descartadas por buffer lleno
+    uint32_t tooLarge;   // tramas rechazadas por exceder PayloadMax
+    uint32_t highWater;  // ocupación máxima observada
+  };
+
+  bool push(uint32_t nodeId, uint32_t rxMs, const char* data, size_t len) {
+    if (len > PayloadMax) {
+      stats_.tooLarge++;
+      return false;
+    }
+    if (count_ == Capacity) {
+      head_ = next(head_);
+      count_--;
+      stats_.overflow++;
+    }
+    Frame& f = frames_[(head_ + count_) % Capacity];
+    f.nodeId = nodeId;
+    f.rxMs = rxMs;
+    f.len = (uint16_t)len;
+    memcpy(f.payload, data, len);
+    f.payload[len] = '\0';
+    count_++;
+    stats_.stored++;
+    if (count_ > stats_.highWater) stats_.highWater = count_;
+    return true;
+  }
+
+  // Trama más antigua, o nullptr si está vacío
+  const Frame* front() const {
+    return count_ ? &frames_[head_] : nullptr;
+  }
+
+  void pop() {
+    if (!count_) return;
+    head_ = next(head_);
+    count_--;
+    stats_.drained++;
+  }
+
+  size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  static constexpr size_t capacity() { return Capacity; }
+  const Stats& stats() const { return stats_; }
+
+ private:
+  static size_t next(size_t i) { return (i + 1) % Capacity; }
+
+  Frame frames_[Capacity];
+  size_t head_ = 0;
+  size_t count_ = 0;
+  Stats stats_ = {};
+};
@@ -3,6 +3,15 @@
 #include <WiFi.h>
 #include <painlessMesh.h>
 
+#include <atomic>
+
+#include "DeferredLog.h"
+#include "FrameStore.h"
+#include "MeshRejoin.h"
+#include "MqttReconnect.h"
+#include "SpscQueue.h"
+#include "WifiScan.h"
+
 #define MESH_PREFIX "RED_Nodos"
 #define MESH_PASSWORD "RED_Nodos_1023374689"
 #define MESH_PORT 5555
@@ -15,143 +24,771 @@
 #define MQTT_TOPIC "Nodos/datos"
 #define MQTT_TOPIC_CONTROL "Nodos/control"
 
+// Store-and-forward: tramas retenidas mientras MQTT no está disponible
+#define STORE_CAPACITY 128          // tramas en RAM (~25 KB)
+#define STORE_PAYLOAD_MAX 192       // bytes por trama de datos
+#define STORE_DRAIN_INTERVAL_MS 100 // ritmo de vaciado al volver MQTT
+#define STORE_DRAIN_BURST 5         // tramas por intervalo (~50 tramas/s)
+
+// Anuncio periódico del root para que los nodos envíen datos por unicast
+#define ROOT_ANNOUNCE_MS 30000
+
+// 1: las tramas binarias (SensorFrame) se publican como JSON, compatible con
+// Puente.py; 0: se publica el texto "#<base64>" tal cual llega del nodo
+#define MQTT_FRAME_FORMAT_JSON 1
+
+// 1: agrupar las tramas en un arreglo JSON publicado en Nodos/datos/batch
+// (un paquete MQTT cada MQTT_BATCH_MAX_MS o MQTT_BATCH_MAX_FRAMES tramas);
+// 0: una publicación por trama en Nodos/datos/<from>, como siempre
+#define MQTT_BATCH_MODE 0
+#define MQTT_BATCH_MAX_FRAMES 16
+#define MQTT_BATCH_MAX_MS 500
+#define MQTT_TOPIC_BATCH MQTT_TOPIC "/batch"
+// Peor caso: cada elemento agrega {"from":..,"age_ms":..,"data":".."} (~56 bytes)
+#define MQTT_BATCH_BUFFER (MQTT_BATCH_MAX_FRAMES * (STORE_PAYLOAD_MAX + 56) + 2)
+
+// Pipeline en dos núcleos: loop() atiende el mesh en el núcleo de Arduino (1)
+// y la tarea MQTT publica desde el núcleo 0, junto a la pila WiFi. Se comunican
+// sólo por colas SPSC, así un publish() lento no frena mesh.update().
+#define MQTT_TASK_CORE 0
+#define MQTT_TASK_STACK 8192
+#define MQTT_TASK_PRIORITY 1
+#define MQTT_TASK_PERIOD_MS 2
+#define MESH_QUEUE_SLOTS 32     // tramas mesh -> MQTT (~6 KB)
+#define REPLY_QUEUE_SLOTS 8     // respuestas de control mesh -> MQTT, con prioridad (~3 KB)
+#define CONTROL_REPLY_MAX 384   // bytes por respuesta, los del nodo (MeshNodeRuntime.h)
+#define CONTROL_QUEUE_SLOTS 8   // comandos MQTT -> mesh
+#define CONTROL_PAYLOAD_MAX 256
+
+// Topología: un TOPO_REQ con "to":0 (o al id de la gateway) se contesta desde
+// la caché de MeshTopology.h sin tocar el mesh; "flood":true fuerza el
+// broadcast de antes. Cada cambio del árbol se publica como TOPO_DIFF.
+#define TOPO_SETTLE_MS 500   // agrupa las ráfagas de changedConnections
+#define TOPO_QUEUE_SLOTS 2   // fotos del árbol mesh -> MQTT
+
+// Secuencia: el núcleo del mesh descarta las lecturas repetidas antes de
+// encolarlas (SeqWindow.h) y cada SEQ_REPORT_MS la tarea MQTT publica un
+// SEQ_STATS con recibidas, perdidas, repetidas, desordenadas y reinicios por nodo
+#define SEQ_TABLE_SLOTS 128  // nodos seguidos, 32 bytes c/u
+#define SEQ_REPORT_MS 60000
+#define SEQ_REPORT_MAX 64    // nodos por SEQ_STATS
+#define SEQ_QUEUE_SLOTS 2    // reportes mesh -> MQTT
+
+// Sin IP, loop() escanea redes cada WIFI_SCAN_PERIOD_MS (WifiScan.h) en modo
+// asíncrono para no dejar a mesh.update() sin correr; el último resultado va
+// al reporte de la gateway. Un hueco entre dos loop() mayor que
+// LOOP_GAP_WARN_MS se avisa por el log.
+#define SCAN_QUEUE_SLOTS 2   // estados de escaneo mesh -> MQTT
+#define LOOP_GAP_WARN_MS 100
+
+// Métricas (GatewayMetrics.h): el núcleo del mesh cuenta tramas y bytes por
+// nodo, el tiempo de cada loop() y la profundidad de la cola; cada
+// METRICS_INTERVAL_MS deja la foto a la tarea MQTT, que agrega la latencia de
+// publish(), los fallos y el heap, y la publica en MQTT_TOPIC_METRICS
+#define MQTT_TOPIC_METRICS "Nodos/metricas"
+#define METRICS_INTERVAL_MS 10000
+#define METRICS_NODE_SLOTS 128  // nodos seguidos, 16 bytes c/u
+#define METRICS_QUEUE_SLOTS 2   // fotos mesh -> MQTT (~2 KB c/u)
+
+// Pedidos de control (ControlTracker.h): la tarea MQTT registra cada PING,
+// TRACE, TOPO_REQ o REPORT_CFG que va al mesh por (tipo, destino, seq), no
+// reenvía los repetidos, limita los pedidos por destino y, con todas las
+// respuestas o a los CONTROL_TIMEOUT_MS, publica un único CTRL_RESULT
+#define CONTROL_TIMEOUT_MS 5000
+#define CONTROL_TRACK_SLOTS 32    // pedidos abiertos a la vez, 64 bytes c/u
+#define CONTROL_TRACK_TARGETS 32  // destinos con límite, 12 bytes c/u
+#define CONTROL_RESPONDER_SLOTS 256  // respuestas distintas entre los abiertos, 8 bytes c/u
+
+// Tramas, tópicos y mensajes propios, compartidos con gateway_linux.cpp. Va
+// después de la configuración: toma MQTT_TOPIC, STORE_PAYLOAD_MAX, etc.
+#include "GatewayCore.h"
+#include "GatewayMetrics.h"
+#include "ControlTracker.h"
+
 Scheduler userScheduler;
 painlessMesh mesh;
+
+// Propiedad del núcleo del mesh (loop y callbacks de painlessMesh)
+MeshLanes<REPLY_QUEUE_SLOTS, MESH_QUEUE_SLOTS> meshLanes; // productor
+SpscQueue<ControlFrame, CONTROL_QUEUE_SLOTS> controlQueue; // consumidor
+SpscQueue<TopoSnapshot, TOPO_QUEUE_SLOTS> topoQueue;     // productor
+SpscQueue<SeqReport, SEQ_QUEUE_SLOTS> seqQueue;          // productor
+SpscQueue<WifiScanStatus, SCAN_QUEUE_SLOTS> scanQueue;   // productor
+SpscQueue<MetricsSnapshot, METRICS_QUEUE_SLOTS> metricsQueue; // productor
+MeshMetrics<METRICS_NODE_SLOTS> meshMetrics;
+unsigned long lastMetrics = 0;
+SeqTable<SEQ_TABLE_SLOTS> seqTable;
+unsigned long lastSeqReport = 0;
+uint32_t meshTooLarge = 0;
+bool topoDirty = true;  // hay que mandar una foto nueva a la tarea MQTT
+unsigned long topoChangedMs = 0;
+
+// Propiedad de la tarea MQTT: ni painlessMesh ni PubSubClient son thread-safe
 WiFiClient espClient;
 PubSubClient client(espClient);
+FrameStore<STORE_CAPACITY, STORE_PAYLOAD_MAX> frameStore;
+TaskHandle_t mqttTaskHandle = nullptr;
+unsigned long firstPublishMs = 0;  // primera trama publicada desde el arranque
+MeshTopology topology;
+char topoJson[TOPO_JSON_MAX];
+WifiScanStatus lastScan = {};  // último escaneo visto por la tarea MQTT
+PublishMetrics publishMetrics;
+char metricsJson[METRICS_JSON_MAX];
+ControlTracker<CONTROL_TRACK_SLOTS, CONTROL_TRACK_TARGETS> controlTracker;
+char resultJson[CONTROL_RESULT_JSON_MAX];
+
+struct TopoStats {
+  uint32_t served;     // TOPO_REQ contestados con la foto completa
+  uint32_t unchanged;  // TOPO_REQ con el etag vigente
+  uint32_t diffs;      // TOPO_DIFF publicados
+  uint32_t failures;   // publicaciones fallidas (el suscriptor verá otro "base")
+};
+TopoStats topoStats = {};
+char seqJson[SEQ_JSON_MAX];
+
+// Canal y BSSID del router en NVS: el AP del mesh arranca ya en el canal del
+// router y los nodos no tienen que volver a buscarlo tras el cambio de canal
+MeshRejoin rejoin;
+bool rejoinSaved = false;
+
+// Estado publicado por un núcleo y sólo leído por el otro
+std::atomic<uint32_t> sharedStationIp{0};
+std::atomic<uint32_t> sharedNodeCount{0};
+std::atomic<bool> mqttUp{false};
+std::atomic<uint32_t> gatewayId{0};
 
 unsigned long lastIPReport = 0;
 unsigned long lastWifiRetry = 0;
-unsigned long lastWifiScan = 0;
-
-// Escaneo de redes para diagnosticar si el SSID está visible (2.4GHz)
-void scanAndReport() {
-  Serial.println("[WiFi] Escaneando redes...");
-  int n = WiFi.scanNetworks();
-  if (n <= 0) {
-    Serial.println("[WiFi] No se encontraron redes");
-    return;
-  }
-  bool seen = false;
-  for (int i = 0; i < n; i++) {
-    String ssid = WiFi.SSID(i);
-    int32_t rssi = WiFi.RSSI(i);
-    int32_t channel = WiFi.channel(i);
-    Serial.printf("  - %s (RSSI %d dBm, ch %d)\n", ssid.c_str(), rssi, channel);
-    if (ssid == WIFI_SSID) seen = true;
+unsigned long lastRootAnnounce = 0;
+MeshTime64 meshClock;  // vueltas de getNodeTime() que se anuncian en el ROOT
+
+// Escaneo de redes para diagnosticar si el SSID está visible (2.4GHz).
+// painlessMesh también escucha SCAN_DONE; cualquier resultado sirve
+struct ArduinoScanRadio {
+  bool start() { return WiFi.scanNetworks(true) == WIFI_SCAN_RUNNING; }
+  int16_t complete() { return WiFi.scanComplete(); }
+  bool entry(int16_t i, WifiNet& net) {
+    snprintf(net.ssid, sizeof(net.ssid), "%s", WiFi.SSID(i).c_str());
+    net.rssi = (int8_t)WiFi.RSSI(i);
+    net.channel = (uint8_t)WiFi.channel(i);
+    return true;
   }
-  if (!seen) {
-    Serial.println("[WiFi] ATENCIÓN: No se ve el SSID objetivo en el escaneo. Probablemente es 5GHz o canal no soportado. Fuerza el hotspot a 2.4GHz (canal 1/6/11) y sin aislamiento de clientes.");
+  void release() { WiFi.scanDelete(); }
+};
+ArduinoScanRadio scanRadio;
+WifiScanner<ArduinoScanRadio> wifiScanner(scanRadio, WIFI_SSID);
+
+void reportScan(const WifiScanStatus& st) {
+  if (st.result != WIFI_SCAN_OK) {
+    LOG_W("[WiFi] Escaneo fallido (%s) tras %u ms", wifiScanResultName(st.result), st.durationMs);
+  } else if (!st.targetSeen) {
+    LOG_W("[WiFi] ATENCIÓN: %u redes y ninguna es el SSID objetivo. Probablemente es 5GHz o canal no soportado. Fuerza el hotspot a 2.4GHz (canal 1/6/11) y sin aislamiento de clientes.",
+          st.networks);
   } else {
-    Serial.println("[WiFi] SSID objetivo detectado en el aire. Si no obtiene IP, revise DHCP/firewall del hotspot.");
+    LOG_I("[WiFi] SSID objetivo en el aire (RSSI %d dBm, ch %u). Si no obtiene IP, revise DHCP/firewall del hotspot.",
+          st.targetRssi, st.targetChannel);
+  }
+  if (WifiScanStatus* slot = scanQueue.claim()) {
+    *slot = st;
+    scanQueue.commit();
   }
 }
 
 // WiFi event logging (ESP32 Arduino >=2.x)
-void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t /*info*/) {
   switch (event) {
     case ARDUINO_EVENT_WIFI_STA_START:
-      Serial.println("[WiFi] STA start");
+      LOG_I("[WiFi] STA start");
       break;
     case ARDUINO_EVENT_WIFI_STA_CONNECTED:
-      Serial.println("[WiFi] Conectado al hotspot (ASSOCIATED)");
+      LOG_I("[WiFi] Conectado al hotspot (ASSOCIATED)");
       break;
     case ARDUINO_EVENT_WIFI_STA_GOT_IP:
-      Serial.printf("[WiFi] GOT_IP: %s\n", WiFi.localIP().toString().c_str());
+      LOG_I("[WiFi] GOT_IP: %s", WiFi.localIP().toString().c_str());
       break;
     case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
-      Serial.println("[WiFi] Desconectado del hotspot");
+      LOG_W("[WiFi] Desconectado del hotspot");
+      break;
+    case ARDUINO_EVENT_WIFI_SCAN_DONE:
+      wifiScanner.notifyDone();
       break;
     default:
       break;
   }
 }
 
-void reconnect() {
-  while (!client.connected()) {
-    Serial.print("Conectando a MQTT...");
-    String clientId = "ESP32Gateway-" + String(random(0xffff), HEX);
-    if (client.connect(clientId.c_str())) {
-      Serial.println("MQTT Conectado!");
+// Reconexión MQTT (MqttReconnect.h): un intento por vez, con backoff
+// exponencial y jitter, desde la tarea MQTT para que mesh.update() siga
+// corriendo mientras el broker está caído.
+#define MQTT_BACKOFF_MIN_MS 1000
+#define MQTT_BACKOFF_MAX_MS 60000
+#define MQTT_SOCKET_TIMEOUT_S 2
+
+struct ArduinoClock {
+  uint32_t operator()() const { return millis(); }
+};
+
+MqttReconnect<PubSubClient, ArduinoClock> mqttLink(client, ArduinoClock());
+char mqttClientId[24];
+
+// Llamado en cada vuelta de la tarea MQTT
+void mqttService() {
+  const MqttStats& st = mqttLink.stats();
+  switch (mqttLink.service(mqttClientId)) {
+    case MQTT_UP:
+      LOG_I("[MQTT] Conectado en %u ms (intento %u)", st.lastAttemptMs, st.attempts);
       client.subscribe(MQTT_TOPIC_CONTROL);
-      Serial.println("Suscrito a control");
+      LOG_I("[MQTT] Suscrito a control");
+      break;
+    case MQTT_ATTEMPT_FAILED:
+      LOG_W("[MQTT] Fallo rc=%d tras %u ms, reintento en %u ms", client.state(), st.lastAttemptMs,
+            mqttLink.lastWait());
+      break;
+    case MQTT_LOST:
+      LOG_W("[MQTT] Conexión perdida (rc=%d)", client.state());
+      break;
+    default:
+      break;
+  }
+}
+
+// Mensajes propios de la gateway (TOPO, TOPO_DIFF, SEQ_STATS) en MQTT_TOPIC_GATEWAY.
+// beginPublish() escribe directo al socket: la foto completa no necesita
+// agrandar el buffer de PubSubClient.
+bool publishRaw(const char* topic, const char* json, size_t len) {
+  if (!len || !client.connected()) return false;
+  if (!client.beginPublish(topic, len, false)) return false;
+  client.write((const uint8_t*)json, len);
+  return client.endPublish();
+}
+
+bool publishGateway(const char* json, size_t len) {
+  return publishRaw(MQTT_TOPIC_GATEWAY, json, len);
+}
+
+// TOPO_REQ desde la caché
+void answerTopology(const char* etag) {
+  bool same = *etag && topology.matches(etag);
+  size_t n = same ? topology.writeUnchanged(gatewayId.load(), topoJson, sizeof(topoJson))
+                  : topology.writeSnapshot(gatewayId.load(), topoJson, sizeof(topoJson));
+  if (!publishGateway(topoJson, n)) {
+    topoStats.failures++;
+    return;
+  }
+  if (same) {
+    topoStats.unchanged++;
+  } else {
+    topoStats.served++;
+  }
+  LOG_D("[TOPO] TOPO_REQ contestado desde la caché (versión %u%s)", topology.version(), same ? ", sin cambios" : "");
+}
+
+// Tarea MQTT: incorpora las fotos que deja el mesh y publica el diff de cada
+// cambio. Si MQTT está caído el diff se pierde; el siguiente trae otro "base"
+// y el suscriptor pide la foto completa.
+void updateTopology() {
+  while (TopoSnapshot* s = topoQueue.front()) {
+    bool changed = topology.update(*s);
+    topoQueue.release();
+    if (!changed) continue;
+    size_t n = topology.writeDiff(gatewayId.load(), topoJson, sizeof(topoJson));
+    if (publishGateway(topoJson, n)) {
+      topoStats.diffs++;
     } else {
-      Serial.printf("Fallo MQTT, rc=%d reintentando en 5s\n", client.state());
-      delay(5000);
+      topoStats.failures++;
     }
+    LOG_I("[TOPO] Versión %u: %u nodos%s", topology.version(), (unsigned)topology.current().count + 1,
+          topology.current().truncated ? " (truncada)" : "");
   }
 }
 
-void mqttCallback(char* topic, byte* payload, unsigned int length) {
-  String msg;
-  for (int i = 0; i < length; i++) {
-    msg += (char)payload[i];
+// Tarea MQTT: publica el reporte de secuencia que deja el mesh (SEQ_STATS)
+void publishSeqStats() {
+  while (SeqReport* r = seqQueue.front()) {
+    SeqTotals t;
+    size_t n = gatewaySeqStatsJson(*r, gatewayId.load(), seqJson, sizeof(seqJson), t);
+    bool ok = publishGateway(seqJson, n);
+    LOG_I("[SEQ] nodos=%u recibidas=%u perdidas=%u repetidas=%u%s", (unsigned)r->tracked, t.received, t.lost,
+          t.duplicates, ok ? "" : " (SEQ_STATS sin publicar)");
+    seqQueue.release();
   }
-  Serial.printf("MQTT Control recibido: %s\n", msg.c_str());
-  
-  // Forward to mesh
-  StaticJsonDocument<200> doc;
-  DeserializationError err = deserializeJson(doc, msg);
-  
-  if (err == DeserializationError::Ok) {
-    uint32_t to = doc["to"];
-    if (to == 0) {
+}
+
+// Tarea MQTT: completa la foto del mesh con publish() y heap y la publica.
+// Sin MQTT la foto se descarta pero los contadores de publish() siguen
+// sumando hasta la próxima que salga.
+void publishMetricsSnapshot() {
+  while (MetricsSnapshot* s = metricsQueue.front()) {
+    HeapSample heap = {ESP.getFreeHeap(), ESP.getMinFreeHeap(), ESP.getMaxAllocHeap()};
+    size_t n = gatewayMetricsJson(*s, publishMetrics, heap, frameStore.size(), gatewayId.load(), metricsJson,
+                                  sizeof(metricsJson));
+    if (publishRaw(MQTT_TOPIC_METRICS, metricsJson, n)) publishMetrics.reset();
+    metricsQueue.release();
+  }
+}
+
+// Tarea MQTT: CTRL_RESULT de un pedido cerrado, en MQTT_TOPIC_GATEWAY
+void publishControlResult(const ControlRequest& r, ControlStatus status) {
+  size_t n = controlResultJson(r, status, gatewayId.load(), millis(), resultJson, sizeof(resultJson));
+  bool ok = publishGateway(resultJson, n);
+  LOG_D("[CTRL] %s a %u seq=%u: %s (%u/%u)%s", controlTypeName((ControlType)r.type), r.target, r.seq,
+        controlStatusName(status), r.answered, r.expected, ok ? "" : " (sin publicar)");
+}
+
+// Tarea MQTT: suma la respuesta a su pedido; la trama se publica igual
+void trackReply(const MeshReplyFrame& f) {
+  ControlType type = controlClassify(f.payload, f.len);
+  controlTracker.reply(type, f.nodeId, controlUint(f.payload, f.len, "seq"), f.rxMs, publishControlResult);
+}
+
+// Corre dentro de client.loop(), en la tarea MQTT: no toca el mesh, sólo
+// deja el comando en controlQueue para que loop() lo reenvíe. Un pedido
+// repetido o por encima del límite del destino no sale (ControlTracker.h).
+// Los campos se leen con ControlDispatch.h sobre el buffer de PubSubClient,
+// que no se modifica: lo que sale al mesh son los bytes publicados.
+void mqttCallback(char* /*topic*/, byte* payload, unsigned int length) {
+  const char* msg = (const char*)payload;
+  LOG_D("MQTT Control recibido: %s", logSpan(msg, length));
+
+  char etag[TOPO_ETAG_MAX];
+  if (gatewayTopologyRequest(msg, length, gatewayId.load(), etag)) {
+    answerTopology(etag);
+    return;
+  }
+  if (!gatewayControlValid(msg, length)) {
+    LOG_W("[COLA] Control de %u bytes descartado (no es un objeto o max %u)", length, CONTROL_PAYLOAD_MAX);
+    return;
+  }
+  ControlFrame* c = controlQueue.claim();
+  if (!c) {
+    LOG_W("[COLA] Cola de control llena, comando descartado");
+    return;
+  }
+  ControlType type = controlClassify(msg, length);
+  uint32_t to = controlUint(msg, length, "to");
+  uint32_t seq = controlUint(msg, length, "seq");
+  uint16_t expected = controlExpected(type, to, topology.current().count);
+  switch (controlTracker.request(type, to, seq, expected, millis())) {
+    case CONTROL_DUPLICATE:
+      LOG_D("[CTRL] %s a %u seq=%u repetido, no se reenvía", controlTypeName(type), to, seq);
+      return;  // el slot reclamado queda libre sin commit()
+    case CONTROL_RATE_LIMITED: {
+      LOG_W("[CTRL] %s a %u descartado: límite del destino", controlTypeName(type), to);
+      ControlRequest r = {};
+      r.type = type;
+      r.target = to;
+      r.seq = seq;
+      r.sentMs = millis();
+      r.expected = expected;
+      publishControlResult(r, CONTROL_LIMITED);
+      return;
+    }
+    default:
+      break;
+  }
+  gatewayControlFrame(msg, length, micros(), *c);
+  controlQueue.commit();
+}
+
+// Núcleo del mesh: reenvía los comandos que dejó la tarea MQTT, sellando
+// gw_in (llegada por MQTT) y gw_tx (salida al mesh) en tiempo del mesh
+void forwardControl() {
+  while (ControlFrame* c = controlQueue.front()) {
+    char buf[CONTROL_PAYLOAD_MAX + 48];
+    uint32_t gwTx = mesh.getNodeTime();
+    uint32_t gwIn = gwTx - (micros() - c->rxUs);
+    gatewayStampControl(*c, gwIn, gwTx, buf, sizeof(buf));
+    String msg(buf);
+    if (c->to == 0) {
       mesh.sendBroadcast(msg);
-      Serial.println("Enviado Broadcast a Mesh");
+      LOG_I("Enviado Broadcast a Mesh");
     } else {
-      mesh.sendSingle(to, msg);
-      Serial.printf("Enviado Unicast a %u\n", to);
+      mesh.sendSingle(c->to, msg);
+      LOG_I("Enviado Unicast a %u", c->to);
     }
+    controlQueue.release();
+  }
+}
+
+// Publica una trama en Nodos/datos/<from>. Con extra (p.ej. "age_ms":N en las
+// tramas diferidas, o los sellos de latencia) se agrega al final del objeto.
+bool publishFrame(uint32_t from, const char* payload, size_t len, const char* extra) {
+  char topic[GATEWAY_TOPIC_MAX];
+  gatewayFrameTopic(from, topic, sizeof(topic));
+  char buf[GATEWAY_FRAME_TEXT_MAX];
+  payload = gatewayFramePayload(payload, len, extra, buf, sizeof(buf));
+  if (!payload) return false;
+  bool ok = client.publish(topic, (const uint8_t*)payload, len);
+  if (ok && !firstPublishMs) firstPublishMs = millis();
+  return ok;
+}
+
+#if MQTT_BATCH_MODE
+struct BatchStats {
+  uint32_t published;  // paquetes enviados a Nodos/datos/batch
+  uint32_t frames;     // tramas incluidas en ellos
+  uint32_t bytes;      // bytes de payload publicados
+  uint32_t failures;   // lotes devueltos al buffer por fallo de publish()
+};
+
+MeshFrame batchFrames[MQTT_BATCH_MAX_FRAMES];
+size_t batchCount = 0;
+unsigned long batchOpenedMs = 0;
+char batchBuf[MQTT_BATCH_BUFFER];
+BatchStats batchStats = {};
+
+template <typename Frame>
+void storeFrame(const Frame& f);
+
+// Publica el lote como [{"from":id,"age_ms":n,"data":{...}},...]. La
+// antigüedad se calcula aquí, así la espera del lote no altera el timestamp
+// que reconstruye Puente.py. Si falla, las tramas pasan al store-and-forward.
+void flushBatch() {
+  if (!batchCount) return;
+  char json[STORE_PAYLOAD_MAX + 1];
+  size_t n = 0;
+  batchBuf[n++] = '[';
+  for (size_t i = 0; i < batchCount; i++) {
+    const MeshFrame& f = batchFrames[i];
+    size_t len = f.len;
+    const char* text = gatewayFrameText(f.payload, len, json, sizeof(json));
+    if (!text) continue;
+    const char* quote = text[0] == '{' ? "" : "\"";
+    int w = snprintf(batchBuf + n, sizeof(batchBuf) - n, "%s{\"from\":%u,\"age_ms\":%u,\"data\":%s%.*s%s}",
+                     n > 1 ? "," : "", f.nodeId, (uint32_t)(millis() - f.rxMs),
+                     quote, (int)len, text, quote);
+    if (w < 0 || n + w >= sizeof(batchBuf) - 1) break;
+    n += w;
+  }
+  batchBuf[n++] = ']';
+
+  bool ok = client.publish(MQTT_TOPIC_BATCH, (const uint8_t*)batchBuf, n);
+  for (size_t i = 0; i < batchCount; i++) publishMetrics.published(LANE_DATA, ok, micros() - batchFrames[i].rxUs);
+  if (ok) {
+    if (!firstPublishMs) firstPublishMs = millis();
+    batchStats.published++;
+    batchStats.frames += batchCount;
+    batchStats.bytes += n;
   } else {
-    Serial.println("Error parseando JSON de control");
+    batchStats.failures++;
+    LOG_E("[BATCH] Error al publicar lote de %u tramas, se retienen", (unsigned)batchCount);
+    for (size_t i = 0; i < batchCount; i++) storeFrame(batchFrames[i]);
   }
+  batchCount = 0;
 }
 
-void receivedCallback(uint32_t from, String &msg) {
-  Serial.printf("Datos recibidos desde nodo %u: %s\n", from, msg.c_str());
+void batchFrame(const MeshFrame& f) {
+  if (batchCount == 0) batchOpenedMs = millis();
+  batchFrames[batchCount++] = f;
+  if (batchCount == MQTT_BATCH_MAX_FRAMES) flushBatch();
+}
+#endif
+
+// Vacía el buffer en orden y a ritmo controlado una vez que MQTT vuelve
+void drainFrameStore() {
+  static unsigned long lastDrain = 0;
+  if (frameStore.empty() || !client.connected()) return;
+  if (millis() - lastDrain < STORE_DRAIN_INTERVAL_MS) return;
+  lastDrain = millis();
 
-  if (client.connected()) {
-    String topic = String(MQTT_TOPIC) + "/" + String(from);
-    if (client.publish(topic.c_str(), msg.c_str())) {
-      Serial.println("Publicado en MQTT: " + msg);
+  // Una respuesta de control que llega mientras tanto no espera a la ráfaga
+  for (int i = 0; i < STORE_DRAIN_BURST && !frameStore.empty() && !meshLanes.controlPending(); i++) {
+    auto* f = frameStore.front();
+    uint32_t ageMs = millis() - f->rxMs;
+    char extra[24];
+    snprintf(extra, sizeof(extra), "\"age_ms\":%u", ageMs);
+    bool ok = publishFrame(f->nodeId, f->payload, f->len, extra);
+    publishMetrics.published(LANE_DATA, ok, ageMs < UINT32_MAX / 1000 ? ageMs * 1000 : UINT32_MAX);
+    if (!ok) {
+      LOG_E("[STORE] Error al publicar trama diferida, se reintenta luego");
+      return;
+    }
+    frameStore.pop();
+  }
+  if (frameStore.empty()) {
+    LOG_I("[STORE] Buffer vaciado (entregadas=%u, overflow=%u)",
+          frameStore.stats().drained, frameStore.stats().overflow);
+  }
+}
+
+// Una respuesta de control más larga que STORE_PAYLOAD_MAX no se retiene
+template <typename Frame>
+void storeFrame(const Frame& f) {
+  if (frameStore.push(f.nodeId, f.rxMs, f.payload, f.len)) {
+    LOG_I("[STORE] Trama de %u retenida (%u/%u)",
+          f.nodeId, (unsigned)frameStore.size(), (unsigned)frameStore.capacity());
+  } else if (f.len > STORE_PAYLOAD_MAX) {
+    LOG_W("[STORE] Respuesta de %u sin retener: %u bytes > %u", f.nodeId, f.len, STORE_PAYLOAD_MAX);
+  }
+}
+
+// Tarea MQTT: saca las tramas de los carriles y las publica, o las retiene
+// si MQTT no está disponible. Antes de cada trama de datos se mira el carril
+// de control, así una respuesta espera como mucho un publish(). Con tramas
+// de datos retenidas las nuevas se encolan detrás para conservar el orden;
+// las respuestas no tienen orden que conservar y salen igual.
+void forwardMeshFrames() {
+  for (;;) {
+    if (MeshReplyFrame* r = meshLanes.frontReply()) {
+      trackReply(*r);
+      if (client.connected()) {
+        // Las respuestas de control no esperan al lote; gw_out se deriva de
+        // gw_rx porque getNodeTime() no se puede llamar desde este núcleo
+        char extra[GATEWAY_STAMP_MAX];
+        snprintf(extra, sizeof(extra), "\"gw_rx\":%u,\"gw_out\":%u",
+                 r->rxNodeUs, r->rxNodeUs + (uint32_t)(micros() - r->rxUs));
+        bool ok = publishFrame(r->nodeId, r->payload, r->len, extra);
+        publishMetrics.published(LANE_CONTROL, ok, micros() - r->rxUs);
+        if (!ok) storeFrame(*r);
+      } else {
+        storeFrame(*r);
+      }
+      meshLanes.release(LANE_CONTROL);
+      continue;
+    }
+    MeshFrame* f = meshLanes.frontData();
+    if (!f) return;
+    if (client.connected() && frameStore.empty()) {
+#if MQTT_BATCH_MODE
+      batchFrame(*f);
+#else
+      bool ok = publishFrame(f->nodeId, f->payload, f->len, nullptr);
+      publishMetrics.published(LANE_DATA, ok, micros() - f->rxUs);
+      if (ok) {
+        LOG_D("Publicado en MQTT: %s", f->payload);
+      } else {
+        LOG_E("Error al publicar en MQTT");
+        storeFrame(*f);
+      }
+#endif
     } else {
-      Serial.println("Error al publicar en MQTT");
+      storeFrame(*f);
     }
-  } else {
-    Serial.println("MQTT desconectado - reintentando...");
+    meshLanes.release(LANE_DATA);
+  }
+}
+
+// Núcleo del mesh: true si la lectura ya había llegado (SeqWindow.h)
+bool duplicateReading(uint32_t from, const char* msg, size_t len) {
+  uint32_t seq = 0;
+  SeqVerdict v = gatewayAcceptReading(seqTable, from, msg, len, &seq);
+  if (v == SEQ_RESTART) LOG_I("[SEQ] Nodo %u reinició (seq=%u)", from, seq);
+  return v == SEQ_DUPLICATE;
+}
+
+// Núcleo del mesh: cada SEQ_REPORT_MS copia los contadores para la tarea MQTT
+void reportSeq() {
+  if (millis() - lastSeqReport < SEQ_REPORT_MS) return;
+  SeqReport* r = seqQueue.claim();
+  if (!r) return;  // la tarea MQTT aún no publicó el anterior
+  lastSeqReport = millis();
+  gatewaySeqReport(seqTable, *r);
+  seqQueue.commit();
+}
+
+// Núcleo del mesh: cada METRICS_INTERVAL_MS copia la ventana para la tarea MQTT
+void reportMetrics() {
+  if (millis() - lastMetrics < METRICS_INTERVAL_MS) return;
+  MetricsSnapshot* s = metricsQueue.claim();
+  if (!s) return;  // la tarea MQTT aún no publicó la anterior
+  lastMetrics = millis();
+  meshMetrics.snapshot(lastMetrics, *s);
+  s->queueFull[LANE_DATA] = meshLanes.stats(LANE_DATA).failures;
+  s->queueFull[LANE_CONTROL] = meshLanes.stats(LANE_CONTROL).failures;
+  metricsQueue.commit();
+}
+
+// Núcleo del mesh: sólo copia la trama a un slot libre de su carril. Las
+// respuestas de control van al carril prioritario (controlClassify mira sólo
+// el "type")
+void receivedCallback(uint32_t from, String &msg) {
+  LOG_D("Datos recibidos desde nodo %u: %s", from, msg.c_str());
+  meshMetrics.frame(from, msg.length(), millis());
+
+  ControlType type = controlClassify(msg.c_str(), msg.length());
+  GatewayLane lane = gatewayLane(type);
+  if (msg.length() > gatewayLaneMax(lane)) {
+    meshTooLarge++;
+    LOG_W("[COLA] Trama de %u descartada: %u bytes > %u",
+          from, msg.length(), (unsigned)gatewayLaneMax(lane));
+    return;
+  }
+  if (type == CTRL_DATA && duplicateReading(from, msg.c_str(), msg.length())) {
+    LOG_D("[SEQ] Lectura repetida de %u descartada", from);
+    return;
+  }
+  uint32_t rxNodeUs = lane == LANE_CONTROL ? mesh.getNodeTime() : 0;
+  if (!meshLanes.push(lane, from, millis(), micros(), rxNodeUs, msg.c_str(), msg.length())) {
+    LOG_W("[COLA] Carril de %s lleno, trama de %u descartada", lane == LANE_CONTROL ? "control" : "datos", from);
+    return;
+  }
+  meshMetrics.queueDepth(lane, meshLanes.size(lane));
+}
+
+// Tarea MQTT: IP de la gateway cada 60 segundos, con datos que deja el mesh
+void reportGateway() {
+  if (millis() - lastIPReport <= 60000) return;
+  lastIPReport = millis();
+  IPAddress ip(sharedStationIp.load());
+  if (!client.connected()) return;
+
+  StaticJsonDocument<384> doc;
+  doc["nodeId"] = "gateway";
+  doc["ip"] = ip.toString();
+  doc["nodes"] = sharedNodeCount.load();
+  doc["ttf_ms"] = firstPublishMs;  // arranque -> primera trama publicada
+  doc["rejoin"] = rejoinPathName(rejoin.path());
+  char etag[TOPO_ETAG_MAX];
+  topology.etag(etag, topology.version());
+  doc["topo"] = etag;  // quien se perdió un TOPO_DIFF lo nota acá
+  while (WifiScanStatus* st = scanQueue.front()) {
+    lastScan = *st;
+    scanQueue.release();
+  }
+  if (lastScan.scans) {
+    // Diagnóstico del último escaneo sin IP: cuánto hace, si se veía el SSID
+    JsonObject scan = doc.createNestedObject("scan");
+    scan["age_ms"] = millis() - lastScan.completedMs;
+    scan["result"] = wifiScanResultName(lastScan.result);
+    scan["nets"] = lastScan.networks;
+    scan["seen"] = lastScan.targetSeen;
+    if (lastScan.targetSeen) {
+      scan["rssi"] = lastScan.targetRssi;
+      scan["ch"] = lastScan.targetChannel;
+    }
+    scan["fails"] = lastScan.failures;
+  }
+
+  String payload;
+  serializeJson(doc, payload);
+
+  if (client.publish(MQTT_TOPIC_GATEWAY, payload.c_str())) {
+    LOG_I("[IP] IP enviada via MQTT: %s", ip.toString().c_str());
   }
 }
 
+void mqttTask(void*) {
+  unsigned long lastStatus = 0;
+  for (;;) {
+    bool online = sharedStationIp.load() != 0;
+    if (online) mqttService();
+    mqttUp.store(client.connected());
+
+#if MQTT_BATCH_MODE
+    // Al caer MQTT el lote abierto va al buffer antes que las tramas nuevas
+    if (batchCount && (!client.connected() || millis() - batchOpenedMs >= MQTT_BATCH_MAX_MS)) {
+      flushBatch();
+    }
+#endif
+    forwardMeshFrames();
+    updateTopology();
+    publishSeqStats();
+    publishMetricsSnapshot();
+    controlTracker.expire(millis(), publishControlResult);
+    if (online) {
+      drainFrameStore();
+      reportGateway();
+    }
+
+    if (millis() - lastStatus > 30000) {
+      lastStatus = millis();
+      const MqttStats& ms = mqttLink.stats();
+      LOG_I("[MQTT] intentos=%u fallos=%u ultimo=%u ms max=%u ms total=%u ms",
+            ms.attempts, ms.failures, ms.lastAttemptMs, ms.maxAttemptMs, ms.totalAttemptMs);
+      auto& st = frameStore.stats();
+      LOG_I("[STORE] pendientes=%u max=%u retenidas=%u entregadas=%u overflow=%u grandes=%u",
+            (unsigned)frameStore.size(), st.highWater, st.stored, st.drained,
+            st.overflow, st.tooLarge);
+#if MQTT_BATCH_MODE
+      LOG_I("[BATCH] lotes=%u tramas=%u bytes=%u fallos=%u",
+            batchStats.published, batchStats.frames, batchStats.bytes, batchStats.failures);
+#endif
+      LOG_I("[TOPO] versión=%u consultas=%u sin cambios=%u diffs=%u fallos=%u",
+            topology.version(), topoStats.served, topoStats.unchanged, topoStats.diffs, topoStats.failures);
+      const ControlTrackerStats& ct = controlTracker.stats();
+      LOG_I("[CTRL] abiertos=%u ok=%u parciales=%u vencidos=%u repetidos=%u limitados=%u sin_seguir=%u huerfanas=%u "
+            "resp_repetidas=%u sin_descartar=%u",
+            (unsigned)controlTracker.size(), ct.done, ct.partial, ct.timeouts, ct.duplicates, ct.limited,
+            ct.untracked, ct.orphans, ct.repeated, ct.unchecked);
+      LOG_I("[MQTT] pila libre min=%u bytes", uxTaskGetStackHighWaterMark(nullptr));
+    }
+    vTaskDelay(pdMS_TO_TICKS(MQTT_TASK_PERIOD_MS));
+  }
+}
+
+// Los nodos aprenden el ID del root y las vueltas del tiempo del mesh con
+// este mensaje (gatewayRootMessage)
+void announceRoot() {
+  lastRootAnnounce = millis();
+  char buf[96];
+  if (!gatewayRootMessage(mesh.getNodeId(), meshClock.at(mesh.getNodeTime(), lastRootAnnounce), buf, sizeof(buf))) return;
+  String msg(buf);
+  mesh.sendBroadcast(msg);
+}
+
+// Foto del árbol para la tarea MQTT, cuando las conexiones llevan
+// TOPO_SETTLE_MS quietas (un nodo que entra dispara varias en ráfaga)
+void snapshotTopology() {
+  if (!topoDirty || millis() - topoChangedMs < TOPO_SETTLE_MS) return;
+  TopoSnapshot* s = topoQueue.claim();
+  if (!s) return;  // la tarea MQTT aún no consumió las anteriores
+  String json = mesh.subConnectionJson();
+  topoParse(json.c_str(), json.length(), mesh.getNodeId(), *s);
+  topoQueue.commit();
+  topoDirty = false;
+}
+
 void changedConnectionCallback() {
-  Serial.printf("Conexiones cambiadas. Nodos actuales: %d\n", mesh.getNodeList().size());
+  LOG_I("Conexiones cambiadas. Nodos actuales: %d", mesh.getNodeList().size());
+  announceRoot();
+  topoDirty = true;
+  topoChangedMs = millis();
   
   auto nodes = mesh.getNodeList();
   if (nodes.size() > 0) {
-    Serial.print("Nodos conectados: ");
+    char list[LOG_ARGS_MAX];
+    size_t n = 0;
     for (auto node : nodes) {
-      Serial.printf("%u ", node);
+      int w = snprintf(list + n, sizeof(list) - n, "%u ", node);
+      if (w < 0 || (size_t)w >= sizeof(list) - n) break;
+      n += w;
     }
-    Serial.println();
+    list[n] = '\0';
+    LOG_I("Nodos conectados: %s", list);
   } else {
-    Serial.println("No hay nodos conectados al mesh");
+    LOG_I("No hay nodos conectados al mesh");
   }
 }
 
 void newConnectionCallback(uint32_t nodeId) {
-  Serial.printf("Nueva conexión mesh, nodeId = %u\n", nodeId);
-  Serial.printf("Total nodos conectados: %d\n", mesh.getNodeList().size());
+  LOG_I("Nueva conexión mesh, nodeId = %u", nodeId);
+  LOG_I("Total nodos conectados: %d", mesh.getNodeList().size());
 }
 
 void setup() {
   Serial.begin(115200);
+  logBegin();
   delay(1000);
-  Serial.println("=== INICIANDO ESP32 GATEWAY ===");
+  LOG_I("=== INICIANDO ESP32 GATEWAY ===");
 
   client.setServer(MQTT_SERVER, MQTT_PORT);
   client.setCallback(mqttCallback);
+  // Acotar cuánto puede bloquear un connect()/lectura contra un broker caído
+  client.setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
+  snprintf(mqttClientId, sizeof(mqttClientId), "ESP32Gateway-%x", (unsigned)(esp_random() & 0xffff));
+  mqttLink.seed(esp_random());
+  // El buffer por defecto de PubSubClient (256 bytes) no alcanza para un lote
+  // ni para una respuesta de control con sellos (TRACE_REPLY, TOPO)
+#if MQTT_BATCH_MODE
+  static_assert(MQTT_BATCH_BUFFER + sizeof(MQTT_TOPIC_BATCH) + 8 >= GATEWAY_PUBLISH_MAX, "lote menor que una respuesta");
+  client.setBufferSize(MQTT_BATCH_BUFFER + sizeof(MQTT_TOPIC_BATCH) + 8);
+#else
+  client.setBufferSize(GATEWAY_PUBLISH_MAX);
+#endif
 
+  uint8_t channel = rejoin.begin(WIFI_SSID);
   mesh.setDebugMsgTypes(ERROR | STARTUP | CONNECTION);
-  mesh.init(MESH_PREFIX, MESH_PASSWORD, &userScheduler, MESH_PORT);
+  mesh.init(MESH_PREFIX, MESH_PASSWORD, &userScheduler, MESH_PORT, WIFI_AP_STA, channel);
 
   // Actuar como ROOT del mesh para permitir uso de estación WiFi
   mesh.setRoot(true);
@@ -168,59 +805,75 @@ void setup() {
   // Recomendación: evitar ahorro de energía que puede retrasar la asociación
   WiFi.setSleep(false);
   
-  Serial.printf("NODE ID: %u\n", mesh.getNodeId());
-  Serial.println("Gateway configurado - Esperando conexiones mesh...");
+  LOG_I("NODE ID: %u", mesh.getNodeId());
+  gatewayId.store(mesh.getNodeId());
+  topology = MeshTopology(esp_random());  // etag distinto en cada arranque
+
+  // Desde aquí el cliente MQTT pertenece a la tarea del otro núcleo
+  if (xTaskCreatePinnedToCore(mqttTask, "mqtt", MQTT_TASK_STACK, nullptr,
+                              MQTT_TASK_PRIORITY, &mqttTaskHandle, MQTT_TASK_CORE) != pdPASS) {
+    LOG_E("[MQTT] ERROR: no se pudo crear la tarea MQTT");
+  }
+  LOG_I("Gateway configurado - Esperando conexiones mesh...");
 }
 
 void loop() {
   static unsigned long lastStatus = 0;
+  static uint32_t lastLoopUs = micros();
+  static uint32_t loopGapMaxUs = 0;
+  uint32_t loopUs = micros();
+  uint32_t gapUs = loopUs - lastLoopUs;
+  lastLoopUs = loopUs;
+  if (gapUs > loopGapMaxUs) loopGapMaxUs = gapUs;
+  meshMetrics.loopTime(gapUs);
+  if (gapUs > LOOP_GAP_WARN_MS * 1000UL) LOG_W("[LOOP] hueco de %u ms sin mesh.update()", gapUs / 1000);
+
   mesh.update();
-  
-  // Solo intentar MQTT si hay conexión WiFi
-  if(mesh.getStationIP() != IPAddress(0,0,0,0)) {
-    if (!client.connected()) {
-      reconnect();
-    }
-    client.loop();
-  } else {
-    // Si aún no hay IP, emitir diagnóstico periódico
+  forwardControl();
+  snapshotTopology();
+  reportSeq();
+  reportMetrics();
+
+  if (millis() - lastRootAnnounce > ROOT_ANNOUNCE_MS) {
+    announceRoot();
+  }
+
+  IPAddress stationIp = mesh.getStationIP();
+  sharedStationIp.store((uint32_t)stationIp);
+  sharedNodeCount.store(mesh.getNodeList().size());
+
+  // Con IP, guardar el enlace al router para el próximo arranque
+  bool hasIp = stationIp != IPAddress(0,0,0,0);
+  if (hasIp && !rejoinSaved) {
+    rejoin.remember(WiFi.channel(), WiFi.BSSID(), mesh.getNodeId());
+  }
+  rejoinSaved = hasIp;
+
+  // Sin IP la tarea MQTT queda en espera; emitir diagnóstico periódico
+  if (!hasIp) {
     if (millis() - lastWifiRetry > 5000) {
       lastWifiRetry = millis();
-      Serial.println("[WiFi] Aún sin IP (0.0.0.0). Verifique que el hotspot sea 2.4GHz y SSID/clave coincidan.");
-    }
-    if (millis() - lastWifiScan > 15000) {
-      lastWifiScan = millis();
-      scanAndReport();
+      LOG_W("[WiFi] Aún sin IP (0.0.0.0). Verifique que el hotspot sea 2.4GHz y SSID/clave coincidan.");
     }
   }
+  // Nunca bloquea: arranca el escaneo o recoge el que avisó SCAN_DONE
+  if (wifiScanner.poll(millis(), !hasIp)) reportScan(wifiScanner.status());
 
   if (millis() - lastStatus > 30000) {
     lastStatus = millis();
-    IPAddress ip = mesh.getStationIP();
-    Serial.printf("Estado: IP=%s, Nodos=%d, MQTT=%s\n", 
-                  ip.toString().c_str(), 
-                  mesh.getNodeList().size(),
-                  client.connected() ? "BIEN" : "MAL");
+    LOG_I("Estado: IP=%s, Nodos=%d, MQTT=%s", 
+          stationIp.toString().c_str(), 
+          mesh.getNodeList().size(),
+          mqttUp.load() ? "BIEN" : "MAL");
+    auto mq = meshLanes.stats(LANE_DATA);
+    auto rq = meshLanes.stats(LANE_CONTROL);
+    auto cq = controlQueue.stats();
+    LOG_I("[COLA] datos: prof=%u max=%u/%u encoladas=%u llenas=%u grandes=%u | respuestas: max=%u/%u llenas=%u | "
+          "control: max=%u llenas=%u",
+          (unsigned)meshLanes.size(LANE_DATA), mq.highWater, (unsigned)meshLanes.capacity(LANE_DATA),
+          mq.pushed, mq.failures, meshTooLarge, rq.highWater, (unsigned)meshLanes.capacity(LANE_CONTROL),
+          rq.failures, cq.highWater, cq.failures);
+    LOG_I("[LOOP] hueco max=%u us", loopGapMaxUs);
+    loopGapMaxUs = 0;
   }
-  
-  // Enviar IP del gateway cada 60 segundos via MQTT
-  if (millis() - lastIPReport > 60000) {
-    lastIPReport = millis();
-    IPAddress ip = mesh.getStationIP();
-    
-    if (ip != IPAddress(0,0,0,0) && client.connected()) {
-      StaticJsonDocument<200> doc;
-      doc["nodeId"] = "gateway";
-      doc["ip"] = ip.toString();
-      doc["nodes"] = mesh.getNodeList().size();
-      
-      String payload;
-      serializeJson(doc, payload);
-      
-      String topic = String(MQTT_TOPIC) + "/gateway";
-      if (client.publish(topic.c_str(), payload.c_str())) {
-        Serial.printf("[IP] IP enviada via MQTT: %s\n", ip.toString().c_str());
-      }
-    }
-  }
-}
\ No newline at end of file
+}
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ControlDispatch.h"
+#include "MeshTime.h"
+#include "MeshTopology.h"
+#include "SensorFrame.h"
+#include "SeqWindow.h"
+#include "SpscQueue.h"
+
+// Lógica de la gateway que no depende de la plataforma. La comparten
+// GATEWAY.cpp (ESP32: FreeRTOS + PubSubClient) y gateway_linux.cpp (Linux:
+// painlessMesh sobre boost::asio + libmosquitto). Cada build pone el mesh, el
+// cliente MQTT y los hilos; aquí quedan las tramas, los tópicos y los
+// mensajes propios de la gateway.
+//
+// C++ puro sin Arduino.
+
+#ifndef MQTT_TOPIC
+#define MQTT_TOPIC "Nodos/datos"
+#endif
+#ifndef MQTT_TOPIC_CONTROL
+#define MQTT_TOPIC_CONTROL "Nodos/control"
+#endif
+#define MQTT_TOPIC_GATEWAY MQTT_TOPIC "/gateway"
+#ifndef MQTT_FRAME_FORMAT_JSON  // ver GATEWAY.cpp
+#define MQTT_FRAME_FORMAT_JSON 1
+#endif
+#ifndef STORE_PAYLOAD_MAX
+#define STORE_PAYLOAD_MAX 192  // bytes por trama de datos
+#endif
+#ifndef CONTROL_REPLY_MAX
+#define CONTROL_REPLY_MAX 384  // respuesta de control de un nodo, igual que en MeshNodeRuntime.h
+#endif
+#ifndef CONTROL_PAYLOAD_MAX
+#define CONTROL_PAYLOAD_MAX 256
+#endif
+#ifndef SEQ_REPORT_MAX
+#define SEQ_REPORT_MAX 64  // nodos por SEQ_STATS
+#endif
+// Peor caso: "[4294967295,4294967295,4294967295,4294967295,4294967295,255]," por nodo
+#define SEQ_JSON_MAX (SEQ_REPORT_MAX * 64 + 160)
+#define GATEWAY_TOPIC_MAX (sizeof(MQTT_TOPIC) + 12)
+// Trama publicada: JSON decodificado más "age_ms" o los sellos de latencia.
+// La más larga es una respuesta de control (TRACE_REPLY con varios saltos,
+// TOPO con muchos vecinos), no una lectura
+#define GATEWAY_STAMP_MAX 48
+#define GATEWAY_FRAME_TEXT_MAX \
+  ((CONTROL_REPLY_MAX > STORE_PAYLOAD_MAX ? CONTROL_REPLY_MAX : STORE_PAYLOAD_MAX) + GATEWAY_STAMP_MAX)
+// publish() más largo de una trama: cabecera fija, largo del tópico, tópico y
+// payload. PubSubClient necesita setBufferSize() con al menos esto (256 por defecto)
+#define GATEWAY_PUBLISH_MAX (5 + 2 + GATEWAY_TOPIC_MAX + GATEWAY_FRAME_TEXT_MAX)
+
+// Latencia: las peticiones de control salen al mesh con "gw_in"/"gw_tx" y las
+// respuestas (PONG, TRACE_REPLY, ...) se publican con "gw_rx"/"gw_out"; todos
+// en tiempo del mesh (mesh.getNodeTime(), us), comparables con los de los nodos
+//
+// Cada carril tiene su tamaño de trama: las lecturas usan el del store
+// (STORE_PAYLOAD_MAX) y las respuestas de control el de un nodo
+// (CONTROL_REPLY_MAX), así un TRACE_REPLY de 3 saltos no se descarta y las
+// lecturas no pagan RAM por él.
+template <size_t PayloadMax>
+struct MeshFrameOf {
+  uint32_t nodeId;
+  uint32_t rxMs;
+  uint32_t rxUs;      // reloj en us al recibir, para calcular gw_out en la otra tarea
+  uint32_t rxNodeUs;  // gw_rx, sólo si timed
+  bool timed;         // respuesta de control: se publica sin demora y con sellos
+  uint16_t len;
+  char payload[PayloadMax + 1];
+};
+typedef MeshFrameOf<STORE_PAYLOAD_MAX> MeshFrame;       // lecturas
+typedef MeshFrameOf<CONTROL_REPLY_MAX> MeshReplyFrame;  // respuestas de control
+
+struct ControlFrame {
+  uint32_t to;
+  uint32_t rxUs;  // al llegar por MQTT, de ahí sale gw_in
+  uint16_t len;
+  char payload[CONTROL_PAYLOAD_MAX + 1];
+};
+
+struct SeqReport {
+  uint16_t count;
+  uint16_t tracked;    // nodos en la tabla (puede superar count)
+  uint32_t untracked;  // lecturas sin seguir por tabla llena
+  SeqEntry nodes[SEQ_REPORT_MAX];
+};
+
+// Respuestas de control: se publican sin esperar al lote y con sellos
+inline bool gatewayTimed(ControlType type) {
+  return type == CTRL_PONG || type == CTRL_TRACE_REPLY || type == CTRL_TOPO || type == CTRL_REPORT_CFG_ACK;
+}
+
+enum GatewayLane : uint8_t {
+  LANE_DATA = 0,  // lecturas de los nodos
+  LANE_CONTROL,   // respuestas de control (gatewayTimed)
+  LANE_COUNT,
+};
+
+inline GatewayLane gatewayLane(ControlType type) { return gatewayTimed(type) ? LANE_CONTROL : LANE_DATA; }
+
+// Bytes que entran en una trama del carril
+inline size_t gatewayLaneMax(GatewayLane lane) { return lane == LANE_CONTROL ? CONTROL_REPLY_MAX : STORE_PAYLOAD_MAX; }
+
+// Tramas mesh -> MQTT en dos carriles SPSC con prioridad estricta: el
+// consumidor mira frontReply() antes de cada frontData(), así un PONG espera
+// a lo sumo el publish() de datos que ya estaba en curso y no toda la cola
+// de lecturas. Dentro de cada carril se conserva el orden.
+template <size_t CONTROL_SLOTS, size_t DATA_SLOTS>
+class MeshLanes {
+ public:
+  // Productor: copia la trama a un slot libre de su carril; false si está
+  // lleno. len no debe superar gatewayLaneMax(lane)
+  bool push(GatewayLane lane, uint32_t from, uint32_t rxMs, uint32_t rxUs, uint32_t rxNodeUs, const char *msg,
+            size_t len) {
+    return lane == LANE_CONTROL ? fill(control_, from, rxMs, rxUs, rxNodeUs, true, msg, len)
+                                : fill(data_, from, rxMs, rxUs, rxNodeUs, false, msg, len);
+  }
+
+  // Consumidor
+  MeshReplyFrame *frontReply() { return control_.front(); }
+  MeshFrame *frontData() { return data_.front(); }
+  void release(GatewayLane lane) { lane == LANE_CONTROL ? control_.release() : data_.release(); }
+  bool controlPending() const { return !control_.empty(); }
+
+  size_t size(GatewayLane lane) const { return lane == LANE_CONTROL ? control_.size() : data_.size(); }
+  size_t capacity(GatewayLane lane) const { return lane == LANE_CONTROL ? CONTROL_SLOTS : DATA_SLOTS; }
+  SpscStats stats(GatewayLane lane) const { return lane == LANE_CONTROL ? control_.stats() : data_.stats(); }
+
+ private:
+  template <typename Queue>
+  static bool fill(Queue &q, uint32_t from, uint32_t rxMs, uint32_t rxUs, uint32_t rxNodeUs, bool timed,
+                   const char *msg, size_t len) {
+    auto *f = q.claim();
+    if (!f) return false;
+    f->nodeId = from;
+    f->rxMs = rxMs;
+    f->rxUs = rxUs;
+    f->timed = timed;
+    f->rxNodeUs = timed ? rxNodeUs : 0;
+    f->len = (uint16_t)len;
+    memcpy(f->payload, msg, len);
+    f->payload[len] = '\0';
+    q.commit();
+    return true;
+  }
+
+  SpscQueue<MeshReplyFrame, CONTROL_SLOTS> control_;
+  SpscQueue<MeshFrame, DATA_SLOTS> data_;
+};
+
+// Nodos/datos/<from>
+inline void gatewayFrameTopic(uint32_t from, char *topic, size_t cap) {
+  snprintf(topic, cap, MQTT_TOPIC "/%u", (unsigned)from);
+}
+
+// Texto a publicar para una trama: el JSON decodificado si es una SensorFrame
+// (con MQTT_FRAME_FORMAT_JSON) o el payload tal cual; actualiza len
+inline const char *gatewayFrameText(const char *payload, size_t &len, char *json, size_t cap) {
+#if MQTT_FRAME_FORMAT_JSON
+  SensorFrame frame;
+  if (decodeSensorFrame(payload, len, frame)) {
+    len = sensorFrameToJson(frame, json, cap);
+    return len ? json : nullptr;
+  }
+#else
+  (void)json;
+  (void)cap;
+#endif
+  return payload;
+}
+
+// Payload de Nodos/datos/<from>. Con extra (p.ej. "age_ms":N en las tramas
+// diferidas, o los sellos de latencia) se agrega al final del objeto. buf
+// debe tener GATEWAY_FRAME_TEXT_MAX; nullptr si la trama no se pudo armar.
+inline const char *gatewayFramePayload(const char *payload, size_t &len, const char *extra, char *buf, size_t cap) {
+  const char *text = gatewayFrameText(payload, len, buf, cap);
+  if (!text || !extra || len < 2 || text[len - 1] != '}') return text;
+  int n = text == buf ? snprintf(buf + len - 1, cap - len + 1, ",%s}", extra)
+                      : snprintf(buf, cap, "%.*s,%s}", (int)(len - 1), text, extra);
+  if (n < 0) return nullptr;
+  len = text == buf ? len - 1 + n : (size_t)n;
+  return len < cap ? buf : nullptr;
+}
+
+// Comando de control para el mesh con gw_in (llegada por MQTT) y gw_tx
+// (salida al mesh) en tiempo del mesh; devuelve la longitud escrita
+inline size_t gatewayStampControl(const ControlFrame &c, uint32_t gwIn, uint32_t gwTx, char *buf, size_t cap) {
+  if (c.len >= 2 && c.payload[c.len - 1] == '}') {
+    int n = snprintf(buf, cap, "%.*s,\"gw_in\":%u,\"gw_tx\":%u}", (int)(c.len - 1), c.payload, (unsigned)gwIn,
+                     (unsigned)gwTx);
+    if (n > 0 && (size_t)n < cap) return n;
+  }
+  size_t n = c.len < cap ? c.len : cap - 1;
+  memcpy(buf, c.payload, n);
+  buf[n] = '\0';
+  return n;
+}
+
+// Anuncio del root: los nodos aprenden su ID y dejan de inundar el mesh; "bin"
+// es la versión de SensorFrame que sabe decodificar y "mt_wraps"/"mt" su tiempo
+// del mesh de 64 bits, del que los nodos toman las vueltas (MeshTime.h)
+inline size_t gatewayRootMessage(uint32_t gatewayId, uint64_t meshUs, char *buf, size_t cap) {
+  int n = snprintf(buf, cap, "{\"type\":\"ROOT\",\"from\":%u,\"bin\":%u,\"mt_wraps\":%u,\"mt\":%u}",
+                   (unsigned)gatewayId, (unsigned)SENSOR_FRAME_VERSION, (unsigned)(meshUs >> 32), (unsigned)meshUs);
+  return n > 0 && (size_t)n < cap ? n : 0;
+}
+
+// Comando recibido por MQTT: un objeto JSON que entra en un ControlFrame
+inline bool gatewayControlValid(const char *msg, size_t len) {
+  return len >= 2 && msg[0] == '{' && len <= CONTROL_PAYLOAD_MAX;
+}
+
+// Copia el comando tal cual llegó, sin parsearlo: el buffer de MQTT no se
+// toca y los bytes que salen al mesh son los publicados (más los sellos)
+inline void gatewayControlFrame(const char *msg, size_t len, uint32_t rxUs, ControlFrame &c) {
+  c.to = controlUint(msg, len, "to");
+  c.rxUs = rxUs;
+  c.len = (uint16_t)len;
+  memcpy(c.payload, msg, len);
+  c.payload[len] = '\0';
+}
+
+// TOPO_REQ que se contesta desde la caché: "to" 0 o la gateway, sin
+// "flood":true. Copia el etag del pedido (vacío si no trae)
+inline bool gatewayTopologyRequest(const char *msg, size_t len, uint32_t gatewayId, char *etag) {
+  if (controlClassify(msg, len) != CTRL_TOPO_REQ) return false;
+  uint32_t to = controlUint(msg, len, "to");
+  const char *flood = controlField(msg, len, "flood");
+  if ((to != 0 && to != gatewayId) || (flood && *flood == 't')) return false;
+  etag[0] = '\0';
+  const char *v = controlField(msg, len, "etag");
+  if (v && *v == '"') {
+    const char *close = (const char *)memchr(v + 1, '"', msg + len - v - 1);
+    size_t n = close ? close - v - 1 : 0;
+    if (n < TOPO_ETAG_MAX) {
+      memcpy(etag, v + 1, n);
+      etag[n] = '\0';
+    }
+  }
+  return true;
+}
+
+// Pasa una lectura por la ventana de secuencia. La seq sale de la cabecera de
+// la SensorFrame o del "seq" del JSON; los mensajes sin seq (nodos viejos)
+// son siempre SEQ_NEW.
+template <size_t N>
+inline SeqVerdict gatewayAcceptReading(SeqTable<N> &table, uint32_t from, const char *msg, size_t len,
+                                       uint32_t *seqOut = nullptr) {
+  SensorFrame sf;
+  uint32_t seq;
+  bool first, backfill = false;
+  if (decodeSensorFrame(msg, len, sf)) {
+    seq = sf.seq;
+    first = sensorReason(sf.flags) == SENSOR_REASON_FIRST;
+  } else {
+    seq = controlUint(msg, len, "seq", UINT32_MAX);
+    if (seq > UINT16_MAX) return SEQ_NEW;
+    const char *reason = controlField(msg, len, "reason");
+    first = reason && strncmp(reason, "\"first\"", 7) == 0;
+    backfill = controlHas(msg, len, "node_age_ms");  // sale del log del nodo
+  }
+  if (seqOut) *seqOut = seq;
+  return table.accept(from, (uint16_t)seq, first, backfill);
+}
+
+// Copia de los contadores para la tarea que publica
+template <size_t N>
+inline void gatewaySeqReport(const SeqTable<N> &table, SeqReport &r) {
+  r.count = 0;
+  r.tracked = table.size();
+  r.untracked = table.untracked();
+  table.forEach([&r](const SeqEntry &e) {
+    if (r.count < SEQ_REPORT_MAX) r.nodes[r.count++] = e;
+  });
+}
+
+struct SeqTotals {
+  uint32_t received;
+  uint32_t lost;
+  uint32_t duplicates;
+};
+
+// {"type":"SEQ_STATS","from":gw,"nodes":n,"untracked":u,
+//  "stats":[[id,recibidas,perdidas,repetidas,desordenadas,reinicios],...]}
+inline size_t gatewaySeqStatsJson(const SeqReport &r, uint32_t from, char *buf, size_t cap, SeqTotals &totals) {
+  totals = SeqTotals{};
+  ControlWriter w(buf, cap);
+  w.printf("{\"type\":\"SEQ_STATS\",\"from\":%u,\"nodes\":%u,\"untracked\":%u,", (unsigned)from,
+           (unsigned)r.tracked, (unsigned)r.untracked);
+  if (r.count < r.tracked) w.raw("\"truncated\":true,");
+  w.raw("\"stats\":[");
+  for (size_t i = 0; i < r.count; i++) {
+    const SeqEntry &e = r.nodes[i];
+    w.printf(i ? ",[%u,%u,%u,%u,%u,%u]" : "[%u,%u,%u,%u,%u,%u]", (unsigned)e.node, (unsigned)e.received,
+             (unsigned)e.lost, (unsigned)e.duplicates, (unsigned)e.reordered, (unsigned)e.restarts);
+    totals.received += e.received;
+    totals.lost += e.lost;
+    totals.duplicates += e.duplicates;
+  }
+  w.raw("]}");
+  return w.ok() ? w.length() : 0;
+}
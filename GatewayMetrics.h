@@ -0,0 +1,281 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ControlDispatch.h"
+#include "GatewayCore.h"
+
+// Métricas de la gateway en memoria fija: contadores por nodo e histogramas
+// log-lineales. Cada METRICS_INTERVAL_MS se publica una foto compacta en
+// MQTT_TOPIC_METRICS con lo ocurrido en el intervalo.
+//
+// - LogHistogram<SUB, MAX>: 2^SUB cubetas lineales por cada potencia de 2
+//   hasta 2^MAX; error relativo < 2^-SUB, valores mayores van a la última
+//   cubeta (max guarda el real). record() es un clz, un índice y un ++.
+// - MeshMetrics (núcleo del mesh): tramas, bytes y última vez visto por nodo,
+//   tiempo de cada vuelta de loop() y profundidad de cada carril al encolar.
+//   snapshot() copia la ventana a un MetricsSnapshot y la reinicia.
+// - PublishMetrics (tarea MQTT): latencia recepción -> publish() y fallos,
+//   por carril (datos y control, ver MeshLanes en GatewayCore.h).
+//
+// C++ puro sin Arduino: bench_metrics.cpp lo prueba y mide record() en el host.
+
+#ifndef MQTT_TOPIC_METRICS
+#define MQTT_TOPIC_METRICS "Nodos/metricas"
+#endif
+#ifndef METRICS_INTERVAL_MS
+#define METRICS_INTERVAL_MS 10000
+#endif
+#ifndef METRICS_NODES_MAX
+#define METRICS_NODES_MAX 64  // nodos por foto
+#endif
+// Peor caso: "[4294967295,42949672.95,4294967295,4294967295]," por nodo
+#define METRICS_JSON_MAX (METRICS_NODES_MAX * 48 + 640)
+
+template <uint8_t SUB_BITS, uint8_t MAX_BITS>
+class LogHistogram {
+  static_assert(SUB_BITS >= 1 && SUB_BITS < MAX_BITS && MAX_BITS <= 32, "rango de LogHistogram");
+
+ public:
+  static const size_t BUCKETS = (size_t)(MAX_BITS - SUB_BITS + 1) << SUB_BITS;
+
+  void record(uint32_t v) {
+    counts_[index(v)]++;
+    if (!count_ || v < min_) min_ = v;
+    if (v > max_) max_ = v;
+    count_++;
+    sum_ += v;
+  }
+
+  uint32_t count() const { return count_; }
+  uint64_t sum() const { return sum_; }
+  uint32_t min() const { return min_; }
+  uint32_t max() const { return max_; }
+  uint32_t mean() const { return count_ ? (uint32_t)(sum_ / count_) : 0; }
+
+  // Cota superior de la cubeta que contiene el percentil q (0..1), sin
+  // pasar del máximo observado; 0 si está vacío
+  uint32_t percentile(double q) const {
+    if (!count_) return 0;
+    uint32_t rank = (uint32_t)(q * count_ + 0.999999);
+    if (rank < 1) rank = 1;
+    uint32_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+      seen += counts_[i];
+      if (seen >= rank) {
+        uint32_t upper = upperBound(i);
+        return upper < max_ ? upper : max_;
+      }
+    }
+    return max_;
+  }
+
+  void merge(const LogHistogram &o) {
+    if (!o.count_) return;
+    for (size_t i = 0; i < BUCKETS; i++) counts_[i] += o.counts_[i];
+    if (!count_ || o.min_ < min_) min_ = o.min_;
+    if (o.max_ > max_) max_ = o.max_;
+    count_ += o.count_;
+    sum_ += o.sum_;
+  }
+
+  void reset() { *this = LogHistogram(); }
+
+  static size_t index(uint32_t v) {
+    if (v < (1u << SUB_BITS)) return v;
+    unsigned msb = 31 - __builtin_clz(v);
+    if (msb >= MAX_BITS) return BUCKETS - 1;
+    unsigned shift = msb - SUB_BITS;
+    return ((size_t)(shift + 1) << SUB_BITS) | ((v >> shift) & ((1u << SUB_BITS) - 1));
+  }
+
+  static uint32_t lowerBound(size_t i) {
+    size_t group = i >> SUB_BITS;
+    if (!group) return (uint32_t)i;
+    return (uint32_t)(((1u << SUB_BITS) | (i & ((1u << SUB_BITS) - 1))) << (group - 1));
+  }
+
+  static uint32_t upperBound(size_t i) {
+    size_t group = i >> SUB_BITS;
+    if (i == BUCKETS - 1) return UINT32_MAX;  // también los que no entran
+    return group ? lowerBound(i) + (uint32_t)((1u << (group - 1)) - 1) : (uint32_t)i;
+  }
+
+ private:
+  uint32_t counts_[BUCKETS] = {};
+  uint32_t count_ = 0;
+  uint32_t min_ = 0;
+  uint32_t max_ = 0;
+  uint64_t sum_ = 0;
+};
+
+typedef LogHistogram<3, 24> LoopHistogram;     // us, hasta ~16 s
+typedef LogHistogram<3, 8> DepthHistogram;     // tramas en cola
+typedef LogHistogram<3, 28> LatencyHistogram;  // us, hasta ~4.5 min
+
+struct NodeSample {
+  uint32_t node;
+  uint32_t lastSeenMs;  // millis() de la última trama; en la foto, antigüedad
+  uint32_t frames;      // en el intervalo
+  uint32_t bytes;
+};
+
+struct MetricsSnapshot {
+  uint32_t windowMs;   // duración del intervalo
+  uint16_t count;      // entradas válidas en nodes
+  uint16_t tracked;    // nodos en la tabla
+  uint32_t untracked;  // tramas de nodos sin lugar en la tabla
+  uint32_t queueFull[LANE_COUNT];  // tramas descartadas por carril lleno (acumulado)
+  LoopHistogram loopUs;
+  DepthHistogram queueDepth[LANE_COUNT];
+  NodeSample nodes[METRICS_NODES_MAX];
+};
+
+// Núcleo del mesh. Tabla de direccionamiento abierto como la de SeqWindow.h;
+// un nodo que desaparece se queda y su antigüedad crece
+template <size_t N>
+class MeshMetrics {
+  static_assert(N && (N & (N - 1)) == 0, "N debe ser potencia de 2");
+
+ public:
+  void frame(uint32_t node, size_t bytes, uint32_t now) {
+    NodeSample *e = find(node);
+    if (!e) {
+      untracked_++;
+      return;
+    }
+    if (!e->node) {
+      e->node = node;
+      used_++;
+    }
+    e->lastSeenMs = now;
+    e->frames++;
+    e->bytes += (uint32_t)bytes;
+  }
+
+  void loopTime(uint32_t us) { loopUs_.record(us); }
+  void queueDepth(GatewayLane lane, uint32_t depth) { queueDepth_[lane].record(depth); }
+
+  // Copia la ventana y empieza otra; queueFull lo completa quien llama
+  void snapshot(uint32_t now, MetricsSnapshot &s) {
+    s.windowMs = now - windowStartMs_;
+    s.count = 0;
+    s.tracked = (uint16_t)used_;
+    s.untracked = untracked_;
+    s.loopUs = loopUs_;
+    for (size_t l = 0; l < LANE_COUNT; l++) {
+      s.queueFull[l] = 0;
+      s.queueDepth[l] = queueDepth_[l];
+      queueDepth_[l].reset();
+    }
+    for (size_t i = 0; i < N; i++) {
+      NodeSample &e = slots_[i];
+      if (!e.node) continue;
+      if (s.count < METRICS_NODES_MAX) {
+        NodeSample &out = s.nodes[s.count++];
+        out = e;
+        out.lastSeenMs = now - e.lastSeenMs;
+      }
+      e.frames = 0;
+      e.bytes = 0;
+    }
+    windowStartMs_ = now;
+    untracked_ = 0;
+    loopUs_.reset();
+  }
+
+  size_t size() const { return used_; }
+
+ private:
+  static size_t slotOf(uint32_t node) { return (size_t)((node * 2654435761u) >> 7) & (N - 1); }
+
+  NodeSample *find(uint32_t node) {
+    size_t i = slotOf(node);
+    for (size_t probes = 0; probes < N; probes++, i = (i + 1) & (N - 1)) {
+      if (slots_[i].node == node || !slots_[i].node) return &slots_[i];
+    }
+    return nullptr;
+  }
+
+  NodeSample slots_[N] = {};
+  size_t used_ = 0;
+  uint32_t untracked_ = 0;
+  uint32_t windowStartMs_ = 0;
+  LoopHistogram loopUs_;
+  DepthHistogram queueDepth_[LANE_COUNT];
+};
+
+// Tarea MQTT
+struct PublishMetrics {
+  LatencyHistogram latencyUs[LANE_COUNT];
+  uint32_t ok[LANE_COUNT] = {};
+  uint32_t failures[LANE_COUNT] = {};
+
+  void published(GatewayLane lane, bool success, uint32_t us) {
+    if (success) {
+      ok[lane]++;
+      latencyUs[lane].record(us);
+    } else {
+      failures[lane]++;
+    }
+  }
+  void reset() { *this = PublishMetrics(); }
+
+  // Suma la de otro publicador (gateway_linux.cpp tiene varios)
+  void merge(const PublishMetrics &o) {
+    for (size_t l = 0; l < LANE_COUNT; l++) {
+      latencyUs[l].merge(o.latencyUs[l]);
+      ok[l] += o.ok[l];
+      failures[l] += o.failures[l];
+    }
+  }
+};
+
+struct HeapSample {
+  uint32_t free;
+  uint32_t minFree;  // mínimo desde el arranque
+  uint32_t largest;  // bloque libre más grande
+};
+
+template <uint8_t S, uint8_t M>
+inline void metricsSummary(ControlWriter &w, const char *key, const LogHistogram<S, M> &h) {
+  w.printf("\"%s\":[%u,%u,%u,%u,%u]", key, (unsigned)h.count(), (unsigned)h.percentile(0.5),
+           (unsigned)h.percentile(0.9), (unsigned)h.percentile(0.99), (unsigned)h.max());
+}
+
+// {"type":"METRICS","from":gw,"ms":intervalo,"heap":[libre,min,bloque],
+//  "loop_us":[n,p50,p90,p99,max],"queue":[...],"queue_ctl":[...],
+//  "queue_full":[datos,control],"store":s,"pub":[ok,fallos],"pub_ctl":[ok,fallos],
+//  "pub_us":[n,p50,p90,p99,max],"pub_us_ctl":[...],"nodes":n,"untracked":u,
+//  "rates":[[id,tramas/s,bytes/s,antigüedad_ms],...]}
+inline size_t gatewayMetricsJson(const MetricsSnapshot &s, const PublishMetrics &p, const HeapSample &heap,
+                                 uint32_t storeDepth, uint32_t from, char *buf, size_t cap) {
+  ControlWriter w(buf, cap);
+  w.printf("{\"type\":\"METRICS\",\"from\":%u,\"ms\":%u,\"heap\":[%u,%u,%u],", (unsigned)from, (unsigned)s.windowMs,
+           (unsigned)heap.free, (unsigned)heap.minFree, (unsigned)heap.largest);
+  metricsSummary(w, "loop_us", s.loopUs);
+  w.raw(",");
+  metricsSummary(w, "queue", s.queueDepth[LANE_DATA]);
+  w.raw(",");
+  metricsSummary(w, "queue_ctl", s.queueDepth[LANE_CONTROL]);
+  w.printf(",\"queue_full\":[%u,%u],\"store\":%u,\"pub\":[%u,%u],\"pub_ctl\":[%u,%u],",
+           (unsigned)s.queueFull[LANE_DATA], (unsigned)s.queueFull[LANE_CONTROL], (unsigned)storeDepth,
+           (unsigned)p.ok[LANE_DATA], (unsigned)p.failures[LANE_DATA], (unsigned)p.ok[LANE_CONTROL],
+           (unsigned)p.failures[LANE_CONTROL]);
+  metricsSummary(w, "pub_us", p.latencyUs[LANE_DATA]);
+  w.raw(",");
+  metricsSummary(w, "pub_us_ctl", p.latencyUs[LANE_CONTROL]);
+  w.printf(",\"nodes\":%u,\"untracked\":%u,", (unsigned)s.tracked, (unsigned)s.untracked);
+  if (s.count < s.tracked) w.raw("\"truncated\":true,");
+  w.raw("\"rates\":[");
+  double secs = s.windowMs ? s.windowMs / 1000.0 : 1.0;
+  for (size_t i = 0; i < s.count; i++) {
+    const NodeSample &n = s.nodes[i];
+    w.printf(i ? ",[%u,%.2f,%u,%u]" : "[%u,%.2f,%u,%u]", (unsigned)n.node, n.frames / secs,
+             (unsigned)(n.bytes / secs + 0.5), (unsigned)n.lastSeenMs);
+  }
+  w.raw("]}");
+  return w.ok() ? w.length() : 0;
+}
@@ -0,0 +1,902 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <TinyGPS++.h>
+#include <painlessMesh.h>
+#include <sys/time.h>
+
+#include "ControlDispatch.h"
+#include "DeferredLog.h"
+#include "MeshRejoin.h"
+#include "MeshTime.h"
+#include "NodeControl.h"
+#include "ReadingLog.h"
+#include "SensorFrame.h"
+
+// Runtime común de los nodos sensores: mesh, descubrimiento del root,
+// despacho de control (PING/TOPO_REQ/PONG/TRACE), tarea de envío y GPS.
+//
+// Cada NODO_*.cpp sólo define su política de sensor y la instancia:
+//
+//   struct MiSensor {
+//     static const char* name();        // etiqueta para logs, p.ej. "LUZ"
+//     static uint8_t type();            // SensorType de SensorFrame.h
+//     static float deadband();          // cambio mínimo de values[0] que fuerza un envío
+//     static uint32_t sampleMs();       // ms de poll() desde begin() hasta que read() tiene un valor
+//     void begin();                     // inicializa pines / driver
+//     void poll();                      // trabajo no bloqueante en cada vuelta de loop()
+//     bool read(SensorReading &r);      // valores en el orden de sensorTypeInfo(); false si falló
+//   };
+//
+// Las lecturas salen en JSON hasta que el root anuncia soporte de trama
+// binaria ("bin" en el mensaje ROOT); desde entonces en SensorFrame.
+//   MeshNodeRuntime<MiSensor> node;
+//
+// El tipo de mesh es un parámetro más (por defecto painlessMesh): el runtime
+// no usa estado global, así que un entorno de simulación puede instanciar
+// muchos nodos en un mismo proceso con un Mesh propio que exponga la misma
+// interfaz (init/update/sendSingle/sendBroadcast/getNodeId/getNodeTime/
+// getNodeList/asNodeTree/isConnected y los callbacks on*).
+
+#ifndef MESH_PREFIX
+#define MESH_PREFIX "RED_Nodos"
+#endif
+#ifndef MESH_PASSWORD
+#define MESH_PASSWORD "RED_Nodos_1023374689"
+#endif
+#ifndef MESH_PORT
+#define MESH_PORT 5555
+#endif
+
+#ifndef GPS_BAUDRATE
+#define GPS_BAUDRATE 9600
+#endif
+#ifndef GPS_RX_PIN
+#define GPS_RX_PIN 16
+#endif
+#ifndef GPS_TX_PIN
+#define GPS_TX_PIN 17
+#endif
+
+#ifndef SEND_INTERVAL_S
+#define SEND_INTERVAL_S 10
+#endif
+
+// Send-on-change: se muestrea cada SEND_INTERVAL_S pero sólo se transmite si
+// values[0] se movió más que el dead-band del sensor o si pasaron
+// REPORT_HEARTBEAT_S sin enviar nada. Ajustable en caliente con REPORT_CFG.
+#ifndef REPORT_HEARTBEAT_S
+#define REPORT_HEARTBEAT_S 300
+#endif
+
+// Ranuras de envío: en vez de un período contado desde el arranque (que hace
+// que los nodos terminen transmitiendo a la vez), cada nodo envía en un
+// desfase fijo dentro del período, medido en el tiempo sincronizado del mesh.
+// El desfase sale de su posición entre los nodeId del mesh (sin el root) y se
+// recalcula cuando cambia la membresía. El tiempo del mesh se extiende a 64
+// bits con las vueltas que anuncia la gateway en el ROOT (MeshTime.h).
+#ifndef SEND_SLOTTED
+#define SEND_SLOTTED 1
+#endif
+#ifndef SLOT_GUARD_MS
+#define SLOT_GUARD_MS 20  // margen al inicio de la ranura por error de sincronía
+#endif
+
+// Instrumentación del loop: peor hueco entre vueltas y costo de sensor.poll()
+#ifndef LOOP_STATS_INTERVAL_S
+#define LOOP_STATS_INTERVAL_S 30
+#endif
+#ifndef SENSOR_POLL_BUDGET_US
+#define SENSOR_POLL_BUDGET_US 500
+#endif
+
+// Log local de lecturas (ReadingLog.h): sin camino al root las lecturas se
+// guardan en flash y, cuando el camino vuelve, se reenvían en orden dentro de
+// la ranura del nodo, a lo sumo BACKFILL_BURST por período. Un entorno de
+// simulación sin flash lo apaga con NODE_LOG 0.
+#ifndef NODE_LOG
+#define NODE_LOG 1
+#endif
+#ifndef BACKFILL_BURST
+#define BACKFILL_BURST 8
+#endif
+#define BACKFILL_JSON_MAX 256
+
+#if NODE_LOG
+static_assert(SENSOR_FRAME_MAX_BIN <= READING_LOG_DATA_MAX, "SensorFrame no entra en un registro del log");
+
+// Sobrevive a deep sleep y reinicios por software, no a un corte de energía:
+// si falta, el reloj RTC también se reinició y el log abre una época nueva
+#define NODE_LOG_BOOT_MAGIC 0x4C4F4731
+RTC_DATA_ATTR static uint32_t nodeLogBootMagic = 0;
+#endif
+
+// Bajo consumo para nodos a batería (NODE_SLEEP_MODE 1). El nodo pasa casi
+// todo el tiempo en deep sleep: cada período (SLEEP_PERIOD_S, ajustable con
+// "period" de REPORT_CFG) despierta en su ranura del tiempo del mesh, muestrea
+// y guarda la lectura en el log; uno de cada SLEEP_JOIN_EVERY despertares
+// además enciende la radio, se une al mesh, envía lo acumulado y un POWER con
+// la energía gastada, y vuelve a dormir.
+//
+// Los nodos dormidos se unen sólo como estación (sin AP), así que nadie rutea
+// a través de ellos: el mesh lo sostienen el gateway y los nodos con
+// NODE_SLEEP_MODE 0, que forman el conjunto de relevo siempre encendido.
+#ifndef NODE_SLEEP_MODE
+#define NODE_SLEEP_MODE 0
+#endif
+#ifndef SLEEP_PERIOD_S
+#define SLEEP_PERIOD_S 300
+#endif
+#ifndef SLEEP_JOIN_EVERY
+#define SLEEP_JOIN_EVERY 3
+#endif
+#ifndef SLEEP_AWAKE_MAX_S
+#define SLEEP_AWAKE_MAX_S 30  // tope de un despertar con radio si el root no aparece
+#endif
+#ifndef SLEEP_LINGER_MS
+#define SLEEP_LINGER_MS 500  // para que salga lo encolado antes de apagar la radio
+#endif
+#ifndef SLEEP_JOIN_MARGIN_MS
+#define SLEEP_JOIN_MARGIN_MS 1000  // adelanto extra: deriva del reloj RTC en el sueño
+#endif
+#define SLEEP_JOIN_GUESS_MS 8000   // duración supuesta de la primera unión
+#define SLEEP_MIN_MS 1000
+
+#if NODE_SLEEP_MODE
+#if !NODE_LOG
+#error "NODE_SLEEP_MODE necesita NODE_LOG: las lecturas entre uniones van al log"
+#endif
+#include <esp_sleep.h>
+#endif
+
+// Reingreso rápido (MeshRejoin.h): canal, padre y root guardados en NVS. Al
+// unirse por primera vez tras el arranque el nodo envía un JOIN con lo que
+// tardó ("ttf_ms") y cómo encontró el mesh.
+#ifndef NODE_FAST_REJOIN
+#define NODE_FAST_REJOIN 1
+#endif
+
+// Lo que entrega la política de sensor en cada envío. Las estadísticas son
+// opcionales (sensores con muestreo en segundo plano) y se refieren a values[0].
+struct SensorReading {
+  float values[SENSOR_FRAME_MAX_VALUES];
+  bool hasStats;
+  float min;
+  float max;
+  float stddev;
+};
+
+#if NODE_SLEEP_MODE
+// Estado del runtime que cruza el deep sleep (memoria RTC; se reinicia junto
+// con nodeLogBootMagic en un arranque en frío)
+struct NodeSleepState {
+  uint32_t cycle;         // despertares desde el arranque en frío
+  uint64_t meshOffsetUs;  // tiempo del mesh (64 bits, MeshTime.h) - reloj RTC, medido en la última unión
+  bool synced;
+  uint32_t joinMs;        // duración de la última unión: adelanto del próximo despertar con radio
+  uint16_t slotIndex;
+  uint16_t slotCount;
+  ReportPolicy report;
+  uint16_t seq;
+  float lastSentValue;
+  uint32_t sinceSentMs;   // ms desde el último envío, al despertar
+  bool hasSent;
+  // Energía de los ciclos completos desde el último POWER
+  uint32_t wakes;
+  uint32_t joins;
+  uint32_t awakeMs;
+  uint32_t radioMs;
+  uint32_t txBytes;
+};
+RTC_DATA_ATTR static NodeSleepState nodeSleepState;
+#endif
+
+template <typename Sensor, typename Mesh = painlessMesh>
+class MeshNodeRuntime {
+ public:
+  MeshNodeRuntime()
+      : gpsSerial_(2),  // Serial2 para GPS
+        taskSendData_(TASK_SECOND * SEND_INTERVAL_S, TASK_FOREVER, [this]() { onSendTask(); }),
+        taskLoopStats_(TASK_SECOND * LOOP_STATS_INTERVAL_S, TASK_FOREVER, [this]() { reportLoopStats(); })
+#if NODE_SLEEP_MODE
+        ,
+        taskSleep_(TASK_MILLISECOND * 100, TASK_FOREVER, [this]() { sleepTick(); })
+#endif
+  {
+  }
+
+  void begin(const char *banner) {
+    Serial.begin(115200);
+    logBegin();
+#if !NODE_SLEEP_MODE
+    delay(1000);  // en bajo consumo sería un segundo despierto por ciclo
+#endif
+    LOG_I("%s", banner);
+
+#if NODE_LOG
+    bool coldBoot = nodeLogBootMagic != NODE_LOG_BOOT_MAGIC;
+    nodeLogBootMagic = NODE_LOG_BOOT_MAGIC;
+#endif
+#if NODE_SLEEP_MODE
+    restoreSleepState(coldBoot);
+#endif
+
+    gpsSerial_.begin(GPS_BAUDRATE, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
+#if NODE_SLEEP_MODE
+    sensorBeginMs_ = millis();
+#endif
+    sensor_.begin();
+
+#if NODE_LOG
+    logReady_ = logFlash_.begin() && log_.mount(coldBoot);
+    if (logReady_) {
+      LOG_I("[LOG] %u lecturas pendientes en flash (capacidad %u, época %u)",
+            (unsigned)log_.pending(), (unsigned)log_.capacity(), log_.epoch());
+    } else {
+      LOG_W("[LOG] Partición \"" READING_LOG_PARTITION "\" no disponible, sin log local");
+    }
+#endif
+#if NODE_SLEEP_MODE
+    if (!radioCycle(nodeSleepState.cycle)) return sampleAndSleep();
+#endif
+
+    uint8_t channel = REJOIN_DEFAULT_CHANNEL;
+#if NODE_FAST_REJOIN
+    channel = rejoin_.begin(MESH_PREFIX);
+    rootId_ = rejoin_.saved().rootId;  // unicast sin esperar el anuncio del root
+#endif
+    mesh_.setDebugMsgTypes(ERROR | STARTUP | CONNECTION);
+    mesh_.init(MESH_PREFIX, MESH_PASSWORD, &userScheduler_, MESH_PORT, NODE_SLEEP_MODE ? WIFI_STA : WIFI_AP_STA,
+               channel);
+
+    mesh_.onReceive([this](uint32_t from, String &msg) { receivedCallback(from, msg); });
+    mesh_.onNewConnection([](uint32_t nodeId) {
+      LOG_I("Nueva conexión: %u", nodeId);
+    });
+    mesh_.onChangedConnections([this]() {
+      LOG_I("Conexiones: %d nodos", mesh_.getNodeList().size());
+      updateRootId();
+      resched();
+      checkJoined();
+    });
+
+    LOG_I("NODE ID: %u", mesh_.getNodeId());
+
+#if NODE_SLEEP_MODE
+    userScheduler_.addTask(taskSleep_);
+    taskSleep_.enable();
+#else
+    userScheduler_.addTask(taskSendData_);
+    taskSendData_.enable();
+    resched();
+#endif
+    userScheduler_.addTask(taskLoopStats_);
+    taskLoopStats_.enable();
+
+    LOG_I("Mesh configurado - Muestreo cada %us, dead-band %.2f, heartbeat %us",
+          report_.periodS, report_.deadband, report_.heartbeatS);
+  }
+
+  // mesh.update() también ejecuta userScheduler_
+  void update() {
+    uint32_t start = micros();
+    if (lastLoopUs_ && start - lastLoopUs_ > maxLoopGapUs_) maxLoopGapUs_ = start - lastLoopUs_;
+    lastLoopUs_ = start;
+
+    mesh_.update();
+
+    uint32_t pollStart = micros();
+    sensor_.poll();
+    uint32_t pollUs = micros() - pollStart;
+    if (pollUs > maxPollUs_) maxPollUs_ = pollUs;
+    if (pollUs > SENSOR_POLL_BUDGET_US) pollOverBudget_++;
+
+    // Leer datos del GPS continuamente
+    while (gpsSerial_.available() > 0) {
+      gps_.encode(gpsSerial_.read());
+    }
+  }
+
+  Mesh &mesh() { return mesh_; }
+  Sensor &sensor() { return sensor_; }
+  uint32_t rootId() const { return rootId_; }
+  uint16_t seq() const { return seq_; }  // última lectura numerada
+
+ private:
+  // ---------- Root ----------
+
+  // Busca el nodo marcado como root en el árbol del mesh
+  template <typename Tree>
+  static uint32_t findRoot(const Tree &node) {
+    if (node.root) return node.nodeId;
+    for (auto &sub : node.subs) {
+      uint32_t id = findRoot(sub);
+      if (id) return id;
+    }
+    return 0;
+  }
+
+  void updateRootId() {
+    uint32_t found = findRoot(mesh_.asNodeTree());
+    if (found && found != rootId_) {
+      rootId_ = found;
+      rootBin_ = false;  // hasta que este root se anuncie
+      LOG_I("[ROOT] Gateway descubierto en el árbol: %u", rootId_);
+    } else if (!found && rootId_ && !mesh_.isConnected(rootId_)) {
+      LOG_W("[ROOT] Gateway %u inalcanzable, vuelvo a broadcast", rootId_);
+      rootId_ = 0;
+    }
+  }
+
+  bool rootReachable() { return rootId_ && mesh_.isConnected(rootId_); }
+
+  // Unicast al gateway; broadcast solo mientras no se conoce el root
+  bool sendToRoot(String &payload) {
+    txBytes_ += payload.length();
+    if (rootId_ && mesh_.sendSingle(rootId_, payload)) return true;
+    mesh_.sendBroadcast(payload);
+    return false;
+  }
+
+  // Las peticiones del servidor llegan con "from": 0; la respuesta va al root.
+  // La API de painlessMesh pide un String: se reusa txMsg_, que tras la
+  // primera respuesta ya tiene capacidad para CONTROL_REPLY_MAX.
+  void reply(uint32_t requester, const ControlWriter &w) {
+    if (!w.ok()) {
+      LOG_W("[CTRL] Respuesta truncada (> %u bytes), no se envía", CONTROL_REPLY_MAX);
+      return;
+    }
+    txMsg_ = w.c_str();
+    if (requester) {
+      txBytes_ += txMsg_.length();
+      mesh_.sendSingle(requester, txMsg_);
+    } else {
+      sendToRoot(txMsg_);
+    }
+  }
+
+  // Primera vez con camino al root desde el arranque: guardar el enlace y
+  // reportar el tiempo hasta la primera trama (desde que arranca el firmware)
+  void checkJoined() {
+    if (joinReported_ || !rootReachable()) return;
+    joinReported_ = true;
+#if NODE_FAST_REJOIN
+    rejoin_.remember(WiFi.channel(), WiFi.BSSID(), rootId_);
+    char buf[CONTROL_REPLY_MAX];
+    ControlWriter w(buf, sizeof(buf));
+    w.printf("{\"type\":\"JOIN\",\"from\":%u,\"ttf_ms\":%u,\"path\":\"%s\",\"channel\":%u,\"scan_ms\":%u,\"root\":%u}",
+             mesh_.getNodeId(), (unsigned)millis(), rejoinPathName(rejoin_.path()), rejoin_.channel(),
+             rejoin_.scanMs(), rootId_);
+    reply(0, w);
+    LOG_I("[REJOIN] Primera trama al root a los %u ms (%s)", (unsigned)millis(), rejoinPathName(rejoin_.path()));
+#endif
+  }
+
+  // ---------- Ranuras de envío ----------
+
+  void onSendTask() {
+    lastSendTaskMs_ = millis();
+    sendData();
+#if NODE_LOG
+    backfill();
+#endif
+#if SEND_SLOTTED
+    scheduleNextSlot(report_.periodS * 500000ULL);  // nunca dos envíos en medio período
+#endif
+  }
+
+  // Recalcula la ranura y reprograma; sin SEND_SLOTTED el período sigue igual
+  void resched() {
+#if SEND_SLOTTED
+    updateSlot();
+#if NODE_SLEEP_MODE
+    return;  // la ranura se usa al calcular el próximo despertar
+#endif
+    uint64_t sinceLastUs = (uint64_t)(millis() - lastSendTaskMs_) * 1000;
+    uint64_t halfUs = report_.periodS * 500000ULL;
+    scheduleNextSlot(lastSendTaskMs_ && sinceLastUs < halfUs ? halfUs - sinceLastUs : 1000);
+#endif
+  }
+
+  // Posición de este nodo entre los miembros ordenados por nodeId; todos los
+  // nodos ven la misma lista, así que las ranuras no se solapan
+  void updateSlot() {
+    uint32_t myId = mesh_.getNodeId();
+    uint16_t index = 0;
+    uint16_t count = 0;
+    for (uint32_t id : mesh_.getNodeList(true)) {
+      if (id == rootId_) continue;
+      if (id < myId) index++;
+      count++;
+    }
+    if (!count) count = 1;
+    if (index != slotIndex_ || count != slotCount_) {
+      slotIndex_ = index;
+      slotCount_ = count;
+      LOG_I("[SLOT] Ranura %u/%u, desfase %u ms en un período de %us",
+            slotIndex_, slotCount_, (unsigned)(slotOffsetUs() / 1000), report_.periodS);
+    }
+  }
+
+  uint64_t slotOffsetUs() const {
+    uint64_t widthUs = report_.periodS * 1000000ULL / slotCount_;
+    uint64_t guardUs = min<uint64_t>(SLOT_GUARD_MS * 1000ULL, widthUs / 4);
+    return slotIndex_ * widthUs + guardUs;
+  }
+
+  // Tiempo del mesh de 64 bits: getNodeTime() da la vuelta cada ~71.6 min y
+  // la fase de la ranura saltaría en cada vuelta (MeshTime.h)
+  uint64_t meshTimeUs() { return meshClock_.at(mesh_.getNodeTime(), millis()); }
+
+  // Programa taskSendData_ para el próximo inicio de ranura que quede a más
+  // de minWaitUs; la fase se calcula sobre el tiempo del mesh, común a todos
+  void scheduleNextSlot(uint64_t minWaitUs) {
+    uint64_t periodUs = report_.periodS * 1000000ULL;
+    uint64_t phaseUs = meshTimeUs() % periodUs;
+    uint64_t offsetUs = slotOffsetUs();
+    uint64_t waitUs = offsetUs >= phaseUs ? offsetUs - phaseUs : periodUs - phaseUs + offsetUs;
+    while (waitUs < minWaitUs) waitUs += periodUs;
+    taskSendData_.delay(waitUs / 1000);
+  }
+
+  // ---------- Envío de datos ----------
+
+  void sendData() {
+    SensorReading reading = {};
+    if (!sensor_.read(reading)) {
+      LOG_E("[SENSOR] Error leyendo %s", Sensor::name());
+      return;
+    }
+    int reason = reportReason(reading);
+    if (reason < 0) {
+      suppressed_++;
+      LOG_D("[TX] %s sin cambio (%.2f), omitido (%u omitidos)", Sensor::name(), reading.values[0], suppressed_);
+      return;
+    }
+    bool gpsValid = gps_.location.isValid();
+    if (gpsValid) {
+      LOG_D("[GPS] OK - Sat: %d", gps_.satellites.value());
+    } else {
+      LOG_D("[GPS] Sin fix - Sat: %d, Chars: %d", gps_.satellites.value(), gps_.charsProcessed());
+    }
+
+    seq_++;
+    lastSentValue_ = reading.values[0];
+    lastSentMs_ = millis();
+    hasSent_ = true;
+#if NODE_LOG
+    if (logReady_ && !rootReachable()) {
+      logReading(buildFrame(reading, gpsValid, reason));
+      return;
+    }
+#endif
+    String payload = (rootId_ && rootBin_) ? encodeBinary(reading, gpsValid, reason) : encodeJson(reading, gpsValid, reason);
+    bool unicast = sendToRoot(payload);
+    LOG_D("[TX] %s -> %s (%s, %s)", Sensor::name(), payload.c_str(),
+          sensorReasonName(reason), unicast ? "unicast root" : "broadcast");
+    LOG_D("[MESH] Nodos conectados: %d", mesh_.getNodeList().size());
+  }
+
+  // Motivo de envío (SensorReason), o -1 si la lectura no justifica transmitir
+  int reportReason(const SensorReading &r) {
+    if (!hasSent_) return SENSOR_REASON_FIRST;
+    if (fabsf(r.values[0] - lastSentValue_) > report_.deadband) return SENSOR_REASON_CHANGE;
+    if (millis() - lastSentMs_ >= report_.heartbeatS * 1000UL) return SENSOR_REASON_HEARTBEAT;
+    return -1;
+  }
+
+  String encodeJson(const SensorReading &r, bool gpsValid, int reason) {
+    const SensorTypeInfo *info = sensorTypeInfo(Sensor::type());
+    StaticJsonDocument<256> doc;
+    for (uint8_t i = 0; i < info->count; i++) doc[info->fields[i].key] = r.values[i];
+    if (gpsValid) {
+      doc["lat"] = gps_.location.lat();
+      doc["lon"] = gps_.location.lng();
+    } else {
+      doc["lat"] = "no data";
+      doc["lon"] = "no data";
+    }
+    if (r.hasStats) {
+      doc["min"] = r.min;
+      doc["max"] = r.max;
+      doc["std"] = r.stddev;
+    }
+    doc["reason"] = sensorReasonName(reason);
+    doc["seq"] = seq_;
+    String out;
+    serializeJson(doc, out);
+    return out;
+  }
+
+  // Instante de la lectura en ms del tiempo del mesh. Con NODE_SLEEP_MODE y
+  // sin unión en este despertar (ciclo sin radio, o el root no apareció) el
+  // mesh no está iniciado o no está sincronizado: se estima con el reloj RTC
+  // y el offset de la última unión, o millis() si nunca hubo una.
+  uint32_t sampleTimeMs() {
+#if NODE_SLEEP_MODE
+    if (!joinedMs_) {
+      const NodeSleepState &s = nodeSleepState;
+      return s.synced ? (uint32_t)((rtcUs() + s.meshOffsetUs) / 1000) : millis();
+    }
+#endif
+    return (uint32_t)(meshTimeUs() / 1000);
+  }
+
+  SensorFrame buildFrame(const SensorReading &r, bool gpsValid, int reason) {
+    const SensorTypeInfo *info = sensorTypeInfo(Sensor::type());
+    SensorFrame frame = {};
+    frame.type = Sensor::type();
+    frame.flags = reason << SENSOR_REASON_SHIFT;
+    frame.seq = seq_;
+    frame.sampleMs = sampleTimeMs();
+    for (uint8_t i = 0; i < info->count; i++) {
+      frame.values[i] = sensorframe::toFixed(r.values[i], info->fields[i].scale);
+    }
+    if (r.hasStats) {
+      int16_t scale = info->fields[0].scale;
+      frame.flags |= SENSOR_FLAG_STATS;
+      frame.statMin = sensorframe::toFixed(r.min, scale);
+      frame.statMax = sensorframe::toFixed(r.max, scale);
+      frame.statStd = sensorframe::toFixed(r.stddev, scale);
+    }
+    if (gpsValid) {
+      frame.flags |= SENSOR_FLAG_GPS;
+      frame.latE6 = sensorframe::toE6(gps_.location.lat());
+      frame.lonE6 = sensorframe::toE6(gps_.location.lng());
+    }
+    return frame;
+  }
+
+  String encodeBinary(const SensorReading &r, bool gpsValid, int reason) {
+    char text[SENSOR_FRAME_MAX_TEXT];
+    encodeSensorFrame(buildFrame(r, gpsValid, reason), text, sizeof(text));
+    return String(text);
+  }
+
+#if NODE_LOG
+  // ---------- Log local ----------
+
+  // Reloj RTC: sigue contando en deep sleep y tras reinicios por software
+  static uint64_t rtcUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000ULL + tv.tv_usec;
+  }
+  static uint32_t rtcMs() { return (uint32_t)(rtcUs() / 1000); }
+
+  void logReading(const SensorFrame &f) {
+    uint8_t bin[SENSOR_FRAME_MAX_BIN];
+    size_t n = packSensorFrame(f, bin);
+    if (n && log_.append(bin, n, rtcMs())) {
+      LOG_I("[LOG] Sin camino al root, seq=%u guardada (%u pendientes)", f.seq, (unsigned)log_.pending());
+    } else {
+      LOG_E("[LOG] Error escribiendo el log, seq=%u perdida", f.seq);
+    }
+  }
+
+  // Reenvía lo pendiente en orden, en JSON con "node_age_ms" (antigüedad en el
+  // nodo). Entre épocas distintas el reloj RTC no es comparable y la edad es
+  // una cota inferior: el tiempo desde este arranque.
+  void backfill() {
+    if (!logReady_ || !log_.pending() || !rootReachable()) return;
+    typename ReadingLog<EspPartitionFlash>::Entry e;
+    unsigned sent = 0;
+    while (sent < BACKFILL_BURST && log_.peek(e)) {
+      SensorFrame f;
+      char json[BACKFILL_JSON_MAX];
+      size_t n = unpackSensorFrame(e.data, e.len, f) ? sensorFrameToJson(f, json, sizeof(json) - 32) : 0;
+      if (!n) {
+        log_.pop();  // registro ilegible: no debe trabar la cola
+        continue;
+      }
+      uint32_t ageMs = e.epoch == log_.epoch() ? rtcMs() - e.tMs : millis();
+      snprintf(json + n - 1, sizeof(json) - n + 1, ",\"node_age_ms\":%u}", ageMs);
+      String out(json);
+      if (!mesh_.sendSingle(rootId_, out)) break;
+      txBytes_ += out.length();
+      log_.pop();
+      sent++;
+    }
+    if (sent) LOG_I("[LOG] Back-fill: %u lecturas reenviadas, %u pendientes", sent, (unsigned)log_.pending());
+  }
+#endif
+
+#if NODE_SLEEP_MODE
+  // ---------- Bajo consumo ----------
+
+  void restoreSleepState(bool coldBoot) {
+    NodeSleepState &s = nodeSleepState;
+    if (coldBoot) {
+      s = NodeSleepState{};
+      s.joinMs = SLEEP_JOIN_GUESS_MS;
+      s.slotCount = 1;
+      s.report = report_;
+    }
+    s.cycle++;
+    report_ = s.report;
+    slotIndex_ = s.slotIndex;
+    slotCount_ = s.slotCount;
+    seq_ = s.seq;
+    lastSentValue_ = s.lastSentValue;
+    lastSentMs_ = millis() - s.sinceSentMs;
+    hasSent_ = s.hasSent;
+    if (s.synced) meshClock_.anchor(rtcUs() + s.meshOffsetUs, millis());
+  }
+
+  // Despertar con radio cada SLEEP_JOIN_EVERY, o siempre mientras no haya log
+  // o no se conozca el tiempo del mesh
+  bool radioCycle(uint32_t cycle) const {
+    return !logReady_ || !nodeSleepState.synced || cycle % SLEEP_JOIN_EVERY == 0;
+  }
+
+  // Despertar sin radio: sin root alcanzable sendData() deja la lectura en el log.
+  // La ventana es la de la política de sensor (el DHT22 no lee antes de ~2 s).
+  void sampleAndSleep() {
+    while (millis() - sensorBeginMs_ < Sensor::sampleMs()) {
+      sensor_.poll();
+      delay(1);
+    }
+    sendData();
+    goSleep(false);
+  }
+
+  // Despertar con radio: esperar al root, enviar la lectura y el POWER, vaciar
+  // el log y dormir tras SLEEP_LINGER_MS. Si el root no aparece en
+  // SLEEP_AWAKE_MAX_S la lectura queda en el log y el nodo duerme igual.
+  void sleepTick() {
+    uint32_t now = millis();
+    bool timedOut = now >= SLEEP_AWAKE_MAX_S * 1000UL;
+    if (!joinedMs_) {
+      // Una unión más rápida que la ventana del sensor espera a la lectura:
+      // joinMs (el adelanto del próximo despertar) ya la incluye
+      if (rootReachable() && now - sensorBeginMs_ >= Sensor::sampleMs()) {
+        joinedMs_ = now;
+        nodeSleepState.joinMs = now;
+        LOG_I("[SLEEP] Unido al root en %u ms", now);
+        sendData();
+        sendPower();
+      } else if (timedOut) {
+        LOG_W("[SLEEP] Sin root tras %us, la lectura queda en el log", SLEEP_AWAKE_MAX_S);
+        sendData();
+        goSleep(true);
+      }
+      return;
+    }
+    backfill();
+    if (log_.pending() && rootReachable() && !timedOut) return;
+    if (!lingerFromMs_) lingerFromMs_ = now;
+    if (now - lingerFromMs_ >= SLEEP_LINGER_MS) goSleep(true);
+  }
+
+  // Energía de los ciclos completos desde el POWER anterior (el actual entra en
+  // el próximo). awake_ms cuenta desde que arranca el firmware, sin el boot de ROM.
+  void sendPower() {
+    NodeSleepState &s = nodeSleepState;
+    char buf[CONTROL_REPLY_MAX];
+    ControlWriter w(buf, sizeof(buf));
+    w.printf("{\"type\":\"POWER\",\"from\":%u,\"wakes\":%u,\"joins\":%u,\"awake_ms\":%u,\"radio_ms\":%u,"
+             "\"tx_bytes\":%u,\"join_ms\":%u,\"period\":%u,\"join_every\":%u,\"pending\":%u}",
+             mesh_.getNodeId(), s.wakes, s.joins, s.awakeMs, s.radioMs, s.txBytes, s.joinMs,
+             report_.periodS, SLEEP_JOIN_EVERY, (unsigned)log_.pending());
+    reply(0, w);
+    s.wakes = s.joins = s.awakeMs = s.radioMs = s.txBytes = 0;
+  }
+
+  // Duerme hasta el próximo inicio de ranura, estimado en tiempo del mesh con
+  // el reloj RTC y el offset de la última unión. Un despertar con radio se
+  // adelanta lo que tardó esa unión para llegar unido a la ranura.
+  void goSleep(bool radio) {
+    NodeSleepState &s = nodeSleepState;
+    uint32_t awakeMs = millis();
+    s.wakes++;
+    if (joinedMs_) s.joins++;
+    s.awakeMs += awakeMs;
+    if (radio) s.radioMs += awakeMs;
+    s.txBytes += txBytes_;
+
+    uint64_t rtcNowUs = rtcUs();
+    if (joinedMs_) {
+      s.meshOffsetUs = meshTimeUs() - rtcNowUs;
+      s.synced = true;
+    }
+    uint64_t periodUs = report_.periodS * 1000000ULL;
+    uint64_t phaseUs = (rtcNowUs + s.meshOffsetUs) % periodUs;
+    uint64_t offsetUs = slotOffsetUs();
+    uint64_t waitUs = offsetUs >= phaseUs ? offsetUs - phaseUs : periodUs - phaseUs + offsetUs;
+    uint32_t leadMs = radioCycle(s.cycle + 1) ? s.joinMs + SLEEP_JOIN_MARGIN_MS : Sensor::sampleMs();
+    if (leadMs < Sensor::sampleMs()) leadMs = Sensor::sampleMs();
+    uint64_t leadUs = leadMs * 1000ULL;
+    while (waitUs < leadUs + SLEEP_MIN_MS * 1000ULL) waitUs += periodUs;
+    uint64_t sleepUs = waitUs - leadUs;
+
+    s.report = report_;
+    s.slotIndex = slotIndex_;
+    s.slotCount = slotCount_;
+    s.seq = seq_;
+    s.lastSentValue = lastSentValue_;
+    s.sinceSentMs = millis() - lastSentMs_ + (uint32_t)(sleepUs / 1000);
+    s.hasSent = hasSent_;
+
+    LOG_I("[SLEEP] Despierto %u ms (%s, %u bytes TX), duermo %u s", awakeMs,
+          radio ? "con radio" : "sin radio", txBytes_, (unsigned)(sleepUs / 1000000));
+    logFlush();
+    Serial.flush();
+    esp_sleep_enable_timer_wakeup(sleepUs);
+    esp_deep_sleep_start();
+  }
+#endif
+
+  // Los máximos se reinician en cada reporte: muestran el peor caso de la ventana
+  void reportLoopStats() {
+    LOG_I("[LOOP] hueco max=%u us, poll max=%u us, sobre presupuesto=%u",
+          maxLoopGapUs_, maxPollUs_, pollOverBudget_);
+    maxLoopGapUs_ = 0;
+    maxPollUs_ = 0;
+#if NODE_LOG
+    if (logReady_ && (log_.pending() || log_.stats().appended)) {
+      const auto &s = log_.stats();
+      LOG_I("[LOG] pendientes=%u/%u guardadas=%u reenviadas=%u perdidas=%u corruptas=%u borrados=%u",
+            (unsigned)log_.pending(), (unsigned)log_.capacity(), s.appended, s.sent, s.overflow,
+            s.corrupt, s.erases);
+    }
+#endif
+  }
+
+  // ---------- Control ----------
+
+  void receivedCallback(uint32_t from, String &msg) {
+    uint32_t rxNodeUs = mesh_.getNodeTime();  // t_rx de PING/TRACE
+    const char *m = msg.c_str();
+    size_t len = msg.length();
+
+    // Clasificación previa: las lecturas de otros nodos no llegan a parsearse
+    ControlType type = controlClassify(m, len);
+    if (type == CTRL_DATA) {
+      LOG_D("[INFO] Mensaje no de control de %u: %s", from, m);
+      return;
+    }
+    LOG_D("[RX] %s de %u: %s", controlTypeName(type), from, m);
+
+    switch (type) {
+      case CTRL_ROOT: return handleRoot(m, len, rxNodeUs);
+      case CTRL_PING: return handlePing(m, len, rxNodeUs);
+      case CTRL_TOPO_REQ: return handleTopoReq(m, len);
+      case CTRL_TRACE: return handleTrace(m, len, rxNodeUs);
+      case CTRL_REPORT_CFG: return handleReportCfg(m, len);
+      case CTRL_PONG:
+        // Normalmente el nodo no inicia pings, solo log
+        LOG_D("[PONG] Recibido seq=%u desde %u", controlUint(m, len, "seq"), from);
+        return;
+      default:
+        return;  // respuestas dirigidas al root (TOPO, TRACE_REPLY, ...)
+    }
+  }
+
+  // ROOT: anuncio del gateway, a partir de aquí los datos van por unicast.
+  // Trae también las vueltas del tiempo del mesh de la gateway (MeshTime.h).
+  void handleRoot(const char *m, size_t len, uint32_t rxNodeUs) {
+    if (controlHas(m, len, "mt_wraps")) {
+      uint64_t gatewayUs = (uint64_t)controlUint(m, len, "mt_wraps") << 32 | controlUint(m, len, "mt");
+      meshClock_.adopt(gatewayUs, rxNodeUs, millis());
+    }
+    uint32_t announced = controlUint(m, len, "from");
+    rootBin_ = controlUint(m, len, "bin") >= SENSOR_FRAME_VERSION;
+    if (announced && announced != rootId_) {
+      rootId_ = announced;
+      LOG_I("[ROOT] Gateway anunciado: %u", rootId_);
+      resched();
+#if NODE_FAST_REJOIN
+      if (joinReported_) rejoin_.remember(WiFi.channel(), WiFi.BSSID(), rootId_);
+#endif
+    }
+    checkJoined();
+  }
+
+  // Los handlers de NodeControl.h escriben la respuesta; aquí sólo se envía
+
+  // PING: responder con PONG si dirigido a este nodo
+  void handlePing(const char *m, size_t len, uint32_t rxNodeUs) {
+    uint32_t myId = mesh_.getNodeId();
+    if (controlUint(m, len, "to") != myId) return;
+    uint32_t requester = controlUint(m, len, "from");
+
+    char buf[CONTROL_REPLY_MAX];
+    ControlWriter w(buf, sizeof(buf));
+    nodePong(w, m, len, myId, rxNodeUs, mesh_.getNodeTime());
+    reply(requester, w);
+    LOG_D("[PING] seq=%u de %u -> PONG enviado", controlUint(m, len, "seq"), requester);
+  }
+
+  // TOPO_REQ: responder con la lista de vecinos
+  void handleTopoReq(const char *m, size_t len) {
+    uint32_t requester = controlUint(m, len, "from");
+    auto list = mesh_.getNodeList();
+
+    char buf[CONTROL_REPLY_MAX];
+    ControlWriter w(buf, sizeof(buf));
+    nodeTopo(w, m, len, mesh_.getNodeId(), list);
+    reply(requester, w);
+    LOG_D("[TOPO_REQ] de %u -> TOPO enviado (%d vecinos)", requester, list.size());
+  }
+
+  // TRACE: responder si soy el destino o reenviar con mi salto agregado
+  void handleTrace(const char *m, size_t len, uint32_t rxNodeUs) {
+    char buf[CONTROL_REPLY_MAX];
+    ControlWriter w(buf, sizeof(buf));
+    if (nodeTrace(w, m, len, mesh_.getNodeId(), rxNodeUs, mesh_.getNodeTime())) {
+      reply(controlUint(m, len, "from"), w);
+      LOG_D("[TRACE] Destino alcanzado seq=%u, TRACE_REPLY enviado", controlUint(m, len, "seq"));
+      return;
+    }
+    if (!w.ok()) return;
+    uint32_t to = controlUint(m, len, "to");
+    txMsg_ = w.c_str();
+    txBytes_ += txMsg_.length();
+    mesh_.sendSingle(to, txMsg_);
+    LOG_D("[TRACE] Reenviado seq=%u hacia %u", controlUint(m, len, "seq"), to);
+  }
+
+  // REPORT_CFG: ajusta dead-band / heartbeat / periodo en caliente ("to": 0 = todos)
+  void handleReportCfg(const char *m, size_t len) {
+    uint32_t to = controlUint(m, len, "to");
+    uint32_t myId = mesh_.getNodeId();
+    if (to && to != myId) return;
+
+    if (nodeApplyReportCfg(m, len, report_)) {
+      taskSendData_.setInterval(TASK_SECOND * report_.periodS);
+      resched();
+    }
+
+    char buf[CONTROL_REPLY_MAX];
+    ControlWriter w(buf, sizeof(buf));
+    nodeReportCfgAck(w, m, len, myId, report_);
+    reply(controlUint(m, len, "from"), w);
+    LOG_I("[CFG] dead-band=%.2f heartbeat=%us periodo=%us",
+          report_.deadband, report_.heartbeatS, report_.periodS);
+  }
+
+  Scheduler userScheduler_;
+  Mesh mesh_;
+  TinyGPSPlus gps_;
+  HardwareSerial gpsSerial_;
+  Sensor sensor_;
+  Task taskSendData_;
+  Task taskLoopStats_;
+  String txMsg_;  // respuestas de control, ver reply()
+  MeshTime64 meshClock_;
+  uint32_t rootId_ = 0;
+  bool rootBin_ = false;  // el root acepta SensorFrame
+  bool joinReported_ = false;
+#if NODE_FAST_REJOIN
+  MeshRejoin rejoin_;
+#endif
+  uint16_t seq_ = 0;      // secuencia de lecturas enviadas
+
+  ReportPolicy report_ = {Sensor::deadband(), REPORT_HEARTBEAT_S, NODE_SLEEP_MODE ? SLEEP_PERIOD_S : SEND_INTERVAL_S};
+  float lastSentValue_ = 0.0f;
+  uint32_t lastSentMs_ = 0;
+  bool hasSent_ = false;
+  uint32_t suppressed_ = 0;
+  uint32_t txBytes_ = 0;  // bytes entregados al mesh (energía por ciclo)
+
+  uint16_t slotIndex_ = 0;
+  uint16_t slotCount_ = 1;
+  uint32_t lastSendTaskMs_ = 0;
+
+#if NODE_LOG
+  EspPartitionFlash logFlash_;
+  ReadingLog<EspPartitionFlash> log_{logFlash_};
+  bool logReady_ = false;
+#endif
+#if NODE_SLEEP_MODE
+  Task taskSleep_;
+  uint32_t joinedMs_ = 0;
+  uint32_t lingerFromMs_ = 0;
+  uint32_t sensorBeginMs_ = 0;
+#endif
+
+  uint32_t lastLoopUs_ = 0;
+  uint32_t maxLoopGapUs_ = 0;
+  uint32_t maxPollUs_ = 0;
+  uint32_t pollOverBudget_ = 0;
+};
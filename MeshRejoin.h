@@ -0,0 +1,131 @@
+#pragma once
+
+#include <Preferences.h>
+#include <WiFi.h>
+
+#include "DeferredLog.h"
+
+// Reingreso rápido tras un reinicio. Sin datos guardados, painlessMesh
+// arranca en su canal por defecto y el nodo escanea hasta dar con el mesh; en
+// un despliegue con muchos reinicios simultáneos eso se repite en todos los
+// nodos a la vez. Aquí se guarda en NVS el último canal que funcionó, el BSSID
+// del padre (el router en la gateway) y el id del root, y al arrancar:
+//   1. se escanea sólo el canal guardado buscando ese BSSID (~REJOIN_SCAN_MS_PER_CHAN);
+//   2. si el padre no aparece, sirve cualquier AP del mesh en ese canal;
+//   3. tras REJOIN_DIRECTED_TRIES intentos, barrido de todos los canales,
+//      acotado a REJOIN_FULL_TRIES; si tampoco aparece, el canal guardado o el
+//      de por defecto, y painlessMesh sigue buscando como siempre.
+// NVS sólo se escribe cuando algo cambia, no en cada unión.
+
+#ifndef REJOIN_NVS_NAMESPACE
+#define REJOIN_NVS_NAMESPACE "rejoin"
+#endif
+#ifndef REJOIN_DEFAULT_CHANNEL
+#define REJOIN_DEFAULT_CHANNEL 1  // el de painlessMesh::init
+#endif
+#define REJOIN_DIRECTED_TRIES 2
+#define REJOIN_FULL_TRIES 1
+#define REJOIN_SCAN_MS_PER_CHAN 120
+
+enum RejoinPath : uint8_t {
+  REJOIN_DIRECTED = 0,  // el padre guardado respondió en su canal
+  REJOIN_CHANNEL,       // otro AP del mesh en el canal guardado
+  REJOIN_SCAN,          // barrido completo
+  REJOIN_DEFAULT,       // nada visible: canal guardado o por defecto
+};
+
+inline const char *rejoinPathName(RejoinPath path) {
+  static const char *const names[] = {"directed", "channel", "scan", "default"};
+  return path <= REJOIN_DEFAULT ? names[path] : "?";
+}
+
+struct RejoinInfo {
+  uint8_t channel;  // 0 = nada guardado
+  uint8_t bssid[6];
+  uint32_t rootId;
+};
+
+class MeshRejoin {
+ public:
+  // Elige el canal con el que iniciar el mesh buscando el SSID dado (el del
+  // mesh en los nodos, el del router en la gateway). Bloquea lo que duren los
+  // escaneos: ~0.25 s en el caso dirigido, ~1.6 s por barrido completo.
+  uint8_t begin(const char *ssid) {
+    load();
+    uint32_t start = millis();
+    WiFi.mode(WIFI_STA);
+    uint8_t channel = 0;
+    if (saved_.channel) {
+      for (int i = 0; i < REJOIN_DIRECTED_TRIES && !channel; i++) {
+        if (scan(ssid, saved_.channel, saved_.bssid) > 0) {
+          channel = saved_.channel;
+          path_ = REJOIN_DIRECTED;
+        } else if (scan(ssid, saved_.channel, nullptr) > 0) {
+          channel = saved_.channel;
+          path_ = REJOIN_CHANNEL;
+        }
+      }
+    }
+    for (int i = 0; i < REJOIN_FULL_TRIES && !channel; i++) {
+      int n = scan(ssid, 0, nullptr);
+      int best = -1;
+      for (int j = 0; j < n; j++) {
+        if (best < 0 || WiFi.RSSI(j) > WiFi.RSSI(best)) best = j;
+      }
+      if (best >= 0) {
+        channel = WiFi.channel(best);
+        path_ = REJOIN_SCAN;
+      }
+    }
+    WiFi.scanDelete();
+    if (!channel) {
+      channel = saved_.channel ? saved_.channel : REJOIN_DEFAULT_CHANNEL;
+      path_ = REJOIN_DEFAULT;
+    }
+    scanMs_ = millis() - start;
+    channel_ = channel;
+    LOG_I("[REJOIN] Canal %u (%s) en %u ms; guardado: canal %u, root %u", channel_,
+          rejoinPathName(path_), scanMs_, saved_.channel, saved_.rootId);
+    return channel_;
+  }
+
+  // Último enlace que funcionó; sólo escribe NVS si cambió algo
+  void remember(uint8_t channel, const uint8_t *bssid, uint32_t rootId) {
+    if (!channel || !bssid) return;
+    if (channel == saved_.channel && rootId == saved_.rootId && memcmp(bssid, saved_.bssid, 6) == 0) return;
+    saved_.channel = channel;
+    memcpy(saved_.bssid, bssid, 6);
+    saved_.rootId = rootId;
+    Preferences prefs;
+    if (!prefs.begin(REJOIN_NVS_NAMESPACE, false)) return;
+    prefs.putBytes("info", &saved_, sizeof(saved_));
+    prefs.end();
+    LOG_I("[REJOIN] Guardado canal %u, padre %02x:%02x:%02x:%02x:%02x:%02x, root %u", channel,
+          bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5], rootId);
+  }
+
+  const RejoinInfo &saved() const { return saved_; }
+  RejoinPath path() const { return path_; }
+  uint8_t channel() const { return channel_; }
+  uint32_t scanMs() const { return scanMs_; }
+
+ private:
+  void load() {
+    Preferences prefs;
+    if (prefs.begin(REJOIN_NVS_NAMESPACE, true)) {
+      if (prefs.getBytes("info", &saved_, sizeof(saved_)) != sizeof(saved_)) saved_ = RejoinInfo{};
+      prefs.end();
+    }
+    if (saved_.channel > 14) saved_ = RejoinInfo{};
+  }
+
+  // Escaneo activo filtrado por SSID (y BSSID); channel 0 = todos
+  static int scan(const char *ssid, uint8_t channel, const uint8_t *bssid) {
+    return WiFi.scanNetworks(false, true, false, REJOIN_SCAN_MS_PER_CHAN, channel, ssid, bssid);
+  }
+
+  RejoinInfo saved_ = {};
+  RejoinPath path_ = REJOIN_DEFAULT;
+  uint8_t channel_ = 0;
+  uint32_t scanMs_ = 0;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+
+// Tiempo del mesh extendido a 64 bits.
+//
+// getNodeTime() de painlessMesh es un uint32 en us: da la vuelta cada ~71.6
+// min. Las ranuras de envío (MeshNodeRuntime.h) toman la fase como
+// tiempo % período, y con 32 bits la fase salta en cada vuelta salvo que el
+// período divida 2^32 us.
+//
+// MeshTime64 guarda un ancla (tiempo del mesh de 64 bits y millis() de ese
+// momento). at() estima el tiempo actual con el ancla más lo transcurrido en
+// millis() y se queda con el valor de 64 bits más cercano que tenga los 32
+// bits bajos de getNodeTime(). La estimación sólo tiene que acertar a media
+// vuelta (~35 min), así que los saltos de la sincronización del mesh no
+// cuentan como vueltas.
+//
+// Las vueltas tienen que ser las mismas en todos los nodos, no las que vio
+// cada uno desde su arranque: la gateway manda su tiempo de 64 bits en el
+// ROOT ("mt_wraps" y "mt") y cada nodo se ancla en él con adopt(). Hasta el
+// primer ROOT el nodo cuenta desde 0.
+//
+// C++ puro sin Arduino: bench_meshtime.cpp lo prueba en el host.
+
+// Valor de 64 bits con los 32 bits bajos de low más cercano a ref (sin bajar de 0)
+inline uint64_t meshTimeNearest(uint64_t ref, uint32_t low) {
+  int64_t d = (int32_t)(low - (uint32_t)ref);
+  if (d < 0 && (uint64_t)-d > ref) d += 0x100000000LL;
+  return ref + d;
+}
+
+class MeshTime64 {
+ public:
+  // Tiempo del mesh de 64 bits para la lectura nodeUs de getNodeTime() hecha
+  // en nowMs (millis()). Reancla en cada llamada; entre dos llamadas no
+  // pueden pasar más de 24 días (media vuelta de millis()).
+  uint64_t at(uint32_t nodeUs, uint32_t nowMs) {
+    uint64_t estimate = refUs_ + (int64_t)(int32_t)(nowMs - refMs_) * 1000;
+    refUs_ = meshTimeNearest(estimate, nodeUs);
+    refMs_ = nowMs;
+    return refUs_;
+  }
+
+  // ROOT de la gateway: gatewayUs es su tiempo de 64 bits al armarlo y
+  // nodeUs la lectura local al recibirlo
+  void adopt(uint64_t gatewayUs, uint32_t nodeUs, uint32_t nowMs) {
+    refUs_ = meshTimeNearest(gatewayUs, nodeUs);
+    refMs_ = nowMs;
+  }
+
+  // Ancla con una estimación propia (reloj RTC + offset tras el deep sleep)
+  void anchor(uint64_t meshUs, uint32_t nowMs) {
+    refUs_ = meshUs;
+    refMs_ = nowMs;
+  }
+
+ private:
+  uint64_t refUs_ = 0;
+  uint32_t refMs_ = 0;
+};
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ControlDispatch.h"
+
+// Topología del mesh vista desde la gateway. El root ya conoce el árbol
+// completo (mesh.subConnectionJson(), que painlessMesh mantiene con sus
+// propios NODE_SYNC), así que un TOPO_REQ con "to":0 se contesta desde esta
+// caché en vez de inundar el mesh y recibir N respuestas.
+//
+// - El árbol se guarda como aristas hijo -> padre ordenadas por hijo: cada
+//   nodo tiene un solo padre, así que comparar dos fotos es un merge.
+// - Cada foto distinta avanza la versión; el etag ("<arranque>-<versión>")
+//   cambia también al reiniciar la gateway, aunque la versión vuelva a 1.
+// - Un diff lleva "set" ([hijo, padre] nuevos o movidos) y "del" (hijos que
+//   ya no están); aplicado sobre la foto "base" da la foto "etag".
+//
+// C++ puro sin Arduino: bench_topo.cpp lo mide en el host.
+
+#ifndef TOPO_MAX_NODES
+#define TOPO_MAX_NODES 64
+#endif
+#define TOPO_ETAG_MAX 20
+// Peor caso: cada arista "[4294967295,4294967295]," más cabecera
+#define TOPO_JSON_MAX (TOPO_MAX_NODES * 24 + 160)
+
+struct TopoEdge {
+  uint32_t child;
+  uint32_t parent;
+};
+
+struct TopoSnapshot {
+  uint16_t count;
+  bool truncated;  // más de TOPO_MAX_NODES nodos: la foto está incompleta
+  TopoEdge edges[TOPO_MAX_NODES];
+};
+
+// Lee el árbol de subConnectionJson(): objetos {"nodeId":N,...,"subs":[...]}
+// anidados. El padre de un nodo es el nodeId del objeto que lo contiene; en
+// el nivel superior, rootId (según la versión de painlessMesh el JSON empieza
+// por el propio root o directamente por su arreglo de subs).
+inline void topoParse(const char *json, size_t len, uint32_t rootId, TopoSnapshot &out) {
+  const size_t kDepth = 32;
+  uint32_t ids[kDepth];
+  size_t depth = 0;  // objetos abiertos
+  out.count = 0;
+  out.truncated = false;
+  const char *p = json;
+  const char *end = json + len;
+  while (p < end) {
+    char c = *p;
+    if (c == '{') {
+      if (depth < kDepth) ids[depth] = depth ? ids[depth - 1] : rootId;
+      depth++;
+      p++;
+    } else if (c == '}') {
+      if (depth) depth--;
+      p++;
+    } else if (c == '"') {
+      const char *key = ++p;
+      while (p < end && *p != '"') p++;
+      bool isId = p - key == 6 && memcmp(key, "nodeId", 6) == 0;
+      p++;
+      if (!isId || !depth || depth > kDepth) continue;
+      while (p < end && (*p == ':' || *p == ' ')) p++;
+      uint32_t id = (uint32_t)strtoul(p, nullptr, 10);
+      uint32_t parent = depth > 1 ? ids[depth - 2] : rootId;
+      ids[depth - 1] = id;
+      if (id == parent || id == rootId) continue;
+      if (out.count == TOPO_MAX_NODES) {
+        out.truncated = true;
+        continue;
+      }
+      out.edges[out.count++] = TopoEdge{id, parent};
+    } else {
+      p++;
+    }
+  }
+  // Orden por hijo (inserción: n chico y casi siempre ya ordenado)
+  for (size_t i = 1; i < out.count; i++) {
+    TopoEdge e = out.edges[i];
+    size_t j = i;
+    for (; j > 0 && out.edges[j - 1].child > e.child; j--) out.edges[j] = out.edges[j - 1];
+    out.edges[j] = e;
+  }
+}
+
+class MeshTopology {
+ public:
+  explicit MeshTopology(uint32_t bootToken = 0) : boot_(bootToken) {}
+
+  // Nueva foto; devuelve true si cambió (y entonces avanza la versión y la
+  // anterior queda como base del diff)
+  bool update(const TopoSnapshot &s) {
+    if (version_ && s.count == cur_.count && s.truncated == cur_.truncated &&
+        memcmp(s.edges, cur_.edges, s.count * sizeof(TopoEdge)) == 0) {
+      return false;
+    }
+    prev_ = cur_;
+    prevVersion_ = version_;
+    cur_ = s;
+    version_++;
+    return true;
+  }
+
+  uint32_t version() const { return version_; }
+  const TopoSnapshot &current() const { return cur_; }
+
+  void etag(char *out, uint32_t version) const {
+    snprintf(out, TOPO_ETAG_MAX, "%08x-%u", (unsigned)boot_, (unsigned)version);
+  }
+  bool matches(const char *etagIn) const {
+    char e[TOPO_ETAG_MAX];
+    etag(e, version_);
+    return etagIn && strcmp(etagIn, e) == 0;
+  }
+
+  // {"type":"TOPO","from":gw,"etag":..,"version":v,"nodes":n,"edges":[[hijo,padre],...],"neighbors":[...]}
+  // "neighbors" son los hijos directos del root, como en el TOPO de un nodo
+  size_t writeSnapshot(uint32_t from, char *buf, size_t cap) const {
+    char e[TOPO_ETAG_MAX];
+    etag(e, version_);
+    ControlWriter w(buf, cap);
+    w.printf("{\"type\":\"TOPO\",\"from\":%u,\"etag\":\"%s\",\"version\":%u,\"nodes\":%u,", (unsigned)from, e,
+             (unsigned)version_, (unsigned)cur_.count + 1);
+    if (cur_.truncated) w.raw("\"truncated\":true,");
+    w.raw("\"edges\":[");
+    for (size_t i = 0; i < cur_.count; i++) {
+      w.printf(i ? ",[%u,%u]" : "[%u,%u]", (unsigned)cur_.edges[i].child, (unsigned)cur_.edges[i].parent);
+    }
+    w.raw("],\"neighbors\":[");
+    bool first = true;
+    for (size_t i = 0; i < cur_.count; i++) {
+      if (cur_.edges[i].parent != from) continue;
+      w.printf(first ? "%u" : ",%u", (unsigned)cur_.edges[i].child);
+      first = false;
+    }
+    w.raw("]}");
+    return w.ok() ? w.length() : 0;
+  }
+
+  // Respuesta a un TOPO_REQ cuyo etag ya es el actual
+  size_t writeUnchanged(uint32_t from, char *buf, size_t cap) const {
+    char e[TOPO_ETAG_MAX];
+    etag(e, version_);
+    ControlWriter w(buf, cap);
+    w.printf("{\"type\":\"TOPO\",\"from\":%u,\"etag\":\"%s\",\"version\":%u,\"unchanged\":true}", (unsigned)from, e,
+             (unsigned)version_);
+    return w.ok() ? w.length() : 0;
+  }
+
+  // {"type":"TOPO_DIFF","from":gw,"base":..,"etag":..,"set":[[hijo,padre],...],"del":[hijo,...]}
+  // del último update() que devolvió true
+  size_t writeDiff(uint32_t from, char *buf, size_t cap) const {
+    char base[TOPO_ETAG_MAX], e[TOPO_ETAG_MAX];
+    etag(base, prevVersion_);
+    etag(e, version_);
+    ControlWriter w(buf, cap);
+    w.printf("{\"type\":\"TOPO_DIFF\",\"from\":%u,\"base\":\"%s\",\"etag\":\"%s\",\"version\":%u,\"nodes\":%u,",
+             (unsigned)from, base, e, (unsigned)version_, (unsigned)cur_.count + 1);
+    if (cur_.truncated) w.raw("\"truncated\":true,");
+    w.raw("\"set\":[");
+    bool first = true;
+    size_t i = 0, j = 0;
+    // Merge de las dos fotos ordenadas por hijo
+    while (i < cur_.count) {
+      const TopoEdge &n = cur_.edges[i];
+      if (j < prev_.count && prev_.edges[j].child < n.child) {
+        j++;
+        continue;
+      }
+      bool same = j < prev_.count && prev_.edges[j].child == n.child && prev_.edges[j].parent == n.parent;
+      if (!same) {
+        w.printf(first ? "[%u,%u]" : ",[%u,%u]", (unsigned)n.child, (unsigned)n.parent);
+        first = false;
+      }
+      if (j < prev_.count && prev_.edges[j].child == n.child) j++;
+      i++;
+    }
+    w.raw("],\"del\":[");
+    first = true;
+    for (i = 0, j = 0; j < prev_.count; j++) {
+      while (i < cur_.count && cur_.edges[i].child < prev_.edges[j].child) i++;
+      if (i < cur_.count && cur_.edges[i].child == prev_.edges[j].child) continue;
+      w.printf(first ? "%u" : ",%u", (unsigned)prev_.edges[j].child);
+      first = false;
+    }
+    w.raw("]}");
+    return w.ok() ? w.length() : 0;
+  }
+
+ private:
+  uint32_t boot_;
+  uint32_t version_ = 0;
+  uint32_t prevVersion_ = 0;
+  TopoSnapshot cur_ = {};
+  TopoSnapshot prev_ = {};
+};
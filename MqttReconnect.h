@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Reconexión MQTT con backoff exponencial y jitter, un intento por vez.
+//
+// service() se llama en cada vuelta de la tarea MQTT: con la conexión arriba
+// sólo atiende client.loop(); caída, intenta connect() cuando vence la espera.
+// connect() de PubSubClient sigue siendo bloqueante (TCP + CONNACK, acotado
+// por setSocketTimeout()), por eso corre en la tarea MQTT del núcleo 0 y no
+// en loop(): el intento frena a esa tarea, nunca a mesh.update().
+//
+// Client es PubSubClient o un doble de prueba con:
+//   bool connected(); bool loop(); bool connect(const char *id); int state();
+// Clock es un functor que devuelve millis().
+//
+// C++ puro sin Arduino: bench_mqtt.cpp lo prueba en el host con un cliente falso.
+
+#ifndef MQTT_BACKOFF_MIN_MS
+#define MQTT_BACKOFF_MIN_MS 1000
+#endif
+#ifndef MQTT_BACKOFF_MAX_MS
+#define MQTT_BACKOFF_MAX_MS 60000
+#endif
+
+enum MqttEvent : uint8_t {
+  MQTT_IDLE = 0,        // nada nuevo
+  MQTT_UP,              // connect() acaba de funcionar
+  MQTT_ATTEMPT_FAILED,  // connect() falló; el próximo en lastWait() ms
+  MQTT_LOST,            // se cayó una conexión que estaba arriba
+};
+
+struct MqttStats {
+  uint32_t attempts;        // intentos de connect()
+  uint32_t failures;        // intentos fallidos
+  uint32_t lastAttemptMs;   // duración del último connect()
+  uint32_t maxAttemptMs;    // peor duración observada
+  uint32_t totalAttemptMs;  // tiempo acumulado dentro de connect()
+};
+
+template <typename Client, typename Clock>
+class MqttReconnect {
+ public:
+  MqttReconnect(Client &client, Clock clock) : client_(client), clock_(clock) {}
+
+  // Semilla del jitter, distinta en cada gateway para que no reintenten a la vez
+  void seed(uint32_t s) { rng_ = s ? s : 1; }
+
+  MqttEvent service(const char *clientId) {
+    if (client_.connected()) {
+      client_.loop();
+      return MQTT_IDLE;
+    }
+    uint32_t now = clock_();
+    if (up_) {
+      up_ = false;
+      backoff_ = MQTT_BACKOFF_MIN_MS;
+      lastWait_ = jitter(backoff_);
+      next_ = now + lastWait_;
+      return MQTT_LOST;
+    }
+    if ((int32_t)(now - next_) < 0) return MQTT_IDLE;
+
+    bool ok = client_.connect(clientId);
+    uint32_t end = clock_();
+    uint32_t elapsed = end - now;
+    stats_.attempts++;
+    stats_.lastAttemptMs = elapsed;
+    stats_.totalAttemptMs += elapsed;
+    if (elapsed > stats_.maxAttemptMs) stats_.maxAttemptMs = elapsed;
+    if (ok) {
+      up_ = true;
+      backoff_ = MQTT_BACKOFF_MIN_MS;
+      return MQTT_UP;
+    }
+    stats_.failures++;
+    lastWait_ = jitter(backoff_);
+    next_ = end + lastWait_;
+    backoff_ = backoff_ * 2 < MQTT_BACKOFF_MAX_MS ? backoff_ * 2 : MQTT_BACKOFF_MAX_MS;
+    return MQTT_ATTEMPT_FAILED;
+  }
+
+  bool up() const { return up_; }
+  uint32_t lastWait() const { return lastWait_; }  // espera elegida tras el último fallo o caída
+  uint32_t backoff() const { return backoff_; }    // base de la próxima espera
+  const MqttStats &stats() const { return stats_; }
+
+ private:
+  // Mitad fija + mitad aleatoria (xorshift32)
+  uint32_t jitter(uint32_t backoff) {
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    return backoff / 2 + rng_ % (backoff / 2 + 1);
+  }
+
+  Client &client_;
+  Clock clock_;
+  bool up_ = false;
+  uint32_t next_ = 0;  // el primer intento es inmediato
+  uint32_t backoff_ = MQTT_BACKOFF_MIN_MS;
+  uint32_t lastWait_ = 0;
+  uint32_t rng_ = 1;
+  MqttStats stats_ = {};
+};
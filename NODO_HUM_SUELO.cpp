@@ -1,364 +1,64 @@
-#include <painlessMesh.h>
-#include <ArduinoJson.h>
-#include <TinyGPS++.h>
+#include "AdcFilter.h"
+#include "MeshNodeRuntime.h"
 
-#define MESH_PREFIX "RED_Nodos"
-#define MESH_PASSWORD "RED_Nodos_1023374689"
-#define MESH_PORT 5555
-
-#define SOIL_PIN 34  
-#define GPS_BAUDRATE 9600
+#define SOIL_PIN 34
 
 // Calibración del sensor (ajusta según tu sensor)
 #define SOIL_DRY 3200    // Valor en aire (seco)
 #define SOIL_WET 1200    // Valor en agua (húmedo)
 
-Scheduler userScheduler;
-painlessMesh mesh;
-TinyGPSPlus gps;
-HardwareSerial gpsSerial(2);  // Serial2 para GPS
-
-Task taskSendData(TASK_SECOND * 10, TASK_FOREVER, []() {
-  int rawValue = analogRead(SOIL_PIN);
-  
-  // Invertir la escala (valores más altos = más seco)
-  // Mapear a porcentaje 0-100% (0% = seco, 100% = húmedo)
-  int percentage = map(rawValue, SOIL_DRY, SOIL_WET, 0, 100);
-  
-  // Limitar entre 0-100%
-  percentage = constrain(percentage, 0, 100);
-
-  // Construir JSON con humedad + GPS
-  #include <ArduinoJson.h>
-#include <TinyGPS++.h>
-#include <painlessMesh.h>
-
-#define MESH_PREFIX "RED_Nodos"
-#define MESH_PASSWORD "Horus9876"
-#define MESH_PORT 5555
-
-#define SOIL_PIN 34
-#define GPS_BAUDRATE 9600
-
-Scheduler userScheduler;
-painlessMesh mesh;
-TinyGPSPlus gps;
-HardwareSerial gpsSerial(2);  // Serial2 para GPS
+// Muestreo en segundo plano: mediana de ADC_MEDIAN_N + EMA, agregado por envío
+#define ADC_SAMPLE_INTERVAL_MS 50  // 20 Hz
+#define ADC_MEDIAN_N 5
+#define ADC_EMA_ALPHA 0.2f
 
-void newConnectionCallback(uint32_t nodeId) {
-  Serial.printf("Nueva conexión: %u\n", nodeId);
-}
+struct HumSueloSensor {
+  AdcFilter<ADC_MEDIAN_N> filter{ADC_EMA_ALPHA};
+  uint32_t nextSampleMs = 0;
 
-void changedConnectionCallback() {
-  Serial.printf("Conexiones: %d nodos\n", mesh.getNodeList().size());
-}
+  static const char *name() { return "HUMEDAD_SUELO"; }
+  static uint8_t type() { return SENSOR_SUELO; }
+  static float deadband() { return 2.0f; }  // %
+  static uint32_t sampleMs() { return (ADC_MEDIAN_N + 1) * ADC_SAMPLE_INTERVAL_MS; }  // una mediana completa
 
-void receivedCallback(uint32_t from, String &msg) {
-  // Debug crudo de mensaje recibido
-  Serial.printf("[RX] de %u: %s\n", from, msg.c_str());
-  
-  // Intentar parsear como JSON de control
-  StaticJsonDocument<512> doc;
-  DeserializationError err = deserializeJson(doc, msg);
-  
-  if (err == DeserializationError::Ok) {
-    const char* type = doc["type"];
-    if (type) {
-      // PING: responder con PONG si dirigido a este nodo
-      if (strcmp(type, "PING") == 0) {
-        uint32_t to = doc["to"].as<uint32_t>();
-        uint32_t seq = doc["seq"].as<uint32_t>();
-        uint32_t requester = doc["from"].as<uint32_t>();
-        uint32_t myId = mesh.getNodeId();
-        
-        if (to == myId) {
-          StaticJsonDocument<128> pong;
-          pong["type"] = "PONG";
-          pong["seq"] = seq;
-          pong["from"] = myId;
-          String out;
-          serializeJson(pong, out);
-          mesh.sendSingle(requester, out);
-          Serial.printf("[PING] seq=%u de %u -> PONG enviado\n", seq, requester);
-        }
-        return;
-      }
-      
-      // TOPO_REQ: responder con lista de vecinos
-      else if (strcmp(type, "TOPO_REQ") == 0) {
-        uint32_t requester = doc["from"].as<uint32_t>();
-        auto list = mesh.getNodeList();
-        StaticJsonDocument<256> topo;
-        topo["type"] = "TOPO";
-        JsonArray arr = topo.createNestedArray("neighbors");
-        for (auto id : list) arr.add(id);
-        String out;
-        serializeJson(topo, out);
-        mesh.sendSingle(requester, out);
-        Serial.printf("[TOPO_REQ] de %u -> TOPO enviado (%d vecinos)\n", requester, list.size());
-        return;
-      }
-      
-      // PONG: normalmente el nodo no inicia pings, solo log
-      else if (strcmp(type, "PONG") == 0) {
-        uint32_t seq = doc["seq"].as<uint32_t>();
-        Serial.printf("[PONG] Recibido seq=%u desde %u\n", seq, from);
-        return;
-      }
-      
-      // TRACE: agregar mi ID a la ruta y responder o reenviar
-      else if (strcmp(type, "TRACE") == 0) {
-        uint32_t to = doc["to"].as<uint32_t>();
-        uint32_t seq = doc["seq"].as<uint32_t>();
-        uint32_t originator = doc["from"].as<uint32_t>();
-        uint32_t myId = mesh.getNodeId();
-        
-        // Agregar mi ID al array de hops
-        JsonArray hops = doc["hops"].as<JsonArray>();
-        hops.add(myId);
-        
-        if (to == myId) {
-          // Soy el destino: responder con TRACE_REPLY
-          StaticJsonDocument<384> reply;
-          reply["type"] = "TRACE_REPLY";
-          reply["seq"] = seq;
-          reply["from"] = myId;
-          JsonArray replyHops = reply.createNestedArray("hops");
-          for(uint32_t hop : hops) replyHops.add(hop);
-          String out;
-          serializeJson(reply, out);
-          mesh.sendSingle(originator, out);
-          Serial.printf("[TRACE] Destino alcanzado seq=%u, TRACE_REPLY enviado a %u\n", seq, originator);
-        } else {
-          // Soy intermediario: reenviar con mi hop agregado
-          String out;
-          serializeJson(doc, out);
-          mesh.sendSingle(to, out);
-          Serial.printf("[TRACE] Reenviado seq=%u hacia %u (saltos=%d)\n", seq, to, hops.size());
-        }
-        return;
-      }
-    }
+  // Invertir la escala (valores más altos = más seco)
+  // Mapear a porcentaje 0-100% (0% = seco, 100% = húmedo)
+  static float toPercent(float raw) {
+    float pct = (raw - SOIL_DRY) * 100.0f / (SOIL_WET - SOIL_DRY);
+    return constrain(pct, 0.0f, 100.0f);
   }
-  
-  // Mensaje normal (datos de sensor u otro tipo)
-  Serial.printf("[INFO] Mensaje no de control: %s\n", msg.c_str());
-}
-
-Task taskSendData(TASK_SECOND * 10, TASK_FOREVER, []() {
-  int rawValue = analogRead(SOIL_PIN);
-  float soilMoisture = map(rawValue, 4095, 0, 0, 100);
 
-  StaticJsonDocument<192> doc;
-  doc["soil_moisture"] = soilMoisture;
-  if (gps.location.isValid()) {
-    doc["lat"] = gps.location.lat();
-    doc["lon"] = gps.location.lng();
-    Serial.printf("[GPS] OK - Sat: %d\n", gps.satellites.value());
-  } else {
-    doc["lat"] = "no data";
-    doc["lon"] = "no data";
-    Serial.printf("[GPS] Sin fix - Sat: %d, Chars: %d\n", gps.satellites.value(), gps.charsProcessed());
+  void begin() {
+    pinMode(SOIL_PIN, INPUT);
+    analogSetAttenuation(ADC_11db);  // Rango completo 0-3.3V
+    LOG_I("Sensor Humedad Suelo configurado");
   }
-  String payload;
-  serializeJson(doc, payload);
-  mesh.sendBroadcast(payload);
-  Serial.printf("[TX] HUMEDAD_SUELO -> %s\n", payload.c_str());
-  Serial.printf("[MESH] Nodos conectados: %d\n", mesh.getNodeList().size());
-});
 
-void setup() {
-  Serial.begin(115200);
-  delay(1000);
-  Serial.println("=== INICIANDO NODO HUMEDAD SUELO + GPS ===");
-  
-  pinMode(SOIL_PIN, INPUT);
-  Serial.println("Sensor Humedad Suelo configurado");
-  
-  // Inicializar GPS
-  gpsSerial.begin(GPS_BAUDRATE, SERIAL_8N1, 16, 17);
-
-  mesh.setDebugMsgTypes(ERROR | STARTUP | CONNECTION);
-  mesh.init(MESH_PREFIX, MESH_PASSWORD, &userScheduler, MESH_PORT);
-  
-  mesh.onReceive(&receivedCallback);
-  mesh.onNewConnection(&newConnectionCallback);
-  mesh.onChangedConnections(&changedConnectionCallback);
-
-  Serial.printf("NODE ID: %u\n", mesh.getNodeId());
-
-  userScheduler.addTask(taskSendData);
-  taskSendData.enable();
-  
-  Serial.println("Mesh configurado - Enviando datos cada 10s");
-}
-
-void loop() {
-  mesh.update();
-  userScheduler.execute();
-  
-  // Leer datos del GPS continuamente
-  while (gpsSerial.available() > 0) {
-    gps.encode(gpsSerial.read());
-  }
-}
-  
-  // Agregar coordenadas GPS
-  if (gps.location.isValid()) {
-    msg += ",\"lat\":" + String(gps.location.lat(), 6);
-    msg += ",\"lon\":" + String(gps.location.lng(), 6);
-    Serial.printf("GPS OK - Sat: %d\n", gps.satellites.value());
-  } else {
-    msg += ",\"lat\":\"no data\"";
-    msg += ",\"lon\":\"no data\"";
-    Serial.printf("GPS sin fix - Sat: %d, Chars: %d\n", 
-                  gps.satellites.value(), gps.charsProcessed());
+  void poll() {
+    if ((long)(millis() - nextSampleMs) < 0) return;
+    nextSampleMs = millis() + ADC_SAMPLE_INTERVAL_MS;
+    filter.push(analogRead(SOIL_PIN));
   }
-  
-  msg += "}";
-  
-  mesh.sendBroadcast(msg);
-  Serial.println("Enviado: " + msg);
-    Serial.printf("Nodos conectados: %d\n", mesh.getNodeList().size());
-});
 
-void receivedCallback(uint32_t from, String &msg) {
-  // Debug crudo de mensaje recibido
-  Serial.printf("[RX] de %u: %s\n", from, msg.c_str());
-  
-  // Intentar parsear como JSON de control
-  StaticJsonDocument<512> doc;
-  DeserializationError err = deserializeJson(doc, msg);
-  
-  Serial.printf("[DEBUG] DeserializationError: %s\n", err.c_str());
-  
-  if (err == DeserializationError::Ok) {
-    const char* type = doc["type"];
-    Serial.printf("[DEBUG] type extraído: %s (null=%d)\n", type ? type : "NULL", type == nullptr);
-    if (type) {
-      // PING: responder con PONG si dirigido a este nodo
-      if (strcmp(type, "PING") == 0) {
-        uint32_t to = doc["to"].as<uint32_t>();
-        uint32_t seq = doc["seq"].as<uint32_t>();
-        uint32_t requester = doc["from"].as<uint32_t>();
-        uint32_t myId = mesh.getNodeId();
-        
-        if (to == myId) {
-          StaticJsonDocument<128> pong;
-          pong["type"] = "PONG";
-          pong["seq"] = seq;
-          pong["from"] = myId;
-          String out;
-          serializeJson(pong, out);
-          mesh.sendSingle(requester, out);
-          Serial.printf("[PING] seq=%u de %u -> PONG enviado: %s\n", seq, requester, out.c_str());
-        } else {
-          Serial.printf("[PING] dirigido a %u, yo soy %u. Ignorado.\n", to, myId);
-        }
-        return;
-      }
-      
-      // TOPO_REQ: responder con lista de vecinos
-      else if (strcmp(type, "TOPO_REQ") == 0) {
-        uint32_t requester = doc["from"].as<uint32_t>();
-        auto list = mesh.getNodeList();
-        StaticJsonDocument<256> topo;
-        topo["type"] = "TOPO";
-        JsonArray arr = topo.createNestedArray("neighbors");
-        for (auto id : list) arr.add(id);
-        String out;
-        serializeJson(topo, out);
-        mesh.sendSingle(requester, out);
-        Serial.printf("[TOPO_REQ] de %u -> TOPO enviado (%d vecinos)\n", requester, list.size());
-        return;
-      }
-      
-      // PONG: normalmente el nodo no inicia pings, solo log
-      else if (strcmp(type, "PONG") == 0) {
-        uint32_t seq = doc["seq"].as<uint32_t>();
-        Serial.printf("[PONG] Recibido seq=%u desde %u\n", seq, from);
-        return;
-      }
-      
-      // TRACE: agregar mi ID a la ruta y responder o reenviar
-      else if (strcmp(type, "TRACE") == 0) {
-        uint32_t to = doc["to"].as<uint32_t>();
-        uint32_t seq = doc["seq"].as<uint32_t>();
-        uint32_t originator = doc["from"].as<uint32_t>();
-        uint32_t myId = mesh.getNodeId();
-        
-        // Agregar mi ID al array de hops
-        JsonArray hops = doc["hops"].as<JsonArray>();
-        hops.add(myId);
-        
-        if (to == myId) {
-          // Soy el destino: responder con TRACE_REPLY
-          StaticJsonDocument<384> reply;
-          reply["type"] = "TRACE_REPLY";
-          reply["seq"] = seq;
-          reply["from"] = myId;
-          JsonArray replyHops = reply.createNestedArray("hops");
-          for(uint32_t hop : hops) replyHops.add(hop);
-          String out;
-          serializeJson(reply, out);
-          mesh.sendSingle(originator, out);
-          Serial.printf("[TRACE] Destino alcanzado seq=%u, TRACE_REPLY enviado a %u\n", seq, originator);
-        } else {
-          // Soy intermediario: reenviar con mi hop agregado
-          String out;
-          serializeJson(doc, out);
-          mesh.sendSingle(to, out);
-          Serial.printf("[TRACE] Reenviado seq=%u hacia %u (saltos=%d)\n", seq, to, hops.size());
-        }
-        return;
-      }
-    }
+  bool read(SensorReading &r) {
+    AdcFilter<ADC_MEDIAN_N>::Window w = filter.takeWindow();
+    if (!w.count) return false;
+    r.values[0] = toPercent(w.mean);
+    // La escala está invertida: el crudo máximo es la humedad mínima
+    r.hasStats = true;
+    r.min = toPercent(w.max);
+    r.max = toPercent(w.min);
+    r.stddev = w.stddev * 100.0f / (SOIL_DRY - SOIL_WET);
+    return true;
   }
-  
-  // Mensaje normal (datos de sensor u otro tipo)
-  Serial.printf("[INFO] Mensaje no de control: %s\n", msg.c_str());
-}
-
-void newConnectionCallback(uint32_t nodeId) {
-  Serial.printf("Nueva conexión: %u\n", nodeId);
-}
+};
 
-void changedConnectionCallback() {
-  Serial.printf("Conexiones: %d nodos\n", mesh.getNodeList().size());
-}
+MeshNodeRuntime<HumSueloSensor> node;
 
 void setup() {
-  Serial.begin(115200);
-  delay(1000);
-  Serial.println("\n=== INICIANDO NODO HUMEDAD DE SUELO (SEN0193) + GPS ===");
-  
-  // Inicializar GPS
-  gpsSerial.begin(GPS_BAUDRATE, SERIAL_8N1, 16, 17);
-  
-  pinMode(SOIL_PIN, INPUT);
-  analogSetAttenuation(ADC_11db);  // Rango completo 0-3.3V
-    
-  mesh.setDebugMsgTypes(ERROR | STARTUP | CONNECTION);
-  mesh.init(MESH_PREFIX, MESH_PASSWORD, &userScheduler, MESH_PORT);
-  
-  Serial.printf("NODE ID: %u\n", mesh.getNodeId());
-  
-  mesh.onReceive(&receivedCallback);
-  mesh.onNewConnection(&newConnectionCallback);
-  mesh.onChangedConnections(&changedConnectionCallback);
-
-  userScheduler.addTask(taskSendData);
-  taskSendData.enable();
-  
-  Serial.printf("NODE ID: %u\n", mesh.getNodeId());
+  node.begin("\n=== INICIANDO NODO HUMEDAD DE SUELO (SEN0193) + GPS ===");
 }
 
 void loop() {
-  // Leer datos del GPS continuamente
-  while (gpsSerial.available() > 0) {
-    gps.encode(gpsSerial.read());
-  }
-  
-  mesh.update();
-  userScheduler.execute();
-}
\ No newline at end of file
+  node.update();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "ControlDispatch.h"
+
+// Handlers de control de los nodos sin el envío al mesh: leen el mensaje en
+// sitio y escriben la respuesta en un ControlWriter. MeshNodeRuntime sólo
+// agrega getNodeTime()/getNodeId() y el sendSingle; bench_dispatch.cpp mide
+// estas mismas funciones en el host.
+
+// Respuestas de control (PONG/TOPO/TRACE_REPLY/...) se arman en la pila
+#ifndef CONTROL_REPLY_MAX
+#define CONTROL_REPLY_MAX 384
+#endif
+#ifndef TRACE_MAX_HOPS
+#define TRACE_MAX_HOPS 24
+#endif
+
+struct ReportPolicy {
+  float deadband;
+  uint32_t heartbeatS;
+  uint32_t periodS;
+};
+
+// Sellos de latencia que viajan con PING/TRACE y vuelven en la respuesta:
+// srv_ms (app.py), gw_in/gw_tx (gateway). Los de tiempo del mesh son us.
+inline void nodeEchoStamps(ControlWriter &w, const char *m, size_t len) {
+  w.printf("\"srv_ms\":%u,\"gw_in\":%u,\"gw_tx\":%u,", controlUint(m, len, "srv_ms"),
+           controlUint(m, len, "gw_in"), controlUint(m, len, "gw_tx"));
+}
+
+// PING dirigido a myId -> PONG con t_rx/t_tx en tiempo del mesh
+inline void nodePong(ControlWriter &w, const char *m, size_t len, uint32_t myId, uint32_t rxUs, uint32_t txUs) {
+  w.printf("{\"type\":\"PONG\",\"seq\":%u,\"from\":%u,", controlUint(m, len, "seq"), myId);
+  nodeEchoStamps(w, m, len);
+  w.printf("\"t_rx\":%u,\"t_tx\":%u}", rxUs, txUs);
+}
+
+// TOPO_REQ -> TOPO con la lista de vecinos; seq vuelve para que la gateway
+// junte las respuestas de un broadcast (ControlTracker.h)
+template <typename Ids>
+inline void nodeTopo(ControlWriter &w, const char *m, size_t len, uint32_t myId, const Ids &neighbors) {
+  w.printf("{\"type\":\"TOPO\",\"seq\":%u,\"from\":%u,", controlUint(m, len, "seq"), myId)
+      .uintArray("neighbors", neighbors)
+      .raw("}");
+}
+
+// TRACE: agrega myId a la ruta. "ts" lleva, en paralelo a "hops", el instante
+// de llegada a cada salto (tiempo del mesh). Devuelve true si myId es el
+// destino (w tiene el TRACE_REPLY para "from"); false si w tiene el TRACE a
+// reenviar hacia "to".
+inline bool nodeTrace(ControlWriter &w, const char *m, size_t len, uint32_t myId, uint32_t rxUs, uint32_t txUs) {
+  uint32_t to = controlUint(m, len, "to");
+  uint32_t seq = controlUint(m, len, "seq");
+
+  uint32_t hops[TRACE_MAX_HOPS];
+  uint32_t ts[TRACE_MAX_HOPS];
+  size_t n = controlUintArray(m, len, "hops", hops, TRACE_MAX_HOPS - 1);
+  size_t nts = controlUintArray(m, len, "ts", ts, n);
+  while (nts < n) ts[nts++] = 0;  // saltos de firmware sin sellos
+  hops[n] = myId;
+  ts[n] = rxUs;
+  n++;
+
+  if (to == myId) {
+    w.printf("{\"type\":\"TRACE_REPLY\",\"seq\":%u,\"from\":%u,", seq, myId);
+    nodeEchoStamps(w, m, len);
+    w.uintArray("hops", UintSpan{hops, n}).raw(",").uintArray("ts", UintSpan{ts, n});
+    w.printf(",\"t_tx\":%u}", txUs);
+    return true;
+  }
+  w.printf("{\"type\":\"TRACE\",\"to\":%u,\"from\":%u,\"seq\":%u,", to, controlUint(m, len, "from"), seq);
+  nodeEchoStamps(w, m, len);
+  w.uintArray("hops", UintSpan{hops, n}).raw(",").uintArray("ts", UintSpan{ts, n}).raw("}");
+  return false;
+}
+
+// REPORT_CFG: aplica los campos presentes a p. Devuelve true si cambió el período.
+inline bool nodeApplyReportCfg(const char *m, size_t len, ReportPolicy &p) {
+  if (controlHas(m, len, "deadband")) p.deadband = controlFloat(m, len, "deadband", p.deadband);
+  if (controlHas(m, len, "heartbeat")) p.heartbeatS = controlUint(m, len, "heartbeat", p.heartbeatS);
+  if (!controlHas(m, len, "period")) return false;
+  uint32_t period = controlUint(m, len, "period", p.periodS);
+  p.periodS = period ? period : 1;
+  return true;
+}
+
+inline void nodeReportCfgAck(ControlWriter &w, const char *m, size_t len, uint32_t myId, const ReportPolicy &p) {
+  w.printf("{\"type\":\"REPORT_CFG_ACK\",\"seq\":%u,\"from\":%u,\"deadband\":%g,\"heartbeat\":%u,\"period\":%u}",
+           controlUint(m, len, "seq"), myId, p.deadband, p.heartbeatS, p.periodS);
+}
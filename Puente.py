@@ -25,6 +25,7 @@ DEFAULT_SERVER_URL = os.getenv(
     "SERVER_URL", "https://proyecto-redes-5b146a15d8b6.herokuapp.com"
 )
 HTTP_TIMEOUT = 10  
+SEQ_WINDOW = 64  # igual que SEQ_WINDOW_BITS de SeqWindow.h
 
 
 logger = logging.getLogger("mqtt_bridge")
@@ -65,21 +66,72 @@ class HTTPClient:
             return None
 
 
+class SeqTracker:
+    """Descarta lecturas repetidas por nodo con las reglas de SeqWindow.h.
+
+    La gateway ya filtra las repetidas del mesh; aquí quedan las que ella no
+    ve: re-publicaciones del store-and-forward y lo que llega después de un
+    reinicio de la gateway (que pierde su ventana).
+    """
+
+    def __init__(self, window: int = SEQ_WINDOW):
+        self._window = window
+        self._nodes: Dict[str, Dict[str, Any]] = {}
+        self.duplicates = 0
+
+    def accept(self, node_id: str, data: Dict[str, Any]) -> bool:
+        seq = data.get("seq")
+        if not isinstance(seq, int):
+            return True  # nodos viejos sin seq
+        first = data.get("reason") == "first"
+        backfill = "node_age_ms" in data  # sale del log en flash del nodo
+        st = self._nodes.get(node_id)
+        if st is None:
+            self._nodes[node_id] = {"top": seq, "seen": {seq}}
+            return True
+        # Aritmética de números de serie sobre uint16, como en la gateway
+        d = ((seq - st["top"] + 0x8000) & 0xFFFF) - 0x8000
+        if first and not backfill and d != 0:
+            self._nodes[node_id] = {"top": seq, "seen": {seq}}  # el nodo reinició
+            return True
+        if -self._window < d <= 0:
+            if seq in st["seen"]:
+                self.duplicates += 1
+                return False
+            st["seen"].add(seq)
+            return True
+        if backfill and d > 0:
+            return True  # puede ser de antes de un reinicio: no mueve la ventana
+        if d > 0:
+            st["top"] = seq
+            st["seen"] = {s for s in st["seen"] if (seq - s) & 0xFFFF < self._window}
+            st["seen"].add(seq)
+            return True
+        if not backfill:
+            self._nodes[node_id] = {"top": seq, "seen": {seq}}
+        return True
+
+
 class MQTTBridge:
     """Main bridge class that manages MQTT connection, message processing, and HTTP forwarding."""
 
-    CONTROL_TYPES = {"PONG", "TOPO", "TRACE_REPLY"}
+    CONTROL_TYPES = {"PONG", "TOPO", "TOPO_DIFF", "TRACE_REPLY", "REPORT_CFG_ACK", "POWER", "JOIN", "SEQ_STATS",
+                     "CTRL_RESULT"}
     NODE_TOPIC_RE = re.compile(r"([^/]+)$") 
+    BATCH_NODE_ID = "batch"  # Nodos/datos/batch: lote de tramas de la gateway
 
-    def __init__(self, broker: str, port: int, topic: str, server_url: str):
+    def __init__(self, broker: str, port: int, topic: str, server_url: str,
+                 latency_log: Optional[str] = None):
         self.broker = broker
         self.port = port
         self.topic = topic
         self.server_url = server_url.rstrip("/")
         self._stop_event = threading.Event()
+        self._latency_log = latency_log
 
         self._http = HTTPClient(self.server_url)
         self._node_cache: Dict[str, Dict[str, Any]] = {}
+        self._seq = SeqTracker()
         self._mqtt = mqtt.Client()
       
         self._mqtt.on_connect = self._on_connect
@@ -107,13 +159,40 @@ class MQTTBridge:
             logger.error("Failed to parse JSON from %s. Payload: %s", topic, payload)
             return
 
+        # Llegada al bridge de las respuestas de control (reloj de pared, ms
+        # módulo 2^32 como "srv_ms" de app.py) para separar broker/backend
+        if isinstance(parsed, dict) and parsed.get("type") in self.CONTROL_TYPES:
+            parsed["bridge_ms"] = int(time.time() * 1000) & 0xFFFFFFFF
+
         node_id = self._extract_node_id(topic)
+        if node_id == self.BATCH_NODE_ID:
+            self._enqueue_batch(topic, parsed)
+            return
+
         envelope = {"topic": topic, "node_id": node_id, "data": parsed, "raw_payload": payload}
-        
+        self._enqueue(envelope)
+
+    def _enqueue(self, envelope: Dict[str, Any]):
         try:
             self._work_q.put_nowait(envelope)
         except queue.Full:
-            logger.error("Work queue full; dropping message from %s", node_id)
+            logger.error("Work queue full; dropping message from %s", envelope["node_id"])
+
+    def _enqueue_batch(self, topic: str, items: Any):
+        """Separa un lote de Nodos/datos/batch en un sobre por trama."""
+        if not isinstance(items, list):
+            logger.error("Batch payload on %s is not a list; ignoring", topic)
+            return
+        logger.debug("Batch with %d frames on %s", len(items), topic)
+        for item in items:
+            data = item.get("data") if isinstance(item, dict) else None
+            if not isinstance(data, dict) or "from" not in item:
+                logger.warning("Skipping malformed batch item: %s", item)
+                continue
+            if item.get("age_ms"):
+                data["age_ms"] = item["age_ms"]
+            node_id = str(item["from"])
+            self._enqueue({"topic": topic, "node_id": node_id, "data": data, "raw_payload": json.dumps(data)})
 
  
     def _worker_loop(self):
@@ -139,6 +218,8 @@ class MQTTBridge:
         # Control messages
         if isinstance(data, dict) and "type" in data and data["type"] in self.CONTROL_TYPES:
             logger.info("Detected control message type=%s -> forwarding to control endpoint", data["type"])
+            if data["type"] == "SEQ_STATS":
+                self._log_seq_stats(data)
             self._forward_control_message(data)
             return
 
@@ -149,8 +230,17 @@ class MQTTBridge:
             return
 
    
+        # Tramas diferidas traen su antigüedad: age_ms del store-and-forward del
+        # gateway y node_age_ms del log en flash del nodo (se suman)
+        age_ms = 0
+        if isinstance(data, dict):
+            if not self._seq.accept(node_id, data):
+                logger.info("Duplicate reading from node=%s seq=%s dropped (total %d)",
+                            node_id, data.get("seq"), self._seq.duplicates)
+                return
+            age_ms = (data.pop("age_ms", 0) or 0) + (data.pop("node_age_ms", 0) or 0)
         self._update_cache_with_sensor_data(node_id, data)
-        complete_payload = {"nodeId": node_id, "timestamp": int(time.time())}
+        complete_payload = {"nodeId": node_id, "timestamp": int(time.time() - age_ms / 1000.0)}
         complete_payload.update(self._node_cache.get(node_id, {}))
 
         logger.info("Forwarding aggregated data to server: %s", complete_payload)
@@ -169,7 +259,9 @@ class MQTTBridge:
         return m.group(1) if m else "unknown"
 
     def _forward_control_message(self, data: Dict[str, Any]):
-        
+        if self._latency_log:
+            self._append_latency_log(data)
+
         base = self.server_url.replace("/datos", "")
         endpoint = f"{base}/api/control_response"
         resp = self._http.post(endpoint, data)
@@ -178,6 +270,24 @@ class MQTTBridge:
         else:
             logger.info("Control forward returned %s", resp.status_code)
 
+    def _append_latency_log(self, data: Dict[str, Any]):
+        """Una respuesta de control por línea, para latencia_analisis.py."""
+        try:
+            with open(self._latency_log, "a", encoding="utf-8") as f:
+                f.write(json.dumps(data) + "\n")
+        except OSError as exc:
+            logger.warning("Could not write latency log %s: %s", self._latency_log, exc)
+
+    def _log_seq_stats(self, data: Dict[str, Any]):
+        """SEQ_STATS: [id, recibidas, perdidas, repetidas, desordenadas, reinicios] por nodo."""
+        for row in data.get("stats", []):
+            if not isinstance(row, list) or len(row) < 6:
+                continue
+            node, received, lost, dup, reordered, restarts = row[:6]
+            total = received + lost
+            logger.info("Seq node=%s received=%d lost=%d (%.1f%%) dup=%d reordered=%d restarts=%d",
+                        node, received, lost, 100.0 * lost / total if total else 0.0, dup, reordered, restarts)
+
     def _handle_gateway_report(self, data: Dict[str, Any]):
         payload = {
             "nodeId": "gateway",
@@ -268,6 +378,7 @@ def parse_args():
     p.add_argument("--port", type=int, default=DEFAULT_PORT, help="MQTT broker port")
     p.add_argument("--topic", default=DEFAULT_TOPIC, help="MQTT topic pattern to subscribe to")
     p.add_argument("--server", default=DEFAULT_SERVER_URL, help="HTTP server base URL")
+    p.add_argument("--latency-log", help="Append control replies (PONG/TRACE_REPLY...) as JSON lines to this file")
     p.add_argument("--debug", action="store_true", help="Enable debug logging")
     return p.parse_args()
 
@@ -278,7 +389,8 @@ def main():
         logger.setLevel(logging.DEBUG)
         logger.debug("Debug logging enabled")
 
-    bridge = MQTTBridge(broker=args.broker, port=args.port, topic=args.topic, server_url=args.server)
+    bridge = MQTTBridge(broker=args.broker, port=args.port, topic=args.topic, server_url=args.server,
+                        latency_log=args.latency_log)
     _install_signal_handlers(bridge)
 
     try:
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Buffer local de lecturas para cuando el nodo no alcanza al root. Vive en
+// flash, así que sobrevive a deep sleep, reinicios y cortes de energía.
+//
+// Formato: anillo de sectores con registros fijos de READING_LOG_RECORD bytes:
+//   [0]      estado: 0xFF libre, 0x7F pendiente, 0x3F enviado
+//   [1]      época (aumenta en cada arranque en frío)
+//   [2..3]   CRC-16 de [4..]
+//   [4..7]   seq del registro (creciente, define el orden de reenvío)
+//   [8..11]  instante de la lectura, ms del reloj RTC de esa época
+//   [12]     largo de la trama
+//   [13..]   SensorFrame empaquetada (packSensorFrame)
+//
+// Sólo se programan bits 1 -> 0, como exige la NOR flash. El registro se
+// escribe con el estado en 0xFF y se confirma después programando 0x7F; un
+// corte a mitad de escritura deja un slot "sucio" que el montaje salta. Marcar
+// como enviado es otra programación del mismo byte, sin borrar.
+//
+// Desgaste: cada sector se borra una vez por vuelta completa del anillo. Con
+// 16 sectores de 4 KB (1632 registros) y una lectura cada 10 s sin root, una
+// vuelta dura ~4.5 h, así que 100k ciclos de borrado son décadas de cortes.
+//
+// Flash es la interfaz del medio (ver EspPartitionFlash abajo):
+//   size_t sectorCount() const;
+//   bool read(uint32_t addr, void *buf, size_t len);
+//   bool write(uint32_t addr, const void *buf, size_t len);  // sólo 1 -> 0
+//   bool erase(uint32_t sector);                              // todo a 0xFF
+// C++ puro sin Arduino: se puede probar en host contra una flash simulada.
+
+#ifndef READING_LOG_SECTOR_SIZE
+#define READING_LOG_SECTOR_SIZE 4096
+#endif
+#define READING_LOG_RECORD 40
+#define READING_LOG_HEADER 13
+#define READING_LOG_DATA_MAX (READING_LOG_RECORD - READING_LOG_HEADER)
+
+template <typename Flash>
+class ReadingLog {
+ public:
+  static const size_t kPerSector = READING_LOG_SECTOR_SIZE / READING_LOG_RECORD;
+
+  struct Entry {
+    uint32_t seq;
+    uint32_t tMs;
+    uint8_t epoch;
+    uint8_t len;
+    uint8_t data[READING_LOG_DATA_MAX];
+  };
+
+  struct Stats {
+    uint32_t appended;  // registros escritos
+    uint32_t sent;      // registros marcados como enviados
+    uint32_t overflow;  // pendientes perdidos al reutilizar un sector
+    uint32_t corrupt;   // registros con CRC inválido o escritura cortada
+    uint32_t erases;    // borrados de sector (desgaste)
+  };
+
+  explicit ReadingLog(Flash &flash) : flash_(flash) {}
+
+  // Recorre la flash y reconstruye cabeza, cola y pendientes. coldBoot abre
+  // una época nueva: los instantes de épocas anteriores usan otro reloj.
+  bool mount(bool coldBoot) {
+    slots_ = flash_.sectorCount() * kPerSector;
+    if (flash_.sectorCount() < 2) return false;
+
+    bool any = false;
+    uint32_t maxSeq = 0, minPendingSeq = 0;
+    size_t head = 0, tail = 0;
+    uint8_t lastEpoch = 0;
+    pending_ = 0;
+    for (size_t i = 0; i < slots_; i++) {
+      uint8_t rec[READING_LOG_RECORD];
+      if (!flash_.read(addr(i), rec, sizeof(rec))) return false;
+      uint8_t state = rec[0];
+      if (state == kFree) continue;
+      if ((state != kPending && state != kSent) || crc16(rec + 4, READING_LOG_RECORD - 4) != get16(rec + 2)) {
+        stats_.corrupt++;
+        continue;
+      }
+      uint32_t seq = get32(rec + 4);
+      if (!any || (int32_t)(seq - maxSeq) > 0) {
+        maxSeq = seq;
+        head = i;
+        lastEpoch = rec[1];
+      }
+      if (state == kPending) {
+        if (!pending_ || (int32_t)(seq - minPendingSeq) < 0) {
+          minPendingSeq = seq;
+          tail = i;
+        }
+        pending_++;
+      }
+      any = true;
+    }
+
+    nextSeq_ = any ? maxSeq + 1 : 1;
+    epoch_ = coldBoot ? (uint8_t)(lastEpoch + 1) : lastEpoch;
+    writePos_ = any ? (head + 1) % slots_ : 0;
+    readPos_ = pending_ ? tail : writePos_;
+    return true;
+  }
+
+  // Agrega una lectura; si el anillo está lleno pisa el sector más antiguo
+  bool append(const uint8_t *data, size_t len, uint32_t tMs) {
+    if (len > READING_LOG_DATA_MAX || !slots_) return false;
+    if (!prepareSlot()) return false;
+
+    uint8_t rec[READING_LOG_RECORD];
+    memset(rec, 0xFF, sizeof(rec));
+    rec[1] = epoch_;
+    put32(rec + 4, nextSeq_);
+    put32(rec + 8, tMs);
+    rec[12] = (uint8_t)len;
+    memcpy(rec + READING_LOG_HEADER, data, len);
+    put16(rec + 2, crc16(rec + 4, READING_LOG_RECORD - 4));
+
+    // Cuerpo primero (estado en 0xFF) y después la confirmación
+    uint32_t a = addr(writePos_);
+    if (!flash_.write(a + 1, rec + 1, READING_LOG_RECORD - 1)) return false;
+    uint8_t state = kPending;
+    if (!flash_.write(a, &state, 1)) return false;
+
+    if (!pending_) readPos_ = writePos_;
+    writePos_ = (writePos_ + 1) % slots_;
+    nextSeq_++;
+    pending_++;
+    stats_.appended++;
+    return true;
+  }
+
+  // Lectura pendiente más antigua, sin consumirla; false si no hay
+  bool peek(Entry &e) {
+    while (pending_) {
+      uint8_t rec[READING_LOG_RECORD];
+      if (!flash_.read(addr(readPos_), rec, sizeof(rec))) return false;
+      if (rec[0] == kPending && crc16(rec + 4, READING_LOG_RECORD - 4) == get16(rec + 2)) {
+        e.seq = get32(rec + 4);
+        e.tMs = get32(rec + 8);
+        e.epoch = rec[1];
+        e.len = rec[12] <= READING_LOG_DATA_MAX ? rec[12] : 0;
+        memcpy(e.data, rec + READING_LOG_HEADER, e.len);
+        return true;
+      }
+      if (readPos_ == writePos_) {
+        pending_ = 0;  // no quedan pendientes reales (contador desfasado)
+        return false;
+      }
+      readPos_ = (readPos_ + 1) % slots_;
+    }
+    return false;
+  }
+
+  // Marca como enviada la lectura devuelta por peek()
+  void pop() {
+    if (!pending_) return;
+    uint8_t state = kSent;
+    flash_.write(addr(readPos_), &state, 1);
+    readPos_ = (readPos_ + 1) % slots_;
+    pending_--;
+    stats_.sent++;
+  }
+
+  size_t pending() const { return pending_; }
+  size_t capacity() const { return slots_; }
+  uint8_t epoch() const { return epoch_; }
+  const Stats &stats() const { return stats_; }
+
+ private:
+  static const uint8_t kFree = 0xFF;
+  static const uint8_t kPending = 0x7F;
+  static const uint8_t kSent = 0x3F;
+
+  uint32_t addr(size_t slot) const {
+    return (uint32_t)((slot / kPerSector) * READING_LOG_SECTOR_SIZE + (slot % kPerSector) * READING_LOG_RECORD);
+  }
+
+  // Deja writePos_ en un slot borrado: salta slots sucios (cortes a mitad de
+  // escritura) y borra el sector siguiente al entrar en él
+  bool prepareSlot() {
+    for (size_t guard = 0; guard <= slots_; guard++) {
+      if (writePos_ % kPerSector == 0 && !sectorClean(writePos_ / kPerSector)) {
+        if (!eraseSector(writePos_ / kPerSector)) return false;
+      }
+      uint8_t rec[READING_LOG_RECORD];
+      if (!flash_.read(addr(writePos_), rec, sizeof(rec))) return false;
+      if (allErased(rec, sizeof(rec))) return true;
+      writePos_ = (writePos_ + 1) % slots_;
+    }
+    return false;
+  }
+
+  bool sectorClean(size_t sector) {
+    uint8_t buf[READING_LOG_RECORD];
+    for (size_t i = 0; i < kPerSector; i++) {
+      if (!flash_.read(addr(sector * kPerSector + i), buf, sizeof(buf)) || !allErased(buf, sizeof(buf))) return false;
+    }
+    return true;
+  }
+
+  // Los pendientes del sector se pierden (los más antiguos del anillo)
+  bool eraseSector(size_t sector) {
+    size_t first = sector * kPerSector;
+    for (size_t i = 0; i < kPerSector && pending_; i++) {
+      uint8_t state;
+      if (flash_.read(addr(first + i), &state, 1) && state == kPending) {
+        pending_--;
+        stats_.overflow++;
+      }
+    }
+    if (!flash_.erase((uint32_t)sector)) return false;
+    stats_.erases++;
+    if (readPos_ >= first && readPos_ < first + kPerSector) {
+      readPos_ = pending_ ? (first + kPerSector) % slots_ : writePos_;
+    }
+    return true;
+  }
+
+  static bool allErased(const uint8_t *p, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      if (p[i] != 0xFF) return false;
+    }
+    return true;
+  }
+
+  static uint16_t crc16(const uint8_t *p, size_t n) {
+    uint16_t crc = 0xFFFF;  // CRC-16/CCITT-FALSE
+    while (n--) {
+      crc ^= (uint16_t)*p++ << 8;
+      for (int b = 0; b < 8; b++) crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+  }
+
+  static void put16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+  static void put32(uint8_t *p, uint32_t v) { put16(p, v); put16(p + 2, v >> 16); }
+  static uint16_t get16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+  static uint32_t get32(const uint8_t *p) { return get16(p) | ((uint32_t)get16(p + 2) << 16); }
+
+  Flash &flash_;
+  size_t slots_ = 0;
+  size_t writePos_ = 0;
+  size_t readPos_ = 0;
+  size_t pending_ = 0;
+  uint32_t nextSeq_ = 1;
+  uint8_t epoch_ = 0;
+  Stats stats_ = {};
+};
+
+#if defined(ESP_PLATFORM)
+#include <esp_partition.h>
+
+#ifndef READING_LOG_PARTITION
+#define READING_LOG_PARTITION "spiffs"  // los nodos no usan SPIFFS
+#endif
+#ifndef READING_LOG_SECTORS
+#define READING_LOG_SECTORS 16
+#endif
+
+// Los primeros READING_LOG_SECTORS sectores de una partición de datos
+class EspPartitionFlash {
+ public:
+  bool begin() {
+    part_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, READING_LOG_PARTITION);
+    return part_ != nullptr;
+  }
+  size_t sectorCount() const {
+    if (!part_) return 0;
+    size_t n = part_->size / READING_LOG_SECTOR_SIZE;
+    return n < READING_LOG_SECTORS ? n : READING_LOG_SECTORS;
+  }
+  bool read(uint32_t addr, void *buf, size_t len) {
+    return esp_partition_read(part_, addr, buf, len) == ESP_OK;
+  }
+  bool write(uint32_t addr, const void *buf, size_t len) {
+    return esp_partition_write(part_, addr, buf, len) == ESP_OK;
+  }
+  bool erase(uint32_t sector) {
+    return esp_partition_erase_range(part_, sector * READING_LOG_SECTOR_SIZE, READING_LOG_SECTOR_SIZE) == ESP_OK;
+  }
+
+ private:
+  const esp_partition_t *part_ = nullptr;
+};
+#endif
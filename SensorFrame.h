@@ -0,0 +1,303 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Trama binaria de sensor, versión 1. No depende de Arduino: la usan los
+// nodos (codificar), la gateway (decodificar a JSON) y puede compilarse en host.
+//
+// Disposición (little-endian):
+//   [0]     versión (SENSOR_FRAME_VERSION)
+//   [1]     tipo de sensor (SensorType)
+//   [2]     flags (SENSOR_FLAG_*; bits 2-3 = SensorReason)
+//   [3..4]  seq del nodo (uint16)
+//   [5..8]  instante de muestreo, ms de tiempo mesh (uint32)
+//   [9..]   valores int16 en punto fijo, cantidad y escala según el tipo
+//   [..]    si SENSOR_FLAG_GPS: lat, lon en int32 (grados * 1e6)
+//   [..]    si SENSOR_FLAG_STATS: min, max, desviación del primer valor en la
+//           ventana de muestreo, int16 con la misma escala
+//
+// painlessMesh transporta String dentro de JSON, así que la trama viaja en
+// base64 (sin padding) precedida de SENSOR_FRAME_MARKER.
+
+#define SENSOR_FRAME_VERSION 1
+#define SENSOR_FRAME_MARKER '#'
+#define SENSOR_FRAME_MAX_VALUES 2
+#define SENSOR_FRAME_HEADER_LEN 9
+#define SENSOR_FRAME_MAX_BIN (SENSOR_FRAME_HEADER_LEN + 2 * SENSOR_FRAME_MAX_VALUES + 8 + 6)
+#define SENSOR_FRAME_MAX_TEXT (1 + (SENSOR_FRAME_MAX_BIN * 4 + 2) / 3 + 1)
+
+enum SensorType : uint8_t {
+  SENSOR_TEMPERATURA = 1,
+  SENSOR_HUMEDAD = 2,
+  SENSOR_LUZ = 3,
+  SENSOR_SUELO = 4,
+};
+
+enum SensorFlags : uint8_t {
+  SENSOR_FLAG_GPS = 0x01,
+  SENSOR_FLAG_STATS = 0x02,
+};
+
+// Motivo del envío, en los bits 2-3 de flags. Junto con seq permite al
+// backend distinguir "sin cambios" (no hay trama, seq continuo) de "perdida".
+enum SensorReason : uint8_t {
+  SENSOR_REASON_PERIODIC = 0,
+  SENSOR_REASON_CHANGE = 1,
+  SENSOR_REASON_HEARTBEAT = 2,
+  SENSOR_REASON_FIRST = 3,
+};
+#define SENSOR_REASON_SHIFT 2
+#define SENSOR_REASON_MASK 0x0C
+
+inline uint8_t sensorReason(uint8_t flags) {
+  return (flags & SENSOR_REASON_MASK) >> SENSOR_REASON_SHIFT;
+}
+
+inline const char *sensorReasonName(uint8_t reason) {
+  static const char *const names[] = {"periodic", "change", "heartbeat", "first"};
+  return names[reason & 0x03];
+}
+
+struct SensorField {
+  const char *key;  // clave JSON que espera el backend
+  int16_t scale;    // valor real = fijo / scale
+};
+
+struct SensorTypeInfo {
+  uint8_t count;
+  SensorField fields[SENSOR_FRAME_MAX_VALUES];
+};
+
+inline const SensorTypeInfo *sensorTypeInfo(uint8_t type) {
+  static const SensorTypeInfo table[] = {
+    {1, {{"temperatura", 100}, {nullptr, 0}}},
+    {1, {{"humidity", 100}, {nullptr, 0}}},
+    {2, {{"light", 10}, {"percentage", 100}}},
+    {1, {{"soil_moisture", 100}, {nullptr, 0}}},
+  };
+  if (type < SENSOR_TEMPERATURA || type > SENSOR_SUELO) return nullptr;
+  return &table[type - 1];
+}
+
+struct SensorFrame {
+  uint8_t type;
+  uint8_t flags;
+  uint16_t seq;
+  uint32_t sampleMs;
+  int16_t values[SENSOR_FRAME_MAX_VALUES];
+  int32_t latE6;
+  int32_t lonE6;
+  int16_t statMin;
+  int16_t statMax;
+  int16_t statStd;
+};
+
+namespace sensorframe {
+
+inline int16_t toFixed(float v, int16_t scale) {
+  float f = v * scale;
+  if (f > 32767.0f) return 32767;
+  if (f < -32768.0f) return -32768;
+  return (int16_t)(f < 0 ? f - 0.5f : f + 0.5f);
+}
+
+inline int32_t toE6(double deg) {
+  double f = deg * 1e6;
+  return (int32_t)(f < 0 ? f - 0.5 : f + 0.5);
+}
+
+inline void put16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+inline void put32(uint8_t *p, uint32_t v) { put16(p, v); put16(p + 2, v >> 16); }
+inline uint16_t get16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+inline uint32_t get32(const uint8_t *p) { return get16(p) | ((uint32_t)get16(p + 2) << 16); }
+
+static const char kB64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+inline int b64Value(char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '+') return 62;
+  if (c == '/') return 63;
+  return -1;
+}
+
+// Base64 sin padding; devuelve caracteres escritos (sin contar el '\0')
+inline size_t b64Encode(const uint8_t *in, size_t len, char *out) {
+  size_t o = 0;
+  uint32_t acc = 0;
+  int bits = 0;
+  for (size_t i = 0; i < len; i++) {
+    acc = (acc << 8) | in[i];
+    bits += 8;
+    while (bits >= 6) {
+      bits -= 6;
+      out[o++] = kB64[(acc >> bits) & 0x3F];
+    }
+  }
+  if (bits) out[o++] = kB64[(acc << (6 - bits)) & 0x3F];
+  out[o] = '\0';
+  return o;
+}
+
+// Devuelve bytes decodificados, o -1 si hay caracteres inválidos o no cabe
+inline int b64Decode(const char *in, size_t len, uint8_t *out, size_t outMax) {
+  size_t o = 0;
+  uint32_t acc = 0;
+  int bits = 0;
+  for (size_t i = 0; i < len; i++) {
+    int v = b64Value(in[i]);
+    if (v < 0) return -1;
+    acc = (acc << 6) | v;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      if (o >= outMax) return -1;
+      out[o++] = (acc >> bits) & 0xFF;
+    }
+  }
+  return (int)o;
+}
+
+// "-12.34" a partir de un valor en punto fijo
+inline int formatFixed(char *buf, size_t size, int32_t fixed, int32_t scale) {
+  int digits = scale >= 1000000 ? 6 : scale >= 100 ? 2 : scale >= 10 ? 1 : 0;
+  uint32_t mag = fixed < 0 ? (uint32_t)(-(int64_t)fixed) : (uint32_t)fixed;
+  if (!digits) return snprintf(buf, size, "%s%lu", fixed < 0 ? "-" : "", (unsigned long)mag);
+  return snprintf(buf, size, "%s%lu.%0*lu", fixed < 0 ? "-" : "",
+                  (unsigned long)(mag / scale), digits, (unsigned long)(mag % scale));
+}
+
+}  // namespace sensorframe
+
+inline bool isSensorFrame(const char *text, size_t len) {
+  return len > 1 && text[0] == SENSOR_FRAME_MARKER;
+}
+
+// Binario crudo (sin base64) en bin[SENSOR_FRAME_MAX_BIN]; 0 si el tipo no existe.
+// Lo usa también el buffer local de los nodos (ReadingLog.h).
+inline size_t packSensorFrame(const SensorFrame &f, uint8_t *bin) {
+  using namespace sensorframe;
+  const SensorTypeInfo *info = sensorTypeInfo(f.type);
+  if (!info) return 0;
+
+  size_t n = 0;
+  bin[n++] = SENSOR_FRAME_VERSION;
+  bin[n++] = f.type;
+  bin[n++] = f.flags;
+  put16(bin + n, f.seq); n += 2;
+  put32(bin + n, f.sampleMs); n += 4;
+  for (uint8_t i = 0; i < info->count; i++) {
+    put16(bin + n, (uint16_t)f.values[i]); n += 2;
+  }
+  if (f.flags & SENSOR_FLAG_GPS) {
+    put32(bin + n, (uint32_t)f.latE6); n += 4;
+    put32(bin + n, (uint32_t)f.lonE6); n += 4;
+  }
+  if (f.flags & SENSOR_FLAG_STATS) {
+    put16(bin + n, (uint16_t)f.statMin); n += 2;
+    put16(bin + n, (uint16_t)f.statMax); n += 2;
+    put16(bin + n, (uint16_t)f.statStd); n += 2;
+  }
+  return n;
+}
+
+inline bool unpackSensorFrame(const uint8_t *bin, size_t n, SensorFrame &f) {
+  using namespace sensorframe;
+  if (n < SENSOR_FRAME_HEADER_LEN || bin[0] != SENSOR_FRAME_VERSION) return false;
+
+  const SensorTypeInfo *info = sensorTypeInfo(bin[1]);
+  if (!info) return false;
+  size_t expected = SENSOR_FRAME_HEADER_LEN + 2 * info->count + ((bin[2] & SENSOR_FLAG_GPS) ? 8 : 0) +
+                    ((bin[2] & SENSOR_FLAG_STATS) ? 6 : 0);
+  if (n != expected) return false;
+
+  f.type = bin[1];
+  f.flags = bin[2];
+  f.seq = get16(bin + 3);
+  f.sampleMs = get32(bin + 5);
+  size_t p = SENSOR_FRAME_HEADER_LEN;
+  for (uint8_t i = 0; i < info->count; i++, p += 2) f.values[i] = (int16_t)get16(bin + p);
+  if (f.flags & SENSOR_FLAG_GPS) {
+    f.latE6 = (int32_t)get32(bin + p);
+    f.lonE6 = (int32_t)get32(bin + p + 4);
+    p += 8;
+  } else {
+    f.latE6 = f.lonE6 = 0;
+  }
+  if (f.flags & SENSOR_FLAG_STATS) {
+    f.statMin = (int16_t)get16(bin + p);
+    f.statMax = (int16_t)get16(bin + p + 2);
+    f.statStd = (int16_t)get16(bin + p + 4);
+  } else {
+    f.statMin = f.statMax = f.statStd = 0;
+  }
+  return true;
+}
+
+// Codifica la trama como texto ("#" + base64). Devuelve la longitud o 0 si el tipo no existe.
+inline size_t encodeSensorFrame(const SensorFrame &f, char *out, size_t outSize) {
+  if (outSize < SENSOR_FRAME_MAX_TEXT) return 0;
+  uint8_t bin[SENSOR_FRAME_MAX_BIN];
+  size_t n = packSensorFrame(f, bin);
+  if (!n) return 0;
+  out[0] = SENSOR_FRAME_MARKER;
+  return 1 + sensorframe::b64Encode(bin, n, out + 1);
+}
+
+inline bool decodeSensorFrame(const char *text, size_t len, SensorFrame &f) {
+  if (!isSensorFrame(text, len)) return false;
+  uint8_t bin[SENSOR_FRAME_MAX_BIN];
+  int n = sensorframe::b64Decode(text + 1, len - 1, bin, sizeof(bin));
+  return n > 0 && unpackSensorFrame(bin, n, f);
+}
+
+// JSON equivalente al que enviaban los nodos, para MQTT / backend.
+// Devuelve la longitud escrita o 0 si no cabe.
+inline size_t sensorFrameToJson(const SensorFrame &f, char *out, size_t outSize) {
+  using namespace sensorframe;
+  const SensorTypeInfo *info = sensorTypeInfo(f.type);
+  if (!info) return 0;
+
+  size_t n = 0;
+  char num[24];
+  auto append = [&](const char *s) {
+    size_t l = strlen(s);
+    if (n + l >= outSize) return false;
+    memcpy(out + n, s, l);
+    n += l;
+    return true;
+  };
+
+  bool ok = append("{");
+  for (uint8_t i = 0; ok && i < info->count; i++) {
+    formatFixed(num, sizeof(num), f.values[i], info->fields[i].scale);
+    ok = append(i ? ",\"" : "\"") && append(info->fields[i].key) && append("\":") && append(num);
+  }
+  if (ok && (f.flags & SENSOR_FLAG_GPS)) {
+    formatFixed(num, sizeof(num), f.latE6, 1000000);
+    ok = append(",\"lat\":") && append(num);
+    formatFixed(num, sizeof(num), f.lonE6, 1000000);
+    ok = ok && append(",\"lon\":") && append(num);
+  } else if (ok) {
+    ok = append(",\"lat\":\"no data\",\"lon\":\"no data\"");
+  }
+  if (ok && (f.flags & SENSOR_FLAG_STATS)) {
+    int16_t scale = info->fields[0].scale;
+    formatFixed(num, sizeof(num), f.statMin, scale);
+    ok = append(",\"min\":") && append(num);
+    formatFixed(num, sizeof(num), f.statMax, scale);
+    ok = ok && append(",\"max\":") && append(num);
+    formatFixed(num, sizeof(num), f.statStd, scale);
+    ok = ok && append(",\"std\":") && append(num);
+  }
+  ok = ok && append(",\"reason\":\"") && append(sensorReasonName(sensorReason(f.flags))) && append("\"");
+  snprintf(num, sizeof(num), ",\"seq\":%u}", (unsigned)f.seq);
+  ok = ok && append(num);
+  if (!ok) return 0;
+  out[n] = '\0';
+  return n;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Ventana de secuencia por nodo en la gateway: descarta las tramas repetidas
+// (el flooding de broadcast y los reintentos de painlessMesh pueden entregar
+// dos veces la misma lectura) y cuenta pérdidas, desorden y reinicios.
+//
+// - Cada nodo ocupa una entrada de 32 bytes (dos por línea de caché) en una
+//   tabla de direccionamiento abierto con sondeo lineal, sin heap.
+// - bits guarda las últimas 64 secuencias: bit i = top - i recibida. seq es
+//   el uint16 que ya viaja en cada trama y se compara en aritmética de
+//   números de serie, así que da la vuelta sin problemas.
+// - Una posición que sale de la ventana sin haber llegado es una pérdida.
+// - El back-fill (con "node_age_ms") puede venir de un arranque anterior del
+//   nodo, con seq de otra numeración: nunca mueve la ventana ni la cuenta de
+//   pérdidas. Dentro de la ventana llena su hueco (o es repetida); fuera de
+//   ella, por delante o por detrás, se entrega como tardía (SEQ_LATE).
+// - Reinicio del nodo (seq vuelve a 1): una trama en vivo con motivo "first"
+//   y otra seq que la más alta, o una en vivo más vieja que la ventana.
+//
+// C++ puro sin Arduino: bench_seq.cpp lo prueba y lo mide en el host.
+
+#define SEQ_WINDOW_BITS 64
+
+enum SeqVerdict : uint8_t {
+  SEQ_NEW = 0,    // primera vez: se entrega
+  SEQ_DUPLICATE,  // ya vista: se descarta
+  SEQ_LATE,       // back-fill fuera de la ventana: se entrega sin tocarla
+  SEQ_RESTART,    // el nodo reinició: ventana nueva, se entrega
+  SEQ_UNTRACKED,  // tabla llena: se entrega sin contar
+};
+
+struct SeqEntry {
+  uint32_t node;  // 0 = libre (painlessMesh no usa el id 0)
+  uint16_t top;   // secuencia más alta vista
+  uint8_t span;   // posiciones válidas de la ventana (hasta SEQ_WINDOW_BITS)
+  uint8_t restarts;
+  uint64_t bits;
+  uint32_t received;
+  uint32_t duplicates;
+  uint32_t lost;
+  uint32_t reordered;  // llegadas fuera de orden (dentro de la ventana o back-fill)
+};
+static_assert(sizeof(SeqEntry) == 32, "SeqEntry debe ocupar media línea de caché");
+
+template <size_t N>
+class SeqTable {
+  static_assert(N && (N & (N - 1)) == 0, "N debe ser potencia de 2");
+
+ public:
+  SeqVerdict accept(uint32_t node, uint16_t seq, bool first, bool backfill) {
+    SeqEntry *e = find(node);
+    if (!e) {
+      untracked_++;
+      return SEQ_UNTRACKED;
+    }
+    if (!e->node) {
+      memset(e, 0, sizeof(*e));
+      e->node = node;
+      used_++;
+      open(*e, seq);
+      return SEQ_NEW;
+    }
+
+    int16_t d = (int16_t)(uint16_t)(seq - e->top);
+    // Un "first" repetido llega enseguida, antes que la trama siguiente: con
+    // otra seq es un arranque nuevo aunque caiga dentro de la ventana
+    if (first && !backfill && d != 0) return restart(*e, seq);
+    // Back-fill por delante de la ventana: puede ser de antes de un reinicio
+    if (backfill && d > 0) return late(*e);
+    uint32_t back = d < 0 ? (uint32_t)-(int32_t)d : 0;
+    if (d <= 0 && back < SEQ_WINDOW_BITS) {
+      uint64_t bit = 1ULL << back;
+      if (back < e->span && (e->bits & bit)) {
+        e->duplicates++;
+        return SEQ_DUPLICATE;
+      }
+      // Hueco dentro de la ventana: aún no contado como perdido
+      if (back < e->span) {
+        e->reordered++;
+      } else if (backfill) {
+        return late(*e);
+      } else {
+        e->span = back + 1;  // anterior a la primera vista: amplía la ventana
+      }
+      e->bits |= bit;
+      e->received++;
+      return SEQ_NEW;
+    }
+    if (d > 0) {
+      advance(*e, (uint32_t)d);
+      e->top = seq;
+      e->bits |= 1;
+      e->received++;
+      return SEQ_NEW;
+    }
+    if (backfill) return late(*e);
+    return restart(*e, seq);
+  }
+
+  size_t size() const { return used_; }
+  size_t capacity() const { return N; }
+  uint32_t untracked() const { return untracked_; }
+
+  // Recorre las entradas ocupadas (para el reporte)
+  template <typename F>
+  void forEach(F fn) const {
+    for (size_t i = 0; i < N; i++) {
+      if (slots_[i].node) fn(slots_[i]);
+    }
+  }
+
+ private:
+  static size_t slotOf(uint32_t node) { return (size_t)((node * 2654435761u) >> 7) & (N - 1); }
+
+  // Entrada del nodo, o la libre donde iría; nullptr si la tabla está llena
+  SeqEntry *find(uint32_t node) {
+    size_t i = slotOf(node);
+    for (size_t probes = 0; probes < N; probes++, i = (i + 1) & (N - 1)) {
+      if (slots_[i].node == node || !slots_[i].node) return &slots_[i];
+    }
+    return nullptr;
+  }
+
+  static void open(SeqEntry &e, uint16_t seq) {
+    e.top = seq;
+    e.bits = 1;
+    e.span = 1;
+    e.received++;
+  }
+
+  static uint32_t missing(const SeqEntry &e, uint64_t mask) {
+    uint64_t valid = e.span >= SEQ_WINDOW_BITS ? ~0ULL : (1ULL << e.span) - 1;
+    return (uint32_t)__builtin_popcountll(~e.bits & valid & mask);
+  }
+
+  // Las posiciones que salen de la ventana sin haber llegado son pérdidas,
+  // igual que las secuencias salteadas que ya no entran en ella
+  static void advance(SeqEntry &e, uint32_t d) {
+    if (d >= SEQ_WINDOW_BITS) {
+      e.lost += missing(e, ~0ULL) + (d - SEQ_WINDOW_BITS);
+      e.bits = 0;
+    } else {
+      e.lost += missing(e, ~((1ULL << (SEQ_WINDOW_BITS - d)) - 1));
+      e.bits <<= d;
+    }
+    e.span = d + e.span >= SEQ_WINDOW_BITS ? SEQ_WINDOW_BITS : (uint8_t)(d + e.span);
+  }
+
+  static SeqVerdict late(SeqEntry &e) {
+    e.received++;
+    e.reordered++;
+    return SEQ_LATE;
+  }
+
+  static SeqVerdict restart(SeqEntry &e, uint16_t seq) {
+    e.lost += missing(e, ~0ULL);
+    if (e.restarts < 255) e.restarts++;
+    open(e, seq);
+    return SEQ_RESTART;
+  }
+
+  SeqEntry slots_[N] = {};
+  size_t used_ = 0;
+  uint32_t untracked_ = 0;
+};
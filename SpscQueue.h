@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Cola circular lock-free de un productor y un consumidor (SPSC) con slots
+// preasignados. La usa la gateway para pasar tramas entre el núcleo del mesh
+// y la tarea MQTT sin mutex ni heap.
+//
+// head_ sólo lo escribe el consumidor y tail_ sólo el productor; ambos son
+// contadores libres (no se reducen módulo N), así que se usan los N slots.
+// La pareja release/acquire garantiza que el contenido del slot sea visible
+// antes que el índice que lo publica.
+//
+// C++ puro sobre std::atomic: se puede compilar en el host.
+struct SpscStats {
+  uint32_t pushed;    // elementos encolados
+  uint32_t failures;  // push() rechazados por cola llena
+  uint32_t highWater; // profundidad máxima observada
+};
+
+template <typename T, size_t N>
+class SpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N debe ser potencia de 2");
+
+ public:
+  typedef SpscStats Stats;  // el mismo tipo para cualquier T y N
+
+  // Sólo el productor. Devuelve un slot libre para escribir en sitio, o
+  // nullptr si la cola está llena; commit() lo publica al consumidor.
+  T* claim() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == N) {
+      failures_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &slots_[tail & (N - 1)];
+  }
+
+  void commit() {
+    size_t tail = tail_.load(std::memory_order_relaxed) + 1;
+    tail_.store(tail, std::memory_order_release);
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+    uint32_t depth = (uint32_t)(tail - head_.load(std::memory_order_relaxed));
+    if (depth > highWater_.load(std::memory_order_relaxed)) {
+      highWater_.store(depth, std::memory_order_relaxed);
+    }
+  }
+
+  bool push(const T& item) {
+    T* slot = claim();
+    if (!slot) return false;
+    *slot = item;
+    commit();
+    return true;
+  }
+
+  // Sólo el consumidor. Elemento más antiguo sin copiarlo, o nullptr si está
+  // vacía; release() libera el slot para el productor.
+  T* front() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) return nullptr;
+    return &slots_[head & (N - 1)];
+  }
+
+  void release() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  bool pop(T& out) {
+    T* slot = front();
+    if (!slot) return false;
+    out = *slot;
+    release();
+    return true;
+  }
+
+  // Aproximado si se llama desde un tercer hilo; exacto desde cualquiera de los dos
+  size_t size() const {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+  static constexpr size_t capacity() { return N; }
+
+  Stats stats() const {
+    return {pushed_.load(std::memory_order_relaxed),
+            failures_.load(std::memory_order_relaxed),
+            highWater_.load(std::memory_order_relaxed)};
+  }
+
+ private:
+  // Índices en líneas de caché distintas para que productor y consumidor
+  // no se invaliden mutuamente en cada operación
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+  alignas(64) std::atomic<uint32_t> pushed_{0};
+  std::atomic<uint32_t> failures_{0};
+  std::atomic<uint32_t> highWater_{0};
+  T slots_[N];
+};
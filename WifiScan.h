@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Escaneo WiFi asíncrono para el diagnóstico de la gateway sin IP. Antes
+// loop() llamaba a WiFi.scanNetworks() síncrono: 1-3 s sin mesh.update() y
+// los enlaces del mesh vencían. Aquí:
+// - poll() arranca el escaneo en modo asíncrono y vuelve enseguida;
+// - el evento SCAN_DONE (tarea de eventos WiFi) sólo llama a notifyDone();
+// - el siguiente poll() copia el resultado a un WifiScanStatus con su
+//   millis(), guarda las WIFI_SCAN_KEEP redes más fuertes y libera la lista.
+// Si el evento no llega en WIFI_SCAN_TIMEOUT_MS se consulta la radio una vez
+// y, si sigue ocupada, el escaneo cuenta como fallido.
+//
+// Radio es un adaptador con:
+//   bool start();                        // escaneo asíncrono; false si no arrancó
+//   int16_t complete();                  // redes, -1 si sigue, -2 si falló
+//   bool entry(int16_t i, WifiNet &net); // red i del resultado
+//   void release();                      // libera la lista de la radio
+// En el ESP32 es WiFi.scanNetworks(true)/scanComplete()/scanDelete();
+// bench_scan.cpp usa una radio simulada para medir el hueco de loop() en el host.
+//
+// C++ puro sin Arduino.
+
+#ifndef WIFI_SCAN_PERIOD_MS
+#define WIFI_SCAN_PERIOD_MS 15000
+#endif
+#ifndef WIFI_SCAN_TIMEOUT_MS
+#define WIFI_SCAN_TIMEOUT_MS 10000  // un barrido activo de 13 canales tarda ~2 s
+#endif
+#define WIFI_SCAN_KEEP 4  // redes más fuertes guardadas en el estado
+
+enum WifiScanResult : uint8_t {
+  WIFI_SCAN_NONE = 0,  // aún no terminó ninguno
+  WIFI_SCAN_OK,
+  WIFI_SCAN_START_FAILED,  // la radio no aceptó el escaneo
+  WIFI_SCAN_ERROR,         // terminó con error
+  WIFI_SCAN_TIMEOUT,       // sin SCAN_DONE ni resultado en WIFI_SCAN_TIMEOUT_MS
+};
+
+inline const char *wifiScanResultName(uint8_t result) {
+  static const char *const names[] = {"none", "ok", "start_failed", "error", "timeout"};
+  return result <= WIFI_SCAN_TIMEOUT ? names[result] : "?";
+}
+
+struct WifiNet {
+  char ssid[33];
+  int8_t rssi;
+  uint8_t channel;
+};
+
+// Último escaneo terminado
+struct WifiScanStatus {
+  uint32_t scans;        // escaneos terminados, bien o mal
+  uint32_t failures;     // los que no dieron resultado
+  uint32_t completedMs;  // millis() al recoger el resultado
+  uint32_t durationMs;   // desde start() hasta recogerlo
+  uint8_t result;        // WifiScanResult
+  bool targetSeen;       // el SSID buscado está en el aire
+  int8_t targetRssi;
+  uint8_t targetChannel;
+  uint16_t networks;  // redes vistas
+  uint8_t count;      // entradas válidas en strongest
+  WifiNet strongest[WIFI_SCAN_KEEP];
+};
+
+template <typename Radio>
+class WifiScanner {
+ public:
+  WifiScanner(Radio &radio, const char *target) : radio_(radio), target_(target) {}
+
+  // Desde el evento SCAN_DONE, en otra tarea: sólo avisa a poll()
+  void notifyDone() { done_.store(true, std::memory_order_release); }
+
+  // Desde loop(), nunca bloquea. Con want arranca un escaneo cada
+  // WIFI_SCAN_PERIOD_MS, el primero a los WIFI_SCAN_PERIOD_MS del arranque
+  // (como antes); uno en curso se recoge aunque want ya sea false.
+  // Devuelve true cuando status() tiene un resultado nuevo.
+  bool poll(uint32_t now, bool want) {
+    if (busy_) return collect(now);
+    if (!want || now - startedMs_ < WIFI_SCAN_PERIOD_MS) return false;
+    startedMs_ = now;
+    done_.store(false, std::memory_order_relaxed);
+    if (radio_.start()) {
+      busy_ = true;
+      return false;
+    }
+    finish(now, WIFI_SCAN_START_FAILED);
+    return true;
+  }
+
+  bool busy() const { return busy_; }
+  const WifiScanStatus &status() const { return status_; }
+
+ private:
+  bool collect(uint32_t now) {
+    bool timedOut = now - startedMs_ >= WIFI_SCAN_TIMEOUT_MS;
+    if (!done_.exchange(false, std::memory_order_acquire) && !timedOut) return false;
+    int16_t n = radio_.complete();
+    if (n < 0) {
+      // Evento de un escaneo que aún no cierra: se espera al siguiente
+      if (!timedOut) return false;
+      radio_.release();
+      finish(now, n == -1 ? WIFI_SCAN_TIMEOUT : WIFI_SCAN_ERROR);
+      return true;
+    }
+
+    status_.networks = (uint16_t)n;
+    status_.count = 0;
+    status_.targetSeen = false;
+    WifiNet net;
+    for (int16_t i = 0; i < n; i++) {
+      if (!radio_.entry(i, net)) continue;
+      if (!status_.targetSeen && strcmp(net.ssid, target_) == 0) {
+        status_.targetSeen = true;
+        status_.targetRssi = net.rssi;
+        status_.targetChannel = net.channel;
+      }
+      keep(net);
+    }
+    radio_.release();
+    finish(now, WIFI_SCAN_OK);
+    return true;
+  }
+
+  // Inserción ordenada por RSSI en las WIFI_SCAN_KEEP más fuertes
+  void keep(const WifiNet &net) {
+    uint8_t i = status_.count < WIFI_SCAN_KEEP ? status_.count++ : WIFI_SCAN_KEEP;
+    if (i == WIFI_SCAN_KEEP && net.rssi <= status_.strongest[WIFI_SCAN_KEEP - 1].rssi) return;
+    if (i == WIFI_SCAN_KEEP) i--;
+    for (; i > 0 && status_.strongest[i - 1].rssi < net.rssi; i--) status_.strongest[i] = status_.strongest[i - 1];
+    status_.strongest[i] = net;
+  }
+
+  void finish(uint32_t now, WifiScanResult result) {
+    busy_ = false;
+    status_.scans++;
+    if (result != WIFI_SCAN_OK) {
+      status_.failures++;
+      status_.networks = 0;
+      status_.count = 0;
+      status_.targetSeen = false;
+    }
+    status_.result = result;
+    status_.completedMs = now;
+    status_.durationMs = now - startedMs_;
+  }
+
+  Radio &radio_;
+  const char *target_;
+  std::atomic<bool> done_{false};
+  bool busy_ = false;
+  uint32_t startedMs_ = 0;
+  WifiScanStatus status_ = {};
+};
@@ -310,10 +310,18 @@ def api_datos():
         return jsonify({"error": str(e)}), 500
 
 
+def _now_ms32():
+    """Reloj de pared en ms, módulo 2^32 para que el nodo lo lea como uint32."""
+    return int(datetime.now().timestamp() * 1000) & 0xFFFFFFFF
+
+
 @app.route('/api/control_response', methods=['POST'])
 def recibir_respuesta_control():
     try:
         data = request.get_json()
+        # RTT real desde que se publicó el comando (srv_ms lo devuelve el nodo)
+        if data.get('srv_ms'):
+            data['rtt'] = (_now_ms32() - int(data['srv_ms'])) & 0xFFFFFFFF
         socketio.emit('command_response', {'node_id': data.get('from'), 'response': data})
         return jsonify({"status": "ok"}), 200
     except Exception as e:
@@ -431,8 +439,14 @@ def handle_enviar_comando(data):
             "type": cmd_type,
             "to": target,
             "from": 0, # Server ID
-            "seq": int(datetime.now().timestamp())
+            "seq": int(datetime.now().timestamp()),
+            "srv_ms": _now_ms32()  # sello de salida, vuelve en PONG/TRACE_REPLY
         }
+
+        # Parámetros opcionales de REPORT_CFG (política send-on-change del nodo)
+        for key in ('deadband', 'heartbeat', 'period'):
+            if data.get(key) is not None:
+                payload[key] = data[key]
         
         json_payload = json.dumps(payload)
         
@@ -0,0 +1,230 @@
+// Prueba y benchmark en el host del filtro de ADC de los nodos (AdcFilter.h).
+//
+//   g++ -O2 -std=c++11 bench_adc.cpp -o bench_adc && ./bench_adc [minutos] [semilla]
+//
+// Casos borde: la primera muestra pasa tal cual, un pico aislado (o dos
+// seguidos con N = 5) no mueve la salida, un escalón se asienta en el tiempo
+// esperado y las estadísticas de takeWindow() coinciden con las calculadas en
+// dos pasadas con double, y se reinician en cada ventana.
+//
+// Después simula el ADC del ESP32 a 20 Hz (ADC_SAMPLE_INTERVAL_MS) con una
+// señal de suelo que deriva lento y otra de luz con escalones, ruido gaussiano
+// y picos esporádicos. Cada SEND_PERIOD_MS compara lo que se reportaba antes
+// (un solo analogRead()) con la media de la ventana: error contra la señal
+// real y reportes de "change" falsos con la banda muerta de NODO_HUM_SUELO
+// (2 % = 40 cuentas). Termina con ns por muestra para N = 3, 5 y 9.
+// Cuenta las llamadas a operator new: deben ser 0. Sale con 1 si algo falla.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "AdcFilter.h"
+
+static size_t allocations = 0;
+
+void *operator new(size_t n) {
+  allocations++;
+  if (void *p = malloc(n)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static int failed = 0;
+
+#define CHECK(cond, ...)         \
+  do {                           \
+    if (!(cond)) {               \
+      printf("FALLO: " __VA_ARGS__); \
+      printf("\n");              \
+      failed++;                  \
+    }                            \
+  } while (0)
+
+// Los de NODO_HUM_SUELO.cpp / NODO_LUZ.cpp
+#define ADC_SAMPLE_INTERVAL_MS 50
+#define ADC_MEDIAN_N 5
+#define ADC_EMA_ALPHA 0.2f
+#define SEND_PERIOD_MS 10000
+#define DEADBAND_COUNTS 40  // 2 % de SOIL_DRY - SOIL_WET
+
+#define NOISE_LSB 25.0      // ruido del ADC del ESP32 con atenuación 11 dB
+#define SPIKE_PROB 0.01
+#define SAMPLES_PER_WINDOW (SEND_PERIOD_MS / ADC_SAMPLE_INTERVAL_MS)
+
+static void checkEdges() {
+  AdcFilter<ADC_MEDIAN_N> f(ADC_EMA_ALPHA);
+  CHECK(!f.primed(), "primed antes de la primera muestra");
+  CHECK(f.push(1234) == 1234.0f && f.primed(), "la primera muestra no pasa tal cual");
+
+  // Picos aislados o de a dos sobre una señal fija: la mediana de 5 los tapa
+  AdcFilter<ADC_MEDIAN_N> s(ADC_EMA_ALPHA);
+  for (int i = 0; i < 10; i++) s.push(2000);
+  const uint16_t spikes[][2] = {{4095, 2000}, {0, 2000}, {4095, 4095}, {0, 0}, {4095, 0}};
+  for (const auto &sp : spikes) {
+    float a = s.push(sp[0]);
+    float b = s.push(sp[1]);
+    float c = 0;
+    for (int i = 0; i < 5; i++) c = s.push(2000);
+    CHECK(a == 2000.0f && b == 2000.0f && c == 2000.0f, "el pico %u,%u movió la salida a %.1f/%.1f", sp[0], sp[1],
+          a, b);
+  }
+  // Tres seguidos ya son señal: con N = 5 deben pasar
+  s.push(3000);
+  s.push(3000);
+  CHECK(s.push(3000) > 2000.0f, "tres muestras iguales no pasan la mediana");
+
+  // Escalón: retardo de la mediana (N/2 muestras) y luego el EMA al 95 %
+  AdcFilter<ADC_MEDIAN_N> e(ADC_EMA_ALPHA);
+  for (int i = 0; i < 10; i++) e.push(1000);
+  int settle = -1;
+  for (int i = 0; i < 100; i++) {
+    if (e.push(2000) >= 1950.0f) {
+      settle = i + 1;
+      break;
+    }
+  }
+  int expected = ADC_MEDIAN_N / 2 + 1 + (int)ceil(log(0.05) / log(1.0 - ADC_EMA_ALPHA));
+  CHECK(settle > 0 && abs(settle - expected) <= 1, "el escalón se asienta en %d muestras, esperaba %d", settle,
+        expected);
+
+  // Estadísticas por ventana contra el cálculo en dos pasadas
+  std::mt19937 rng(7);
+  AdcFilter<ADC_MEDIAN_N> w(ADC_EMA_ALPHA);
+  for (int win = 0; win < 20; win++) {
+    std::vector<double> out;
+    size_t n = 1 + rng() % 400;
+    for (size_t i = 0; i < n; i++) out.push_back(w.push((uint16_t)(1500 + rng() % 1000)));
+    double mean = 0, m2 = 0, lo = out[0], hi = out[0];
+    for (double v : out) {
+      mean += v;
+      lo = std::min(lo, v);
+      hi = std::max(hi, v);
+    }
+    mean /= n;
+    for (double v : out) m2 += (v - mean) * (v - mean);
+    double sd = n > 1 ? sqrt(m2 / (n - 1)) : 0;
+    AdcFilter<ADC_MEDIAN_N>::Window got = w.takeWindow();
+    CHECK(got.count == n && got.min == (float)lo && got.max == (float)hi, "ventana %d: count/min/max", win);
+    CHECK(fabs(got.mean - mean) < 1e-3 && fabs(got.stddev - sd) < 1e-2 * (1 + sd), "ventana %d: media %.4f/%.4f, "
+          "desviación %.4f/%.4f", win, got.mean, mean, got.stddev, sd);
+  }
+  AdcFilter<ADC_MEDIAN_N>::Window empty = w.takeWindow();
+  CHECK(empty.count == 0 && empty.stddev == 0.0f, "la ventana no se reinicia");
+}
+
+struct Trace {
+  const char *name;
+  double (*truth)(double sec);
+};
+
+// Suelo: deriva lenta de ±15 cuentas en 6 h alrededor de 2400, dentro de la banda muerta
+static double soil(double sec) { return 2400 + 15 * sin(sec / 21600.0 * 2 * M_PI); }
+// Luz: nubes que cambian el nivel cada dos minutos
+static double light(double sec) { return 1800 + 300 * (((int)(sec / 120) % 3) - 1); }
+
+static const Trace kTraces[] = {{"suelo", soil}, {"luz", light}};
+
+struct Score {
+  double rawErr2 = 0, filtErr2 = 0;
+  uint32_t windows = 0, rawChanges = 0, filtChanges = 0, realChanges = 0;
+};
+
+static Score simulate(const Trace &t, uint32_t minutes, std::mt19937 &rng) {
+  std::normal_distribution<double> noise(0, NOISE_LSB);
+  std::uniform_real_distribution<double> u(0, 1);
+  AdcFilter<ADC_MEDIAN_N> f(ADC_EMA_ALPHA);
+  Score s;
+  double lastRaw = -1e9, lastFilt = -1e9, lastTruth = -1e9;
+  const uint32_t total = minutes * 60000 / ADC_SAMPLE_INTERVAL_MS;
+  uint16_t raw = 0;
+  for (uint32_t i = 1; i <= total; i++) {
+    double sec = i * ADC_SAMPLE_INTERVAL_MS / 1000.0;
+    double v = t.truth(sec) + noise(rng);
+    if (u(rng) < SPIKE_PROB) v = u(rng) < 0.5 ? 4095 : v * u(rng);  // rieles o caída por WiFi
+    raw = (uint16_t)std::max(0.0, std::min(4095.0, v + 0.5));
+    f.push(raw);
+    if (i % SAMPLES_PER_WINDOW) continue;
+
+    // Antes: un analogRead() al enviar; ahora: la media de la ventana.
+    // La referencia es la media real de la ventana, que es lo que se quiere reportar.
+    double truth = 0;
+    for (uint32_t k = 0; k < SAMPLES_PER_WINDOW; k++) {
+      truth += t.truth((i - k) * ADC_SAMPLE_INTERVAL_MS / 1000.0);
+    }
+    truth /= SAMPLES_PER_WINDOW;
+    double filt = f.takeWindow().mean;
+    s.windows++;
+    s.rawErr2 += (raw - truth) * (raw - truth);
+    s.filtErr2 += (filt - truth) * (filt - truth);
+    // Reportes por cambio con banda muerta, como reportReason()
+    if (fabs(raw - lastRaw) > DEADBAND_COUNTS) {
+      s.rawChanges++;
+      lastRaw = raw;
+    }
+    if (fabs(filt - lastFilt) > DEADBAND_COUNTS) {
+      s.filtChanges++;
+      lastFilt = filt;
+    }
+    if (fabs(truth - lastTruth) > DEADBAND_COUNTS) {
+      s.realChanges++;
+      lastTruth = truth;
+    }
+  }
+  return s;
+}
+
+template <size_t N>
+static void timePush(int samples, std::mt19937 &rng) {
+  static uint16_t trace[4096];
+  for (uint16_t &x : trace) x = (uint16_t)(2000 + rng() % 200);
+  AdcFilter<N> f(ADC_EMA_ALPHA);
+  volatile float sink = 0;
+  size_t before = allocations;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < samples; i++) sink = sink + f.push(trace[i & 4095]);
+  auto t1 = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / samples;
+  printf("  N = %zu: %6.1f ns por muestra\n", N, ns);
+  CHECK(allocations == before, "N = %zu reservó memoria", N);
+}
+
+int main(int argc, char **argv) {
+  const uint32_t minutes = argc > 1 ? (uint32_t)atoi(argv[1]) : 24 * 60;
+  const unsigned seed = argc > 2 ? (unsigned)atoi(argv[2]) : 1;
+  std::mt19937 rng(seed);
+
+  checkEdges();
+
+  printf("ADC a %u Hz, ruido %.0f LSB, %.0f %% de picos; un envío cada %u s durante %u min\n",
+         1000 / ADC_SAMPLE_INTERVAL_MS, NOISE_LSB, SPIKE_PROB * 100, SEND_PERIOD_MS / 1000, minutes);
+  printf("%-6s %8s | %11s %11s | %18s %18s %10s\n", "señal", "envíos", "RMS crudo", "RMS filtro", "change crudo",
+         "change filtro", "reales");
+  size_t before = allocations;
+  for (const Trace &t : kTraces) {
+    Score s = simulate(t, minutes, rng);
+    double rawRms = sqrt(s.rawErr2 / s.windows), filtRms = sqrt(s.filtErr2 / s.windows);
+    printf("%-6s %8u | %11.1f %11.1f | %18u %18u %10u\n", t.name, s.windows, rawRms, filtRms, s.rawChanges,
+           s.filtChanges, s.realChanges);
+    CHECK(filtRms * 5 < rawRms, "%s: el filtro no reduce el error (%.1f frente a %.1f)", t.name, filtRms, rawRms);
+    CHECK(s.filtChanges <= s.realChanges + s.realChanges / 10 + 2, "%s: %u cambios filtrados para %u reales",
+          t.name, s.filtChanges, s.realChanges);
+  }
+  CHECK(allocations == before, "la simulación reservó memoria");
+
+  printf("Costo de push() (mediana por inserción + EMA + Welford):\n");
+  timePush<3>(10000000, rng);
+  timePush<5>(10000000, rng);
+  timePush<9>(10000000, rng);
+
+  printf(failed ? "FALLO: %d comprobaciones\n"
+                : "OK: picos rechazados, escalón a tiempo, estadísticas exactas y menos cambios falsos\n",
+         failed);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,211 @@
+from __future__ import annotations
+
+import argparse
+import asyncio
+import json
+import logging
+import random
+import statistics
+import sys
+import time
+from typing import Dict, List, Tuple
+
+
+logger = logging.getLogger("bench_batch")
+logger.setLevel(logging.INFO)
+handler = logging.StreamHandler(sys.stdout)
+handler.setFormatter(logging.Formatter("%(message)s"))
+logger.addHandler(handler)
+
+TOPIC = "Nodos/datos"
+TOPIC_BATCH = TOPIC + "/batch"
+# Cabeceras IPv4 + TCP por paquete, que el loopback no cobra pero el WiFi sí
+TCPIP_OVERHEAD = 40
+
+
+# ---------- MQTT mínimo (PUBLISH QoS 0) ----------
+def encode_publish(topic: str, payload: bytes) -> bytes:
+    """Paquete PUBLISH QoS 0 tal como lo arma PubSubClient."""
+    t = topic.encode()
+    body = len(t).to_bytes(2, "big") + t + payload
+    remaining = bytearray()
+    n = len(body)
+    while True:
+        byte, n = n % 128, n // 128
+        remaining.append(byte | (0x80 if n else 0))
+        if not n:
+            break
+    return bytes([0x30]) + bytes(remaining) + body
+
+
+async def read_packet(reader: asyncio.StreamReader) -> Tuple[str, bytes, int]:
+    header = await reader.readexactly(1)
+    size = 0
+    shift = 0
+    wire = 1
+    while True:
+        b = (await reader.readexactly(1))[0]
+        wire += 1
+        size |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            break
+    body = await reader.readexactly(size)
+    tlen = int.from_bytes(body[:2], "big")
+    return body[2:2 + tlen].decode(), body[2 + tlen:], wire + size
+
+
+class BrokerStandIn:
+    """Recibe PUBLISH por TCP local, cuenta paquetes/bytes y mide latencia."""
+
+    def __init__(self, sent_at: Dict[Tuple[int, int], float]):
+        self.sent_at = sent_at
+        self.packets = 0
+        self.bytes = 0
+        self.latencies: List[float] = []
+
+    async def handle(self, reader: asyncio.StreamReader, writer: asyncio.StreamWriter):
+        try:
+            while True:
+                topic, payload, wire = await read_packet(reader)
+                now = time.perf_counter()
+                self.packets += 1
+                self.bytes += wire + TCPIP_OVERHEAD
+                data = json.loads(payload)
+                items = data if topic == TOPIC_BATCH else [{"from": int(topic.rsplit("/", 1)[1]), "data": data}]
+                for item in items:
+                    key = (item["from"], item["data"]["seq"])
+                    if key in self.sent_at:
+                        self.latencies.append(now - self.sent_at.pop(key))
+        except asyncio.IncompleteReadError:
+            pass
+        finally:
+            writer.close()
+
+
+# ---------- Gateway emulada ----------
+class Gateway:
+    """Reproduce el camino de publicación de GATEWAY.cpp en ambos modos."""
+
+    def __init__(self, writer: asyncio.StreamWriter, batch: bool, max_frames: int,
+                 max_ms: int, publish_cost_ms: float):
+        self.writer = writer
+        self.batch = batch
+        self.max_frames = max_frames
+        self.max_ms = max_ms
+        self.publish_cost_ms = publish_cost_ms
+        self.pending: List[Tuple[int, str, float]] = []
+        self.opened = 0.0
+
+    async def _publish(self, topic: str, payload: str):
+        self.writer.write(encode_publish(topic, payload.encode()))
+        await self.writer.drain()
+        if self.publish_cost_ms:
+            # Costo por paquete en el ESP32 (PubSubClient + lwIP), bloqueante
+            time.sleep(self.publish_cost_ms / 1000.0)
+
+    async def on_frame(self, node_id: int, payload: str):
+        if not self.batch:
+            await self._publish(f"{TOPIC}/{node_id}", payload)
+            return
+        if not self.pending:
+            self.opened = time.perf_counter()
+        self.pending.append((node_id, payload, time.perf_counter()))
+        if len(self.pending) >= self.max_frames:
+            await self.flush()
+
+    async def tick(self):
+        if self.pending and (time.perf_counter() - self.opened) * 1000 >= self.max_ms:
+            await self.flush()
+
+    async def flush(self):
+        now = time.perf_counter()
+        items = ",".join(
+            f'{{"from":{n},"age_ms":{int((now - rx) * 1000)},"data":{p}}}' for n, p, rx in self.pending
+        )
+        self.pending = []
+        await self._publish(TOPIC_BATCH, f"[{items}]")
+
+
+def sample_payload(node_id: int, seq: int) -> str:
+    """JSON típico de una trama decodificada (~75 bytes)."""
+    return json.dumps({
+        "temperatura": f"{random.uniform(18, 30):.2f}",
+        "lat": "no data", "lon": "no data",
+        "reason": "change", "seq": seq,
+    }, separators=(",", ":"))
+
+
+async def run_mode(batch: bool, args) -> Dict[str, float]:
+    sent_at: Dict[Tuple[int, int], float] = {}
+    broker = BrokerStandIn(sent_at)
+    server = await asyncio.start_server(broker.handle, "127.0.0.1", 0)
+    port = server.sockets[0].getsockname()[1]
+    _, writer = await asyncio.open_connection("127.0.0.1", port)
+    gw = Gateway(writer, batch, args.max_frames, args.max_ms, args.publish_cost_ms)
+
+    # Cada nodo reporta cada `period` s con un desfase aleatorio, como en el mesh
+    rng = random.Random(args.seed)
+    start = time.perf_counter()
+    events = []
+    for n in range(args.nodes):
+        offset = rng.uniform(0, args.period)
+        events += [(offset + k * args.period, 1000 + n, k) for k in range(int(args.duration / args.period))]
+    events.sort()
+    for at, node_id, seq in events:
+        while (delay := start + at - time.perf_counter()) > 0:
+            await gw.tick()
+            await asyncio.sleep(min(delay, 0.001))
+        sent_at[(node_id, seq)] = time.perf_counter()
+        await gw.on_frame(node_id, sample_payload(node_id, seq))
+    if gw.pending:
+        await gw.flush()
+    await asyncio.sleep(0.2)
+
+    elapsed = time.perf_counter() - start
+    writer.close()
+    await writer.wait_closed()
+    await asyncio.sleep(0.05)
+    server.close()
+    await server.wait_closed()
+
+    lat = sorted(broker.latencies) or [0.0]
+    return {
+        "tramas": len(events),
+        "entregadas": len(broker.latencies),
+        "paquetes/s": broker.packets / elapsed,
+        "bytes/s": broker.bytes / elapsed,
+        "bytes/trama": broker.bytes / max(len(broker.latencies), 1),
+        "lat media ms": statistics.mean(lat) * 1000,
+        "lat p95 ms": lat[int(0.95 * (len(lat) - 1))] * 1000,
+        "lat max ms": lat[-1] * 1000,
+    }
+
+
+def parse_args():
+    p = argparse.ArgumentParser(description="Compara publicación por nodo vs. por lotes (MQTT_BATCH_MODE)")
+    p.add_argument("--nodes", type=int, default=40, help="Nodos simulados")
+    p.add_argument("--period", type=float, default=1.0, help="Período de reporte por nodo (s)")
+    p.add_argument("--duration", type=float, default=10.0, help="Duración de cada corrida (s)")
+    p.add_argument("--max-frames", type=int, default=16, help="MQTT_BATCH_MAX_FRAMES")
+    p.add_argument("--max-ms", type=int, default=500, help="MQTT_BATCH_MAX_MS")
+    p.add_argument("--publish-cost-ms", type=float, default=0.0,
+                   help="Costo fijo simulado por publish() en el ESP32")
+    p.add_argument("--seed", type=int, default=1)
+    return p.parse_args()
+
+
+def main():
+    args = parse_args()
+    results = {}
+    for name, batch in (("por nodo", False), ("lotes", True)):
+        logger.info("Corriendo modo %s...", name)
+        results[name] = asyncio.run(run_mode(batch, args))
+
+    logger.info("\n%-14s %12s %12s", "", "por nodo", "lotes")
+    for key in results["por nodo"]:
+        logger.info("%-14s %12.1f %12.1f", key, results["por nodo"][key], results["lotes"][key])
+
+
+if __name__ == "__main__":
+    main()
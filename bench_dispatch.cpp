@@ -0,0 +1,115 @@
+// Benchmark en el host del despacho de control de los nodos (ControlDispatch.h
+// y los handlers de NodeControl.h).
+//
+//   g++ -O2 -std=c++11 bench_dispatch.cpp -o bench_dispatch && ./bench_dispatch
+//
+// Mide mensajes/s de la ruta que sigue MeshNodeRuntime::receivedCallback
+// (clasificar, leer campos, escribir la respuesta en la pila) y cuenta las
+// llamadas a operator new durante cada corrida: deben ser 0. Antes comprueba
+// que cada respuesta traiga sus campos (sellos, "ts", "period").
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "NodeControl.h"
+
+static size_t allocations = 0;
+
+void *operator new(size_t n) {
+  allocations++;
+  if (void *p = malloc(n)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+struct Case {
+  const char *name;
+  const char *msg;
+  const char *reply;  // fragmento que debe traer la respuesta (nullptr: sin respuesta)
+};
+
+static const Case kCases[] = {
+    {"dato JSON", "{\"temperatura\":24.31,\"lat\":\"no data\",\"lon\":\"no data\",\"reason\":\"change\",\"seq\":812}", nullptr},
+    {"SensorFrame", "#AQEEAywBAAAsAQAAmAk", nullptr},
+    {"ROOT", "{\"type\":\"ROOT\",\"from\":2147483649,\"bin\":1}", nullptr},
+    {"PING", "{\"type\": \"PING\", \"to\": 3735928559, \"from\": 0, \"seq\": 1712345678, \"srv_ms\": 3141592653,\"gw_in\":1000000,\"gw_tx\":1000350}",
+     "\"srv_ms\":3141592653,\"gw_in\":1000000,\"gw_tx\":1000350,\"t_rx\":1000,\"t_tx\":1200}"},
+    {"TOPO_REQ", "{\"type\": \"TOPO_REQ\", \"to\": 3735928559, \"from\": 0, \"seq\": 1712345678}",
+     "\"neighbors\":[2147483649,12345678,87654321,55555555]}"},
+    {"TRACE", "{\"type\":\"TRACE\",\"to\":3735928559,\"from\":0,\"seq\":7,\"hops\":[2147483649,12345678,87654321],\"ts\":[10,20,30]}",
+     "\"hops\":[2147483649,12345678,87654321,3735928559],\"ts\":[10,20,30,1000],\"t_tx\":1200}"},
+    {"REPORT_CFG", "{\"type\": \"REPORT_CFG\", \"to\": 0, \"deadband\": 0.25, \"heartbeat\": 900, \"period\": 60, \"seq\": 9}",
+     "\"deadband\":0.25,\"heartbeat\":900,\"period\":60}"},
+};
+
+static const uint32_t kMyId = 3735928559u;
+static const uint32_t kNeighbors[] = {2147483649u, 12345678u, 87654321u, 55555555u};
+static volatile uint32_t rootSeen = 0;
+
+// receivedCallback de MeshNodeRuntime con los handlers de NodeControl.h; el
+// envío (sendSingle con el String reusado de reply()) queda fuera
+static size_t dispatch(const char *m, size_t len, char *buf) {
+  ControlWriter w(buf, CONTROL_REPLY_MAX);
+  switch (controlClassify(m, len)) {
+    case CTRL_ROOT:  // sin respuesta: sólo actualiza el root
+      rootSeen = controlUint(m, len, "from") + controlUint(m, len, "bin");
+      return 0;
+    case CTRL_PING:
+      if (controlUint(m, len, "to") != kMyId) return 0;
+      nodePong(w, m, len, kMyId, 1000u, 1200u);
+      break;
+    case CTRL_TOPO_REQ:
+      nodeTopo(w, m, len, kMyId, kNeighbors);
+      break;
+    case CTRL_TRACE:
+      nodeTrace(w, m, len, kMyId, 1000u, 1200u);
+      break;
+    case CTRL_REPORT_CFG: {
+      ReportPolicy p = {0.5f, 600, 30};
+      nodeApplyReportCfg(m, len, p);
+      nodeReportCfgAck(w, m, len, kMyId, p);
+      break;
+    }
+    default:
+      return 0;
+  }
+  return w.ok() ? w.length() : 0;
+}
+
+int main(int argc, char **argv) {
+  const int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+  volatile size_t sink = 0;
+  int failed = 0;
+  char buf[CONTROL_REPLY_MAX];
+
+  // Las respuestas son las del nodo, con sellos y todos los campos
+  for (const Case &c : kCases) {
+    size_t n = dispatch(c.msg, strlen(c.msg), buf);
+    if (c.reply ? !n || !strstr(buf, c.reply) : n != 0) {
+      printf("FALLO: %s respondió \"%s\"\n", c.name, n ? buf : "");
+      failed++;
+    }
+  }
+
+  printf("%-12s %12s %10s %12s\n", "mensaje", "msgs/s", "ns/msg", "allocs/msg");
+  for (const Case &c : kCases) {
+    size_t len = strlen(c.msg);
+    size_t before = allocations;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) sink = sink + dispatch(c.msg, len, buf);
+    auto t1 = std::chrono::steady_clock::now();
+    size_t allocs = allocations - before;
+
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+    printf("%-12s %12.0f %10.1f %12.3f\n", c.name, 1e9 / ns, ns, (double)allocs / iterations);
+    if (allocs) {
+      printf("FALLO: %s reservó memoria\n", c.name);
+      failed++;
+    }
+  }
+  if (!failed) printf("OK: respuestas completas y 0 reservas de heap por mensaje\n");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,271 @@
+// Prueba y benchmark en el host de la trama binaria de sensor (SensorFrame.h).
+//
+//   g++ -O2 -std=c++11 bench_frame.cpp -o bench_frame && ./bench_frame [iteraciones] [semilla]
+//
+// Primero la corrección, con tramas al azar de los cuatro tipos, con y sin
+// GPS y estadísticas:
+//   - encode -> decode devuelve la misma trama, y pack/unpack el mismo binario;
+//   - el JSON de sensorFrameToJson() (lo que publica la gateway) trae los
+//     mismos valores, leídos con controlFloat();
+//   - se rechazan versiones o tipos desconocidos, largos que no coinciden con
+//     los flags, base64 inválido y texto sin el marcador.
+// Después el tamaño en el mesh y ns por trama de cada paso frente al JSON que
+// arman los nodos sin "bin". ArduinoJson no compila en el host: el JSON de
+// referencia se arma con snprintf con los mismos campos y bytes, y se lee con
+// controlFloat() de ControlDispatch.h. Cuenta las llamadas a operator new:
+// deben ser 0. Sale con 1 si algo falla.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+#include "ControlDispatch.h"
+#include "SensorFrame.h"
+
+static size_t allocations = 0;
+
+void *operator new(size_t n) {
+  allocations++;
+  if (void *p = malloc(n)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static int failed = 0;
+
+#define CHECK(cond, ...)         \
+  do {                           \
+    if (!(cond)) {               \
+      printf("FALLO: " __VA_ARGS__); \
+      printf("\n");              \
+      failed++;                  \
+    }                            \
+  } while (0)
+
+static SensorFrame randomFrame(std::mt19937 &rng, uint8_t type, uint8_t flags) {
+  SensorFrame f = {};
+  f.type = type;
+  f.flags = flags | (uint8_t)((rng() % 4) << SENSOR_REASON_SHIFT);
+  f.seq = (uint16_t)rng();
+  f.sampleMs = rng();
+  for (int i = 0; i < sensorTypeInfo(type)->count; i++) f.values[i] = (int16_t)rng();
+  if (flags & SENSOR_FLAG_GPS) {
+    f.latE6 = (int32_t)(rng() % 180000001) - 90000000;
+    f.lonE6 = (int32_t)(rng() % 360000001) - 180000000;
+  }
+  if (flags & SENSOR_FLAG_STATS) {
+    f.statMin = (int16_t)rng();
+    f.statMax = (int16_t)rng();
+    f.statStd = (int16_t)(rng() & 0x7fff);
+  }
+  return f;
+}
+
+// unpackSensorFrame() sólo escribe los valores que trae el tipo
+static bool sameFrame(const SensorFrame &a, const SensorFrame &b) {
+  if (a.type != b.type) return false;
+  for (uint8_t i = 0; i < sensorTypeInfo(a.type)->count; i++) {
+    if (a.values[i] != b.values[i]) return false;
+  }
+  return a.flags == b.flags && a.seq == b.seq && a.sampleMs == b.sampleMs && a.latE6 == b.latE6 &&
+         a.lonE6 == b.lonE6 && a.statMin == b.statMin && a.statMax == b.statMax && a.statStd == b.statStd;
+}
+
+// Lo que manda encodeJson() de MeshNodeRuntime.h con los mismos valores
+static size_t nodeJson(const SensorFrame &f, char *out, size_t size) {
+  const SensorTypeInfo *info = sensorTypeInfo(f.type);
+  int n = 1;
+  out[0] = '{';
+  for (uint8_t i = 0; i < info->count; i++) {
+    n += snprintf(out + n, size - n, "%s\"%s\":%.2f", i ? "," : "", info->fields[i].key,
+                  (double)f.values[i] / info->fields[i].scale);
+  }
+  if (f.flags & SENSOR_FLAG_GPS) {
+    n += snprintf(out + n, size - n, ",\"lat\":%.6f,\"lon\":%.6f", f.latE6 / 1e6, f.lonE6 / 1e6);
+  } else {
+    n += snprintf(out + n, size - n, ",\"lat\":\"no data\",\"lon\":\"no data\"");
+  }
+  if (f.flags & SENSOR_FLAG_STATS) {
+    double s = info->fields[0].scale;
+    n += snprintf(out + n, size - n, ",\"min\":%.2f,\"max\":%.2f,\"std\":%.2f", f.statMin / s, f.statMax / s,
+                  f.statStd / s);
+  }
+  n += snprintf(out + n, size - n, ",\"reason\":\"%s\",\"seq\":%u}", sensorReasonName(sensorReason(f.flags)),
+                (unsigned)f.seq);
+  return (size_t)n;
+}
+
+// Lectura de los valores desde el JSON, como haría quien lo recibe
+static float readJson(const char *json, size_t len, uint8_t type) {
+  const SensorTypeInfo *info = sensorTypeInfo(type);
+  float sum = 0;
+  for (uint8_t i = 0; i < info->count; i++) sum += controlFloat(json, len, info->fields[i].key);
+  return sum + controlFloat(json, len, "lat") + controlUint(json, len, "seq");
+}
+
+static bool near(float got, int32_t fixed, int32_t scale) {
+  float want = (float)fixed / scale;
+  return fabsf(got - want) <= 0.5f / scale + fabsf(want) * 1e-6f;
+}
+
+static void checkRoundTrips(std::mt19937 &rng, int count) {
+  size_t bad = 0, badBin = 0, badJson = 0;
+  for (int i = 0; i < count; i++) {
+    SensorFrame f = randomFrame(rng, 1 + rng() % 4, rng() % 4);
+    char text[SENSOR_FRAME_MAX_TEXT];
+    size_t n = encodeSensorFrame(f, text, sizeof(text));
+    SensorFrame g;
+    if (!n || n >= sizeof(text) || !decodeSensorFrame(text, n, g) || !sameFrame(f, g)) bad++;
+
+    uint8_t bin[SENSOR_FRAME_MAX_BIN], bin2[SENSOR_FRAME_MAX_BIN];
+    size_t b = packSensorFrame(f, bin);
+    if (!unpackSensorFrame(bin, b, g) || packSensorFrame(g, bin2) != b || memcmp(bin, bin2, b)) badBin++;
+
+    char json[256];
+    size_t j = sensorFrameToJson(f, json, sizeof(json));
+    const SensorTypeInfo *info = sensorTypeInfo(f.type);
+    bool ok = j > 0 && controlUint(json, j, "seq") == f.seq;
+    for (uint8_t k = 0; ok && k < info->count; k++) {
+      ok = near(controlFloat(json, j, info->fields[k].key), f.values[k], info->fields[k].scale);
+    }
+    if (ok && (f.flags & SENSOR_FLAG_GPS)) {
+      // float pierde los últimos dígitos de lat/lon; basta con 1e-4 grados
+      ok = fabsf(controlFloat(json, j, "lat") - f.latE6 / 1e6f) < 1e-4f &&
+           fabsf(controlFloat(json, j, "lon") - f.lonE6 / 1e6f) < 1e-4f;
+    }
+    if (ok && (f.flags & SENSOR_FLAG_STATS)) {
+      ok = near(controlFloat(json, j, "min"), f.statMin, info->fields[0].scale) &&
+           near(controlFloat(json, j, "max"), f.statMax, info->fields[0].scale) &&
+           near(controlFloat(json, j, "std"), f.statStd, info->fields[0].scale);
+    }
+    if (!ok) badJson++;
+  }
+  CHECK(!bad, "%zu de %d tramas no vuelven iguales por texto", bad, count);
+  CHECK(!badBin, "%zu de %d tramas no vuelven iguales en binario", badBin, count);
+  CHECK(!badJson, "%zu de %d tramas con JSON distinto", badJson, count);
+}
+
+static void checkRejects(std::mt19937 &rng) {
+  SensorFrame f = randomFrame(rng, SENSOR_LUZ, SENSOR_FLAG_GPS | SENSOR_FLAG_STATS), g;
+  uint8_t bin[SENSOR_FRAME_MAX_BIN] = {};
+  size_t n = packSensorFrame(f, bin);
+  CHECK(n == SENSOR_FRAME_MAX_BIN, "la trama más larga mide %zu, no %d", n, SENSOR_FRAME_MAX_BIN);
+  for (size_t cut = 0; cut < n; cut++) CHECK(!unpackSensorFrame(bin, cut, g), "aceptó %zu de %zu bytes", cut, n);
+  bin[0] = SENSOR_FRAME_VERSION + 1;
+  CHECK(!unpackSensorFrame(bin, n, g), "aceptó otra versión");
+  bin[0] = SENSOR_FRAME_VERSION;
+  bin[1] = 0;
+  CHECK(!unpackSensorFrame(bin, n, g), "aceptó el tipo 0");
+  bin[1] = SENSOR_SUELO + 1;
+  CHECK(!unpackSensorFrame(bin, n, g), "aceptó un tipo desconocido");
+  bin[1] = SENSOR_LUZ;
+  bin[2] &= ~SENSOR_FLAG_STATS;
+  CHECK(!unpackSensorFrame(bin, n, g), "aceptó un largo que no coincide con los flags");
+
+  f.type = 9;
+  char text[SENSOR_FRAME_MAX_TEXT];
+  CHECK(!encodeSensorFrame(f, text, sizeof(text)) && !sensorFrameToJson(f, text, sizeof(text)),
+        "codificó un tipo desconocido");
+  f.type = SENSOR_TEMPERATURA;
+  CHECK(!encodeSensorFrame(f, text, sizeof(text) - 1), "escribió en un buffer chico");
+  size_t t = encodeSensorFrame(f, text, sizeof(text));
+  CHECK(decodeSensorFrame(text, t, g), "no decodifica una trama válida");
+  text[3] = '*';
+  CHECK(!decodeSensorFrame(text, t, g), "aceptó base64 inválido");
+  CHECK(!decodeSensorFrame(text + 1, t - 1, g) && !decodeSensorFrame("#", 1, g), "aceptó texto sin trama");
+  const char *json = "{\"temperatura\":24.31,\"seq\":1}";
+  CHECK(!decodeSensorFrame(json, strlen(json), g), "tomó JSON como trama");
+  char small[16];
+  f = randomFrame(rng, SENSOR_LUZ, SENSOR_FLAG_GPS | SENSOR_FLAG_STATS);
+  CHECK(!sensorFrameToJson(f, small, sizeof(small)), "sensorFrameToJson no detectó que no cabe");
+}
+
+struct Timing {
+  double ns;
+  size_t allocs;
+};
+
+template <typename Fn>
+static Timing timeIt(int iterations, Fn fn) {
+  size_t before = allocations;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) fn(i);
+  auto t1 = std::chrono::steady_clock::now();
+  return {std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations, allocations - before};
+}
+
+struct Variant {
+  const char *name;
+  uint8_t type;
+  uint8_t flags;
+};
+
+static const Variant kVariants[] = {
+    {"temperatura", SENSOR_TEMPERATURA, 0},
+    {"temp+gps", SENSOR_TEMPERATURA, SENSOR_FLAG_GPS},
+    {"suelo+stats", SENSOR_SUELO, SENSOR_FLAG_STATS},
+    {"luz+gps+stats", SENSOR_LUZ, SENSOR_FLAG_GPS | SENSOR_FLAG_STATS},
+};
+
+#define POOL 64  // tramas distintas por variante, para no medir siempre la misma
+
+int main(int argc, char **argv) {
+  const int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+  const unsigned seed = argc > 2 ? (unsigned)atoi(argv[2]) : 1;
+  std::mt19937 rng(seed);
+
+  checkRoundTrips(rng, 200000);
+  checkRejects(rng);
+
+  printf("%-14s %9s %9s | %11s %11s | %11s %11s %11s\n", "trama", "JSON B", "bin B", "JSON arma", "bin arma",
+         "JSON lee", "bin lee", "bin->JSON");
+  volatile size_t sink = 0;
+  size_t allocs = 0;
+  for (const Variant &v : kVariants) {
+    static SensorFrame frames[POOL];
+    static char texts[POOL][SENSOR_FRAME_MAX_TEXT];
+    static char jsons[POOL][256];
+    static size_t textLen[POOL], jsonLen[POOL];
+    double textBytes = 0, jsonBytes = 0;
+    for (int i = 0; i < POOL; i++) {
+      frames[i] = randomFrame(rng, v.type, v.flags);
+      // Valores de sensor reales, no int16 al azar, para que el JSON mida lo de siempre
+      frames[i].values[0] = (int16_t)(1500 + rng() % 2000);
+      frames[i].values[1] = (int16_t)(rng() % 10000);
+      textLen[i] = encodeSensorFrame(frames[i], texts[i], sizeof(texts[i]));
+      jsonLen[i] = nodeJson(frames[i], jsons[i], sizeof(jsons[i]));
+      textBytes += textLen[i];
+      jsonBytes += jsonLen[i];
+    }
+    char buf[256];
+    SensorFrame g;
+    Timing encJson = timeIt(iterations, [&](int i) { sink = sink + nodeJson(frames[i % POOL], buf, sizeof(buf)); });
+    Timing encBin =
+        timeIt(iterations, [&](int i) { sink = sink + encodeSensorFrame(frames[i % POOL], buf, sizeof(buf)); });
+    Timing decJson = timeIt(iterations, [&](int i) {
+      sink = sink + (size_t)readJson(jsons[i % POOL], jsonLen[i % POOL], v.type);
+    });
+    Timing decBin = timeIt(iterations, [&](int i) {
+      sink = sink + decodeSensorFrame(texts[i % POOL], textLen[i % POOL], g) + g.values[0];
+    });
+    // Lo que hace la gateway con una trama binaria antes de publicar
+    Timing toJson = timeIt(iterations, [&](int i) {
+      if (decodeSensorFrame(texts[i % POOL], textLen[i % POOL], g)) sink = sink + sensorFrameToJson(g, buf, sizeof(buf));
+    });
+    allocs += encJson.allocs + encBin.allocs + decJson.allocs + decBin.allocs + toJson.allocs;
+    printf("%-14s %9.1f %9.1f | %8.1f ns %8.1f ns | %8.1f ns %8.1f ns %8.1f ns\n", v.name, jsonBytes / POOL,
+           textBytes / POOL, encJson.ns, encBin.ns, decJson.ns, decBin.ns, toJson.ns);
+    CHECK(textBytes < jsonBytes, "%s: la trama binaria no es más chica", v.name);
+  }
+  printf("(bin B: \"#\" + base64 tal como viaja en el mesh; bin->JSON: decode + sensorFrameToJson en la gateway)\n");
+  CHECK(!allocs, "%zu reservas de heap", allocs);
+
+  printf(failed ? "FALLO: %d comprobaciones\n"
+                : "OK: ida y vuelta exacta, rechazos y 0 reservas de heap por trama\n",
+         failed);
+  return failed ? 1 : 0;
+}
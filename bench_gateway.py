@@ -0,0 +1,260 @@
+from __future__ import annotations
+
+import argparse
+import asyncio
+import json
+import logging
+import os
+import random
+import statistics
+import subprocess
+import sys
+import time
+from typing import Dict, List, Optional, Tuple
+
+
+logger = logging.getLogger("bench_gateway")
+logger.setLevel(logging.INFO)
+handler = logging.StreamHandler(sys.stdout)
+handler.setFormatter(logging.Formatter("%(message)s"))
+logger.addHandler(handler)
+
+# Tipos de paquete de painlessMesh (painlessmesh/protocol.hpp)
+PM_NODE_SYNC_REQUEST = 5
+PM_NODE_SYNC_REPLY = 6
+PM_SINGLE = 9
+PM_SYNC_EVERY_S = 3.0  # los nodos reales resincronizan cada pocos segundos
+
+
+# ---------- Broker MQTT mínimo (QoS 0) ----------
+async def read_mqtt(reader: asyncio.StreamReader) -> Tuple[int, bytes]:
+    header = (await reader.readexactly(1))[0]
+    size = 0
+    shift = 0
+    while True:
+        b = (await reader.readexactly(1))[0]
+        size |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            break
+    return header, await reader.readexactly(size)
+
+
+class BrokerStandIn:
+    """CONNECT/SUBSCRIBE/PINGREQ/PUBLISH de libmosquitto; cuenta y mide latencia.
+
+    cost_us simula lo que tarda el broker en procesar cada PUBLISH de una
+    misma conexión (en serie por conexión, en paralelo entre conexiones).
+    """
+
+    def __init__(self, sent_at: Dict[Tuple[int, int], float], cost_us: float):
+        self.sent_at = sent_at
+        self.cost_us = cost_us
+        self.clients = 0
+        self.packets = 0
+        self.latencies: List[float] = []
+        self.per_connection: List[int] = []
+
+    async def handle(self, reader: asyncio.StreamReader, writer: asyncio.StreamWriter):
+        idx = len(self.per_connection)
+        self.per_connection.append(0)
+        busy_until = time.perf_counter()
+        try:
+            while True:
+                header, body = await read_mqtt(reader)
+                kind = header >> 4
+                if kind == 1:  # CONNECT
+                    self.clients += 1
+                    writer.write(b"\x20\x02\x00\x00")
+                elif kind == 8:  # SUBSCRIBE
+                    writer.write(b"\x90\x03" + body[:2] + b"\x00")
+                elif kind == 12:  # PINGREQ
+                    writer.write(b"\xd0\x00")
+                elif kind == 14:  # DISCONNECT
+                    break
+                elif kind == 3:
+                    now = time.perf_counter()
+                    tlen = int.from_bytes(body[:2], "big")
+                    topic = body[2:2 + tlen].decode()
+                    self.packets += 1
+                    self.per_connection[idx] += 1
+                    node = topic.rsplit("/", 1)[1]
+                    if node.isdigit():
+                        seq = json.loads(body[2 + tlen:]).get("seq")
+                        sent = self.sent_at.pop((int(node), seq), None)
+                        if sent is not None:
+                            self.latencies.append(now - sent)
+                    if self.cost_us:
+                        busy_until = max(busy_until, now) + self.cost_us / 1e6
+                        if busy_until - now > 0.001:
+                            await asyncio.sleep(busy_until - now)
+                await writer.drain()
+        except (asyncio.IncompleteReadError, ConnectionError):
+            pass
+        finally:
+            writer.close()
+
+
+# ---------- Nodos sintéticos ----------
+def pm_package(obj: dict) -> bytes:
+    """Paquete de painlessMesh: JSON terminado en '\\0'."""
+    return json.dumps(obj, separators=(",", ":")).encode() + b"\0"
+
+
+def sample_payload(seq: int) -> str:
+    """Lectura JSON como la de MeshNodeRuntime.h (~80 bytes)."""
+    return json.dumps({
+        "temperatura": round(random.uniform(18, 30), 2),
+        "lat": "no data", "lon": "no data",
+        "reason": "first" if seq == 1 else "change", "seq": seq,
+    }, separators=(",", ":"))
+
+
+class MeshPeer:
+    """Un nodo conectado por TCP al puerto del mesh de gateway_linux."""
+
+    def __init__(self, node_id: int):
+        self.node_id = node_id
+        self.root = 0
+        self.seq = 0
+        self.reader: Optional[asyncio.StreamReader] = None
+        self.writer: Optional[asyncio.StreamWriter] = None
+        self.synced = asyncio.Event()
+
+    def _sync_request(self) -> bytes:
+        return pm_package({"type": PM_NODE_SYNC_REQUEST, "dest": self.root, "from": self.node_id,
+                           "nodeId": self.node_id, "subs": []})
+
+    async def connect(self, port: int):
+        self.reader, self.writer = await asyncio.open_connection("127.0.0.1", port)
+        self.writer.write(self._sync_request())
+        await self.writer.drain()
+        asyncio.ensure_future(self._read_loop())
+        asyncio.ensure_future(self._sync_loop())
+
+    async def _read_loop(self):
+        try:
+            while True:
+                raw = await self.reader.readuntil(b"\0")
+                msg = json.loads(raw[:-1])
+                kind = msg.get("type")
+                if kind == PM_NODE_SYNC_REPLY:
+                    self.root = msg.get("from", self.root)
+                    self.synced.set()
+                elif kind == PM_NODE_SYNC_REQUEST:
+                    self.root = msg.get("from", self.root)
+                    self.writer.write(pm_package({"type": PM_NODE_SYNC_REPLY, "dest": self.root,
+                                                  "from": self.node_id, "nodeId": self.node_id, "subs": []}))
+        except (asyncio.IncompleteReadError, ConnectionError, ValueError):
+            pass
+
+    async def _sync_loop(self):
+        while not self.writer.is_closing():
+            await asyncio.sleep(PM_SYNC_EVERY_S)
+            self.writer.write(self._sync_request())
+
+    def send_reading(self, sent_at: Dict[Tuple[int, int], float]):
+        self.seq += 1
+        sent_at[(self.node_id, self.seq)] = time.perf_counter()
+        self.writer.write(pm_package({"type": PM_SINGLE, "dest": self.root, "from": self.node_id,
+                                      "msg": sample_payload(self.seq)}))
+
+    async def close(self):
+        self.writer.close()
+
+
+# ---------- Corrida ----------
+async def run(publishers: int, args) -> Dict[str, float]:
+    sent_at: Dict[Tuple[int, int], float] = {}
+    broker = BrokerStandIn(sent_at, args.broker_cost_us)
+    server = await asyncio.start_server(broker.handle, "127.0.0.1", 0)
+    mqtt_port = server.sockets[0].getsockname()[1]
+
+    proc = None
+    if not args.no_spawn:
+        cmd = [args.daemon, "--mesh-port", str(args.mesh_port), "--broker", "127.0.0.1",
+               "--mqtt-port", str(mqtt_port), "--publishers", str(publishers)]
+        proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL if not args.verbose else None)
+    deadline = time.perf_counter() + 10
+    while broker.clients < publishers and time.perf_counter() < deadline:
+        await asyncio.sleep(0.05)
+    if broker.clients < publishers:
+        raise RuntimeError(f"sólo {broker.clients}/{publishers} publicadores conectados al broker")
+
+    peers = [MeshPeer(100000 + n) for n in range(args.nodes)]
+    for p in peers:
+        await p.connect(args.mesh_port)
+    await asyncio.wait_for(asyncio.gather(*(p.synced.wait() for p in peers)), 10)
+
+    # Todos los nodos a la vez; con --rate 0 tan rápido como acepte el socket
+    sent = 0
+    start = time.perf_counter()
+    interval = 1.0 / args.rate if args.rate else 0.0
+    next_at = start
+    while time.perf_counter() - start < args.duration:
+        for p in peers:
+            p.send_reading(sent_at)
+        sent += len(peers)
+        await asyncio.gather(*(p.writer.drain() for p in peers))
+        next_at += interval
+        await asyncio.sleep(max(0.0, next_at - time.perf_counter()))
+    # Espera a que se vacíen los carriles
+    settle = time.perf_counter() + 5
+    while len(broker.latencies) < sent and time.perf_counter() < settle:
+        await asyncio.sleep(0.05)
+    elapsed = time.perf_counter() - start
+
+    for p in peers:
+        await p.close()
+    if proc:
+        proc.terminate()
+        proc.wait(timeout=5)
+    server.close()
+    await server.wait_closed()
+
+    lat = sorted(broker.latencies) or [0.0]
+    data_conns = [c for c in broker.per_connection if c]
+    return {
+        "enviadas": sent,
+        "entregadas": len(broker.latencies),
+        "tramas/s": len(broker.latencies) / elapsed,
+        "lat media ms": statistics.mean(lat) * 1000,
+        "lat p99 ms": lat[int(0.99 * (len(lat) - 1))] * 1000,
+        "reparto max/min": max(data_conns) / max(min(data_conns), 1) if data_conns else 0.0,
+    }
+
+
+def parse_args():
+    p = argparse.ArgumentParser(
+        description="Throughput de gateway_linux con nodos sintéticos y un broker local por loopback")
+    p.add_argument("--daemon", default=os.path.join(".", "gateway_linux"), help="Binario de gateway_linux.cpp")
+    p.add_argument("--no-spawn", action="store_true",
+                   help="No lanzar el daemon (ya corre apuntando al broker del bench)")
+    p.add_argument("--publishers", default="1,2,4", help="Valores de --publishers a comparar")
+    p.add_argument("--mesh-port", type=int, default=5555)
+    p.add_argument("--nodes", type=int, default=50, help="Nodos sintéticos")
+    p.add_argument("--rate", type=float, default=0.0, help="Lecturas/s por nodo (0 = sin límite)")
+    p.add_argument("--duration", type=float, default=10.0, help="Duración de cada corrida (s)")
+    p.add_argument("--broker-cost-us", type=float, default=50.0,
+                   help="Costo simulado del broker por PUBLISH y conexión")
+    p.add_argument("--verbose", action="store_true", help="Mostrar el log del daemon")
+    p.add_argument("--seed", type=int, default=1)
+    return p.parse_args()
+
+
+def main():
+    args = parse_args()
+    random.seed(args.seed)
+    counts = [int(x) for x in args.publishers.split(",")]
+    results = {}
+    for n in counts:
+        logger.info("Corriendo con %d publicador(es)...", n)
+        results[n] = asyncio.run(run(n, args))
+
+    logger.info("\n%-16s" + " %12s" * len(counts), "publicadores", *[str(n) for n in counts])
+    for key in results[counts[0]]:
+        logger.info("%-16s" + " %12.1f" * len(counts), key, *[results[n][key] for n in counts])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,180 @@
+// Prueba en el host de los carriles con prioridad de la gateway (MeshLanes en
+// GatewayCore.h).
+//
+//   g++ -O2 -std=c++11 bench_lanes.cpp -o bench_lanes && ./bench_lanes [segundos] [semilla]
+//
+// Simulación de eventos con reloj virtual del camino mesh -> MQTT del ESP32:
+// lecturas con llegadas de Poisson a una carga creciente, un PONG cada
+// PING_EVERY_US y una tarea MQTT que publica cada trama en PUBLISH_MIN_US a
+// PUBLISH_MAX_US y, con las colas vacías, duerme MQTT_TASK_PERIOD_US. Las
+// colas y los histogramas son los de la gateway. Compara la cola única de
+// antes con los dos carriles y falla si la latencia de control con carriles
+// pasa de CONTROL_LIMIT_US a cualquier carga o crece más de FLAT_RATIO
+// veces entre la carga más baja y la más alta. Sale con 1 si algo falla.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "GatewayMetrics.h"
+
+static int failed = 0;
+
+#define CHECK(cond, ...)         \
+  do {                           \
+    if (!(cond)) {               \
+      printf("FALLO: " __VA_ARGS__); \
+      printf("\n");              \
+      failed++;                  \
+    }                            \
+  } while (0)
+
+#define MESH_QUEUE_SLOTS 32  // los de GATEWAY.cpp
+#define REPLY_QUEUE_SLOTS 8
+#define MQTT_TASK_PERIOD_US 2000
+#define PUBLISH_MIN_US 1500  // publish() de PubSubClient a un broker en la LAN
+#define PUBLISH_MAX_US 2500
+#define PING_EVERY_US 250000
+#define CONTROL_LIMIT_US (2 * PUBLISH_MAX_US + MQTT_TASK_PERIOD_US)  // una de datos en curso + la propia + el sueño
+#define FLAT_RATIO 2.0
+
+// La cola única de antes, con el mismo push() que MeshLanes
+class SingleQueue {
+ public:
+  bool push(GatewayLane lane, uint32_t, uint32_t, uint32_t rxUs, uint32_t, const char *, size_t) {
+    MeshFrame *f = q_.claim();
+    if (!f) return false;
+    f->rxUs = rxUs;
+    f->timed = lane == LANE_CONTROL;
+    q_.commit();
+    return true;
+  }
+  MeshFrame *front() { return q_.front(); }
+  void release(GatewayLane) { q_.release(); }
+
+ private:
+  SpscQueue<MeshFrame, MESH_QUEUE_SLOTS> q_;
+};
+
+// La trama que toma la tarea MQTT: en orden de llegada con la cola única; con
+// carriles, la de control más vieja antes que cualquier dato
+static bool nextFrame(SingleQueue &q, GatewayLane &lane, uint32_t &rxUs) {
+  MeshFrame *f = q.front();
+  if (!f) return false;
+  lane = f->timed ? LANE_CONTROL : LANE_DATA;
+  rxUs = f->rxUs;
+  return true;
+}
+
+template <size_t CONTROL_SLOTS, size_t DATA_SLOTS>
+static bool nextFrame(MeshLanes<CONTROL_SLOTS, DATA_SLOTS> &q, GatewayLane &lane, uint32_t &rxUs) {
+  if (MeshReplyFrame *r = q.frontReply()) {
+    lane = LANE_CONTROL;
+    rxUs = r->rxUs;
+    return true;
+  }
+  MeshFrame *f = q.frontData();
+  if (!f) return false;
+  lane = LANE_DATA;
+  rxUs = f->rxUs;
+  return true;
+}
+
+struct Result {
+  LatencyHistogram latency[LANE_COUNT];
+  uint32_t dropped[LANE_COUNT];
+};
+
+template <typename Q>
+static void simulate(Q &queue, double load, double seconds, uint32_t seed, Result &r) {
+  std::mt19937 rng(seed);
+  const double meanCost = (PUBLISH_MIN_US + PUBLISH_MAX_US) / 2.0;
+  std::exponential_distribution<double> gap(load / meanCost);  // llegadas de datos por us
+  const uint64_t end = (uint64_t)(seconds * 1e6);
+
+  uint64_t now = 0;
+  uint64_t nextData = (uint64_t)gap(rng);
+  uint64_t nextPing = PING_EVERY_US / 2;
+  uint64_t taskAt = 0;  // próxima vez que la tarea MQTT mira las colas
+  bool busy = false;  // hay un publish() en curso
+  uint32_t rxUs = 0;  // el de la trama que se está publicando
+  GatewayLane lane = LANE_DATA;
+
+  while (now < end) {
+    now = std::min(nextData, std::min(nextPing, taskAt));
+    if (now == nextData || now == nextPing) {
+      GatewayLane in = now == nextPing ? LANE_CONTROL : LANE_DATA;
+      if (!queue.push(in, 0, 0, (uint32_t)now, 0, "", 0)) r.dropped[in]++;
+      if (in == LANE_CONTROL) {
+        nextPing += PING_EVERY_US;
+      } else {
+        nextData = now + 1 + (uint64_t)gap(rng);
+      }
+      continue;
+    }
+    // La tarea MQTT: termina el publish() en curso y toma la siguiente, como
+    // forwardMeshFrames()
+    if (busy) {
+      r.latency[lane].record((uint32_t)now - rxUs);
+      queue.release(lane);
+    }
+    busy = nextFrame(queue, lane, rxUs);
+    if (busy) {
+      taskAt = now + PUBLISH_MIN_US + rng() % (PUBLISH_MAX_US - PUBLISH_MIN_US + 1);
+    } else {
+      taskAt = now + MQTT_TASK_PERIOD_US;  // vTaskDelay con las colas vacías
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  const double seconds = argc > 1 ? atof(argv[1]) : 120;
+  const uint32_t seed = argc > 2 ? (uint32_t)atoi(argv[2]) : 1;
+  const double loads[] = {0.1, 0.3, 0.5, 0.7, 0.9, 0.99, 1.2};
+  const size_t nLoads = sizeof(loads) / sizeof(loads[0]);
+
+  printf("%.0f s por carga, publish() de %u-%u us, un PONG cada %u ms, carriles de %u/%u tramas\n", seconds,
+         PUBLISH_MIN_US, PUBLISH_MAX_US, PING_EVERY_US / 1000, REPLY_QUEUE_SLOTS, MESH_QUEUE_SLOTS);
+  printf("%-6s %8s | %-29s | %-29s | %12s %10s\n", "carga", "datos/s", "control cola única p50/p99/max",
+         "control carriles p50/p99/max", "datos p99", "perdidas");
+
+  uint32_t lanesP99[nLoads];
+  uint32_t singleP99[nLoads];
+  for (size_t i = 0; i < nLoads; i++) {
+    // Colas nuevas en cada carga (los atómicos no se pueden reasignar)
+    static SingleQueue singles[nLoads];
+    static MeshLanes<REPLY_QUEUE_SLOTS, MESH_QUEUE_SLOTS> lanes[nLoads];
+    static Result a, b;
+    a = Result();
+    b = Result();
+    simulate(singles[i], loads[i], seconds, seed, a);
+    simulate(lanes[i], loads[i], seconds, seed, b);
+
+    const LatencyHistogram &sc = a.latency[LANE_CONTROL], &lc = b.latency[LANE_CONTROL];
+    singleP99[i] = sc.percentile(0.99);
+    lanesP99[i] = lc.percentile(0.99);
+    double dataRate = loads[i] * 1e6 / ((PUBLISH_MIN_US + PUBLISH_MAX_US) / 2.0);
+    printf("%-6.2f %8.0f | %8.1f %9.1f %9.1f ms | %8.1f %9.1f %9.1f ms | %9.1f ms %10u\n", loads[i], dataRate,
+           sc.percentile(0.5) / 1e3, singleP99[i] / 1e3, sc.max() / 1e3, lc.percentile(0.5) / 1e3, lanesP99[i] / 1e3,
+           lc.max() / 1e3, b.latency[LANE_DATA].percentile(0.99) / 1e3, b.dropped[LANE_DATA]);
+
+    CHECK(lc.count() >= (uint32_t)(seconds * 1e6 / PING_EVERY_US) - 1, "carga %.2f: %u PONG publicados", loads[i],
+          lc.count());
+    CHECK(b.dropped[LANE_CONTROL] == 0, "carga %.2f: %u PONG descartados", loads[i], b.dropped[LANE_CONTROL]);
+    CHECK(lc.max() <= CONTROL_LIMIT_US, "carga %.2f: control max %u us > %u us", loads[i], lc.max(),
+          (unsigned)CONTROL_LIMIT_US);
+  }
+
+  uint32_t lo = *std::min_element(lanesP99, lanesP99 + nLoads);
+  uint32_t hi = *std::max_element(lanesP99, lanesP99 + nLoads);
+  CHECK(hi <= lo * FLAT_RATIO, "control p99 con carriles de %u a %u us: no es plana", lo, hi);
+  // La simulación tiene que mostrar el problema con la cola única
+  CHECK(singleP99[nLoads - 1] > hi * 5, "cola única p99 %u us a carga %.2f: la simulación no carga la cola",
+        singleP99[nLoads - 1], loads[nLoads - 1]);
+
+  printf(failed ? "FALLO: %d comprobaciones\n"
+                : "OK: con carriles la latencia de control queda plana y acotada a cualquier carga de datos\n",
+         failed);
+  return failed ? 1 : 0;
+}
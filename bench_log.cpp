@@ -0,0 +1,232 @@
+// Benchmark en el host del log diferido (DeferredLog.h).
+//
+//   g++ -O2 -std=c++11 -pthread bench_log.cpp -o bench_log && ./bench_log
+//   g++ -O2 -std=c++11 -pthread -DLOG_LEVEL=LOG_LEVEL_DEBUG bench_log.cpp -o bench_log && ./bench_log
+//
+// Mide el costo por mensaje en el hilo que loguea para cada nivel (lo que
+// paga mesh.update() o la tarea MQTT), frente a formatear con snprintf en el
+// momento, y el tiempo que ese printf tendría bloqueado el UART a 115200
+// baudios. Los niveles por encima de LOG_LEVEL deben costar lo mismo que el
+// bucle vacío: no generan código. Además comprueba que el formato diferido sea igual al de printf,
+// que no haya reservas de heap y que con varios productores no se pierda ni
+// se desordene nada. Sale con 1 si algo falla.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+
+static size_t sinkBytes = 0;
+static size_t sinkLines = 0;
+static void (*sinkHook)(const char *, size_t) = nullptr;
+
+static void sinkWrite(const char *buf, size_t len) {
+  sinkBytes += len;
+  sinkLines++;
+  if (sinkHook) sinkHook(buf, len);
+}
+
+#define LOG_SINK(buf, len) sinkWrite((buf), (len))
+#include "DeferredLog.h"
+
+static size_t allocations = 0;
+
+void *operator new(size_t n) {
+  allocations++;
+  if (void *p = malloc(n)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static const char kPayload[] =
+    "{\"temperatura\":24.31,\"lat\":\"no data\",\"lon\":\"no data\",\"reason\":\"change\",\"seq\":812}";
+
+// ---------- Formato igual al de printf ----------
+// Las comprobaciones llaman a deferredlog::log directamente: valen con
+// cualquier LOG_LEVEL
+
+static char lastLine[LOG_LINE_MAX];
+static void captureLine(const char *buf, size_t len) {
+  memcpy(lastLine, buf, len);
+  lastLine[len] = '\0';
+}
+
+static int checkFormat() {
+  int failed = 0;
+  char want[LOG_LINE_MAX];
+  sinkHook = captureLine;
+#define CHECK_FMT(fmt, ...)                                                 \
+  do {                                                                      \
+    snprintf(want, sizeof(want), fmt "\n", __VA_ARGS__);                    \
+    deferredlog::log(LOG_LEVEL_ERROR, fmt, __VA_ARGS__);                    \
+    logFlush();                                                             \
+    const char *got = strstr(lastLine, " E ");                              \
+    if (!got || strcmp(got + 3, want) != 0) {                               \
+      printf("FALLO formato: esperado \"%s\" obtenido \"%s\"\n", want, lastLine); \
+      failed++;                                                             \
+    }                                                                       \
+  } while (0)
+  CHECK_FMT("Datos recibidos desde nodo %u: %s", 3735928559u, kPayload);
+  CHECK_FMT("[COLA] Encolado; pendientes=%u, descartados=%u", 12u, 0u);
+  CHECK_FMT("%d %5.2f %-6s| %x %c %%", -42, 3.14159, "ab", 0xbeefu, 'z');
+  CHECK_FMT("%lu %lld %llu", 4000000000ul, -9000000000ll, 18000000000000000000ull);
+  CHECK_FMT("%08.3f %+d %*d|%-*s|", 2.5, 7, 5, 42, 4, "x");
+  CHECK_FMT("%.*s", 5, "MQTT Control");
+  CHECK_FMT("%s", "");
+  CHECK_FMT("[MQTT] Conectado a %s:%d", "192.168.1.10", 1883);
+
+  // Buffer sin '\0' con logSpan
+  deferredlog::log(LOG_LEVEL_ERROR, "MQTT Control recibido: %s", logSpan("{\"type\":\"PING\"}XXXX", 15));
+  logFlush();
+  if (!strstr(lastLine, "recibido: {\"type\":\"PING\"}\n")) {
+    printf("FALLO logSpan: \"%s\"\n", lastLine);
+    failed++;
+  }
+  // Cadena más larga que el slot: se corta y se marca
+  char big[300];
+  memset(big, 'a', sizeof(big) - 1);
+  big[sizeof(big) - 1] = '\0';
+  deferredlog::log(LOG_LEVEL_ERROR, "%s", big);
+  logFlush();
+  if (!strstr(lastLine, "a ...\n")) {
+    printf("FALLO truncado: \"%s\"\n", lastLine);
+    failed++;
+  }
+  sinkHook = nullptr;
+  return failed;
+}
+
+// ---------- Varios productores, un consumidor ----------
+
+static uint32_t nextExpected[2];
+static int orderErrors = 0;
+static void checkOrder(const char *buf, size_t) {
+  unsigned p, i;
+  const char *m = strstr(buf, "prod ");
+  if (!m || sscanf(m, "prod %u msg %u", &p, &i) != 2 || p > 1) return;
+  if (i < nextExpected[p]) orderErrors++;
+  nextExpected[p] = i + 1;
+}
+
+static int checkMpsc() {
+  const uint32_t perProducer = 200000;
+  deferredlog::Stats before = logStats();
+  sinkHook = checkOrder;
+  bool done = false;
+  std::thread consumer([&] {
+    while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) logDrain(LOG_SLOTS);
+    logFlush();
+  });
+  std::thread producers[2];
+  for (unsigned p = 0; p < 2; p++) {
+    producers[p] = std::thread([p] {
+      for (uint32_t i = 0; i < perProducer; i++) {
+        deferredlog::log(LOG_LEVEL_ERROR, "prod %u msg %u", p, i);
+        // Con un solo núcleo en el host el consumidor también tiene que correr
+        if (i % 8 == 7) std::this_thread::yield();
+      }
+    });
+  }
+  for (std::thread &t : producers) t.join();
+  __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+  consumer.join();
+  sinkHook = nullptr;
+
+  deferredlog::Stats after = logStats();
+  uint32_t logged = after.logged - before.logged;
+  uint32_t dropped = after.dropped - before.dropped;
+  uint32_t written = after.written - before.written;
+  int failed = 0;
+  if (logged + dropped != 2 * perProducer || written != logged || orderErrors) {
+    printf("FALLO MPSC: encolados %u + descartados %u != %u, escritos %u, desorden %d\n", logged, dropped,
+           2 * perProducer, written, orderErrors);
+    failed++;
+  } else {
+    printf("MPSC: 2 productores, %u encolados, %u descartados (anillo lleno), orden por productor OK\n", logged,
+           dropped);
+  }
+  return failed;
+}
+
+// ---------- Costo por mensaje ----------
+
+struct Row {
+  const char *name;
+  bool enabled;
+  double ns;
+  size_t allocs;
+  size_t lineBytes;
+};
+
+// Corre en tandas de medio anillo y vacía fuera del tiempo medido: cada
+// mensaje se encola de verdad, nunca se mide el camino de descarte
+template <typename F>
+static Row measure(const char *name, bool enabled, int iterations, F body) {
+  const int batch = LOG_SLOTS / 2;
+  double ns = 0;
+  size_t allocs = 0;
+  size_t bytes0 = sinkBytes, lines0 = sinkLines;
+  for (int done = 0; done < iterations; done += batch) {
+    size_t before = allocations;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < batch; i++) body(done + i);
+    auto t1 = std::chrono::steady_clock::now();
+    allocs += allocations - before;
+    ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+    logFlush();
+  }
+  size_t lines = sinkLines - lines0;
+  return Row{name, enabled, ns / iterations, allocs, lines ? (sinkBytes - bytes0) / lines : 0};
+}
+
+int main(int argc, char **argv) {
+  const int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+  int failed = checkFormat();
+  failed += checkMpsc();
+
+  volatile size_t sink = 0;
+  uint32_t node = 3735928559u;
+  Row rows[] = {
+      measure("(bucle)", false, iterations, [&](int i) { sink = sink + (size_t)i; }),
+      measure("ERROR", LOG_LEVEL >= LOG_LEVEL_ERROR, iterations,
+              [&](int i) { LOG_E("[MQTT] Error de conexión, rc=%d; reintento en %u ms", -2, (unsigned)i); }),
+      measure("WARN", LOG_LEVEL >= LOG_LEVEL_WARN, iterations,
+              [&](int i) { LOG_W("[COLA] Llena, descartado (total descartados=%u)", (unsigned)i); }),
+      measure("INFO", LOG_LEVEL >= LOG_LEVEL_INFO, iterations,
+              [&](int i) { LOG_I("[BATCH] %u lecturas en %u bytes, %.2f ms", (unsigned)i, 812u, 1.25); }),
+      measure("DEBUG", LOG_LEVEL >= LOG_LEVEL_DEBUG, iterations,
+              [&](int) { LOG_D("Datos recibidos desde nodo %u: %s", node, kPayload); }),
+      measure("snprintf", true, iterations,
+              [&](int) {
+                char line[LOG_LINE_MAX];
+                int n = snprintf(line, sizeof(line), "Datos recibidos desde nodo %u: %s\n", node, kPayload);
+                sinkWrite(line, (size_t)n);
+                sink = sink + (size_t)line[n / 2];
+              }),
+  };
+
+  printf("\nLOG_LEVEL=%d, %d mensajes por nivel\n", LOG_LEVEL, iterations);
+  printf("%-9s %-9s %10s %12s %12s %14s\n", "nivel", "estado", "ns/msg", "allocs/msg", "bytes/línea",
+         "UART 115200 µs");
+  const double baseNs = rows[0].ns;
+  for (const Row &r : rows) {
+    bool deferred = strcmp(r.name, "snprintf") != 0 && r.name[0] != '(';
+    double uartUs = r.lineBytes * 10 * 1e6 / 115200.0;
+    printf("%-9s %-9s %10.1f %12.3f %12zu %14.0f\n", r.name,
+           r.name[0] == '(' ? "-" : !deferred ? "directo" : r.enabled ? "encolado" : "fuera", r.ns, (double)r.allocs / iterations,
+           r.lineBytes, r.enabled ? uartUs : 0.0);
+    if (deferred && r.allocs) failed++;
+    // Un nivel compilado fuera cuesta lo mismo que el bucle vacío
+    if (deferred && !r.enabled && r.ns > baseNs * 1.5 + 0.5) {
+      printf("FALLO: %s está compilado fuera y cuesta %.1f ns/msg (bucle %.1f)\n", r.name, r.ns, baseNs);
+      failed++;
+    }
+  }
+  printf("(UART: lo que bloquearía Serial.printf con el FIFO lleno; el log diferido lo paga la tarea de log)\n");
+  printf(failed ? "FALLO: %d comprobaciones\n" : "OK: formato igual a printf, 0 reservas de heap, MPSC en orden y sin huecos en la cuenta\n",
+         failed);
+  return failed ? 1 : 0;
+}
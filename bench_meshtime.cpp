@@ -0,0 +1,217 @@
+// Pruebas en el host del tiempo del mesh de 64 bits (MeshTime.h).
+//
+//   g++ -O2 -std=c++11 bench_meshtime.cpp -o bench_meshtime && ./bench_meshtime [horas] [semilla]
+//
+// Simula una gateway y NODES nodos que arrancan en momentos distintos a lo
+// largo de varias vueltas de getNodeTime() (uint32 en us, ~71.6 min). Cada
+// nodo lee el tiempo del mesh con su error de sincronización (que a veces
+// salta hacia atrás unos ms) y recibe el ROOT de la gateway cada 30 s con
+// pérdidas. En cada segundo compara la fase de las ranuras (tiempo % período)
+// de cada nodo con la de la gateway, para varios períodos que no dividen
+// 2^32 us, y cuenta los saltos de fase: con 64 bits no debe haber ninguno;
+// con getNodeTime() % período (como antes) los hay en cada vuelta.
+// Además simula un nodo en deep sleep que estima el tiempo con el reloj RTC
+// (con deriva) y sólo a veces oye el ROOT, y casos borde: vuelta entre el
+// ROOT y su recepción, ajuste hacia atrás al cruzar la vuelta, millis() que
+// da la vuelta y valores cerca de 0. Sale con 1 si algo falla.
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "MeshTime.h"
+
+static int failed = 0;
+
+#define CHECK(cond, ...)         \
+  do {                           \
+    if (!(cond)) {               \
+      printf("FALLO: " __VA_ARGS__); \
+      printf("\n");              \
+      failed++;                  \
+    }                            \
+  } while (0)
+
+#define NODES 20
+#define ROOT_EVERY_S 30
+#define ROOT_LOSS 0.3
+#define SYNC_ERR_US 2000   // error de getNodeTime() por nodo, +-
+#define SLEEP_CYCLE_S 300  // nodo en deep sleep
+#define SLEEP_JOIN_EVERY 3
+#define RTC_DRIFT_PPM 40
+
+static const uint64_t kWrapUs = 1ULL << 32;
+static const uint64_t kPeriodsS[] = {7, 30, 60, 600};
+static const uint64_t kMeshStartUs = 3 * kWrapUs + kWrapUs - 90000000ULL;  // primera vuelta a los 90 s
+
+struct Device {
+  uint64_t bootUs;    // tiempo real de arranque
+  uint32_t millis0;   // millis() no arranca en 0 en todos (uno cerca de la vuelta)
+  int32_t errUs;
+  MeshTime64 clock;
+  bool heardRoot;
+  uint64_t lastPhase32[4];
+  bool havePhase;
+};
+
+static uint32_t nodeTime(const Device &d, uint64_t tUs) { return (uint32_t)(kMeshStartUs + tUs + d.errUs); }
+static uint32_t millisOf(const Device &d, uint64_t tUs) { return d.millis0 + (uint32_t)((tUs - d.bootUs) / 1000); }
+
+// Distancia circular entre dos fases de un período
+static uint64_t phaseDiff(uint64_t a, uint64_t b, uint64_t periodUs) {
+  uint64_t d = a > b ? a - b : b - a;
+  return d < periodUs - d ? d : periodUs - d;
+}
+
+static void checkCases() {
+  // Cerca de 0 no baja a valores enormes
+  CHECK(meshTimeNearest(1000, 0xFFFFFF00u) == 0xFFFFFF00ULL, "nearest(1000, 0xFFFFFF00) bajó de 0");
+  CHECK(meshTimeNearest(5 * kWrapUs + 10, 0xFFFFFFF0u) == 5 * kWrapUs - 16, "nearest no retrocedió una vuelta");
+  CHECK(meshTimeNearest(5 * kWrapUs - 10, 20u) == 5 * kWrapUs + 20, "nearest no avanzó una vuelta");
+
+  // ROOT armado antes de la vuelta y recibido después
+  MeshTime64 n;
+  n.adopt(7 * kWrapUs + 0xFFFFFFF0u, 0x10u, 500);
+  CHECK(n.at(0x20u, 500) == 8 * kWrapUs + 0x20, "la vuelta entre el ROOT y su recepción se perdió");
+  // y al revés: armado después, recibido por un nodo que aún no dio la vuelta
+  n.adopt(8 * kWrapUs + 0x10u, 0xFFFFFFF0u, 500);
+  CHECK(n.at(0xFFFFFFF8u, 500) == 8 * kWrapUs - 8, "un nodo atrasado contó una vuelta de más");
+
+  // Ajuste de sincronización hacia atrás justo al cruzar la vuelta
+  MeshTime64 b;
+  b.anchor(2 * kWrapUs + 0xFFFFFF00u, 1000);
+  CHECK(b.at(0x100u, 1000) == 3 * kWrapUs + 0x100, "no contó la vuelta");
+  CHECK(b.at(0xFFFFFFF0u, 1000) == 3 * kWrapUs - 16, "un ajuste hacia atrás dejó una vuelta de más");
+  CHECK(b.at(0x200u, 1001) == 3 * kWrapUs + 0x200, "no volvió a contar la vuelta tras el ajuste");
+
+  // millis() da la vuelta entre dos lecturas
+  MeshTime64 m;
+  m.anchor(4 * kWrapUs + 100, 0xFFFFFF00u);
+  uint64_t later = m.at((uint32_t)(100 + 40 * 60 * 1000000ULL), 0xFFFFFF00u + 40 * 60 * 1000);
+  CHECK(later == 4 * kWrapUs + 100 + 40 * 60 * 1000000ULL, "la vuelta de millis() corrió el tiempo del mesh");
+}
+
+int main(int argc, char **argv) {
+  const double hours = argc > 1 ? atof(argv[1]) : 6;
+  const uint32_t seed = argc > 2 ? (uint32_t)atoi(argv[2]) : 1;
+  checkCases();
+
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> uni(0, 1);
+  const uint64_t endUs = (uint64_t)(hours * 3600e6);
+  const size_t nPeriods = sizeof(kPeriodsS) / sizeof(kPeriodsS[0]);
+
+  Device gw = {};
+  std::vector<Device> nodes(NODES);
+  for (size_t i = 0; i < nodes.size(); i++) {
+    nodes[i] = Device{};
+    nodes[i].bootUs = (uint64_t)(uni(rng) * endUs * 0.6);
+    nodes[i].millis0 = i == 0 ? 0xFFFF0000u : 0;
+  }
+
+  // Nodo en deep sleep: RTC propio con deriva, millis() desde 0 en cada despertar
+  uint64_t sleepOffsetUs = 0;
+  bool sleepSynced = false;
+  uint64_t sleepWakes = 0, sleepChecks = 0, sleepMaxDiffUs = 0;
+
+  uint64_t checks = 0, jumps64 = 0, jumps32 = 0, maxDiffUs = 0, rootsHeard = 0;
+  uint64_t gwPrev[4] = {0, 0, 0, 0};
+  bool gwHavePrev = false;
+
+  for (uint64_t t = 0; t < endUs; t += 1000000) {
+    // Error de sincronización: paseo acotado, a veces un salto hacia atrás
+    for (Device &d : nodes) {
+      d.errUs += (int32_t)(uni(rng) * 400) - 200;
+      if (uni(rng) < 0.01) d.errUs -= 1500;
+      if (d.errUs > SYNC_ERR_US) d.errUs = SYNC_ERR_US;
+      if (d.errUs < -SYNC_ERR_US) d.errUs = -SYNC_ERR_US;
+    }
+    uint64_t gwUs = gw.clock.at(nodeTime(gw, t), millisOf(gw, t));
+
+    // La fase de la gateway avanza 1 s exacto en cada paso
+    for (size_t p = 0; p < nPeriods; p++) {
+      uint64_t periodUs = kPeriodsS[p] * 1000000ULL;
+      uint64_t phase = gwUs % periodUs;
+      if (gwHavePrev && phaseDiff(phase, (gwPrev[p] + 1000000) % periodUs, periodUs) > 0) jumps64++;
+      gwPrev[p] = phase;
+    }
+    gwHavePrev = true;
+
+    for (Device &d : nodes) {
+      if (t < d.bootUs) continue;
+      uint64_t nodeUs = d.clock.at(nodeTime(d, t), millisOf(d, t));
+      for (size_t p = 0; p < nPeriods; p++) {
+        uint64_t periodUs = kPeriodsS[p] * 1000000ULL;
+        uint64_t phase32 = nodeTime(d, t) % periodUs;
+        // Como antes: la fase de 32 bits salta en cada vuelta
+        if (d.havePhase && phaseDiff(phase32, (d.lastPhase32[p] + 1000000) % periodUs, periodUs) > 2 * SYNC_ERR_US) jumps32++;
+        d.lastPhase32[p] = phase32;
+        if (!d.heardRoot) continue;
+        uint64_t diff = phaseDiff(nodeUs % periodUs, gwUs % periodUs, periodUs);
+        if (diff > maxDiffUs) maxDiffUs = diff;
+        checks++;
+      }
+      d.havePhase = true;
+    }
+
+    // ROOT: llega a cada nodo tras el camino por el mesh, antes de su próxima lectura
+    if (t % (ROOT_EVERY_S * 1000000ULL) == 0) {
+      for (Device &d : nodes) {
+        if (t < d.bootUs || uni(rng) < ROOT_LOSS) continue;
+        uint64_t rxUs = t + (uint64_t)(uni(rng) * 50000);  // camino por el mesh
+        d.clock.adopt(gwUs, nodeTime(d, rxUs), millisOf(d, rxUs));
+        d.heardRoot = true;
+        rootsHeard++;
+      }
+    }
+
+    // Deep sleep: despierta cada SLEEP_CYCLE_S con el ancla del RTC y el offset
+    if (t % (SLEEP_CYCLE_S * 1000000ULL) == 0) {
+      Device s = {};
+      s.bootUs = t;
+      uint64_t rtcUs = t + t / 1000000 * RTC_DRIFT_PPM;  // RTC desde el arranque en frío
+      if (sleepSynced) s.clock.anchor(rtcUs + sleepOffsetUs, 0);
+      bool radio = !sleepSynced || sleepWakes % SLEEP_JOIN_EVERY == 0;
+      sleepWakes++;
+      if (radio) {
+        uint64_t joinUs = t + 2000000;  // unido a los 2 s
+        if (!sleepSynced || uni(rng) < 0.3) s.clock.adopt(gwUs + 2000000, nodeTime(s, joinUs), 2000);
+        uint64_t meshUs = s.clock.at(nodeTime(s, joinUs), 2000);
+        sleepOffsetUs = meshUs - (rtcUs + 2000000);
+        sleepSynced = true;
+      } else {
+        for (size_t p = 0; p < nPeriods; p++) {
+          uint64_t periodUs = kPeriodsS[p] * 1000000ULL;
+          uint64_t diff = phaseDiff((rtcUs + sleepOffsetUs) % periodUs, gwUs % periodUs, periodUs);
+          if (diff > sleepMaxDiffUs) sleepMaxDiffUs = diff;
+          sleepChecks++;
+        }
+      }
+    }
+  }
+
+  const uint64_t wraps = (kMeshStartUs + endUs) / kWrapUs - kMeshStartUs / kWrapUs;
+  printf("%.1f h simuladas (%u vueltas de getNodeTime()), %d nodos, ROOT cada %d s con %.0f%% de pérdida\n", hours,
+         (unsigned)wraps, NODES, ROOT_EVERY_S, ROOT_LOSS * 100);
+  printf("fase nodo vs gateway: %llu comparaciones, máx %.2f ms (error de sync +-%.1f ms)\n",
+         (unsigned long long)checks, maxDiffUs / 1000.0, SYNC_ERR_US / 1000.0);
+  printf("saltos de fase: 64 bits=%llu, getNodeTime() %% período=%llu\n", (unsigned long long)jumps64,
+         (unsigned long long)jumps32);
+  printf("deep sleep: %llu despertares, %llu sin radio, fase máx %.2f ms de la gateway\n",
+         (unsigned long long)sleepWakes, (unsigned long long)sleepChecks / nPeriods, sleepMaxDiffUs / 1000.0);
+
+  const uint64_t sleepLimitUs = SLEEP_JOIN_EVERY * SLEEP_CYCLE_S * RTC_DRIFT_PPM + 2 * SYNC_ERR_US;
+  CHECK(wraps >= 1, "la simulación no cruzó ninguna vuelta");
+  CHECK(rootsHeard > 0 && checks > 0, "ningún nodo oyó el ROOT");
+  CHECK(maxDiffUs <= 2 * SYNC_ERR_US, "fase de un nodo a %.2f ms de la gateway", maxDiffUs / 1000.0);
+  CHECK(jumps64 == 0, "la fase de 64 bits saltó %llu veces", (unsigned long long)jumps64);
+  CHECK(jumps32 > 0, "la fase de 32 bits no saltó: la simulación no cruza vueltas");
+  CHECK(sleepChecks > 0 && sleepMaxDiffUs <= sleepLimitUs, "nodo dormido a %.2f ms de la gateway (límite %.2f)",
+        sleepMaxDiffUs / 1000.0, sleepLimitUs / 1000.0);
+
+  printf(failed ? "FALLO: %d comprobaciones\n"
+                : "OK: fase continua y común a todos los nodos a través de las vueltas, también tras el deep sleep\n",
+         failed);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,255 @@
+// Pruebas y benchmark en el host de las métricas de la gateway (GatewayMetrics.h).
+//
+//   g++ -O2 -std=c++11 bench_metrics.cpp -o bench_metrics && ./bench_metrics [muestras] [semilla]
+//
+// Comprueba que cada valor caiga en una cubeta que lo contiene y de ancho
+// < 1/8 del valor, que los percentiles acoten por arriba al exacto con ese
+// error, que merge() sea igual a registrar todo junto, las tasas y la
+// antigüedad por nodo de MeshMetrics, la tabla llena y que el JSON del peor
+// caso entre en METRICS_JSON_MAX. Después mide ns por record()/frame()
+// frente a guardar cada muestra en un std::vector y ordenar al publicar, y
+// cuenta reservas de heap. Sale con 1 si algo falla.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "GatewayMetrics.h"
+
+static size_t allocations = 0;
+
+void *operator new(size_t n) {
+  allocations++;
+  if (void *p = malloc(n)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static int failed = 0;
+
+#define CHECK(cond, ...)         \
+  do {                           \
+    if (!(cond)) {               \
+      printf("FALLO: " __VA_ARGS__); \
+      printf("\n");              \
+      failed++;                  \
+    }                            \
+  } while (0)
+
+typedef std::chrono::steady_clock Clock;
+
+// ---------- Histograma ----------
+template <typename H>
+static void checkBuckets(const char *name, std::mt19937 &rng) {
+  size_t lastIndex = 0;
+  int bad = 0;
+  for (uint32_t v = 0; v < (1u << 20) && bad < 5; v++) {
+    size_t i = H::index(v);
+    if (i < lastIndex || i >= H::BUCKETS) {
+      printf("FALLO: %s índice %zu de %u fuera de orden\n", name, i, v);
+      bad++;
+    }
+    lastIndex = i;
+  }
+  for (int k = 0; k < 200000 && bad < 5; k++) {
+    uint32_t v = rng() >> (rng() % 32);
+    size_t i = H::index(v);
+    uint32_t lo = H::lowerBound(i), hi = H::upperBound(i);
+    bool overflow = i == H::BUCKETS - 1;  // la última cubeta junta lo que no entra
+    if (v < lo || (v > hi && !overflow)) {
+      printf("FALLO: %s %u fuera de su cubeta [%u,%u]\n", name, v, lo, hi);
+      bad++;
+    } else if (i != H::BUCKETS - 1 && v >= 8 && (double)(hi - lo + 1) / lo > 1.0 / 8 + 1e-9) {
+      printf("FALLO: %s cubeta [%u,%u] de %u demasiado ancha\n", name, lo, hi, v);
+      bad++;
+    }
+  }
+  // Debajo de 2^SUB las cubetas son exactas
+  for (uint32_t v = 0; v < 8; v++) {
+    CHECK(H::lowerBound(H::index(v)) == v && H::upperBound(H::index(v)) == v, "%s: %u no es exacto", name, v);
+  }
+  failed += bad;
+}
+
+static void checkPercentiles(std::mt19937 &rng, size_t samples) {
+  LatencyHistogram h, a, b;
+  std::vector<uint32_t> exact;
+  exact.reserve(samples);
+  std::lognormal_distribution<double> latency(8.0, 1.2);  // ~3 ms de mediana, cola larga
+  uint64_t sum = 0;
+  for (size_t i = 0; i < samples; i++) {
+    uint32_t v = (uint32_t)std::min(latency(rng), 2e8);
+    h.record(v);
+    (i & 1 ? a : b).record(v);
+    exact.push_back(v);
+    sum += v;
+  }
+  std::sort(exact.begin(), exact.end());
+  const double qs[] = {0.0, 0.5, 0.9, 0.99, 0.999, 1.0};
+  for (double q : qs) {
+    size_t rank = std::max<size_t>(1, (size_t)(q * exact.size() + 0.999999));
+    uint32_t want = exact[rank - 1];
+    uint32_t got = h.percentile(q);
+    CHECK(got >= want && got <= want + want / 8 + 1, "p%.1f = %u, exacto %u", q * 100, got, want);
+  }
+  CHECK(h.count() == samples && h.sum() == sum && h.min() == exact.front() && h.max() == exact.back(),
+        "count/sum/min/max");
+  a.merge(b);
+  for (double q : qs) CHECK(a.percentile(q) == h.percentile(q), "merge p%.1f", q * 100);
+  CHECK(a.count() == h.count() && a.sum() == h.sum() && a.min() == h.min() && a.max() == h.max(), "merge totales");
+
+  // Fuera de rango: a la última cubeta, con el máximo real
+  DepthHistogram d;
+  d.record(3);
+  d.record(100000);
+  CHECK(d.percentile(1.0) == 100000 && d.percentile(0.5) == 3, "desborde: p50=%u p100=%u", d.percentile(0.5),
+        d.percentile(1.0));
+  d.reset();
+  CHECK(d.count() == 0 && d.percentile(0.5) == 0 && d.max() == 0, "reset");
+}
+
+// ---------- Por nodo ----------
+static void checkNodes() {
+  static MeshMetrics<8> m;
+  static MetricsSnapshot s;
+  // 10 s de ventana: el nodo 1 manda 50 tramas de 80 bytes, el 2 sólo una al principio
+  m.snapshot(1000, s);
+  m.frame(2, 120, 1000);
+  for (int i = 0; i < 50; i++) m.frame(1, 80, 1000 + i * 200);
+  for (int i = 0; i < 100; i++) m.loopTime(1000 + i);
+  m.queueDepth(LANE_DATA, 3);
+  m.queueDepth(LANE_CONTROL, 1);
+  m.snapshot(11000, s);
+  s.queueFull[LANE_DATA] = 7;
+  CHECK(s.windowMs == 10000 && s.tracked == 2 && s.count == 2, "foto: ms=%u nodos=%u", s.windowMs, s.tracked);
+  for (size_t i = 0; i < s.count; i++) {
+    const NodeSample &n = s.nodes[i];
+    if (n.node == 1) CHECK(n.frames == 50 && n.bytes == 4000 && n.lastSeenMs == 200, "nodo 1: %u tramas, edad %u", n.frames, n.lastSeenMs);
+    if (n.node == 2) CHECK(n.frames == 1 && n.bytes == 120 && n.lastSeenMs == 10000, "nodo 2: edad %u", n.lastSeenMs);
+  }
+  CHECK(s.loopUs.count() == 100 && s.queueDepth[LANE_DATA].max() == 3 && s.queueDepth[LANE_CONTROL].max() == 1,
+        "histogramas de la foto");
+
+  static char json[METRICS_JSON_MAX];
+  PublishMetrics p;
+  p.published(LANE_DATA, true, 3500);
+  p.published(LANE_DATA, false, 0);
+  p.published(LANE_CONTROL, true, 900);
+  HeapSample heap = {180000, 150000, 110000};
+  size_t n = gatewayMetricsJson(s, p, heap, 4, 99, json, sizeof(json));
+  CHECK(n && strstr(json, "\"rates\":[") && strstr(json, "[1,5.00,400,200]") && strstr(json, "[2,0.10,12,10000]") &&
+            strstr(json, "\"pub\":[1,1],\"pub_ctl\":[1,0]") &&
+            strstr(json, "\"queue_full\":[7,0]") && strstr(json, "\"pub_us_ctl\":[1,900,900,900,900]") && strstr(json, "\"heap\":[180000,150000,110000]"),
+        "JSON: %s", json);
+
+  // La ventana siguiente empieza en cero; los nodos siguen con su antigüedad
+  m.snapshot(21000, s);
+  CHECK(s.count == 2 && s.nodes[0].frames == 0 && s.nodes[1].frames == 0 && s.loopUs.count() == 0, "no reinició la ventana");
+
+  // Tabla llena: se cuentan sin nodo
+  for (uint32_t id = 10; id < 20; id++) m.frame(id, 10, 21000);
+  CHECK(m.size() == 8, "tabla con %zu nodos", m.size());
+  m.snapshot(22000, s);
+  CHECK(s.untracked == 4 && s.count == 8, "untracked=%u", s.untracked);
+}
+
+// Peor caso de METRICS_NODES_MAX nodos con contadores al máximo
+static void checkJsonWorstCase() {
+  static MetricsSnapshot s;  // estática: empieza en cero
+  s.windowMs = 1000;
+  s.count = s.tracked = METRICS_NODES_MAX;
+  s.untracked = s.queueFull[LANE_DATA] = s.queueFull[LANE_CONTROL] = UINT32_MAX;
+  for (int i = 0; i < 3; i++) s.loopUs.record(UINT32_MAX - i);
+  for (int l = 0; l < LANE_COUNT; l++) {
+    for (int i = 0; i < 3; i++) s.queueDepth[l].record(UINT32_MAX - i);
+  }
+  for (size_t i = 0; i < METRICS_NODES_MAX; i++) s.nodes[i] = {UINT32_MAX, UINT32_MAX, 99999999, UINT32_MAX};
+  PublishMetrics p;
+  for (int l = 0; l < LANE_COUNT; l++) {
+    p.ok[l] = p.failures[l] = UINT32_MAX;
+    p.latencyUs[l].record(UINT32_MAX);
+  }
+  HeapSample heap = {UINT32_MAX, UINT32_MAX, UINT32_MAX};
+  static char json[METRICS_JSON_MAX];
+  size_t n = gatewayMetricsJson(s, p, heap, UINT32_MAX, UINT32_MAX, json, sizeof(json));
+  CHECK(n > 0, "el peor caso no entra en METRICS_JSON_MAX (%u)", (unsigned)METRICS_JSON_MAX);
+  printf("JSON: %zu bytes con %u nodos en el peor caso (buffer %u)\n", n, (unsigned)METRICS_NODES_MAX,
+         (unsigned)METRICS_JSON_MAX);
+}
+
+// ---------- Benchmark ----------
+template <typename F>
+static double nsPer(size_t n, F fn) {
+  Clock::time_point t0 = Clock::now();
+  for (size_t i = 0; i < n; i++) fn(i);
+  return std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / n;
+}
+
+int main(int argc, char **argv) {
+  const size_t samples = argc > 1 ? (size_t)atol(argv[1]) : 2000000;
+  const uint32_t seed = argc > 2 ? (uint32_t)atoi(argv[2]) : 1;
+  std::mt19937 rng(seed);
+
+  checkBuckets<LoopHistogram>("LoopHistogram", rng);
+  checkBuckets<DepthHistogram>("DepthHistogram", rng);
+  checkBuckets<LatencyHistogram>("LatencyHistogram", rng);
+  checkPercentiles(rng, 200000);
+  checkNodes();
+  checkJsonWorstCase();
+
+  // Valores y nodos precalculados: se mide sólo el registro
+  std::vector<uint32_t> values(samples), nodes(samples);
+  std::lognormal_distribution<double> latency(8.0, 1.2);
+  std::vector<uint32_t> ids(200);
+  for (uint32_t &id : ids) id = rng() | 1;
+  for (size_t i = 0; i < samples; i++) {
+    values[i] = (uint32_t)std::min(latency(rng), 2e8);
+    nodes[i] = ids[rng() % ids.size()];
+  }
+
+  static LatencyHistogram h;
+  static MeshMetrics<512> m;  // < 50% ocupada, como METRICS_NODE_SLOTS en la gateway
+  static PublishMetrics p;
+  static MetricsSnapshot snap;
+  size_t before = allocations;
+  double histNs = nsPer(samples, [&](size_t i) { h.record(values[i]); });
+  double frameNs = nsPer(samples, [&](size_t i) { m.frame(nodes[i], 80, (uint32_t)i); });
+  double pubNs = nsPer(samples, [&](size_t i) { p.published(LANE_DATA, true, values[i]); });
+  Clock::time_point t0 = Clock::now();
+  m.snapshot((uint32_t)samples, snap);
+  double snapUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+  t0 = Clock::now();
+  uint32_t p99 = h.percentile(0.99);
+  double pctUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+  size_t hot = allocations - before;
+
+  std::vector<uint32_t> naive;
+  before = allocations;
+  double vecNs = nsPer(samples, [&](size_t i) { naive.push_back(values[i]); });
+  size_t naiveAllocs = allocations - before;
+  t0 = Clock::now();
+  std::sort(naive.begin(), naive.end());
+  uint32_t exact = naive[(size_t)(0.99 * naive.size())];
+  double sortUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+
+  printf("\n%zu muestras, %zu nodos\n", samples, ids.size());
+  printf("%-28s %10s %14s %10s\n", "operación", "ns/muestra", "foto/p99 us", "allocs");
+  printf("%-28s %10.1f %14.1f %10zu\n", "LatencyHistogram::record", histNs, pctUs, (size_t)0);
+  printf("%-28s %10.1f %14.1f %10s\n", "MeshMetrics::frame", frameNs, snapUs, "-");
+  printf("%-28s %10.1f %14s %10s\n", "PublishMetrics::published", pubNs, "-", "-");
+  printf("%-28s %10.1f %14.1f %10zu\n", "vector + sort", vecNs, sortUs, naiveAllocs);
+  printf("p99: histograma %u us, exacto %u us; memoria %zu bytes frente a %zu\n", p99, exact, sizeof(h),
+         naive.capacity() * sizeof(uint32_t));
+  CHECK(hot == 0, "el registro reservó heap %zu veces", hot);
+  CHECK(p99 >= exact && p99 <= exact + exact / 8 + 1, "p99 del benchmark %u, exacto %u", p99, exact);
+
+  printf(failed ? "FALLO: %d comprobaciones\n"
+                : "OK: cubetas con error < 1/8, percentiles acotados, tasas por nodo y 0 reservas de heap\n",
+         failed);
+  return failed ? 1 : 0;
+}
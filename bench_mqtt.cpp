@@ -0,0 +1,217 @@
+// Prueba en el host de la reconexión MQTT (MqttReconnect.h) con un
+// PubSubClient falso.
+//
+//   g++ -O2 -std=c++11 -pthread bench_mqtt.cpp -o bench_mqtt && ./bench_mqtt [segundos]
+//
+// Primero con reloj virtual: el connect() falso "bloquea" MQTT_SOCKET_TIMEOUT_MS
+// con el broker caído. Comprueba el backoff (mitad fija + jitter, duplicando
+// hasta MQTT_BACKOFF_MAX_MS), los contadores por intento, la vuelta al mínimo
+// al conectar y el aviso de conexión perdida.
+// Después con dos hilos, como en el ESP32: uno hace mesh.update() cada
+// MESH_PERIOD_MS y el otro es la tarea MQTT con el broker caído, cuyo
+// connect() bloquea de verdad. Mide el hueco máximo entre dos mesh.update()
+// y lo compara con el mismo servicio llamado desde el bucle del mesh (el
+// reconnect() de antes). Sale con 1 si algo falla.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "MqttReconnect.h"
+
+static int failed = 0;
+
+#define CHECK(cond, ...)         \
+  do {                           \
+    if (!(cond)) {               \
+      printf("FALLO: " __VA_ARGS__); \
+      printf("\n");              \
+      failed++;                  \
+    }                            \
+  } while (0)
+
+#define MQTT_SOCKET_TIMEOUT_MS 2000  // setSocketTimeout(2) de GATEWAY.cpp
+#define MESH_PERIOD_MS 1             // una vuelta de loop() sin trabajo
+#define BLOCK_SCALE 10               // con hilos: connect() de 200 ms
+#define GAP_LIMIT_MS 50
+
+// ---------- Reloj virtual ----------
+
+static uint32_t virtualNow = 0;
+
+struct VirtualClock {
+  uint32_t operator()() const { return virtualNow; }
+};
+
+// PubSubClient falso: con el broker caído connect() tarda el socket timeout
+struct FakeClient {
+  bool brokerUp = false;
+  bool isConnected = false;
+  uint32_t connects = 0;
+  uint32_t loops = 0;
+  bool connected() { return isConnected; }
+  bool loop() {
+    loops++;
+    return isConnected;
+  }
+  bool connect(const char *) {
+    connects++;
+    virtualNow += brokerUp ? 30 : MQTT_SOCKET_TIMEOUT_MS;
+    isConnected = brokerUp;
+    return isConnected;
+  }
+  int state() { return isConnected ? 0 : -2; }  // MQTT_CONNECT_FAILED
+};
+
+static void checkStateMachine() {
+  static FakeClient client;
+  static MqttReconnect<FakeClient, VirtualClock> link(client, VirtualClock());
+  link.seed(12345);
+
+  // Primer intento inmediato; luego backoff duplicando con jitter
+  uint32_t base = MQTT_BACKOFF_MIN_MS;
+  uint32_t attemptAt = 0;
+  bool jitterVaries = false;
+  uint32_t firstShare = 0;  // parte aleatoria de la primera espera, en milésimas
+  for (int i = 0; i < 12; i++) {
+    while (virtualNow < attemptAt) {
+      CHECK(link.service("gw") == MQTT_IDLE, "intento antes de tiempo en %u ms", virtualNow);
+      virtualNow += 10;
+    }
+    virtualNow = attemptAt;
+    MqttEvent ev = link.service("gw");
+    CHECK(ev == MQTT_ATTEMPT_FAILED, "intento %d: evento %u", i, ev);
+    uint32_t wait = link.lastWait();
+    CHECK(wait >= base / 2 && wait <= base, "intento %d: espera %u fuera de [%u, %u]", i, wait, base / 2, base);
+    uint32_t share = (uint32_t)((uint64_t)(wait - base / 2) * 1000 / (base / 2 + 1));
+    if (i == 0) firstShare = share;
+    if (share != firstShare) jitterVaries = true;
+    attemptAt = virtualNow + wait;
+    base = std::min<uint32_t>(base * 2, MQTT_BACKOFF_MAX_MS);
+  }
+  CHECK(jitterVaries, "el jitter no varía");
+  CHECK(link.backoff() == MQTT_BACKOFF_MAX_MS, "backoff sin tope: %u", link.backoff());
+  const MqttStats &st = link.stats();
+  CHECK(st.attempts == 12 && st.failures == 12 && client.connects == 12, "contadores: %u intentos, %u fallos",
+        st.attempts, st.failures);
+  CHECK(st.lastAttemptMs == MQTT_SOCKET_TIMEOUT_MS && st.maxAttemptMs == MQTT_SOCKET_TIMEOUT_MS &&
+            st.totalAttemptMs == 12 * MQTT_SOCKET_TIMEOUT_MS,
+        "tiempos: último %u, max %u, total %u", st.lastAttemptMs, st.maxAttemptMs, st.totalAttemptMs);
+
+  // Vuelve el broker: conecta en el próximo intento y el backoff vuelve al mínimo
+  client.brokerUp = true;
+  virtualNow = attemptAt;
+  CHECK(link.service("gw") == MQTT_UP && link.up() && link.backoff() == MQTT_BACKOFF_MIN_MS,
+        "no conectó al volver el broker");
+  CHECK(st.lastAttemptMs == 30 && st.maxAttemptMs == MQTT_SOCKET_TIMEOUT_MS, "tiempos tras conectar");
+  uint32_t loops = client.loops;
+  for (int i = 0; i < 5; i++) CHECK(link.service("gw") == MQTT_IDLE, "evento con la conexión arriba");
+  CHECK(client.loops == loops + 5, "client.loop() no se llamó en cada vuelta");
+
+  // Se cae: un aviso y el reintento tras jitter(mínimo), no enseguida
+  client.isConnected = false;
+  client.brokerUp = false;
+  CHECK(link.service("gw") == MQTT_LOST && !link.up(), "caída sin aviso");
+  uint32_t wait = link.lastWait();
+  CHECK(wait >= MQTT_BACKOFF_MIN_MS / 2 && wait <= MQTT_BACKOFF_MIN_MS, "espera tras la caída %u", wait);
+  uint32_t connects = client.connects;
+  CHECK(link.service("gw") == MQTT_IDLE && client.connects == connects, "reintento inmediato tras la caída");
+  virtualNow += wait;
+  CHECK(link.service("gw") == MQTT_ATTEMPT_FAILED && client.connects == connects + 1, "sin reintento tras la espera");
+}
+
+// ---------- Dos hilos, reloj real ----------
+
+static uint32_t realMs() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct RealClock {
+  uint32_t operator()() const { return realMs(); }
+};
+
+// Con el broker caído connect() bloquea de verdad (escalado por BLOCK_SCALE)
+struct BlockingClient {
+  std::atomic<uint32_t> connects{0};
+  bool connected() { return false; }
+  bool loop() { return false; }
+  bool connect(const char *) {
+    connects++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(MQTT_SOCKET_TIMEOUT_MS / BLOCK_SCALE));
+    return false;
+  }
+  int state() { return -2; }
+};
+
+struct MeshLoop {
+  uint32_t updates = 0;
+  uint32_t maxGapMs = 0;
+  uint32_t last = realMs();
+  void update() {  // mesh.update() más el resto de loop()
+    uint32_t now = realMs();
+    maxGapMs = std::max(maxGapMs, now - last);
+    last = now;
+    updates++;
+  }
+};
+
+int main(int argc, char **argv) {
+  const double seconds = argc > 1 ? atof(argv[1]) : 3;
+  checkStateMachine();
+
+  const uint32_t runMs = (uint32_t)(seconds * 1000);
+
+  // Como en GATEWAY.cpp: la tarea MQTT en otro hilo
+  BlockingClient separate;
+  MqttReconnect<BlockingClient, RealClock> task(separate, RealClock());
+  std::atomic<bool> running{true};
+  std::thread mqtt([&] {
+    while (running.load()) {
+      task.service("gw");
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));  // MQTT_TASK_PERIOD_MS
+    }
+  });
+  MeshLoop twoCores;
+  uint32_t start = realMs();
+  while (realMs() - start < runMs) {
+    twoCores.update();
+    std::this_thread::sleep_for(std::chrono::milliseconds(MESH_PERIOD_MS));
+  }
+  running.store(false);
+  mqtt.join();
+
+  // El servicio desde el bucle del mesh, como el reconnect() en loop()
+  BlockingClient inline_;
+  MqttReconnect<BlockingClient, RealClock> inLoop(inline_, RealClock());
+  MeshLoop oneCore;
+  start = realMs();
+  while (realMs() - start < runMs) {
+    oneCore.update();
+    inLoop.service("gw");
+    std::this_thread::sleep_for(std::chrono::milliseconds(MESH_PERIOD_MS));
+  }
+
+  printf("broker caído %.0f s, connect() bloquea %u ms, mesh.update() cada %u ms\n", seconds,
+         MQTT_SOCKET_TIMEOUT_MS / BLOCK_SCALE, MESH_PERIOD_MS);
+  printf("%-26s %10s %14s %10s\n", "", "updates/s", "hueco max ms", "connect()");
+  printf("%-26s %10.0f %14u %10u\n", "tarea MQTT aparte", twoCores.updates / seconds, twoCores.maxGapMs,
+         separate.connects.load());
+  printf("%-26s %10.0f %14u %10u\n", "reconexión en loop()", oneCore.updates / seconds, oneCore.maxGapMs,
+         inline_.connects.load());
+
+  CHECK(separate.connects >= 2, "la tarea MQTT sólo intentó %u veces", separate.connects.load());
+  CHECK(twoCores.maxGapMs <= GAP_LIMIT_MS, "hueco de %u ms en mesh.update() con la tarea MQTT aparte",
+        twoCores.maxGapMs);
+  CHECK(oneCore.maxGapMs >= MQTT_SOCKET_TIMEOUT_MS / BLOCK_SCALE,
+        "la referencia en loop() no muestra el bloqueo (%u ms)", oneCore.maxGapMs);
+
+  printf(failed ? "FALLO: %d comprobaciones\n"
+                : "OK: backoff con jitter y contadores; mesh.update() sigue a su ritmo con el broker caído\n",
+         failed);
+  return failed ? 1 : 0;
+}
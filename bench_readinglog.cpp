@@ -0,0 +1,378 @@
+// Prueba en el host del log de lecturas en flash de los nodos (ReadingLog.h).
+//
+//   g++ -O2 -std=c++11 bench_readinglog.cpp -o bench_readinglog && ./bench_readinglog [vueltas] [semilla]
+//
+// Contra una NOR flash en RAM (borrar deja 0xFF, escribir sólo baja bits) con
+// las SensorFrame empaquetadas que guarda MeshNodeRuntime:
+//
+// - Orden: lo pendiente se reenvía en orden de seq, byte a byte como se
+//   escribió, también tras remontar en caliente o en frío (época nueva).
+// - Vuelta del anillo: sin root durante VUELTAS vueltas, con y sin reenvíos
+//   intercalados. Lo pendiente es siempre la cola más reciente, sin huecos, y
+//   escritas = enviadas + pendientes + overflow. Cuenta borrados por registro.
+// - Corte de energía: se corta la escritura en cada byte de un registro y en
+//   cada byte de un borrado de sector. Al remontar no se reenvía nada
+//   corrupto ni se pierde nada confirmado antes del corte (salvo lo del
+//   sector que se estaba borrando, que ya era overflow), y el log sigue
+//   escribiendo.
+// - Un bit dañado en un registro pendiente se cuenta como corrupto y se salta.
+// Sale con 1 si algo falla.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "ReadingLog.h"
+#include "SensorFrame.h"
+
+static int failed = 0;
+
+#define CHECK(cond, ...)         \
+  do {                           \
+    if (!(cond)) {               \
+      printf("FALLO: " __VA_ARGS__); \
+      printf("\n");              \
+      failed++;                  \
+    }                            \
+  } while (0)
+
+#define SECTORS 16  // READING_LOG_SECTORS de los nodos
+#define READING_MS 10000
+
+// NOR en RAM. Con cutAfter >= 0 se corta la energía tras programar o borrar
+// esa cantidad de bytes: la operación en curso queda a medias y falla, igual
+// que todas las siguientes hasta reboot()
+class SimFlash {
+ public:
+  explicit SimFlash(size_t sectors) : mem_(sectors * READING_LOG_SECTOR_SIZE, 0xFF) {}
+
+  size_t sectorCount() const { return mem_.size() / READING_LOG_SECTOR_SIZE; }
+  bool read(uint32_t addr, void *buf, size_t len) {
+    if (dead_ || addr + len > mem_.size()) return false;
+    memcpy(buf, &mem_[addr], len);
+    return true;
+  }
+  bool write(uint32_t addr, const void *buf, size_t len) {
+    if (dead_ || addr + len > mem_.size()) return false;
+    const uint8_t *p = (const uint8_t *)buf;
+    for (size_t i = 0; i < len; i++) {
+      if (!spend()) return false;
+      mem_[addr + i] &= p[i];
+    }
+    writes += len;
+    return true;
+  }
+  bool erase(uint32_t sector) {
+    if (dead_ || (sector + 1) * READING_LOG_SECTOR_SIZE > mem_.size()) return false;
+    for (size_t i = 0; i < READING_LOG_SECTOR_SIZE; i++) {
+      if (!spend()) {
+        cutInErase = true;
+        return false;
+      }
+      mem_[sector * READING_LOG_SECTOR_SIZE + i] = 0xFF;
+    }
+    erases++;
+    return true;
+  }
+
+  void cutAfter(long bytes) { budget_ = bytes; }
+  bool dead() const { return dead_; }
+  void reboot() {
+    dead_ = false;
+    budget_ = -1;
+  }
+  void flip(uint32_t addr, uint8_t mask) { mem_[addr] ^= mask; }
+
+  uint64_t writes = 0;
+  uint32_t erases = 0;
+  bool cutInErase = false;  // el corte dejó un sector borrado a medias
+
+ private:
+  bool spend() {
+    if (budget_ < 0) return true;
+    if (budget_ == 0) {
+      dead_ = true;
+      return false;
+    }
+    budget_--;
+    return true;
+  }
+
+  std::vector<uint8_t> mem_;
+  long budget_ = -1;
+  bool dead_ = false;
+};
+
+typedef ReadingLog<SimFlash> Log;
+
+// Lo que escribe MeshNodeRuntime: la lectura empaquetada, a veces con GPS y
+// estadísticas (la trama más larga ocupa todo el registro)
+static size_t makeReading(uint32_t i, uint8_t *bin) {
+  SensorFrame f = {};
+  f.type = (uint8_t)(1 + i % 4);
+  f.flags = (uint8_t)((i % 3 == 0 ? SENSOR_FLAG_GPS : 0) | (i % 5 == 0 ? SENSOR_FLAG_STATS : 0));
+  f.seq = (uint16_t)i;
+  f.sampleMs = i * READING_MS;
+  f.values[0] = (int16_t)(2000 + i % 977);
+  f.values[1] = (int16_t)(-(int)(i % 331));
+  f.latE6 = 4600000 + (int32_t)i;
+  f.lonE6 = -74080000 - (int32_t)i;
+  f.statMin = -1;
+  f.statMax = 1;
+  f.statStd = (int16_t)(i % 7);
+  return packSensorFrame(f, bin);
+}
+
+// Lo confirmado por append(), por seq del log
+typedef std::map<uint32_t, std::vector<uint8_t>> Model;
+
+static bool append(Log &log, Model &model, uint32_t &next) {
+  uint8_t bin[SENSOR_FRAME_MAX_BIN];
+  size_t n = makeReading(next, bin);
+  if (!log.append(bin, n, next * READING_MS)) return false;
+  model[next] = std::vector<uint8_t>(bin, bin + n);
+  next++;
+  return true;
+}
+
+struct Replay {
+  uint32_t count = 0;
+  uint32_t first = 0, last = 0;
+  uint32_t disorder = 0;   // seq no creciente
+  uint32_t unknown = 0;    // seq que nunca se confirmó, o contenido distinto
+  uint32_t gaps = 0;       // confirmadas sin reenviar entre first y last
+  uint32_t undecoded = 0;  // no se puede desempaquetar como SensorFrame
+  uint8_t epoch = 0;
+};
+
+// Reenvía hasta max pendientes (todo si max es 0), como backfill() del nodo.
+// Las seq del log empiezan en 1 y las lecturas del modelo usan la misma
+static Replay replay(Log &log, Model &model, size_t max = 0) {
+  Replay r;
+  Log::Entry e;
+  while ((!max || r.count < max) && log.peek(e)) {
+    if (r.count && e.seq <= r.last) r.disorder++;
+    if (r.count && e.seq > r.last + 1) {
+      for (uint32_t s = r.last + 1; s < e.seq; s++) r.gaps += model.count(s);
+    }
+    auto it = model.find(e.seq);
+    if (it == model.end() || it->second.size() != e.len || memcmp(it->second.data(), e.data, e.len) != 0) {
+      r.unknown++;
+    } else {
+      model.erase(it);
+    }
+    SensorFrame f;
+    if (!unpackSensorFrame(e.data, e.len, f)) r.undecoded++;
+    if (!r.count) r.first = e.seq;
+    r.last = e.seq;
+    r.epoch = e.epoch;
+    r.count++;
+    log.pop();
+  }
+  return r;
+}
+
+// Lo que quedó en el modelo por debajo de la primera reenviada se perdió por
+// overflow; lo que quede por encima es una pérdida indebida
+static uint32_t lostAbove(const Model &model, uint32_t seq) {
+  uint32_t n = 0;
+  for (auto &kv : model) n += kv.first > seq;
+  return n;
+}
+
+// drained: se reenvió todo lo pendiente, así que no puede quedar nada más
+// nuevo que la primera reenviada
+static void checkReplay(const char *name, const Replay &r, const Model &model, bool drained = true) {
+  CHECK(!r.disorder && !r.unknown && !r.gaps && !r.undecoded,
+        "%s: %u fuera de orden, %u desconocidas o distintas, %u huecos, %u sin decodificar", name, r.disorder,
+        r.unknown, r.gaps, r.undecoded);
+  if (drained) {
+    CHECK(!lostAbove(model, r.count ? r.first : 0), "%s: %u confirmadas sin reenviar", name,
+          lostAbove(model, r.count ? r.first : 0));
+  }
+}
+
+static void orderAndRemount() {
+  SimFlash flash(SECTORS);
+  Model model;
+  uint32_t next = 1;
+  {
+    Log log(flash);
+    CHECK(log.mount(true), "montaje inicial");
+    for (int i = 0; i < 250; i++) append(log, model, next);
+    Replay r = replay(log, model, 100);
+    CHECK(r.count == 100 && r.first == 1 && r.last == 100 && !r.disorder && !r.unknown,
+          "reenvío parcial: %u de 100, seq %u..%u", r.count, r.first, r.last);
+    CHECK(log.pending() == 150, "pendientes tras reenviar 100 de 250: %u", (unsigned)log.pending());
+  }
+  // Despertar de deep sleep: misma época, sigue la numeración
+  uint8_t epoch;
+  {
+    Log log(flash);
+    CHECK(log.mount(false) && log.pending() == 150, "remontaje en caliente: %u pendientes", (unsigned)log.pending());
+    epoch = log.epoch();
+    for (int i = 0; i < 10; i++) append(log, model, next);
+    Replay r = replay(log, model);
+    checkReplay("remontaje en caliente", r, model);
+    CHECK(r.count == 160 && r.first == 101 && r.last == next - 1 && r.epoch == epoch,
+          "remontaje en caliente: %u reenviadas, seq %u..%u, época %u/%u", r.count, r.first, r.last, r.epoch, epoch);
+  }
+  // Arranque en frío: época nueva para los instantes de otro reloj
+  {
+    Log log(flash);
+    CHECK(log.mount(true) && !log.pending(), "remontaje en frío: %u pendientes", (unsigned)log.pending());
+    CHECK(log.epoch() == (uint8_t)(epoch + 1), "época %u tras arranque en frío, antes %u", log.epoch(), epoch);
+    append(log, model, next);
+    Replay r = replay(log, model);
+    CHECK(r.count == 1 && r.first == next - 1 && r.epoch == log.epoch(), "primera del arranque en frío: seq %u",
+          r.first);
+  }
+  printf("%-28s OK\n", "orden y remontaje");
+}
+
+static void wrap(uint32_t laps, uint32_t seed) {
+  std::mt19937 rng(seed);
+  for (int interleave = 0; interleave < 2; interleave++) {
+    SimFlash flash(SECTORS);
+    std::unique_ptr<Log> boot(new Log(flash));
+    boot->mount(true);
+    Model model;
+    uint32_t next = 1;
+    const size_t total = laps * boot->capacity();
+    uint32_t overflow = 0, popped = 0, remounts = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < total; i++) {
+      Log &log = *boot;
+      CHECK(append(log, model, next), "vuelta: append %u falló", (unsigned)i);
+      if (interleave && rng() % 32 == 0) {
+        // Vuelve el root un rato: reenvía una ráfaga como BACKFILL_BURST, menos
+        // de lo que se escribe, así que el anillo igual da la vuelta
+        Replay r = replay(log, model, 8);
+        checkReplay("vuelta con reenvíos", r, model, false);
+        popped += r.count;
+      }
+      if (interleave && rng() % 500 == 0) {
+        // Reinicio a mitad de la vuelta: los contadores vuelven a cero
+        overflow += log.stats().overflow;
+        boot.reset(new Log(flash));
+        boot->mount(rng() % 2);
+        remounts++;
+      }
+    }
+    Log &log = *boot;
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / total;
+
+    const Log::Stats st = log.stats();
+    size_t pending = log.pending();
+    Replay r = replay(log, model);
+    const char *name = interleave ? "vuelta con reenvíos" : "vuelta sin root";
+    checkReplay(name, r, model);
+    CHECK(r.count == pending && (!pending || r.last == next - 1), "%s: %u reenviadas de %u pendientes, última %u de %u",
+          name, r.count, (unsigned)pending, r.last, next - 1);
+    CHECK(pending >= log.capacity() - Log::kPerSector || interleave,
+          "%s: sólo %u pendientes con el anillo lleno (capacidad %u)", name, (unsigned)pending,
+          (unsigned)log.capacity());
+    // Los contadores no sobreviven a un remontaje: sólo en la corrida sin reinicios
+    if (!remounts) {
+      CHECK(st.appended == total && st.appended == st.sent + pending + st.overflow,
+            "%s: escritas %u != enviadas %u + pendientes %u + overflow %u", name, st.appended, st.sent,
+            (unsigned)pending, st.overflow);
+    }
+    printf("%-28s %7u lecturas (%u vueltas de %u), %5u reenviadas antes, %5u overflow, %u reinicios, %.3f borrados "
+           "por lectura, %.0f ns por lectura\n",
+           name, (unsigned)total, laps, (unsigned)log.capacity(), popped, overflow + st.overflow, remounts,
+           (double)flash.erases / total, ns);
+  }
+}
+
+// Corta la energía tras `bytes` bytes programados/borrados durante un append
+// y comprueba lo que queda al remontar
+static bool powerCut(long bytes, size_t prefill, size_t popFirst, uint32_t &cutsInErase) {
+  SimFlash flash(SECTORS);
+  Model model;
+  uint32_t next = 1;
+  size_t pendingBefore;
+  {
+    Log log(flash);
+    log.mount(true);
+    for (size_t i = 0; i < prefill; i++) append(log, model, next);
+    replay(log, model, popFirst);
+    pendingBefore = log.pending();
+    flash.cutAfter(bytes);
+    if (append(log, model, next)) return false;  // terminó antes del corte: no hay más casos
+    cutsInErase += flash.cutInErase;
+  }
+  flash.reboot();
+  Log log(flash);
+  CHECK(log.mount(true), "corte tras %ld bytes: no monta", bytes);
+  // Lo que se estaba pisando al borrar un sector ya era overflow
+  Replay r = replay(log, model);
+  char name[64];
+  snprintf(name, sizeof(name), "corte tras %ld bytes (%u escritas)", bytes, (unsigned)prefill);
+  checkReplay(name, r, model);
+  CHECK(r.count + Log::kPerSector >= pendingBefore, "%s: %u reenviadas de %u pendientes antes del corte", name,
+        r.count, (unsigned)pendingBefore);
+  // Y sigue escribiendo sobre lo que quedó
+  for (int i = 0; i < 3; i++) CHECK(append(log, model, next), "%s: append tras el corte falló", name);
+  Replay after = replay(log, model);
+  checkReplay(name, after, model);
+  CHECK(after.count == 3 && after.last == next - 1, "%s: %u de 3 tras el corte", name, after.count);
+  return true;
+}
+
+static void powerCuts() {
+  uint32_t cases = 0, inErase = 0;
+  const size_t slots = SECTORS * Log::kPerSector;
+  // Corte dentro de un registro: anillo a medias, con algo ya reenviado
+  for (long b = 0; powerCut(b, 37, 5, inErase); b++) cases++;
+  // Anillo lleno y la mitad ya enviada: se borra un sector sin pendientes
+  for (long b = 0; powerCut(b, slots, slots / 2, inErase); b += 61) cases++;
+  // Anillo lleno sin root: el borrado pisa pendientes
+  for (long b = 0; powerCut(b, slots, 0, inErase); b += 61) cases++;
+  CHECK(inErase > 0, "ningún corte cayó dentro de un borrado");
+  printf("%-28s %u cortes (%u durante un borrado) sin reenvíos corruptos ni pérdidas de lo confirmado\n",
+         "corte de energía", cases, inErase);
+}
+
+static void bitRot() {
+  SimFlash flash(SECTORS);
+  Model model;
+  uint32_t next = 1;
+  {
+    Log log(flash);
+    log.mount(true);
+    for (int i = 0; i < 20; i++) append(log, model, next);
+  }
+  // El registro 7 (seq 8) pierde un bit del valor
+  flash.flip(7 * READING_LOG_RECORD + READING_LOG_HEADER + 10, 0x04);
+  Log log(flash);
+  log.mount(false);
+  CHECK(log.stats().corrupt == 1, "bit dañado: %u corruptos al montar", log.stats().corrupt);
+  Replay r = replay(log, model);
+  CHECK(r.count == 19 && !r.unknown && model.size() == 1 && model.count(8), "bit dañado: %u reenviadas, %u distintas",
+        r.count, r.unknown);
+  printf("%-28s OK (se salta el registro dañado)\n", "bit dañado");
+}
+
+int main(int argc, char **argv) {
+  const uint32_t laps = argc > 1 ? (uint32_t)atoi(argv[1]) : 5;
+  const uint32_t seed = argc > 2 ? (uint32_t)atoi(argv[2]) : 1;
+
+  printf("%u sectores de %u bytes, %u registros de %u bytes por sector\n", SECTORS, READING_LOG_SECTOR_SIZE,
+         (unsigned)Log::kPerSector, READING_LOG_RECORD);
+  orderAndRemount();
+  wrap(laps, seed);
+  powerCuts();
+  bitRot();
+
+  printf(failed ? "FALLO: %d comprobaciones\n"
+                : "OK: reenvío en orden y sin huecos, vueltas del anillo contadas y cortes de energía sin "
+                  "registros corruptos\n",
+         failed);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,328 @@
+// Pruebas en el host del escaneo WiFi asíncrono de la gateway (WifiScan.h).
+//
+//   g++ -O2 -std=c++11 -pthread bench_scan.cpp -o bench_scan && ./bench_scan [segundos] [semilla]
+//
+// Simula loop() de la gateway sin IP con un reloj virtual: cada vuelta cuesta
+// LOOP_COST_MS (mesh.update() y compañía) más lo que tarde de verdad poll()
+// medido con steady_clock. La radio simulada tarda 1-3 s por escaneo y avisa
+// con SCAN_DONE desde otro hilo, como la tarea de eventos WiFi del ESP32.
+// Compara el hueco máximo entre dos mesh.update() contra el scanNetworks()
+// síncrono de antes y falla si el asíncrono supera LOOP_GAP_LIMIT_MS.
+// Además prueba el SSID objetivo, las redes más fuertes, el evento perdido,
+// la radio colgada, el arranque rechazado y que poll() no reserve heap.
+// Sale con 1 si algo falla.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "WifiScan.h"
+
+static size_t allocations = 0;
+
+void *operator new(size_t n) {
+  allocations++;
+  if (void *p = malloc(n)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static int failed = 0;
+
+#define CHECK(cond, ...)         \
+  do {                           \
+    if (!(cond)) {               \
+      printf("FALLO: " __VA_ARGS__); \
+      printf("\n");              \
+      failed++;                  \
+    }                            \
+  } while (0)
+
+#define LOOP_COST_MS 1.0     // una vuelta de loop() sin escaneo
+#define LOOP_GAP_LIMIT_MS 5  // máximo aceptable entre dos mesh.update()
+#define SCAN_MIN_MS 1000
+#define SCAN_MAX_MS 3000
+#define SIM_NETWORKS 30
+#define TARGET_SSID "Doo"
+
+typedef std::chrono::steady_clock Clock;
+
+// ---------- Radio simulada ----------
+struct SimRadio {
+  double *now;  // reloj virtual, ms
+  std::mt19937 rng;
+  bool running = false;
+  bool results = false;
+  double doneAt = 0;
+  bool refuseStart = false;  // start() rechazado
+  bool dropEvent = false;    // SCAN_DONE nunca llega
+  bool hang = false;         // la radio no termina nunca
+  bool targetOnAir = true;
+  std::vector<WifiNet> nets;
+  uint32_t starts = 0;
+  uint32_t releases = 0;
+
+  explicit SimRadio(double *clock, uint32_t seed) : now(clock), rng(seed) { nets.reserve(SIM_NETWORKS + 1); }
+
+  double scanMs() { return SCAN_MIN_MS + rng() % (SCAN_MAX_MS - SCAN_MIN_MS + 1); }
+
+  bool start() {
+    if (refuseStart || running) return false;
+    starts++;
+    running = true;
+    results = false;
+    doneAt = *now + (hang ? 1e12 : scanMs());
+    return true;
+  }
+
+  // El "hardware": cierra el escaneo al llegar doneAt. true si hay que
+  // avisar con SCAN_DONE
+  bool step() {
+    if (!running || *now < doneAt) return false;
+    running = false;
+    results = true;
+    nets.clear();
+    for (int i = 0; i < SIM_NETWORKS; i++) {
+      WifiNet n;
+      snprintf(n.ssid, sizeof(n.ssid), "vecino-%02d", i);
+      n.rssi = (int8_t)-(30 + (int)(rng() % 65));
+      n.channel = (uint8_t)(1 + rng() % 13);
+      nets.push_back(n);
+    }
+    if (targetOnAir) {
+      WifiNet t;
+      snprintf(t.ssid, sizeof(t.ssid), "%s", TARGET_SSID);
+      t.rssi = -61;
+      t.channel = 6;
+      nets.insert(nets.begin() + rng() % nets.size(), t);
+    }
+    return !dropEvent;
+  }
+
+  int16_t complete() { return running ? -1 : results ? (int16_t)nets.size() : -2; }
+
+  bool entry(int16_t i, WifiNet &net) {
+    if (!results || i >= (int16_t)nets.size()) return false;
+    net = nets[i];
+    return true;
+  }
+
+  void release() {
+    running = false;
+    results = false;
+    releases++;
+  }
+};
+
+// ---------- loop() simulado ----------
+struct LoopRun {
+  double maxGapMs;
+  double maxPollUs;
+  uint32_t loops;
+  uint32_t scans;
+  size_t allocs;
+};
+
+// SCAN_DONE llega desde otro hilo, como la tarea de eventos WiFi
+struct EventTask {
+  WifiScanner<SimRadio> &scanner;
+  std::atomic<int> pending{0};
+  std::atomic<bool> stop{false};
+  std::thread thread;
+
+  explicit EventTask(WifiScanner<SimRadio> &s) : scanner(s) {
+    thread = std::thread([this] {
+      while (!stop.load()) {
+        if (pending.load(std::memory_order_acquire)) {
+          pending.fetch_sub(1);
+          scanner.notifyDone();
+        }
+        std::this_thread::yield();
+      }
+    });
+  }
+  ~EventTask() {
+    stop.store(true);
+    thread.join();
+  }
+  // Espera a que el hilo entregue el evento, así el reloj virtual no avanza
+  // mientras tanto y la prueba es determinista
+  void deliver() {
+    pending.fetch_add(1, std::memory_order_release);
+    while (pending.load(std::memory_order_acquire)) std::this_thread::yield();
+  }
+};
+
+static LoopRun runAsync(double seconds, uint32_t seed, bool &targetAlwaysSeen) {
+  double now = 0;
+  SimRadio radio(&now, seed);
+  WifiScanner<SimRadio> scanner(radio, TARGET_SSID);
+  EventTask events(scanner);
+  LoopRun r = {};
+  targetAlwaysSeen = true;
+  double lastUpdate = 0;
+  while (now < seconds * 1000) {
+    r.maxGapMs = std::max(r.maxGapMs, now - lastUpdate);
+    lastUpdate = now;
+    now += LOOP_COST_MS;  // mesh.update() y el resto de loop()
+    if (radio.step()) events.deliver();
+
+    size_t allocsBefore = allocations;
+    Clock::time_point t0 = Clock::now();
+    bool fresh = scanner.poll((uint32_t)now, true);
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+    r.allocs += allocations - allocsBefore;
+    r.maxPollUs = std::max(r.maxPollUs, us);
+    now += us / 1000;
+    if (fresh) {
+      r.scans++;
+      targetAlwaysSeen = targetAlwaysSeen && scanner.status().targetSeen;
+    }
+    r.loops++;
+  }
+  return r;
+}
+
+// Lo de antes: WiFi.scanNetworks() síncrono cada WIFI_SCAN_PERIOD_MS
+static LoopRun runSync(double seconds, uint32_t seed) {
+  double now = 0;
+  SimRadio radio(&now, seed);
+  LoopRun r = {};
+  double lastUpdate = 0;
+  double lastScan = 0;
+  while (now < seconds * 1000) {
+    r.maxGapMs = std::max(r.maxGapMs, now - lastUpdate);
+    lastUpdate = now;
+    now += LOOP_COST_MS;
+    if (now - lastScan > WIFI_SCAN_PERIOD_MS) {
+      lastScan = now;
+      radio.start();
+      now = radio.doneAt;  // bloqueado hasta que termina
+      radio.step();
+      radio.release();
+      r.scans++;
+    }
+    r.loops++;
+  }
+  return r;
+}
+
+// ---------- Casos puntuales ----------
+static void checkCases(uint32_t seed) {
+  double now = 0;
+  SimRadio radio(&now, seed);
+  WifiScanner<SimRadio> scanner(radio, TARGET_SSID);
+
+  // El primer escaneo espera WIFI_SCAN_PERIOD_MS, como el scanNetworks() de antes
+  CHECK(!scanner.poll(0, true) && !scanner.busy(), "escaneo antes de WIFI_SCAN_PERIOD_MS");
+  now = WIFI_SCAN_PERIOD_MS;
+  CHECK(!scanner.poll((uint32_t)now, true) && scanner.busy() && radio.starts == 1, "no arrancó el escaneo");
+
+  // Un SCAN_DONE con la radio todavía ocupada (p.ej. de otro escaneo) no cierra
+  scanner.notifyDone();
+  CHECK(!scanner.poll((uint32_t)now + 1, true) && scanner.busy(), "cerró con la radio ocupada");
+
+  // Resultado normal: SSID objetivo y las WIFI_SCAN_KEEP más fuertes en orden
+  now = radio.doneAt;
+  radio.step();
+  scanner.notifyDone();
+  CHECK(scanner.poll((uint32_t)now, true), "no recogió el resultado");
+  const WifiScanStatus &st = scanner.status();
+  std::vector<int> rssis;
+  for (const WifiNet &n : radio.nets) rssis.push_back(n.rssi);
+  std::sort(rssis.rbegin(), rssis.rend());
+  CHECK(st.result == WIFI_SCAN_OK && st.scans == 1 && st.failures == 0, "estado %s scans=%u", wifiScanResultName(st.result),
+        st.scans);
+  CHECK(st.networks == SIM_NETWORKS + 1, "redes %u", st.networks);
+  CHECK(st.targetSeen && st.targetRssi == -61 && st.targetChannel == 6, "no vio el SSID objetivo");
+  CHECK(st.count == WIFI_SCAN_KEEP, "guardó %u redes", st.count);
+  for (int i = 0; i < st.count; i++) {
+    CHECK(st.strongest[i].rssi == rssis[i], "fuerte[%d] %d != %d", i, st.strongest[i].rssi, rssis[i]);
+  }
+  CHECK(st.completedMs == (uint32_t)now && st.durationMs == (uint32_t)(now - WIFI_SCAN_PERIOD_MS), "sello de tiempo");
+  CHECK(radio.releases == 1, "no liberó la lista");
+
+  // Sin want no arranca otro; sin el SSID en el aire lo reporta
+  now += WIFI_SCAN_PERIOD_MS;
+  CHECK(!scanner.poll((uint32_t)now, false) && !scanner.busy(), "escaneó con IP");
+  radio.targetOnAir = false;
+  scanner.poll((uint32_t)now, true);
+  now = radio.doneAt;
+  radio.step();
+  scanner.notifyDone();
+  // Recoge el que estaba en curso aunque ya haya IP
+  CHECK(scanner.poll((uint32_t)now, false) && !scanner.status().targetSeen, "SSID ausente no detectado");
+  radio.targetOnAir = true;
+
+  // Evento perdido: al vencer WIFI_SCAN_TIMEOUT_MS se consulta la radio
+  now += WIFI_SCAN_PERIOD_MS;
+  radio.dropEvent = true;
+  double started = now;
+  scanner.poll((uint32_t)now, true);
+  now = radio.doneAt;
+  CHECK(!radio.step(), "evento no perdido");
+  CHECK(!scanner.poll((uint32_t)now, true), "recogió sin evento ni timeout");
+  now = started + WIFI_SCAN_TIMEOUT_MS;
+  CHECK(scanner.poll((uint32_t)now, true) && scanner.status().result == WIFI_SCAN_OK, "no se recuperó del evento perdido");
+  radio.dropEvent = false;
+
+  // Radio colgada: timeout, se libera y cuenta como fallo
+  now += WIFI_SCAN_PERIOD_MS;
+  radio.hang = true;
+  started = now;
+  scanner.poll((uint32_t)now, true);
+  now = started + WIFI_SCAN_TIMEOUT_MS - 1;
+  CHECK(!scanner.poll((uint32_t)now, true), "timeout adelantado");
+  now += 1;
+  CHECK(scanner.poll((uint32_t)now, true), "no venció");
+  CHECK(scanner.status().result == WIFI_SCAN_TIMEOUT && scanner.status().failures == 1 &&
+            scanner.status().networks == 0 && !scanner.busy() && !radio.running,
+        "radio colgada: %s", wifiScanResultName(scanner.status().result));
+  radio.hang = false;
+
+  // Arranque rechazado: se reporta enseguida y se reintenta al periodo siguiente
+  now += WIFI_SCAN_PERIOD_MS;
+  radio.refuseStart = true;
+  CHECK(scanner.poll((uint32_t)now, true) && scanner.status().result == WIFI_SCAN_START_FAILED &&
+            scanner.status().failures == 2,
+        "arranque rechazado");
+  radio.refuseStart = false;
+  CHECK(!scanner.poll((uint32_t)now + 1, true) && !scanner.busy(), "reintentó antes del periodo");
+  CHECK(scanner.status().scans == 5, "scans=%u", scanner.status().scans);
+}
+
+int main(int argc, char **argv) {
+  const double seconds = argc > 1 ? atof(argv[1]) : 600;
+  const uint32_t seed = argc > 2 ? (uint32_t)atoi(argv[2]) : 1;
+  checkCases(seed);
+
+  bool targetSeen = false;
+  LoopRun async = runAsync(seconds, seed, targetSeen);
+  LoopRun sync = runSync(seconds, seed);
+
+  printf("\n%.0f s sin IP, escaneo cada %u ms, radio de %u-%u ms, vuelta de loop() de %.1f ms\n", seconds,
+         WIFI_SCAN_PERIOD_MS, SCAN_MIN_MS, SCAN_MAX_MS, LOOP_COST_MS);
+  printf("%-10s %10s %10s %16s %12s %12s\n", "modo", "vueltas", "escaneos", "hueco max ms", "poll max us", "allocs");
+  printf("%-10s %10u %10u %16.1f %12s %12s\n", "síncrono", sync.loops, sync.scans, sync.maxGapMs, "-", "-");
+  printf("%-10s %10u %10u %16.1f %12.1f %12zu\n", "asíncrono", async.loops, async.scans, async.maxGapMs, async.maxPollUs,
+         async.allocs);
+
+  const uint32_t expected = (uint32_t)(seconds * 1000 / WIFI_SCAN_PERIOD_MS);
+  CHECK(async.maxGapMs <= LOOP_GAP_LIMIT_MS, "hueco máximo de loop() %.1f ms > %d ms", async.maxGapMs, LOOP_GAP_LIMIT_MS);
+  CHECK(sync.maxGapMs >= SCAN_MIN_MS, "el síncrono no bloqueó (%.1f ms): la simulación no sirve", sync.maxGapMs);
+  CHECK(async.scans + 1 >= expected && async.scans <= expected, "escaneos %u, esperados ~%u", async.scans, expected);
+  CHECK(targetSeen, "algún escaneo no vio el SSID objetivo");
+  CHECK(async.allocs == 0, "poll() reservó heap %zu veces", async.allocs);
+
+  printf(failed ? "FALLO: %d comprobaciones\n"
+                : "OK: loop() nunca espera a la radio, SSID y redes fuertes correctos, timeouts y 0 reservas de heap\n",
+         failed);
+  return failed ? 1 : 0;
+}
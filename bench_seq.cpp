@@ -0,0 +1,286 @@
+// Pruebas y benchmark en el host de la ventana de secuencia (SeqWindow.h).
+//
+//   g++ -O2 -std=c++11 bench_seq.cpp -o bench_seq && ./bench_seq [nodos] [tramas] [semilla]
+//
+// Primero casos puntuales: repetidas, desorden, pérdidas, reinicio del nodo,
+// back-fill (tardío, en la ventana y de un arranque anterior) y vuelta de seq en 65535. Después un tráfico al azar
+// (repetidas, pérdidas y desorden de hasta 16 posiciones) contra un modelo de
+// referencia que recuerda todas las seq: no debe entregarse ninguna repetida,
+// no debe descartarse ninguna nueva y las pérdidas deben coincidir.
+// Por último mide ns por trama con 1000 nodos en una tabla de 2048 entradas,
+// frente a un std::unordered_map de std::set, y cuenta reservas de heap.
+// Sale con 1 si algo falla.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "SeqWindow.h"
+
+static size_t allocations = 0;
+
+void *operator new(size_t n) {
+  allocations++;
+  if (void *p = malloc(n)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static int failed = 0;
+
+#define CHECK(cond, ...)         \
+  do {                           \
+    if (!(cond)) {               \
+      printf("FALLO: " __VA_ARGS__); \
+      printf("\n");              \
+      failed++;                  \
+    }                            \
+  } while (0)
+
+template <size_t N>
+static const SeqEntry *entryOf(const SeqTable<N> &t, uint32_t node) {
+  const SeqEntry *found = nullptr;
+  t.forEach([&](const SeqEntry &e) {
+    if (e.node == node) found = &e;
+  });
+  return found;
+}
+
+// ---------- Casos puntuales ----------
+
+static void checkCases() {
+  static SeqTable<16> t;
+  SeqVerdict v;
+
+  // En orden y repetidas
+  for (uint16_t s = 1; s <= 100; s++) CHECK(t.accept(1, s, s == 1, false) == SEQ_NEW, "nodo 1 seq %u", s);
+  for (uint16_t s = 40; s <= 100; s++) CHECK(t.accept(1, s, false, false) == SEQ_DUPLICATE, "repetida %u", s);
+  const SeqEntry *e = entryOf(t, 1);
+  CHECK(e && e->received == 100 && e->duplicates == 61 && e->lost == 0, "cuentas en orden");
+
+  // Desorden dentro de la ventana: 1 2 4 3
+  uint16_t order[] = {1, 2, 4, 3};
+  for (uint16_t s : order) CHECK(t.accept(2, s, s == 1, false) == SEQ_NEW, "nodo 2 seq %u", s);
+  CHECK(t.accept(2, 3, false, false) == SEQ_DUPLICATE, "3 repetida tras el desorden");
+  e = entryOf(t, 2);
+  CHECK(e && e->reordered == 1 && e->lost == 0, "desorden contado");
+
+  // Pérdida: falta la 11, se cuenta al salir de la ventana
+  for (uint16_t s = 1; s <= 74; s++) {
+    if (s != 11) t.accept(3, s, s == 1, false);
+  }
+  e = entryOf(t, 3);
+  CHECK(e && e->lost == 0, "la 11 aún puede llegar");
+  t.accept(3, 75, false, false);
+  CHECK(e->lost == 1, "la 11 perdida al salir de la ventana (perdidas=%u)", e->lost);
+
+  // Salto grande: las salteadas fuera de la ventana se cuentan enseguida
+  t.accept(4, 1, true, false);
+  t.accept(4, 1000, false, false);
+  e = entryOf(t, 4);
+  CHECK(e && e->lost == 998 - (SEQ_WINDOW_BITS - 1), "salto de 999 (perdidas=%u)", e ? e->lost : 0);
+
+  // Reinicio: "first" con otra seq, fuera o dentro de la ventana
+  v = t.accept(1, 1, true, false);
+  CHECK(v == SEQ_RESTART, "first tras seq 100 -> reinicio (%u)", v);
+  CHECK(t.accept(1, 1, true, false) == SEQ_DUPLICATE, "first repetido");
+  CHECK(t.accept(1, 2, false, false) == SEQ_NEW, "seq 2 tras el reinicio");
+  for (uint16_t s = 3; s <= 5; s++) t.accept(1, s, false, false);
+  CHECK(t.accept(1, 1, true, false) == SEQ_RESTART, "first dentro de la ventana -> reinicio");
+  e = entryOf(t, 1);
+  CHECK(e && e->restarts == 2 && e->lost == 0, "reinicios=%u perdidas=%u", e ? e->restarts : 0, e ? e->lost : 0);
+  // Reinicio sin ver la "first": una en vivo muy vieja
+  for (uint16_t s = 2; s <= 200; s++) t.accept(1, s, false, false);
+  CHECK(t.accept(1, 3, false, false) == SEQ_RESTART, "vieja en vivo -> reinicio");
+
+  // Back-fill: 11..200 guardadas en el nodo llegan después de 201..400. Ya
+  // salieron de la ventana: tardías, sin descontar pérdidas
+  for (uint16_t s = 1; s <= 10; s++) t.accept(5, s, s == 1, false);
+  for (uint16_t s = 201; s <= 400; s++) t.accept(5, s, false, false);
+  e = entryOf(t, 5);
+  CHECK(e && e->lost == 190, "hueco de back-fill (perdidas=%u)", e ? e->lost : 0);
+  for (uint16_t s = 11; s <= 200; s++) {
+    v = t.accept(5, s, s == 11, true);
+    CHECK(v == SEQ_LATE, "back-fill %u (%u)", s, v);
+  }
+  CHECK(e->lost == 190 && e->reordered == 190 && e->restarts == 0, "back-fill tardío (perdidas=%u)", e->lost);
+  // Repetida dentro de la ventana aunque venga como back-fill
+  CHECK(t.accept(5, 390, false, true) == SEQ_DUPLICATE, "back-fill repetido");
+  // Back-fill dentro de la ventana: llena su hueco antes de que se cuente
+  t.accept(5, 402, false, false);
+  CHECK(t.accept(5, 401, false, true) == SEQ_NEW, "back-fill en el hueco");
+  t.accept(5, 466, false, false);
+  CHECK(e->lost == 190 && e->reordered == 191, "hueco llenado por back-fill (perdidas=%u)", e->lost);
+
+  // Reinicio y después back-fill del arranque anterior (seq 31..60, por
+  // encima de la ventana nueva) mezclado con las en vivo: no mueve la ventana
+  for (uint16_t s = 1; s <= 30; s++) t.accept(7, s, s == 1, false);
+  CHECK(t.accept(7, 1, true, false) == SEQ_RESTART, "reinicio del nodo 7");
+  for (uint16_t s = 31; s <= 60; s++) {
+    CHECK(t.accept(7, s, false, true) == SEQ_LATE, "back-fill anterior %u", s);
+    t.accept(7, s - 29, false, false);
+  }
+  for (uint16_t s = 32; s <= 200; s++) CHECK(t.accept(7, s, false, false) == SEQ_NEW, "en vivo %u", s);
+  e = entryOf(t, 7);
+  CHECK(e && e->lost == 0 && e->restarts == 1 && e->reordered == 30, "back-fill tras reinicio (perdidas=%u, "
+        "reinicios=%u)", e ? e->lost : 0, e ? e->restarts : 0);
+
+  // Vuelta de seq
+  for (uint32_t s = 65530; s <= 65545; s++) {
+    CHECK(t.accept(6, (uint16_t)s, s == 65530, false) == SEQ_NEW, "vuelta %u", (unsigned)(uint16_t)s);
+  }
+  CHECK(t.accept(6, 65535, false, false) == SEQ_DUPLICATE, "65535 repetida tras la vuelta");
+  e = entryOf(t, 6);
+  CHECK(e && e->lost == 0 && e->restarts == 0, "vuelta sin pérdidas ni reinicios");
+
+  // Tabla llena
+  static SeqTable<4> small;
+  for (uint32_t n = 1; n <= 4; n++) small.accept(n, 1, true, false);
+  CHECK(small.accept(99, 1, true, false) == SEQ_UNTRACKED && small.untracked() == 1, "tabla llena");
+  CHECK(small.accept(3, 2, false, false) == SEQ_NEW, "nodo existente con la tabla llena");
+}
+
+// ---------- Tráfico al azar contra un modelo de referencia ----------
+
+struct Traffic {
+  uint32_t node;
+  uint16_t seq;
+  bool first;
+};
+
+// Cada nodo genera seq 1..perNode; se pierde un 2 %, se repite un 3 % y las
+// tramas se desordenan hasta 16 posiciones entre las del mismo nodo
+static std::vector<Traffic> makeTraffic(const std::vector<uint32_t> &ids, int perNode, std::mt19937 &rng,
+                                        std::unordered_map<uint32_t, uint32_t> &lostByNode) {
+  std::vector<Traffic> out;
+  std::vector<std::vector<Traffic>> streams(ids.size());
+  for (size_t i = 0; i < ids.size(); i++) {
+    std::vector<Traffic> &s = streams[i];
+    for (int q = 1; q <= perNode; q++) {
+      Traffic t{ids[i], (uint16_t)q, q == 1};
+      if (q > 1 && q < perNode - SEQ_WINDOW_BITS && rng() % 50 == 0) {
+        lostByNode[ids[i]]++;
+        continue;
+      }
+      s.push_back(t);
+      if (rng() % 33 == 0) s.push_back(t);
+    }
+    // Desorden acotado: se ordena por posición + [0, 16]. La primera (y su
+    // repetida) quedan al frente: una "first" que llega después de otra seq
+    // es un reinicio del nodo
+    std::vector<std::pair<size_t, Traffic>> keyed;
+    for (size_t k = 0; k < s.size(); k++) keyed.push_back({s[k].first ? 0 : k + rng() % 17, s[k]});
+    std::stable_sort(keyed.begin(), keyed.end(),
+                     [](const std::pair<size_t, Traffic> &a, const std::pair<size_t, Traffic> &b) {
+                       return a.first < b.first;
+                     });
+    for (size_t k = 0; k < s.size(); k++) s[k] = keyed[k].second;
+  }
+  // Intercala los nodos al azar respetando el orden de cada uno
+  std::vector<size_t> pos(ids.size(), 0);
+  size_t left = 0;
+  for (auto &s : streams) left += s.size();
+  while (left) {
+    size_t i = rng() % ids.size();
+    if (pos[i] == streams[i].size()) continue;
+    out.push_back(streams[i][pos[i]++]);
+    left--;
+  }
+  return out;
+}
+
+template <size_t N>
+static void checkRandom(SeqTable<N> &t, const std::vector<uint32_t> &ids, const std::vector<Traffic> &traffic,
+                        std::unordered_map<uint32_t, uint32_t> &lostByNode) {
+  std::unordered_map<uint32_t, std::set<uint16_t>> seen;
+  size_t wrongDrops = 0, wrongPass = 0;
+  for (const Traffic &f : traffic) {
+    bool fresh = seen[f.node].insert(f.seq).second;
+    SeqVerdict v = t.accept(f.node, f.seq, f.first, false);
+    if (fresh && v == SEQ_DUPLICATE) wrongDrops++;
+    if (!fresh && v != SEQ_DUPLICATE) wrongPass++;
+  }
+  CHECK(!wrongDrops && !wrongPass, "al azar: %zu nuevas descartadas, %zu repetidas entregadas", wrongDrops,
+        wrongPass);
+  size_t wrongLoss = 0, restarts = 0;
+  for (uint32_t id : ids) {
+    const SeqEntry *e = entryOf(t, id);
+    if (!e || e->lost != lostByNode[id]) wrongLoss++;
+    if (e) restarts += e->restarts;
+  }
+  CHECK(!wrongLoss && !restarts, "al azar: %zu nodos con pérdidas mal contadas, %zu reinicios falsos", wrongLoss,
+        restarts);
+}
+
+// ---------- Referencia para el benchmark ----------
+
+struct NaiveWindow {
+  std::unordered_map<uint32_t, std::set<uint16_t>> recent;
+  bool accept(uint32_t node, uint16_t seq) {
+    std::set<uint16_t> &s = recent[node];
+    if (!s.insert(seq).second) return false;
+    if (s.size() > SEQ_WINDOW_BITS) s.erase(s.begin());
+    return true;
+  }
+};
+
+int main(int argc, char **argv) {
+  const int nodes = argc > 1 ? atoi(argv[1]) : 1000;
+  const int perNode = argc > 2 ? atoi(argv[2]) : 2000;
+  const unsigned seed = argc > 3 ? atoi(argv[3]) : 1;
+  std::mt19937 rng(seed);
+
+  checkCases();
+
+  std::vector<uint32_t> ids;
+  while ((int)ids.size() < nodes) {
+    uint32_t id = rng() | 1;
+    if (std::find(ids.begin(), ids.end(), id) == ids.end()) ids.push_back(id);
+  }
+  std::unordered_map<uint32_t, uint32_t> lostByNode;
+  std::vector<Traffic> traffic = makeTraffic(ids, perNode, rng, lostByNode);
+
+  static SeqTable<2048> table;
+  checkRandom(table, ids, traffic, lostByNode);
+
+  // Medición: mismo tráfico sobre tablas nuevas
+  static SeqTable<2048> timed;
+  size_t before = allocations;
+  size_t dropped = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (const Traffic &f : traffic) dropped += timed.accept(f.node, f.seq, f.first, false) == SEQ_DUPLICATE;
+  auto t1 = std::chrono::steady_clock::now();
+  size_t tableAllocs = allocations - before;
+  double tableNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / traffic.size();
+
+  NaiveWindow naive;
+  before = allocations;
+  size_t naiveDropped = 0;
+  t0 = std::chrono::steady_clock::now();
+  for (const Traffic &f : traffic) naiveDropped += !naive.accept(f.node, f.seq);
+  t1 = std::chrono::steady_clock::now();
+  size_t naiveAllocs = allocations - before;
+  double naiveNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / traffic.size();
+
+  printf("%d nodos, %zu tramas (%zu repetidas descartadas), tabla de %zu entradas\n", nodes, traffic.size(),
+         dropped, timed.capacity());
+  printf("%-28s %10s %14s %12s\n", "", "ns/trama", "allocs/trama", "memoria");
+  printf("%-28s %10.1f %14.3f %9zu KB\n", "SeqTable (ventana de bits)", tableNs, (double)tableAllocs / traffic.size(),
+         sizeof(timed) / 1024);
+  printf("%-28s %10.1f %14.3f %12s\n", "unordered_map + std::set", naiveNs, (double)naiveAllocs / traffic.size(),
+         "heap");
+  CHECK(tableAllocs == 0, "SeqTable reservó heap (%zu)", tableAllocs);
+  CHECK(dropped == naiveDropped, "descartes distintos a la referencia (%zu vs %zu)", dropped, naiveDropped);
+
+  printf(failed ? "FALLO: %d comprobaciones\n"
+                : "OK: repetidas, desorden, pérdidas, reinicios, back-fill y vuelta de seq; 0 reservas de heap\n",
+         failed);
+  return failed ? 1 : 0;
+}
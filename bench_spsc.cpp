@@ -0,0 +1,323 @@
+// Prueba en el host, con dos hilos reales, de las colas entre los núcleos de
+// la gateway (SpscQueue.h, MeshLanes y los ControlFrame de GatewayCore.h).
+//
+//   g++ -O2 -std=c++11 -pthread bench_spsc.cpp -o bench_spsc && ./bench_spsc [mensajes] [semilla]
+//   g++ -O1 -g -std=c++11 -pthread -fsanitize=thread bench_spsc.cpp -o bench_spsc && ./bench_spsc 200000
+//
+// - MQTT -> mesh: el hilo "MQTT" arma comandos como los que entrega
+//   PubSubClient (byte* no const, con escapes y UTF-8 que un parser en sitio
+//   reescribiría), los pasa por gatewayControlFrame() a una
+//   SpscQueue<ControlFrame, 8> y comprueba que su buffer no cambió. El hilo
+//   "mesh" los sella con gatewayStampControl() como forwardControl(): lo que
+//   sale al mesh debe ser el comando publicado, byte a byte, más gw_in/gw_tx.
+// - Mesh -> MQTT: el hilo "mesh" llena los dos carriles de MeshLanes con
+//   push() y descarta si no hay slot, como receivedCallback(); las de control
+//   llegan hasta CONTROL_REPLY_MAX. El hilo "MQTT" vacía con frontReply()
+//   antes de cada frontData(), como forwardMeshFrames(). Cada carril debe
+//   salir en orden, sin tramas mezcladas, y recibidas + descartadas = enviadas.
+// - SpscQueue<uint64_t, 2>: la capacidad mínima, con push()/pop(), donde
+//   productor y consumidor chocan en cada operación.
+// - Respuestas largas: un TRACE_REPLY de 3 saltos y un TOPO con 20 vecinos,
+//   armados como en MeshNodeRuntime.h, pasan más de STORE_PAYLOAD_MAX y deben
+//   entrar en el carril de control y publicarse con sus sellos dentro de
+//   GATEWAY_PUBLISH_MAX (el buffer de PubSubClient).
+// Sale con 1 si algo falla.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+
+#include "GatewayCore.h"
+
+static int failed = 0;
+
+#define CHECK(cond, ...)         \
+  do {                           \
+    if (!(cond)) {               \
+      printf("FALLO: " __VA_ARGS__); \
+      printf("\n");              \
+      failed++;                  \
+    }                            \
+  } while (0)
+
+#define CONTROL_QUEUE_SLOTS 8  // los de GATEWAY.cpp
+#define MESH_QUEUE_SLOTS 32
+#define REPLY_QUEUE_SLOTS 8
+
+// xorshift32: barato de sembrar en cada comando, así los dos hilos lo rearman
+struct Rng {
+  uint32_t s;
+  uint32_t operator()() {
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+  }
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Comando i, reproducible desde los dos hilos. El relleno lleva lo que un
+// parser zero-copy reescribe en sitio: \" \\ \n é y UTF-8 crudo
+static size_t makeCommand(uint32_t i, char *out) {
+  static const char *const kTypes[] = {"PING", "TRACE", "REPORT_CFG", "TOPO_REQ"};
+  static const char *const kPieces[] = {"\\\"", "\\\\", "\\n", "\\u00e9", "\xc3\xb1", "a", " ", "{}", ":,"};
+  Rng rng{(i * 2654435761u) | 1u};
+  int n = snprintf(out, CONTROL_PAYLOAD_MAX + 1, "{\"type\":\"%s\",\"to\":%u,\"from\":0,\"seq\":%u,\"note\":\"",
+                   kTypes[rng() % 4], (uint32_t)rng(), i);
+  size_t len = (size_t)n;
+  size_t target = len + 2 + rng() % (CONTROL_PAYLOAD_MAX - len - 1);
+  for (;;) {
+    const char *p = kPieces[rng() % (sizeof(kPieces) / sizeof(kPieces[0]))];
+    size_t k = strlen(p);
+    if (len + k + 2 > target) break;
+    memcpy(out + len, p, k);
+    len += k;
+  }
+  memcpy(out + len, "\"}", 3);
+  return len + 2;
+}
+
+static void controlPath(uint32_t count) {
+  SpscQueue<ControlFrame, CONTROL_QUEUE_SLOTS> queue;
+  std::atomic<uint32_t> producerErrors{0};
+  uint32_t consumerErrors = 0;
+  auto t0 = std::chrono::steady_clock::now();
+
+  std::thread mqtt([&] {
+    uint8_t payload[CONTROL_PAYLOAD_MAX + 1];  // el byte* de mqttCallback
+    char copy[CONTROL_PAYLOAD_MAX + 1];
+    for (uint32_t i = 0; i < count; i++) {
+      size_t len = makeCommand(i, (char *)payload);
+      memcpy(copy, payload, len + 1);
+      const char *msg = (const char *)payload;
+      if (!gatewayControlValid(msg, len)) {
+        producerErrors++;
+        continue;
+      }
+      ControlFrame *c;
+      while (!(c = queue.claim())) std::this_thread::yield();
+      gatewayControlFrame(msg, len, i, *c);
+      if (memcmp(copy, payload, len + 1) != 0 || c->to != controlUint(copy, len, "to")) producerErrors++;
+      queue.commit();
+    }
+  });
+
+  char expected[CONTROL_PAYLOAD_MAX + 1];
+  char stamped[CONTROL_PAYLOAD_MAX + 48];
+  char tail[40];
+  for (uint32_t i = 0; i < count;) {
+    ControlFrame *c = queue.front();
+    if (!c) {
+      std::this_thread::yield();
+      continue;
+    }
+    size_t len = makeCommand(i, expected);
+    size_t n = gatewayStampControl(*c, c->rxUs, c->rxUs + 1, stamped, sizeof(stamped));
+    int t = snprintf(tail, sizeof(tail), ",\"gw_in\":%u,\"gw_tx\":%u}", i, i + 1);
+    bool same = c->len == len && memcmp(c->payload, expected, len + 1) == 0;
+    bool sent = n == len - 1 + (size_t)t && memcmp(stamped, expected, len - 1) == 0 &&
+                memcmp(stamped + len - 1, tail, (size_t)t + 1) == 0;
+    if (!same || !sent) {
+      if (consumerErrors++ < 3) printf("  comando %u: %.*s\n  salió:     %s\n", i, (int)len, expected, stamped);
+    }
+    queue.release();
+    i++;
+  }
+  mqtt.join();
+  double s = secondsSince(t0);
+  CHECK(!producerErrors.load(), "MQTT -> mesh: %u comandos inválidos o con el buffer de MQTT modificado",
+        producerErrors.load());
+  CHECK(!consumerErrors, "MQTT -> mesh: %u comandos salieron distintos de lo publicado", consumerErrors);
+  CHECK(queue.empty() && queue.stats().pushed == count, "MQTT -> mesh: encolados %u de %u", queue.stats().pushed,
+        count);
+  printf("%-16s %10u %12.0f %10u %10u\n", "MQTT -> mesh", count, count / s, queue.stats().failures,
+         queue.stats().highWater);
+}
+
+// Trama de datos o de control con seq por carril, hasta el máximo del
+// carril; el contenido depende de (carril, seq) para detectar slots leídos a
+// medio escribir
+static size_t makeFrame(GatewayLane lane, uint32_t seq, char *out) {
+  size_t len = 32 + (seq * 7 + lane) % (gatewayLaneMax(lane) - 31);
+  int n = snprintf(out, 32, "{\"l\":%u,\"seq\":%u,\"p\":\"", (unsigned)lane, seq);
+  for (size_t k = (size_t)n; k + 2 < len; k++) out[k] = (char)('a' + (seq + k) % 26);
+  memcpy(out + len - 2, "\"}", 3);
+  return len;
+}
+
+static void meshPath(uint32_t count, uint32_t seed) {
+  MeshLanes<REPLY_QUEUE_SLOTS, MESH_QUEUE_SLOTS> lanes;
+  uint32_t sent[2] = {0, 0}, dropped[2] = {0, 0};
+  std::atomic<bool> done{false};
+  auto t0 = std::chrono::steady_clock::now();
+
+  std::thread mesh([&] {
+    std::mt19937 rng(seed);
+    char frame[CONTROL_REPLY_MAX + 1];
+    for (uint32_t i = 0; i < count; i++) {
+      GatewayLane lane = rng() % 10 ? LANE_DATA : LANE_CONTROL;
+      uint32_t seq = sent[lane] + dropped[lane];
+      size_t len = makeFrame(lane, seq, frame);
+      if (!lanes.push(lane, seq, 0, 0, seq, frame, len)) {
+        dropped[lane]++;  // receivedCallback() descarta y sigue
+        if (i % 64 == 0) std::this_thread::yield();
+        continue;
+      }
+      sent[lane]++;
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  uint32_t received[2] = {0, 0}, disorder = 0, torn = 0;
+  int64_t last[2] = {-1, -1};
+  char expected[CONTROL_REPLY_MAX + 1];
+  // Mismos campos en los dos tipos de trama
+  auto check = [&](GatewayLane lane, uint32_t seq, bool timed, uint32_t rxNodeUs, const char *payload, size_t len) {
+    if ((int64_t)seq <= last[lane] || timed != (lane == LANE_CONTROL) || rxNodeUs != (timed ? seq : 0)) disorder++;
+    last[lane] = seq;
+    size_t want = makeFrame(lane, seq, expected);
+    if (len != want || memcmp(payload, expected, want + 1) != 0) torn++;
+    received[lane]++;
+    lanes.release(lane);
+  };
+  for (;;) {
+    bool finished = done.load(std::memory_order_acquire);
+    if (MeshReplyFrame *r = lanes.frontReply()) {
+      check(LANE_CONTROL, r->nodeId, r->timed, r->rxNodeUs, r->payload, r->len);
+    } else if (MeshFrame *f = lanes.frontData()) {
+      check(LANE_DATA, f->nodeId, f->timed, f->rxNodeUs, f->payload, f->len);
+    } else if (finished) {
+      break;  // done se leyó antes de mirar los carriles: no queda nada
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  mesh.join();
+  double s = secondsSince(t0);
+  CHECK(!disorder && !torn, "mesh -> MQTT: %u fuera de orden, %u tramas mezcladas", disorder, torn);
+  for (int l = 0; l < 2; l++) {
+    SpscStats st = lanes.stats((GatewayLane)l);
+    CHECK(received[l] == sent[l] && st.pushed == sent[l] && st.failures == dropped[l],
+          "carril %d: recibidas %u, enviadas %u, descartadas %u (stats %u/%u)", l, received[l], sent[l], dropped[l],
+          st.pushed, st.failures);
+  }
+  printf("%-16s %10u %12.0f %10u %10u   (control %u, datos %u)\n", "mesh -> MQTT", count, count / s,
+         dropped[0] + dropped[1], lanes.stats(LANE_DATA).highWater, received[LANE_CONTROL], received[LANE_DATA]);
+}
+
+// Peor caso de los nodos: IDs y sellos de 10 dígitos
+static size_t traceReply(size_t hops, char *buf, size_t cap) {
+  uint32_t ids[8], ts[8];
+  for (size_t i = 0; i < hops; i++) {
+    ids[i] = 4000000000u + (uint32_t)i;
+    ts[i] = 4100000000u + (uint32_t)i;
+  }
+  ControlWriter w(buf, cap);
+  w.printf("{\"type\":\"TRACE_REPLY\",\"seq\":%u,\"from\":%u,", 4294967295u, ids[hops - 1]);
+  w.printf("\"srv_ms\":%u,\"gw_in\":%u,\"gw_tx\":%u,", 4294967295u, 4294967295u, 4294967295u);
+  w.uintArray("hops", UintSpan{ids, hops}).raw(",").uintArray("ts", UintSpan{ts, hops});
+  w.printf(",\"t_tx\":%u}", 4294967295u);
+  return w.ok() ? w.length() : 0;
+}
+
+static size_t topoReply(size_t neighbors, char *buf, size_t cap) {
+  uint32_t ids[32];
+  for (size_t i = 0; i < neighbors; i++) ids[i] = 4000000000u + (uint32_t)i;
+  ControlWriter w(buf, cap);
+  w.printf("{\"type\":\"TOPO\",\"seq\":%u,\"from\":%u,", 4294967295u, 4294967295u)
+      .uintArray("neighbors", UintSpan{ids, neighbors})
+      .raw("}");
+  return w.ok() ? w.length() : 0;
+}
+
+static void longReplies() {
+  struct Reply {
+    const char *name;
+    size_t len;
+    char buf[CONTROL_REPLY_MAX];
+  };
+  static Reply replies[2] = {{"TRACE_REPLY 3 saltos", 0, {}}, {"TOPO 20 vecinos", 0, {}}};
+  replies[0].len = traceReply(3, replies[0].buf, sizeof(replies[0].buf));
+  replies[1].len = topoReply(20, replies[1].buf, sizeof(replies[1].buf));
+  MeshLanes<REPLY_QUEUE_SLOTS, MESH_QUEUE_SLOTS> lanes;
+  for (Reply &r : replies) {
+    ControlType type = controlClassify(r.buf, r.len);
+    GatewayLane lane = gatewayLane(type);
+    CHECK(r.len > STORE_PAYLOAD_MAX, "%s: %u bytes, ya entraba en una trama de datos", r.name, (unsigned)r.len);
+    CHECK(lane == LANE_CONTROL && r.len <= gatewayLaneMax(lane), "%s: %u bytes no entran en el carril de control",
+          r.name, (unsigned)r.len);
+    if (lane != LANE_CONTROL || r.len > gatewayLaneMax(lane)) continue;
+    CHECK(lanes.push(lane, 4000000002u, 1, 2, 3, r.buf, r.len), "%s: carril de control lleno", r.name);
+    MeshReplyFrame *f = lanes.frontReply();
+    CHECK(f && f->len == r.len && memcmp(f->payload, r.buf, r.len + 1) == 0 && f->rxNodeUs == 3,
+          "%s: la trama del carril no es la recibida", r.name);
+    if (!f) continue;
+
+    // forwardMeshFrames(): sellos al final y publish() en Nodos/datos/<from>
+    char extra[GATEWAY_STAMP_MAX];
+    snprintf(extra, sizeof(extra), "\"gw_rx\":%u,\"gw_out\":%u", 4294967295u, 4294967295u);
+    char topic[GATEWAY_TOPIC_MAX];
+    gatewayFrameTopic(4294967295u, topic, sizeof(topic));
+    char text[GATEWAY_FRAME_TEXT_MAX];
+    size_t len = f->len;
+    const char *out = gatewayFramePayload(f->payload, len, extra, text, sizeof(text));
+    size_t packet = 5 + 2 + strlen(topic) + len;  // la cuenta de PubSubClient::publish()
+    CHECK(out && packet <= GATEWAY_PUBLISH_MAX, "%s: publish de %u bytes con buffer de %u", r.name,
+          (unsigned)packet, (unsigned)GATEWAY_PUBLISH_MAX);
+    lanes.release(LANE_CONTROL);
+    printf("%-22s %4u bytes en el mesh, %4u publicados (máx. datos %u, control %u, publish %u)\n", r.name,
+           (unsigned)r.len, (unsigned)packet, STORE_PAYLOAD_MAX, CONTROL_REPLY_MAX, (unsigned)GATEWAY_PUBLISH_MAX);
+  }
+}
+
+static void minimalQueue(uint32_t count) {
+  SpscQueue<uint64_t, 2> queue;
+  auto t0 = std::chrono::steady_clock::now();
+  std::thread producer([&] {
+    for (uint64_t i = 1; i <= count; i++) {
+      uint64_t v = i * 0x9E3779B97F4A7C15ull;
+      while (!queue.push(v)) std::this_thread::yield();
+    }
+  });
+  uint32_t wrong = 0;
+  for (uint64_t i = 1; i <= count;) {
+    uint64_t v;
+    if (!queue.pop(v)) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (v != i * 0x9E3779B97F4A7C15ull) wrong++;
+    i++;
+  }
+  producer.join();
+  double s = secondsSince(t0);
+  CHECK(!wrong && queue.empty(), "SpscQueue<2>: %u valores distintos de los encolados", wrong);
+  CHECK(queue.stats().highWater <= 2, "SpscQueue<2>: profundidad %u", queue.stats().highWater);
+  printf("%-16s %10u %12.0f %10u %10u\n", "SpscQueue<2>", count, count / s, queue.stats().failures,
+         queue.stats().highWater);
+}
+
+int main(int argc, char **argv) {
+  const uint32_t count = argc > 1 ? (uint32_t)atoi(argv[1]) : 2000000;
+  const uint32_t seed = argc > 2 ? (uint32_t)atoi(argv[2]) : 1;
+
+  longReplies();
+  printf("%u mensajes por prueba, productor y consumidor en hilos distintos\n", count);
+  printf("%-16s %10s %12s %10s %10s\n", "cola", "mensajes", "mensajes/s", "llenas", "max prof");
+  controlPath(count);
+  meshPath(count, seed);
+  minimalQueue(count);
+
+  printf(failed ? "FALLO: %d comprobaciones\n"
+                : "OK: los comandos salen al mesh byte a byte como llegaron por MQTT; cada carril en orden, sin "
+                  "tramas mezcladas ni pérdidas sin contar\n",
+         failed);
+  return failed ? 1 : 0;
+}
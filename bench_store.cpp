@@ -0,0 +1,183 @@
+// Prueba en el host del store-and-forward de la gateway (FrameStore.h).
+//
+//   g++ -O2 -std=c++11 bench_store.cpp -o bench_store && ./bench_store [nodos] [minutos] [semilla]
+//
+// Simula con reloj virtual NODES nodos que envían una lectura cada
+// NODE_PERIOD_MS (con fase al azar) y un corte de MQTT de OUTAGE_MIN minutos.
+// La gateway sigue la regla de forwardMeshFrames(): con MQTT caído, o con
+// tramas retenidas, la trama nueva va al final del buffer; al volver MQTT se
+// vacía a STORE_DRAIN_BURST tramas cada STORE_DRAIN_INTERVAL_MS, como
+// drainFrameStore().
+//
+// - Con capacidad para todo el corte no se pierde ninguna trama, cada nodo
+//   conserva su orden y "age_ms" (rxMs) es el instante real de recepción.
+// - Con la capacidad del ESP32 (STORE_CAPACITY) se conservan exactamente las
+//   últimas y el resto se cuenta como overflow, sin huecos en medio.
+// Sale con 1 si algo falla.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "FrameStore.h"
+
+static int failed = 0;
+
+#define CHECK(cond, ...)         \
+  do {                           \
+    if (!(cond)) {               \
+      printf("FALLO: " __VA_ARGS__); \
+      printf("\n");              \
+      failed++;                  \
+    }                            \
+  } while (0)
+
+#define STORE_CAPACITY 128  // los de GATEWAY.cpp
+#define STORE_PAYLOAD_MAX 192
+#define STORE_DRAIN_INTERVAL_MS 100
+#define STORE_DRAIN_BURST 5
+#define NODE_PERIOD_MS 10000
+#define TICK_MS 10
+
+struct Delivered {
+  uint32_t node;
+  uint32_t seq;
+  uint32_t sentMs;  // cuando la leyó el nodo (la gateway la recibe en el mismo tick)
+  uint32_t ageMs;   // "age_ms" al publicar
+  uint32_t publishedMs;
+};
+
+struct Run {
+  uint32_t generated = 0;
+  uint32_t maxDrainMs = 0;  // desde que vuelve MQTT hasta vaciar el buffer
+  std::vector<Delivered> out;
+};
+
+template <size_t CAP>
+static void simulate(size_t nodes, uint32_t outageMin, uint32_t seed, FrameStore<CAP, STORE_PAYLOAD_MAX> &store,
+                     Run &run) {
+  std::mt19937 rng(seed);
+  std::vector<uint32_t> phase(nodes), seq(nodes, 0);
+  for (size_t n = 0; n < nodes; n++) phase[n] = rng() % NODE_PERIOD_MS;
+  const uint32_t outageStart = 60000;
+  const uint32_t outageEnd = outageStart + outageMin * 60000;
+  const uint32_t end = outageEnd + 30 * 60000;
+  uint32_t lastDrain = 0;
+
+  for (uint32_t now = 0; now < end; now += TICK_MS) {
+    bool up = now < outageStart || now >= outageEnd;
+    // Lecturas de este tick
+    for (size_t n = 0; n < nodes; n++) {
+      if (now % NODE_PERIOD_MS != phase[n] / TICK_MS * TICK_MS) continue;
+      uint32_t node = 1000 + (uint32_t)n;
+      char payload[96];
+      int len = snprintf(payload, sizeof(payload), "{\"temperatura\":%u.%u,\"seq\":%u}", 20 + (seq[n] % 10),
+                         (unsigned)(rng() % 10), seq[n]);
+      run.generated++;
+      if (up && store.empty()) {
+        run.out.push_back({node, seq[n], now, 0, now});
+      } else {
+        store.push(node, now, payload, (size_t)len);
+      }
+      seq[n]++;
+    }
+    // drainFrameStore()
+    if (up && !store.empty() && now - lastDrain >= STORE_DRAIN_INTERVAL_MS) {
+      lastDrain = now;
+      for (int i = 0; i < STORE_DRAIN_BURST && !store.empty(); i++) {
+        auto *f = store.front();
+        uint32_t s = (uint32_t)atoi(strstr(f->payload, "\"seq\":") + 6);
+        run.out.push_back({f->nodeId, s, f->rxMs, now - f->rxMs, now});
+        store.pop();
+      }
+      if (store.empty() && now >= outageEnd && now - outageEnd > run.maxDrainMs) run.maxDrainMs = now - outageEnd;
+    }
+  }
+}
+
+// Por nodo: seq estrictamente creciente; devuelve cuántos huecos hay
+static size_t checkOrder(const Run &run, size_t nodes, const char *name) {
+  std::vector<int64_t> last(nodes, -1);
+  size_t disorder = 0, gaps = 0, wrongAge = 0;
+  for (const Delivered &d : run.out) {
+    size_t n = d.node - 1000;
+    if ((int64_t)d.seq <= last[n]) disorder++;
+    if ((int64_t)d.seq > last[n] + 1) gaps++;
+    last[n] = d.seq;
+    if (d.sentMs + d.ageMs != d.publishedMs) wrongAge++;
+  }
+  CHECK(!disorder && !wrongAge, "%s: %zu fuera de orden, %zu con age_ms mal", name, disorder, wrongAge);
+  return gaps;
+}
+
+int main(int argc, char **argv) {
+  const size_t nodes = argc > 1 ? (size_t)atoi(argv[1]) : 50;
+  const uint32_t outageMin = argc > 2 ? (uint32_t)atoi(argv[2]) : 10;
+  const uint32_t seed = argc > 3 ? (uint32_t)atoi(argv[3]) : 1;
+  const uint32_t perOutage = (uint32_t)(nodes * outageMin * 60000 / NODE_PERIOD_MS);
+
+  // Capacidad de sobra para todo el corte (como gateway_linux.cpp)
+  static FrameStore<8192, STORE_PAYLOAD_MAX> big;
+  Run a;
+  simulate(nodes, outageMin, seed, big, a);
+  size_t gapsA = checkOrder(a, nodes, "capacidad suficiente");
+  CHECK(!gapsA, "capacidad suficiente: %zu huecos", gapsA);
+  const auto &sa = big.stats();
+  CHECK(a.out.size() == a.generated && sa.overflow == 0 && big.empty(), "capacidad suficiente: %zu de %u entregadas",
+        a.out.size(), a.generated);
+  CHECK(sa.stored == sa.drained && sa.highWater >= perOutage, "retenidas %u, entregadas %u, max %u (corte: %u)",
+        sa.stored, sa.drained, sa.highWater, perOutage);
+  std::vector<size_t> perNode(nodes, 0);
+  for (const Delivered &d : a.out) perNode[d.node - 1000]++;
+  size_t short_ = 0;
+  for (size_t n = 0; n < nodes; n++) short_ += perNode[n] == 0;
+  CHECK(!short_, "%zu nodos sin tramas", short_);
+
+  // Capacidad del ESP32: sólo las últimas STORE_CAPACITY del corte sobreviven
+  static FrameStore<STORE_CAPACITY, STORE_PAYLOAD_MAX> small;
+  Run b;
+  simulate(nodes, outageMin, seed, small, b);
+  size_t gapsB = checkOrder(b, nodes, "capacidad del ESP32");
+  CHECK(gapsB <= nodes, "ESP32: %zu huecos (como mucho uno por nodo)", gapsB);
+  const auto &sb = small.stats();
+  uint32_t lost = b.generated - (uint32_t)b.out.size();
+  CHECK(lost == sb.overflow && sb.highWater == STORE_CAPACITY, "ESP32: %u perdidas, overflow %u", lost, sb.overflow);
+  // Las conservadas son exactamente las más recientes del corte: ninguna
+  // retenida es anterior a una descartada. Cada trama es (nodo, seq) y la
+  // corrida con capacidad de sobra tiene todas.
+  size_t olderKept = 0;
+  uint32_t newestLost = 0;
+  {
+    std::vector<std::vector<uint8_t>> kept(nodes);
+    for (const Delivered &d : b.out) {
+      auto &k = kept[d.node - 1000];
+      if (k.size() <= d.seq) k.resize(d.seq + 1, 0);
+      k[d.seq] = 1;
+    }
+    for (const Delivered &d : a.out) {
+      auto &k = kept[d.node - 1000];
+      bool ok = d.seq < k.size() && k[d.seq];
+      if (!ok && d.sentMs > newestLost) newestLost = d.sentMs;
+    }
+    for (const Delivered &d : b.out) {
+      if (d.ageMs && d.sentMs < newestLost) olderKept++;  // ageMs > 0: pasó por el buffer
+    }
+  }
+  CHECK(!olderKept, "ESP32: %zu tramas conservadas son más viejas que una descartada", olderKept);
+
+  printf("%zu nodos, una lectura cada %u s, corte de %u min (%u lecturas durante el corte)\n", nodes,
+         NODE_PERIOD_MS / 1000, outageMin, perOutage);
+  printf("%-24s %9s %10s %10s %10s %14s\n", "", "lecturas", "entregadas", "perdidas", "max buffer", "vaciado en ms");
+  printf("%-24s %9u %10zu %10u %10u %14u\n", "capacidad 8192", a.generated, a.out.size(), sa.overflow, sa.highWater,
+         a.maxDrainMs);
+  printf("%-24s %9u %10zu %10u %10u %14u\n", "STORE_CAPACITY 128", b.generated, b.out.size(), sb.overflow,
+         sb.highWater, b.maxDrainMs);
+
+  printf(failed ? "FALLO: %d comprobaciones\n"
+                : "OK: sin pérdidas hasta la capacidad, orden por nodo y age_ms; al llenarse se conservan las "
+                  "más recientes\n",
+         failed);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,240 @@
+// Benchmark en el host de la caché de topología de la gateway (MeshTopology.h).
+//
+//   g++ -O2 -std=c++11 bench_topo.cpp -o bench_topo && ./bench_topo [nodos] [cambios] [semilla]
+//
+// Arma árboles al azar como los de painlessMesh (hasta 4 hijos por nodo), los
+// serializa como subConnectionJson() y les aplica cambios (nodos que se
+// mueven de padre, se caen o llegan). Por cada cambio mide parse + update + diff, y
+// comprueba que el TOPO_DIFF aplicado sobre la foto anterior dé la nueva.
+//
+// Después compara lo que cuesta refrescar la vista de topología:
+//   - inundando: TOPO_REQ en broadcast (una transmisión por enlace del árbol)
+//     y un TOPO por nodo, ruteado hasta el root (una por salto), cada uno
+//     publicado en MQTT;
+//   - desde la caché: 0 mensajes en el mesh y una publicación, o la respuesta
+//     "unchanged" si el etag del pedido ya es el actual;
+//   - los TOPO_DIFF que la gateway publica por cada cambio.
+// Sale con 1 si algún diff no reconstruye la foto.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "MeshTopology.h"
+
+struct Tree {
+  uint32_t root;
+  std::map<uint32_t, uint32_t> parent;  // hijo -> padre
+
+  std::vector<uint32_t> children(uint32_t id) const {
+    std::vector<uint32_t> out;
+    for (auto &e : parent) {
+      if (e.second == id) out.push_back(e.first);
+    }
+    return out;
+  }
+  int depth(uint32_t id) const {
+    int d = 0;
+    for (; id != root; d++) id = parent.at(id);
+    return d;
+  }
+  bool inSubtree(uint32_t id, uint32_t top) const {
+    for (; id != root; id = parent.at(id)) {
+      if (id == top) return true;
+    }
+    return top == root;
+  }
+  void removeSubtree(uint32_t id) {
+    for (uint32_t c : children(id)) removeSubtree(c);
+    parent.erase(id);
+  }
+
+  // Como mesh.subConnectionJson(): con el root al frente o sólo sus subs
+  void json(uint32_t id, std::string &out) const {
+    out += "{\"nodeId\":" + std::to_string(id);
+    if (id == root) out += ",\"root\":true";
+    out += ",\"subs\":[";
+    bool first = true;
+    for (uint32_t c : children(id)) {
+      if (!first) out += ",";
+      json(c, out);
+      first = false;
+    }
+    out += "]}";
+  }
+  std::string json(bool withRoot) const {
+    std::string out;
+    if (withRoot) {
+      json(root, out);
+      return out;
+    }
+    out = "[";
+    bool first = true;
+    for (uint32_t c : children(root)) {
+      if (!first) out += ",";
+      json(c, out);
+      first = false;
+    }
+    return out + "]";
+  }
+};
+
+static const size_t kMaxChildren = 4;
+
+static uint32_t randomParent(const Tree &t, std::mt19937 &rng, uint32_t avoid) {
+  std::vector<uint32_t> cands{t.root};
+  for (auto &e : t.parent) cands.push_back(e.first);
+  for (int tries = 0; tries < 100; tries++) {
+    uint32_t p = cands[rng() % cands.size()];
+    if (avoid && t.inSubtree(p, avoid)) continue;
+    if (t.children(p).size() < kMaxChildren) return p;
+  }
+  return 0;
+}
+
+// Reconstruye hijo -> padre aplicando "set" y "del" de un TOPO_DIFF
+static bool applyDiff(const char *json, size_t len, std::map<uint32_t, uint32_t> &edges) {
+  const char *set = strstr(json, "\"set\":[");
+  const char *del = strstr(json, "\"del\":[");
+  if (!set || !del) return false;
+  uint32_t pairs[2 * TOPO_MAX_NODES];
+  // Pares anidados [hijo,padre]: controlUintArray sólo lee un nivel
+  size_t n = 0;
+  for (const char *p = set + 7; *p && *p != ']' && n < 2 * TOPO_MAX_NODES;) {
+    if (*p == '[') {
+      char *end;
+      pairs[n++] = (uint32_t)strtoul(p + 1, &end, 10);
+      pairs[n++] = (uint32_t)strtoul(end + 1, &end, 10);
+      p = end + 1;
+      if (*p == ',') p++;
+    } else {
+      p++;
+    }
+  }
+  for (size_t i = 0; i + 1 < n; i += 2) edges[pairs[i]] = pairs[i + 1];
+  uint32_t gone[TOPO_MAX_NODES];
+  size_t g = controlUintArray(del, json + len - del, "del", gone, TOPO_MAX_NODES);
+  for (size_t i = 0; i < g; i++) edges.erase(gone[i]);
+  return true;
+}
+
+struct RefreshCost {
+  double meshTx = 0;
+  double mqttMsgs = 0;
+  double mqttBytes = 0;
+};
+
+// TOPO_REQ inundado: una transmisión por enlace para el broadcast, y cada
+// nodo responde su lista de vecinos ruteada hasta el root
+static RefreshCost floodCost(const Tree &t) {
+  RefreshCost c;
+  char buf[512];
+  for (auto &e : t.parent) {
+    c.meshTx += 1 + t.depth(e.first);
+    std::vector<uint32_t> nb = t.children(e.first);
+    nb.push_back(e.second);
+    ControlWriter w(buf, sizeof(buf));
+    w.printf("{\"type\":\"TOPO\",\"from\":%u,", e.first).uintArray("neighbors", nb).raw("}");
+    c.mqttMsgs += 1;
+    c.mqttBytes += w.length();
+  }
+  return c;
+}
+
+int main(int argc, char **argv) {
+  const int nodes = argc > 1 ? atoi(argv[1]) : 50;
+  const int changes = argc > 2 ? atoi(argv[2]) : 500;
+  const unsigned seed = argc > 3 ? atoi(argv[3]) : 1;
+  std::mt19937 rng(seed);
+  int failed = 0;
+
+  Tree t;
+  t.root = 0x80000000u + (rng() & 0xffff);
+  auto newId = [&]() {
+    uint32_t id;
+    do id = rng() | 1; while (id == t.root || t.parent.count(id));
+    return id;
+  };
+  for (int i = 0; i < nodes; i++) {
+    uint32_t p = randomParent(t, rng, 0);
+    if (p) t.parent[newId()] = p;
+  }
+
+  static MeshTopology topo(0x1234abcd);
+  static TopoSnapshot snap;
+  static char json[TOPO_JSON_MAX];
+  std::string sub = t.json(true);
+  topoParse(sub.c_str(), sub.size(), t.root, snap);
+  topo.update(snap);
+  std::map<uint32_t, uint32_t> mirror(t.parent);  // lo que reconstruye un suscriptor
+
+  double ns = 0, diffBytes = 0, snapBytes = 0;
+  int applied = 0;
+  RefreshCost flood;
+  for (int i = 0; i < changes; i++) {
+    // Cambio al azar: mover un subárbol, o caída / llegada de un nodo (la
+    // población se mantiene cerca de la inicial)
+    std::vector<uint32_t> ids;
+    for (auto &e : t.parent) ids.push_back(e.first);
+    if (rng() % 2 && !ids.empty()) {
+      uint32_t id = ids[rng() % ids.size()];
+      uint32_t p = randomParent(t, rng, id);
+      if (p) t.parent[id] = p;
+    } else if ((int)ids.size() >= nodes || (ids.size() > 1 && rng() % 2)) {
+      std::vector<uint32_t> leaves;
+      for (uint32_t id : ids) {
+        if (t.children(id).empty()) leaves.push_back(id);
+      }
+      t.parent.erase(leaves[rng() % leaves.size()]);
+    } else if ((int)t.parent.size() < TOPO_MAX_NODES - 1) {
+      uint32_t p = randomParent(t, rng, 0);
+      if (p) t.parent[newId()] = p;
+    }
+    sub = t.json(i % 2 == 0);
+
+    auto t0 = std::chrono::steady_clock::now();
+    topoParse(sub.c_str(), sub.size(), t.root, snap);
+    bool changed = topo.update(snap);
+    size_t n = changed ? topo.writeDiff(t.root, json, sizeof(json)) : 0;
+    auto t1 = std::chrono::steady_clock::now();
+    ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+
+    if (changed) {
+      if (!n || !applyDiff(json, n, mirror)) {
+        printf("FALLO: diff vacío o ilegible en el cambio %d\n", i);
+        failed++;
+      }
+      diffBytes += n;
+      applied++;
+    }
+    if (mirror != t.parent) {
+      printf("FALLO: el diff %d no reconstruye la foto (%zu vs %zu aristas)\n", i, mirror.size(), t.parent.size());
+      failed++;
+      mirror = t.parent;
+    }
+    snapBytes += topo.writeSnapshot(t.root, json, sizeof(json));
+    RefreshCost f = floodCost(t);
+    flood.meshTx += f.meshTx;
+    flood.mqttMsgs += f.mqttMsgs;
+    flood.mqttBytes += f.mqttBytes;
+  }
+
+  size_t unchanged = topo.writeUnchanged(t.root, json, sizeof(json));
+  printf("%d nodos iniciales, %d cambios (%d con diff), versión final %u\n", nodes, changes, applied,
+         topo.version());
+  printf("parse + update + diff: %.1f us por cambio\n\n", ns / changes / 1000);
+  printf("%-24s %12s %12s %12s\n", "por refresco", "mesh tx", "MQTT msgs", "MQTT bytes");
+  printf("%-24s %12.1f %12.1f %12.0f\n", "TOPO_REQ inundado", flood.meshTx / changes, flood.mqttMsgs / changes,
+         flood.mqttBytes / changes);
+  printf("%-24s %12.1f %12.1f %12.0f\n", "caché (foto)", 0.0, 1.0, snapBytes / changes);
+  printf("%-24s %12.1f %12.1f %12zu\n", "caché (etag vigente)", 0.0, 1.0, unchanged);
+  printf("%-24s %12.1f %12.1f %12.0f\n", "TOPO_DIFF por cambio", 0.0, 1.0, applied ? diffBytes / applied : 0.0);
+
+  printf(failed ? "FALLO: %d comprobaciones\n" : "OK: cada TOPO_DIFF reconstruye la foto anterior + diff\n",
+         failed);
+  return failed ? 1 : 0;
+}
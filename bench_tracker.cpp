@@ -0,0 +1,384 @@
+// Pruebas y benchmark en el host del seguimiento de pedidos de control
+// (ControlTracker.h).
+//
+//   g++ -O2 -std=c++11 bench_tracker.cpp -o bench_tracker && ./bench_tracker [pedidos] [semilla]
+//
+// Primero casos puntuales: unicast contestado, vencido, repetidos, límite por
+// destino, broadcast con respuestas juntadas (también con más respondedores
+// que ids publicados y repetidos fuera de la lista), respuestas huérfanas y
+// tablas llenas. Después operaciones al azar sobre una tabla chica con muchas
+// colisiones contra un modelo de referencia (std::map), para el borrado por
+// corrimiento. Por último 1000 pedidos abiertos a la vez con reloj virtual:
+// respuestas al azar, repetidos y respuestas dobles; cada pedido debe cerrar
+// una sola vez con el estado correcto y sin reservas de heap. Sale con 1 si
+// algo falla.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "ControlTracker.h"
+
+static size_t allocations = 0;
+
+void *operator new(size_t n) {
+  allocations++;
+  if (void *p = malloc(n)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static int failed = 0;
+
+#define CHECK(cond, ...)         \
+  do {                           \
+    if (!(cond)) {               \
+      printf("FALLO: " __VA_ARGS__); \
+      printf("\n");              \
+      failed++;                  \
+    }                            \
+  } while (0)
+
+// Último resultado emitido
+struct Emitted {
+  size_t count = 0;
+  ControlRequest req;
+  ControlStatus status;
+  void operator()(const ControlRequest &r, ControlStatus s) {
+    count++;
+    req = r;
+    status = s;
+  }
+};
+
+// ---------- Casos puntuales ----------
+
+static void checkCases() {
+  static ControlTracker<16, 16> t;
+  Emitted e;
+  auto emit = [&](const ControlRequest &r, ControlStatus s) { e(r, s); };
+
+  // Unicast contestado: un resultado con la demora
+  CHECK(t.request(CTRL_PING, 7, 100, 1, 1000) == CONTROL_TRACKED, "PING no registrado");
+  CHECK(t.reply(CTRL_PONG, 7, 100, 1040, emit), "PONG sin pedido");
+  CHECK(e.count == 1 && e.status == CONTROL_DONE && e.req.firstMs == 40 && e.req.count == 1 &&
+            e.req.responders[0] == 7,
+        "PING: %zu resultados, estado %u, rtt %u", e.count, e.status, e.req.firstMs);
+  CHECK(t.size() == 0, "PING contestado sigue abierto");
+  CHECK(!t.reply(CTRL_PONG, 7, 100, 1050, emit) && e.count == 1, "PONG repetido cerró otra vez");
+
+  // Vencido: nada antes de CONTROL_TIMEOUT_MS, "timeout" después
+  e = Emitted();
+  t.request(CTRL_TRACE, 8, 101, 1, 2000);
+  CHECK(t.expire(2000 + CONTROL_TIMEOUT_MS - 1, emit) == 0 && e.count == 0, "TRACE vencido antes de tiempo");
+  CHECK(t.expire(2000 + CONTROL_TIMEOUT_MS, emit) == 1 && e.status == CONTROL_TIMEOUT, "TRACE no venció");
+  CHECK(!t.reply(CTRL_TRACE_REPLY, 8, 101, 2000 + CONTROL_TIMEOUT_MS + 1, emit), "respuesta tardía aceptada");
+
+  // Repetidos: no se reenvían ni consumen cupo; otra seq es otro pedido
+  e = Emitted();
+  uint32_t now = 10000;
+  CHECK(t.request(CTRL_PING, 9, 200, 1, now) == CONTROL_TRACKED, "PING 200");
+  for (int i = 0; i < 10; i++) {
+    CHECK(t.request(CTRL_PING, 9, 200, 1, now) == CONTROL_DUPLICATE, "repetido %d reenviado", i);
+  }
+  CHECK(t.request(CTRL_TRACE, 9, 200, 1, now) == CONTROL_TRACKED, "otro tipo con la misma seq");
+  CHECK(t.request(CTRL_PING, 9, 201, 1, now) == CONTROL_TRACKED, "otra seq");
+  t.reply(CTRL_PONG, 9, 200, now + 5, emit);
+  CHECK(e.count == 1 && e.req.duplicates == 10, "repetidos absorbidos: %u", e.req.duplicates);
+
+  // Límite: CONTROL_RATE_BURST seguidos (ya van 3 al nodo 9), luego uno por intervalo
+  CHECK(t.request(CTRL_PING, 9, 202, 1, now) == CONTROL_TRACKED, "cuarto del cupo");
+  CHECK(t.request(CTRL_PING, 9, 203, 1, now) == CONTROL_RATE_LIMITED, "quinto sin límite");
+  CHECK(t.request(CTRL_PING, 10, 203, 1, now) == CONTROL_TRACKED, "el límite alcanzó a otro destino");
+  CHECK(t.request(CTRL_PING, 9, 203, 1, now + CONTROL_RATE_INTERVAL_MS - 1) == CONTROL_RATE_LIMITED,
+        "cupo antes del intervalo");
+  CHECK(t.request(CTRL_PING, 9, 203, 1, now + CONTROL_RATE_INTERVAL_MS) == CONTROL_TRACKED,
+        "sin cupo tras un intervalo");
+  CHECK(t.request(CTRL_PING, 9, 204, 1, now + CONTROL_RATE_INTERVAL_MS) == CONTROL_RATE_LIMITED,
+        "dos por intervalo");
+  t.expire(now + 60000, [](const ControlRequest &, ControlStatus) {});
+  CHECK(t.size() == 0, "quedaron %zu abiertos", t.size());
+
+  // Broadcast: una sola respuesta con todos, el repetido de un nodo no cuenta
+  e = Emitted();
+  now = 100000;
+  CHECK(t.request(CTRL_TOPO_REQ, 0, 300, 5, now) == CONTROL_TRACKED, "TOPO_REQ broadcast");
+  const uint32_t nodes[] = {11, 12, 13, 12, 14, 15};
+  for (size_t i = 0; i < 6; i++) t.reply(CTRL_TOPO, nodes[i], 300, now + 10 * (uint32_t)(i + 1), emit);
+  CHECK(e.count == 1 && e.status == CONTROL_DONE && e.req.answered == 5 && e.req.firstMs == 10 &&
+            e.req.lastMs == 60,
+        "broadcast: %zu resultados, %u respuestas, rtt %u-%u", e.count, e.req.answered, e.req.firstMs,
+        e.req.lastMs);
+  char json[CONTROL_RESULT_JSON_MAX];
+  size_t n = controlResultJson(e.req, e.status, 1, now + 60, json, sizeof(json));
+  CHECK(n && strstr(json, "\"req\":\"TOPO_REQ\"") && strstr(json, "\"status\":\"ok\"") &&
+            strstr(json, "\"nodes\":[11,12,13,14,15]"),
+        "JSON del broadcast: %s", json);
+
+  // Broadcast con más respondedores que ids publicados: los repetidos de los
+  // nodos 9..12, fuera de la lista, tampoco cuentan
+  e = Emitted();
+  uint32_t repeated = t.stats().repeated;
+  t.request(CTRL_TOPO_REQ, 0, 302, 20, now);
+  for (uint32_t id = 1; id <= 12; id++) t.reply(CTRL_TOPO, 100 + id, 302, now + id, emit);
+  for (uint32_t id = 9; id <= 12; id++) t.reply(CTRL_TOPO, 100 + id, 302, now + 20 + id, emit);
+  CHECK(e.count == 0 && t.stats().repeated == repeated + 4, "broadcast: %zu resultados con 12 de 20, %u repetidas",
+        e.count, t.stats().repeated - repeated);
+  for (uint32_t id = 13; id <= 20; id++) t.reply(CTRL_TOPO, 100 + id, 302, now + 40 + id, emit);
+  n = controlResultJson(e.req, e.status, 1, now + 60, json, sizeof(json));
+  CHECK(e.count == 1 && e.status == CONTROL_DONE && e.req.answered == 20 && e.req.count == CONTROL_RESPONDERS_MAX &&
+            e.req.lastMs == 60 && n && strstr(json, "\"truncated\":true"),
+        "broadcast de 20: %zu resultados, %u respuestas, %u ids", e.count, e.req.answered, e.req.count);
+
+  // Tabla de pares chica: lo que no entra se cuenta sin descartar repetidos,
+  // y al cerrar el pedido sus pares quedan libres para el siguiente
+  static ControlTracker<16, 16, 16> pairs;
+  e = Emitted();
+  pairs.request(CTRL_REPORT_CFG, 0, 1, 30, now);
+  for (uint32_t id = 1; id <= 20; id++) pairs.reply(CTRL_REPORT_CFG_ACK, id, 1, now, emit);
+  pairs.reply(CTRL_REPORT_CFG_ACK, 1, 1, now, emit);
+  pairs.reply(CTRL_REPORT_CFG_ACK, 15, 1, now, emit);
+  pairs.expire(now + CONTROL_TIMEOUT_MS, emit);
+  CHECK(e.count == 1 && e.req.answered == 20 && pairs.stats().unchecked == 5 && pairs.stats().repeated == 2,
+        "pares llenos: %u respuestas, %u sin descartar, %u repetidas", e.req.answered, pairs.stats().unchecked,
+        pairs.stats().repeated);
+  pairs.request(CTRL_REPORT_CFG, 0, 2, 15, now + CONTROL_TIMEOUT_MS);
+  for (uint32_t id = 1; id <= 15; id++) pairs.reply(CTRL_REPORT_CFG_ACK, id, 2, now + CONTROL_TIMEOUT_MS, emit);
+  CHECK(e.count == 2 && e.status == CONTROL_DONE && pairs.stats().unchecked == 5 && pairs.size() == 0,
+        "pares no liberados: %u sin descartar", pairs.stats().unchecked);
+
+  // Broadcast parcial
+  e = Emitted();
+  t.request(CTRL_REPORT_CFG, 0, 301, 4, now);
+  t.reply(CTRL_REPORT_CFG_ACK, 11, 301, now + 5, emit);
+  t.reply(CTRL_REPORT_CFG_ACK, 12, 301, now + 6, emit);
+  t.expire(now + CONTROL_TIMEOUT_MS, emit);
+  CHECK(e.count == 1 && e.status == CONTROL_PARTIAL && e.req.answered == 2, "broadcast parcial: estado %u",
+        e.status);
+
+  // Sin respuesta esperada: PING en broadcast, tipos que no son pedidos
+  CHECK(controlExpected(CTRL_PING, 0, 5) == 0 && controlExpected(CTRL_TOPO_REQ, 0, 5) == 5 &&
+            controlExpected(CTRL_TRACE, 3, 5) == 1 && controlExpected(CTRL_ROOT, 3, 5) == 0,
+        "controlExpected");
+  CHECK(t.request(CTRL_PING, 0, 400, 0, now) == CONTROL_UNTRACKED, "PING broadcast seguido");
+  uint32_t orphans = t.stats().orphans;
+  CHECK(!t.reply(CTRL_PONG, 20, 999, now, emit) && !t.reply(CTRL_DATA, 20, 0, now, emit) &&
+            t.stats().orphans == orphans + 2,
+        "huérfanas mal contadas");
+
+  // Tabla llena: SLOTS - 1 abiertos, el siguiente sale sin seguir
+  static ControlTracker<8, 16> small;
+  for (uint32_t i = 0; i < 7; i++) small.request(CTRL_PING, 100 + i, 1, 1, 0);
+  CHECK(small.size() == 7 && small.request(CTRL_PING, 200, 1, 1, 0) == CONTROL_UNTRACKED, "tabla llena: %zu",
+        small.size());
+
+  // Peor caso del JSON
+  ControlRequest worst;
+  memset(&worst, 0xff, sizeof(worst));
+  worst.type = CTRL_REPORT_CFG;
+  worst.count = CONTROL_RESPONDERS_MAX;
+  CHECK(controlResultJson(worst, CONTROL_LIMITED, UINT32_MAX, 0, json, sizeof(json)) > 0,
+        "el peor caso no entra en CONTROL_RESULT_JSON_MAX");
+}
+
+// ---------- Al azar contra un modelo ----------
+
+typedef std::tuple<uint8_t, uint32_t, uint32_t> Key;  // tipo, destino, seq
+
+// Muchas colisiones: 8 destinos x 16 seq x 2 tipos en 64 entradas
+static void checkRandom(std::mt19937 &rng, size_t ops) {
+  static ControlTracker<64, 64> t;
+  std::map<Key, uint32_t> open;       // clave -> enviado
+  std::map<uint32_t, uint32_t> tat;   // GCRA de referencia
+  size_t wrong = 0, closedModel = 0, closedTable = 0;
+  uint32_t now = 0;
+  auto emit = [&](const ControlRequest &r, ControlStatus) {
+    closedTable++;
+    if (!open.erase(Key(r.type, r.target, r.seq))) wrong++;
+  };
+
+  for (size_t k = 0; k < ops; k++) {
+    now += rng() % 40;
+    uint8_t type = rng() % 2 ? CTRL_PING : CTRL_TRACE;
+    uint32_t target = 1 + rng() % 8, seq = rng() % 16;
+    Key key(type, target, seq);
+    switch (rng() % 3) {
+      case 0: {
+        ControlVerdict v = t.request((ControlType)type, target, seq, 1, now);
+        ControlVerdict want;
+        if (open.count(key)) {
+          want = CONTROL_DUPLICATE;
+        } else {
+          uint32_t &x = tat.emplace(target, now).first->second;
+          uint32_t start = (int32_t)(now - x) > 0 ? now : x;
+          if (start - now > (CONTROL_RATE_BURST - 1) * CONTROL_RATE_INTERVAL_MS) {
+            want = CONTROL_RATE_LIMITED;
+          } else if (open.size() == t.capacity()) {
+            want = CONTROL_UNTRACKED;
+          } else {
+            want = CONTROL_TRACKED;
+            open[key] = now;
+          }
+          if (want != CONTROL_RATE_LIMITED) x = start + CONTROL_RATE_INTERVAL_MS;
+        }
+        if (v != want) wrong++;
+        break;
+      }
+      case 1: {
+        ControlType reply = type == CTRL_PING ? CTRL_PONG : CTRL_TRACE_REPLY;
+        bool had = open.count(key) > 0;
+        size_t before = closedTable;
+        if (t.reply(reply, target, seq, now, emit) != had || closedTable != before + had) wrong++;
+        closedModel += had;
+        break;
+      }
+      default:
+        for (auto it = open.begin(); it != open.end();) {
+          if (now - it->second >= CONTROL_TIMEOUT_MS) {
+            it = open.erase(it);
+            closedModel++;
+          } else {
+            ++it;
+          }
+        }
+        // emit borra del modelo: se compara con lo que sigue abierto después
+        {
+          std::map<Key, uint32_t> keep = open;
+          t.expire(now, [&](const ControlRequest &r, ControlStatus) {
+            closedTable++;
+            if (keep.count(Key(r.type, r.target, r.seq))) wrong++;
+          });
+        }
+        break;
+    }
+    if (t.size() != open.size()) wrong++;
+  }
+  CHECK(!wrong && closedModel == closedTable, "al azar: %zu diferencias, cerrados %zu vs %zu", wrong, closedModel,
+        closedTable);
+}
+
+// ---------- 1000 pedidos a la vez ----------
+
+struct Event {
+  uint32_t at;
+  uint8_t kind;  // 0 pedido, 1 respuesta
+  uint32_t req;  // índice del pedido
+  bool operator<(const Event &o) const { return at < o.at || (at == o.at && kind < o.kind); }
+};
+
+struct Outcome {
+  uint32_t results;
+  uint8_t status;
+  uint32_t firstMs;
+};
+
+int main(int argc, char **argv) {
+  // Hasta la capacidad de la tabla de la simulación
+  const size_t requests = std::min<size_t>(argc > 1 ? (size_t)atoi(argv[1]) : 1000, 2047);
+  const unsigned seed = argc > 2 ? atoi(argv[2]) : 1;
+  std::mt19937 rng(seed);
+
+  checkCases();
+  checkRandom(rng, 200000);
+
+  // Un PING o TRACE a cada uno de los nodos en los primeros 100 ms; el 90 %
+  // contesta entre 200 ms y 1.5 x CONTROL_TIMEOUT_MS, el 5 % se repite y el
+  // 5 % contesta dos veces. Todos están abiertos a la vez a los 100 ms
+  std::vector<uint32_t> target(requests), seq(requests), sent(requests), answerAt(requests);
+  std::vector<uint8_t> type(requests);
+  std::vector<Event> events;
+  for (size_t i = 0; i < requests; i++) {
+    target[i] = 0x10000000u + (uint32_t)i * 7919;
+    seq[i] = 1700000000u + (uint32_t)(rng() % 3);
+    type[i] = rng() % 4 ? CTRL_PING : CTRL_TRACE;
+    sent[i] = rng() % 100;
+    events.push_back({sent[i], 0, (uint32_t)i});
+    if (rng() % 20 == 0) events.push_back({sent[i] + 1 + (uint32_t)(rng() % 50), 0, (uint32_t)i});
+    answerAt[i] = UINT32_MAX;
+    if (rng() % 10) {
+      answerAt[i] = sent[i] + 200 + rng() % (CONTROL_TIMEOUT_MS * 3 / 2);
+      events.push_back({answerAt[i], 1, (uint32_t)i});
+      if (rng() % 20 == 0) events.push_back({answerAt[i] + 1 + (uint32_t)(rng() % 20), 1, (uint32_t)i});
+    }
+  }
+  std::sort(events.begin(), events.end());
+
+  static ControlTracker<2048, 2048, 4096> tracker;
+  static Outcome outcome[2048];
+  size_t maxOpen = 0, lost = 0, forwarded = 0;
+  uint32_t end = 0;
+  for (const Event &ev : events) end = std::max(end, ev.at);
+  end += CONTROL_TIMEOUT_MS + 100;
+
+  auto emit = [&](const ControlRequest &r, ControlStatus s) {
+    size_t i = (r.target - 0x10000000u) / 7919;
+    outcome[i].results++;
+    outcome[i].status = s;
+    outcome[i].firstMs = r.firstMs;
+  };
+  size_t before = allocations;
+  size_t next = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t now = 0; now <= end; now++) {
+    for (; next < events.size() && events[next].at == now; next++) {
+      uint32_t i = events[next].req;
+      if (events[next].kind == 0) {
+        ControlVerdict v = tracker.request((ControlType)type[i], target[i], seq[i], 1, now);
+        if (v == CONTROL_TRACKED || v == CONTROL_UNTRACKED) forwarded++;
+        if (v == CONTROL_UNTRACKED || v == CONTROL_RATE_LIMITED) lost++;
+      } else {
+        ControlType reply = type[i] == CTRL_PING ? CTRL_PONG : CTRL_TRACE_REPLY;
+        tracker.reply(reply, target[i], seq[i], now, emit);
+      }
+    }
+    maxOpen = std::max(maxOpen, tracker.size());
+    if (now % 10 == 0) tracker.expire(now, emit);  // barrido de la tarea MQTT
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  size_t allocs = allocations - before;
+
+  size_t wrongCount = 0, wrongStatus = 0, wrongRtt = 0, done = 0, timeouts = 0;
+  for (size_t i = 0; i < requests; i++) {
+    const Outcome &o = outcome[i];
+    // Vence en el primer barrido desde CONTROL_TIMEOUT_MS; hasta ahí la
+    // respuesta todavía lo completa
+    uint32_t expiresAt = (sent[i] + CONTROL_TIMEOUT_MS + 9) / 10 * 10;
+    bool inTime = answerAt[i] <= expiresAt;
+    if (o.results != 1) wrongCount++;
+    if (o.status != (inTime ? CONTROL_DONE : CONTROL_TIMEOUT)) wrongStatus++;
+    if (inTime && o.firstMs != answerAt[i] - sent[i]) wrongRtt++;
+    (inTime ? done : timeouts)++;
+  }
+  const ControlTrackerStats &st = tracker.stats();
+  double usTotal = std::chrono::duration<double, std::micro>(t1 - t0).count();
+
+  printf("%zu pedidos, %zu eventos, tabla de %zu entradas (%zu KB)\n", requests, events.size(), tracker.capacity(),
+         sizeof(tracker) / 1024);
+  printf("abiertos a la vez: %zu  reenviados al mesh: %zu  repetidos absorbidos: %u  huérfanas: %u\n", maxOpen,
+         forwarded, st.duplicates, st.orphans);
+  printf("resultados: ok=%u vencidos=%u parciales=%u  simulación de %u ms en %.1f ms, %zu reservas\n", st.done,
+         st.timeouts, st.partial, end, usTotal / 1000, allocs);
+
+  CHECK(maxOpen == requests, "sólo %zu pedidos abiertos a la vez", maxOpen);
+  CHECK(forwarded == requests && !lost, "reenviados %zu de %zu, %zu sin seguir o limitados", forwarded, requests,
+        lost);
+  CHECK(!wrongCount, "%zu pedidos sin exactamente un resultado", wrongCount);
+  CHECK(!wrongStatus && !wrongRtt, "%zu estados y %zu rtt incorrectos", wrongStatus, wrongRtt);
+  CHECK(st.done == done && st.timeouts == timeouts && tracker.size() == 0, "contadores: ok %u/%zu, vencidos %u/%zu",
+        st.done, done, st.timeouts, timeouts);
+  CHECK(allocs == 0, "ControlTracker reservó heap (%zu)", allocs);
+  CHECK(!st.unchecked, "%u respuestas sin descartar repetidos", st.unchecked);
+
+  printf(failed ? "FALLO: %d comprobaciones\n"
+                : "OK: un resultado por pedido, repetidos absorbidos, límite por destino y vencimientos; 0 reservas "
+                  "de heap\n",
+         failed);
+  return failed ? 1 : 0;
+}
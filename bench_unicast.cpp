@@ -0,0 +1,173 @@
+// Cuenta en el host las transmisiones del mesh por lectura: broadcast
+// inundado frente a unicast al root (sendToRoot() de MeshNodeRuntime.h).
+//
+//   g++ -O2 -std=c++11 bench_unicast.cpp -o bench_unicast && ./bench_unicast [árboles] [semilla]
+//
+// Arma árboles al azar como los de painlessMesh (hasta 4 hijos por nodo, como
+// bench_topo.cpp) y también una cadena, el peor caso de profundidad, para
+// 5, 20 y 50 nodos. Cada nodo manda una lectura y se propaga salto a salto:
+//   - broadcast: cada nodo la reenvía a todas sus conexiones menos la de
+//     llegada y se la entrega a su receivedCallback, que la parsea para
+//     descartarla si no es el root;
+//   - unicast: sólo viaja por el camino al root; los nodos intermedios la
+//     rutean sin entregarla a la aplicación.
+// Suma también el anuncio ROOT de la gateway (un broadcast cada
+// ROOT_ANNOUNCE_MS) repartido entre las lecturas del período.
+// Comprueba que el root reciba cada lectura una sola vez en ambos modos y que
+// el unicast nunca transmita más que el broadcast. Sale con 1 si algo falla.
+
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <vector>
+
+static int failed = 0;
+
+#define CHECK(cond, ...)         \
+  do {                           \
+    if (!(cond)) {               \
+      printf("FALLO: " __VA_ARGS__); \
+      printf("\n");              \
+      failed++;                  \
+    }                            \
+  } while (0)
+
+#define ROOT_ANNOUNCE_MS 30000  // los de GATEWAY.cpp y los nodos
+#define SEND_PERIOD_MS 10000
+#define READING_BYTES 96        // lectura JSON típica con GPS
+
+static const size_t kMaxChildren = 4;
+
+// Nodo 0 es el root; parent[0] no se usa
+struct Tree {
+  std::vector<int> parent;
+  std::vector<std::vector<int>> links;  // conexiones de cada nodo
+
+  explicit Tree(size_t n) : parent(n, -1), links(n) {}
+  void connect(int child, int p) {
+    parent[child] = p;
+    links[child].push_back(p);
+    links[p].push_back(child);
+  }
+  int depth(int id) const {
+    int d = 0;
+    for (; id != 0; d++) id = parent[id];
+    return d;
+  }
+};
+
+static Tree randomTree(size_t n, std::mt19937 &rng) {
+  Tree t(n);
+  std::vector<size_t> kids(n, 0);
+  for (size_t i = 1; i < n; i++) {
+    int p;
+    do p = (int)(rng() % i); while (kids[p] >= kMaxChildren);
+    kids[p]++;
+    t.connect((int)i, p);
+  }
+  return t;
+}
+
+static Tree chain(size_t n) {
+  Tree t(n);
+  for (size_t i = 1; i < n; i++) t.connect((int)i, (int)i - 1);
+  return t;
+}
+
+struct Cost {
+  uint64_t tx = 0;        // transmisiones por enlace
+  uint64_t parsed = 0;    // entregas a la aplicación de nodos que no son el root
+  uint64_t atRoot = 0;    // entregas al root
+};
+
+// Inundación de painlessMesh: reenvía a todas las conexiones menos la de llegada
+static void flood(const Tree &t, int from, Cost &c) {
+  std::deque<std::pair<int, int>> q;  // (nodo, de dónde llegó)
+  q.push_back({from, -1});
+  while (!q.empty()) {
+    std::pair<int, int> cur = q.front();
+    q.pop_front();
+    if (cur.second >= 0) {
+      if (cur.first == 0) c.atRoot++;
+      else c.parsed++;
+    }
+    for (int nb : t.links[cur.first]) {
+      if (nb == cur.second) continue;
+      c.tx++;
+      q.push_back({nb, cur.first});
+    }
+  }
+}
+
+// sendSingle() al root: un salto por nivel, sin entregar en el camino
+static void unicast(const Tree &t, int from, Cost &c) {
+  for (int id = from; id != 0; id = t.parent[id]) c.tx++;
+  c.atRoot++;
+}
+
+struct Row {
+  double bcastTx = 0, bcastParsed = 0, uniTx = 0, depth = 0, announceTx = 0;
+  uint64_t readings = 0;
+};
+
+static void measure(const Tree &t, Row &row) {
+  size_t n = t.parent.size();
+  Cost b, u;
+  uint64_t depthSum = 0;
+  for (size_t i = 1; i < n; i++) {
+    flood(t, (int)i, b);
+    unicast(t, (int)i, u);
+    depthSum += t.depth((int)i);
+  }
+  uint64_t readings = n - 1;
+  CHECK(b.atRoot == readings && u.atRoot == readings, "%zu nodos: el root recibió %llu/%llu de %llu", n,
+        (unsigned long long)b.atRoot, (unsigned long long)u.atRoot, (unsigned long long)readings);
+  CHECK(b.tx == readings * (n - 1), "%zu nodos: la inundación no usó cada enlace una vez", n);
+  CHECK(u.tx == depthSum && u.tx <= b.tx, "%zu nodos: unicast %llu tx, broadcast %llu", n,
+        (unsigned long long)u.tx, (unsigned long long)b.tx);
+  Cost a;
+  flood(t, 0, a);  // anuncio ROOT desde la gateway
+  row.bcastTx += b.tx;
+  row.bcastParsed += b.parsed;
+  row.uniTx += u.tx;
+  row.depth += depthSum;
+  row.announceTx += a.tx * (double)SEND_PERIOD_MS / ROOT_ANNOUNCE_MS;  // por período de envío
+  row.readings += readings;
+}
+
+static void print(const char *name, size_t n, const Row &r) {
+  double k = (double)r.readings;
+  double bcast = r.bcastTx / k;
+  double uni = (r.uniTx + r.announceTx) / k;
+  printf("%-8s %5zu %8.2f %10.2f %11.2f %10.2f %13.2f %9.1fx %10.0f\n", name, n, r.depth / k, bcast,
+         r.bcastParsed / k, r.uniTx / k, uni, bcast / uni, (bcast - uni) * READING_BYTES);
+}
+
+int main(int argc, char **argv) {
+  const size_t trees = argc > 1 ? (size_t)atoi(argv[1]) : 200;
+  const unsigned seed = argc > 2 ? (unsigned)atoi(argv[2]) : 1;
+  std::mt19937 rng(seed);
+
+  printf("Por lectura: broadcast inundado frente a unicast al root; %zu árboles al azar por tamaño\n", trees);
+  printf("(unicast+ROOT suma un anuncio cada %u s repartido entre lecturas cada %u s)\n\n", ROOT_ANNOUNCE_MS / 1000,
+         SEND_PERIOD_MS / 1000);
+  printf("%-8s %5s %8s %10s %11s %10s %13s %10s %10s\n", "árbol", "nodos", "saltos", "bcast tx", "parseadas",
+         "unicast tx", "unicast+ROOT", "ahorro", "bytes/lect");
+  const size_t sizes[] = {5, 20, 50};
+  for (size_t n : sizes) {
+    Row r;
+    for (size_t i = 0; i < trees; i++) measure(randomTree(n, rng), r);
+    print("azar", n, r);
+    Row c;
+    measure(chain(n), c);
+    print("cadena", n, c);
+    CHECK(r.uniTx < r.bcastTx && c.uniTx < c.bcastTx, "%zu nodos: el unicast no ahorra transmisiones", n);
+  }
+
+  printf(failed ? "\nFALLO: %d comprobaciones\n"
+                : "\nOK: cada lectura llega una vez al root; unicast = profundidad del nodo, broadcast = N-1 "
+                  "transmisiones y N-2 parseos inútiles\n",
+         failed);
+  return failed ? 1 : 0;
+}
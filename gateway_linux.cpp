@@ -0,0 +1,690 @@
+// Gateway en Linux: la lógica de GATEWAY.cpp (GatewayCore.h) sobre el port de
+// painlessMesh a boost::asio y libmosquitto, para correr la gateway en un host
+// con más núcleos, RAM y conexiones MQTT que un ESP32.
+//
+//   PM=<painlessMesh>; g++ -O2 -std=c++17 -pthread -DPAINLESSMESH_BOOST
+//       -I$PM/src -I$PM/test/include -I<ArduinoJson>/src -I<TaskScheduler>/src
+//       gateway_linux.cpp -o gateway_linux -lmosquitto -lboost_system
+//   (C++17: las colas SPSC alinean sus índices a 64 bytes dentro de Publisher)
+//   Sin probar: sólo se revisó la sintaxis contra cabeceras de reemplazo de
+//   painlessMesh y libmosquitto, nunca se compiló ni corrió contra las reales.
+//   Por eso no está en CMakeLists.txt ni en ctest.
+//   ./gateway_linux --mesh-port 5555 --broker 127.0.0.1 --publishers 4
+//
+// - El hilo principal es el "núcleo del mesh": io_service.poll() y el
+//   Scheduler de painlessMesh. Acepta nodos por TCP en --mesh-port (sobre la
+//   NIC del host, una TAP o loopback) y con --connect se une como cliente a un
+//   mesh existente, p.ej. al AP de un ESP32 a través de la NIC del host.
+// - Publicación: un grupo fijo de --publishers hilos (no un hilo por nodo).
+//   Cada trama va al hilo nodeId % publishers, así cada nodo conserva el orden
+//   y muchos nodos comparten hilo. Cada hilo tiene su propia conexión MQTT, su
+//   cola SPSC y su store-and-forward; un broker lento con una conexión no
+//   frena a las demás.
+// - El publicador 0 además atiende Nodos/control, el seguimiento de pedidos
+//   (ControlTracker.h, CTRL_RESULT), la caché de topología, los SEQ_STATS, las
+//   métricas (GatewayMetrics.h) y el reporte de la gateway, igual que la tarea
+//   MQTT del ESP32. Las métricas suman la latencia de publish() de todos los
+//   publicadores; "heap" va en 0 (es el del ESP32).
+//
+// bench_gateway.py mide el throughput con nodos sintéticos por loopback.
+
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <ifaddrs.h>
+#include <mosquitto.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "Arduino.h"
+#include "painlessMeshConnection.h"
+#include "painlessmesh/mesh.hpp"
+#include "painlessmesh/tcp.hpp"
+
+static void logSinkStdout(const char* buf, size_t len) {
+  fwrite(buf, 1, len, stdout);
+  fflush(stdout);
+}
+#define LOG_SINK(buf, len) logSinkStdout((buf), (len))
+#include "DeferredLog.h"
+#include "FrameStore.h"
+#include "SpscQueue.h"
+
+#define MESH_PORT 5555
+#define MQTT_PORT 1883
+
+// Store-and-forward por publicador
+#define STORE_CAPACITY 4096
+#define STORE_PAYLOAD_MAX 192
+#define CONTROL_REPLY_MAX 384  // respuestas de control, las del nodo (MeshNodeRuntime.h)
+#define STORE_DRAIN_BURST 64  // por vuelta del publicador al volver MQTT
+
+#define ROOT_ANNOUNCE_MS 30000
+#define MQTT_FRAME_FORMAT_JSON 1
+
+#define PUBLISHERS_MAX 16
+#define LANE_SLOTS 1024         // tramas mesh -> cada publicador
+#define REPLY_LANE_SLOTS 64     // respuestas de control, con prioridad (publicador 0)
+#define CONTROL_QUEUE_SLOTS 64  // comandos MQTT -> mesh
+#define CONTROL_PAYLOAD_MAX 256
+#define MESH_POLL_US 200        // pausa del hilo del mesh sin trabajo
+#define PUBLISHER_IDLE_MS 2     // pausa de un publicador sin tramas
+#define MQTT_BACKOFF_MIN_MS 1000
+#define MQTT_BACKOFF_MAX_MS 60000
+#define MQTT_CONNACK_WAIT_MS 5000  // tras connect(), espera al CONNACK antes de reintentar
+#define MQTT_KEEPALIVE_S 30
+
+#define TOPO_SETTLE_MS 500
+#define TOPO_QUEUE_SLOTS 2
+#define SEQ_TABLE_SLOTS 4096  // más nodos que en el ESP32
+#define SEQ_REPORT_MS 60000
+#define SEQ_REPORT_MAX 64
+#define SEQ_QUEUE_SLOTS 2
+#define STATUS_REPORT_MS 60000
+
+#define METRICS_INTERVAL_MS 10000
+#define METRICS_NODE_SLOTS 4096  // como SEQ_TABLE_SLOTS
+#define METRICS_QUEUE_SLOTS 2
+
+#define CONTROL_TIMEOUT_MS 5000
+#define CONTROL_TRACK_SLOTS 256
+#define CONTROL_TRACK_TARGETS 256
+#define CONTROL_RESPONDER_SLOTS 4096
+
+#include "GatewayCore.h"
+#include "GatewayMetrics.h"
+#include "ControlTracker.h"
+
+using MeshConnection = painlessmesh::Connection;
+using Mesh = painlessmesh::Mesh<MeshConnection>;
+
+// Lo que pide el shim Arduino de painlessMesh en Linux
+WiFiClass WiFi;
+ESPClass ESP;
+painlessmesh::logger::LogClass Log;
+
+static uint32_t nowMs() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static uint32_t nowUs() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Options {
+  uint16_t meshPort = MESH_PORT;
+  std::string connect;  // host:puerto de un mesh existente
+  uint32_t nodeId = 0;  // 0 = al azar
+  std::string broker = "127.0.0.1";
+  uint16_t mqttPort = MQTT_PORT;
+  unsigned publishers = 2;
+};
+
+Options opts;
+Scheduler scheduler;
+boost::asio::io_service ioService;
+Mesh mesh;
+
+// Propiedad del hilo del mesh
+SpscQueue<ControlFrame, CONTROL_QUEUE_SLOTS> controlQueue;  // consumidor
+SpscQueue<TopoSnapshot, TOPO_QUEUE_SLOTS> topoQueue;        // productor
+SpscQueue<SeqReport, SEQ_QUEUE_SLOTS> seqQueue;             // productor
+SpscQueue<MetricsSnapshot, METRICS_QUEUE_SLOTS> metricsQueue;  // productor
+SeqTable<SEQ_TABLE_SLOTS> seqTable;
+MeshMetrics<METRICS_NODE_SLOTS> meshMetrics;
+uint32_t lastMetrics = 0;
+bool topoDirty = true;
+uint32_t topoChangedMs = 0;
+uint32_t lastSeqReport = 0;
+uint32_t lastRootAnnounce = 0;
+MeshTime64 meshClock;  // vueltas de getNodeTime() que se anuncian en el ROOT
+
+// Estado publicado por un hilo y leído por otros
+std::atomic<uint32_t> gatewayId{0};
+std::atomic<uint32_t> sharedNodeCount{0};
+std::atomic<uint32_t> firstPublishMs{0};
+std::atomic<bool> running{true};
+uint32_t startMs = 0;
+
+// Un publicador: su conexión MQTT, su carril de tramas y su store-and-forward
+struct Publisher {
+  struct Stats {
+    std::atomic<uint32_t> published{0};
+    std::atomic<uint32_t> failures{0};
+    std::atomic<uint32_t> laneFull{0};  // tramas descartadas con el carril lleno (cualquiera)
+    std::atomic<uint32_t> reconnects{0};
+  };
+
+  // Latencia de publish() y tramas retenidas; las junta el publicador 0
+  struct Metrics {
+    std::mutex lock;
+    PublishMetrics pub;
+    uint32_t storeDepth = 0;
+  };
+
+  unsigned index = 0;
+  mosquitto* client = nullptr;
+  bool connected = false;
+  bool attempted = false;  // ya hubo un connect(): los siguientes son reconnect()
+  uint32_t nextAttempt = 0;
+  uint32_t backoff = MQTT_BACKOFF_MIN_MS;
+  MeshLanes<REPLY_LANE_SLOTS, LANE_SLOTS> lanes;  // productor: hilo del mesh
+  FrameStore<STORE_CAPACITY, STORE_PAYLOAD_MAX> store;
+  Stats stats;
+  Metrics metrics;
+  std::thread thread;
+
+  void published(GatewayLane lane, bool ok, uint32_t us) {
+    std::lock_guard<std::mutex> g(metrics.lock);
+    metrics.pub.published(lane, ok, us);
+  }
+};
+
+std::vector<std::unique_ptr<Publisher>> publishers;
+
+// Propiedad del publicador 0
+MeshTopology topology;
+char topoJson[TOPO_JSON_MAX];
+char seqJson[SEQ_JSON_MAX];
+char metricsJson[METRICS_JSON_MAX];
+ControlTracker<CONTROL_TRACK_SLOTS, CONTROL_TRACK_TARGETS> controlTracker;
+char resultJson[CONTROL_RESULT_JSON_MAX];
+uint32_t lastStatusReport = 0;
+
+// ---------- Publicadores ----------
+
+bool publishRaw(Publisher& p, const char* topic, const char* payload, size_t len) {
+  if (!p.connected) return false;
+  int rc = mosquitto_publish(p.client, nullptr, topic, (int)len, payload, 0, false);
+  if (rc != MOSQ_ERR_SUCCESS) {
+    p.stats.failures++;
+    return false;
+  }
+  p.stats.published++;
+  return true;
+}
+
+bool publishFrame(Publisher& p, uint32_t from, const char* payload, size_t len, const char* extra) {
+  char topic[GATEWAY_TOPIC_MAX];
+  gatewayFrameTopic(from, topic, sizeof(topic));
+  char buf[GATEWAY_FRAME_TEXT_MAX];
+  payload = gatewayFramePayload(payload, len, extra, buf, sizeof(buf));
+  if (!payload || !publishRaw(p, topic, payload, len)) return false;
+  uint32_t none = 0;
+  firstPublishMs.compare_exchange_strong(none, nowMs() - startMs);
+  return true;
+}
+
+bool publishGateway(Publisher& p, const char* json, size_t len) {
+  return len && publishRaw(p, MQTT_TOPIC_GATEWAY, json, len);
+}
+
+// Publicador 0: CTRL_RESULT de un pedido cerrado
+void publishControlResult(Publisher& p, const ControlRequest& r, ControlStatus status) {
+  size_t n = controlResultJson(r, status, gatewayId.load(), nowMs(), resultJson, sizeof(resultJson));
+  bool ok = publishGateway(p, resultJson, n);
+  LOG_D("[CTRL] %s a %u seq=%u: %s (%u/%u)%s", controlTypeName((ControlType)r.type), r.target, r.seq,
+        controlStatusName(status), r.answered, r.expected, ok ? "" : " (sin publicar)");
+}
+
+// Publicador 0: suma la respuesta a su pedido; la trama se publica igual
+void trackReply(Publisher& p, const MeshReplyFrame& f) {
+  ControlType type = controlClassify(f.payload, f.len);
+  controlTracker.reply(type, f.nodeId, controlUint(f.payload, f.len, "seq"), f.rxMs,
+                       [&](const ControlRequest& r, ControlStatus s) { publishControlResult(p, r, s); });
+}
+
+void answerTopology(Publisher& p, const char* etag) {
+  bool same = *etag && topology.matches(etag);
+  size_t n = same ? topology.writeUnchanged(gatewayId.load(), topoJson, sizeof(topoJson))
+                  : topology.writeSnapshot(gatewayId.load(), topoJson, sizeof(topoJson));
+  publishGateway(p, topoJson, n);
+}
+
+// Corre dentro de mosquitto_loop() del publicador 0: como mqttCallback en el ESP32
+void onControl(mosquitto*, void* ctx, const mosquitto_message* m) {
+  Publisher& p = *static_cast<Publisher*>(ctx);
+  const char* msg = static_cast<const char*>(m->payload);
+  size_t len = (size_t)m->payloadlen;
+  LOG_D("MQTT Control recibido: %s", logSpan(msg, len));
+  char etag[TOPO_ETAG_MAX];
+  if (gatewayTopologyRequest(msg, len, gatewayId.load(), etag)) {
+    answerTopology(p, etag);
+    return;
+  }
+  if (!gatewayControlValid(msg, len)) {
+    LOG_W("[COLA] Control de %u bytes descartado", (unsigned)len);
+    return;
+  }
+  ControlFrame* c = controlQueue.claim();
+  if (!c) {
+    LOG_W("[COLA] Cola de control llena, comando descartado");
+    return;
+  }
+  ControlType type = controlClassify(msg, len);
+  uint32_t to = controlUint(msg, len, "to");
+  uint32_t seq = controlUint(msg, len, "seq");
+  uint16_t expected = controlExpected(type, to, topology.current().count);
+  switch (controlTracker.request(type, to, seq, expected, nowMs())) {
+    case CONTROL_DUPLICATE:
+      LOG_D("[CTRL] %s a %u seq=%u repetido, no se reenvía", controlTypeName(type), to, seq);
+      return;  // el slot reclamado queda libre sin commit()
+    case CONTROL_RATE_LIMITED: {
+      LOG_W("[CTRL] %s a %u descartado: límite del destino", controlTypeName(type), to);
+      ControlRequest r = {};
+      r.type = type;
+      r.target = to;
+      r.seq = seq;
+      r.sentMs = nowMs();
+      r.expected = expected;
+      publishControlResult(p, r, CONTROL_LIMITED);
+      return;
+    }
+    default:
+      break;
+  }
+  gatewayControlFrame(msg, len, nowUs(), *c);
+  controlQueue.commit();
+}
+
+void onConnect(mosquitto* client, void* ctx, int rc) {
+  Publisher& p = *static_cast<Publisher*>(ctx);
+  if (rc != 0) return;
+  p.connected = true;
+  p.backoff = MQTT_BACKOFF_MIN_MS;
+  if (p.index == 0) mosquitto_subscribe(client, nullptr, MQTT_TOPIC_CONTROL, 0);
+  LOG_I("[MQTT] Publicador %u conectado a %s:%u", p.index, opts.broker.c_str(), (unsigned)opts.mqttPort);
+}
+
+void onDisconnect(mosquitto*, void* ctx, int rc) {
+  Publisher& p = *static_cast<Publisher*>(ctx);
+  if (!p.connected) return;
+  LOG_W("[MQTT] Publicador %u desconectado (rc=%d)", p.index, rc);
+  p.connected = false;
+  p.nextAttempt = nowMs() + MQTT_BACKOFF_MIN_MS;
+}
+
+// Reconexión con backoff exponencial y jitter, como mqttService() del ESP32.
+// Bloquea sólo a este publicador.
+void mqttService(Publisher& p, std::mt19937& rng) {
+  if (p.connected || (int32_t)(nowMs() - p.nextAttempt) < 0) return;
+  p.stats.reconnects++;
+  int rc = p.attempted ? mosquitto_reconnect(p.client)
+                       : mosquitto_connect(p.client, opts.broker.c_str(), opts.mqttPort, MQTT_KEEPALIVE_S);
+  p.attempted = true;
+  if (rc == MOSQ_ERR_SUCCESS) {
+    p.nextAttempt = nowMs() + MQTT_CONNACK_WAIT_MS;  // onConnect llega con el CONNACK
+    return;
+  }
+  uint32_t wait = p.backoff / 2 + rng() % (p.backoff / 2 + 1);
+  p.nextAttempt = nowMs() + wait;
+  LOG_W("[MQTT] Publicador %u: %s, reintento en %u ms", p.index, mosquitto_strerror(rc), wait);
+  p.backoff = std::min<uint32_t>(p.backoff * 2, MQTT_BACKOFF_MAX_MS);
+}
+
+// Igual que forwardMeshFrames() del ESP32: el carril de control primero y,
+// con tramas de datos retenidas, las nuevas se encolan detrás para conservar
+// el orden
+size_t forwardLane(Publisher& p) {
+  size_t n = 0;
+  for (;; n++) {
+    if (MeshReplyFrame* r = p.lanes.frontReply()) {
+      trackReply(p, *r);  // sólo el publicador 0 tiene carril de control
+      bool sent = false;
+      if (p.connected) {
+        char extra[GATEWAY_STAMP_MAX];
+        snprintf(extra, sizeof(extra), "\"gw_rx\":%u,\"gw_out\":%u", r->rxNodeUs,
+                 r->rxNodeUs + (nowUs() - r->rxUs));
+        sent = publishFrame(p, r->nodeId, r->payload, r->len, extra);
+        p.published(LANE_CONTROL, sent, nowUs() - r->rxUs);
+      }
+      // Una respuesta más larga que STORE_PAYLOAD_MAX no se retiene
+      if (!sent) p.store.push(r->nodeId, r->rxMs, r->payload, r->len);
+      p.lanes.release(LANE_CONTROL);
+      continue;
+    }
+    MeshFrame* f = p.lanes.frontData();
+    if (!f) return n;
+    bool sent = false;
+    if (p.connected && p.store.empty()) {
+      sent = publishFrame(p, f->nodeId, f->payload, f->len, nullptr);
+      p.published(LANE_DATA, sent, nowUs() - f->rxUs);
+    }
+    if (!sent) p.store.push(f->nodeId, f->rxMs, f->payload, f->len);
+    p.lanes.release(LANE_DATA);
+  }
+}
+
+void drainStore(Publisher& p) {
+  for (int i = 0; i < STORE_DRAIN_BURST && p.connected && !p.store.empty() && !p.lanes.controlPending(); i++) {
+    auto* f = p.store.front();
+    uint32_t ageMs = nowMs() - f->rxMs;
+    char extra[24];
+    snprintf(extra, sizeof(extra), "\"age_ms\":%u", ageMs);
+    bool ok = publishFrame(p, f->nodeId, f->payload, f->len, extra);
+    p.published(LANE_DATA, ok, ageMs < UINT32_MAX / 1000 ? ageMs * 1000 : UINT32_MAX);
+    if (!ok) return;
+    p.store.pop();
+  }
+}
+
+// Publicador 0: la foto del mesh con la latencia de publish() de todos los
+// publicadores. Sin MQTT la foto se descarta y los contadores siguen sumando
+void publishMetricsSnapshot(Publisher& p) {
+  while (MetricsSnapshot* s = metricsQueue.front()) {
+    PublishMetrics all;
+    uint32_t storeDepth = 0;
+    for (auto& q : publishers) {
+      std::lock_guard<std::mutex> g(q->metrics.lock);
+      all.merge(q->metrics.pub);
+      storeDepth += q->metrics.storeDepth;
+    }
+    HeapSample heap = {};
+    size_t n = gatewayMetricsJson(*s, all, heap, storeDepth, gatewayId.load(), metricsJson, sizeof(metricsJson));
+    if (n && publishRaw(p, MQTT_TOPIC_METRICS, metricsJson, n)) {
+      for (auto& q : publishers) {
+        std::lock_guard<std::mutex> g(q->metrics.lock);
+        q->metrics.pub.reset();
+      }
+    }
+    metricsQueue.release();
+  }
+}
+
+// Sólo el publicador 0: pedidos de control, topología, SEQ_STATS, métricas y
+// reporte de la gateway
+void gatewayDuties(Publisher& p) {
+  controlTracker.expire(nowMs(), [&](const ControlRequest& r, ControlStatus s) { publishControlResult(p, r, s); });
+  publishMetricsSnapshot(p);
+  while (TopoSnapshot* s = topoQueue.front()) {
+    bool changed = topology.update(*s);
+    topoQueue.release();
+    if (!changed) continue;
+    publishGateway(p, topoJson, topology.writeDiff(gatewayId.load(), topoJson, sizeof(topoJson)));
+    LOG_I("[TOPO] Versión %u: %u nodos", topology.version(), (unsigned)topology.current().count + 1);
+  }
+  while (SeqReport* r = seqQueue.front()) {
+    SeqTotals t;
+    publishGateway(p, seqJson, gatewaySeqStatsJson(*r, gatewayId.load(), seqJson, sizeof(seqJson), t));
+    LOG_I("[SEQ] nodos=%u recibidas=%u perdidas=%u repetidas=%u", (unsigned)r->tracked, t.received, t.lost,
+          t.duplicates);
+    seqQueue.release();
+  }
+  if (!p.connected || nowMs() - lastStatusReport < STATUS_REPORT_MS) return;
+  lastStatusReport = nowMs();
+  char ip[INET_ADDRSTRLEN] = "0.0.0.0";
+  ifaddrs* ifs = nullptr;
+  if (getifaddrs(&ifs) == 0) {
+    for (ifaddrs* i = ifs; i; i = i->ifa_next) {
+      if (!i->ifa_addr || i->ifa_addr->sa_family != AF_INET) continue;
+      auto* in = reinterpret_cast<sockaddr_in*>(i->ifa_addr);
+      if (ntohl(in->sin_addr.s_addr) >> 24 == 127) continue;
+      inet_ntop(AF_INET, &in->sin_addr, ip, sizeof(ip));
+      break;
+    }
+    freeifaddrs(ifs);
+  }
+  char etag[TOPO_ETAG_MAX];
+  topology.etag(etag, topology.version());
+  char json[256];
+  int n = snprintf(json, sizeof(json),
+                   "{\"nodeId\":\"gateway\",\"ip\":\"%s\",\"nodes\":%u,\"ttf_ms\":%u,\"rejoin\":\"linux\","
+                   "\"topo\":\"%s\",\"publishers\":%u}",
+                   ip, sharedNodeCount.load(), firstPublishMs.load(), etag, (unsigned)publishers.size());
+  if (n > 0 && (size_t)n < sizeof(json)) publishRaw(p, MQTT_TOPIC_GATEWAY, json, n);
+}
+
+void publisherLoop(Publisher& p) {
+  std::mt19937 rng(p.index * 7919u + nowUs());
+  uint32_t lastStatus = nowMs();
+  while (running.load()) {
+    mqttService(p, rng);
+    size_t work = forwardLane(p);
+    drainStore(p);
+    if (p.index == 0) gatewayDuties(p);
+    // Lee CONNACK/SUBACK/control y escribe lo pendiente; sin tramas espera
+    // a lo sumo PUBLISHER_IDLE_MS en el socket
+    int rc = p.attempted ? mosquitto_loop(p.client, work ? 0 : PUBLISHER_IDLE_MS, 1) : MOSQ_ERR_NO_CONN;
+    if (rc != MOSQ_ERR_SUCCESS) {
+      onDisconnect(p.client, &p, rc);
+      std::this_thread::sleep_for(std::chrono::milliseconds(PUBLISHER_IDLE_MS));
+    }
+
+    {
+      std::lock_guard<std::mutex> g(p.metrics.lock);
+      p.metrics.storeDepth = (uint32_t)p.store.size();
+    }
+
+    if (nowMs() - lastStatus > 30000) {
+      lastStatus = nowMs();
+      auto& st = p.store.stats();
+      LOG_I("[PUB %u] publicadas=%u fallos=%u carril lleno=%u retenidas=%u overflow=%u conexiones=%u", p.index,
+            p.stats.published.load(), p.stats.failures.load(), p.stats.laneFull.load(), (unsigned)p.store.size(),
+            st.overflow, p.stats.reconnects.load());
+      if (p.index == 0) {
+        const ControlTrackerStats& ct = controlTracker.stats();
+        LOG_I("[CTRL] abiertos=%u ok=%u parciales=%u vencidos=%u repetidos=%u limitados=%u sin_seguir=%u "
+              "huerfanas=%u resp_repetidas=%u sin_descartar=%u",
+              (unsigned)controlTracker.size(), ct.done, ct.partial, ct.timeouts, ct.duplicates, ct.limited,
+              ct.untracked, ct.orphans, ct.repeated, ct.unchecked);
+      }
+    }
+  }
+  mosquitto_disconnect(p.client);
+}
+
+// ---------- Hilo del mesh ----------
+
+void receivedCallback(uint32_t from, TSTRING& msg) {
+  LOG_D("Datos recibidos desde nodo %u: %s", from, msg.c_str());
+  meshMetrics.frame(from, msg.length(), nowMs());
+  ControlType type = controlClassify(msg.c_str(), msg.length());
+  GatewayLane lane = gatewayLane(type);
+  if (msg.length() > gatewayLaneMax(lane)) {
+    LOG_W("[COLA] Trama de %u descartada: %u bytes > %u", from, (unsigned)msg.length(),
+          (unsigned)gatewayLaneMax(lane));
+    return;
+  }
+  if (type == CTRL_DATA) {
+    uint32_t seq = 0;
+    SeqVerdict v = gatewayAcceptReading(seqTable, from, msg.c_str(), msg.length(), &seq);
+    if (v == SEQ_DUPLICATE) return;
+    if (v == SEQ_RESTART) LOG_I("[SEQ] Nodo %u reinició (seq=%u)", from, seq);
+  }
+  // Las respuestas de control van al carril prioritario del publicador 0, el
+  // que recibe los pedidos
+  Publisher& p = lane == LANE_CONTROL ? *publishers[0] : *publishers[from % publishers.size()];
+  uint32_t rxNodeUs = lane == LANE_CONTROL ? mesh.getNodeTime() : 0;
+  if (!p.lanes.push(lane, from, nowMs(), nowUs(), rxNodeUs, msg.c_str(), msg.length())) {
+    p.stats.laneFull++;
+    return;
+  }
+  meshMetrics.queueDepth(lane, p.lanes.size(lane));
+}
+
+// Cada METRICS_INTERVAL_MS copia la ventana para el publicador 0; los carriles
+// llenos se suman entre publicadores
+void reportMetrics() {
+  if (nowMs() - lastMetrics < METRICS_INTERVAL_MS) return;
+  MetricsSnapshot* s = metricsQueue.claim();
+  if (!s) return;  // el publicador 0 aún no publicó la anterior
+  lastMetrics = nowMs();
+  meshMetrics.snapshot(lastMetrics, *s);
+  for (auto& p : publishers) {
+    s->queueFull[LANE_DATA] += p->lanes.stats(LANE_DATA).failures;
+    s->queueFull[LANE_CONTROL] += p->lanes.stats(LANE_CONTROL).failures;
+  }
+  metricsQueue.commit();
+}
+
+void announceRoot() {
+  lastRootAnnounce = nowMs();
+  char msg[96];
+  if (!gatewayRootMessage(mesh.getNodeId(), meshClock.at(mesh.getNodeTime(), lastRootAnnounce), msg, sizeof(msg))) return;
+  mesh.sendBroadcast(TSTRING(msg));
+}
+
+void forwardControl() {
+  while (ControlFrame* c = controlQueue.front()) {
+    char buf[CONTROL_PAYLOAD_MAX + 48];
+    uint32_t gwTx = mesh.getNodeTime();
+    gatewayStampControl(*c, gwTx - (nowUs() - c->rxUs), gwTx, buf, sizeof(buf));
+    if (c->to == 0) {
+      mesh.sendBroadcast(TSTRING(buf));
+    } else {
+      mesh.sendSingle(c->to, TSTRING(buf));
+    }
+    controlQueue.release();
+  }
+}
+
+void meshHousekeeping() {
+  forwardControl();
+  if (topoDirty && nowMs() - topoChangedMs >= TOPO_SETTLE_MS) {
+    if (TopoSnapshot* s = topoQueue.claim()) {
+      TSTRING json = mesh.subConnectionJson();
+      topoParse(json.c_str(), json.length(), mesh.getNodeId(), *s);
+      topoQueue.commit();
+      topoDirty = false;
+    }
+  }
+  if (nowMs() - lastSeqReport >= SEQ_REPORT_MS) {
+    if (SeqReport* r = seqQueue.claim()) {
+      lastSeqReport = nowMs();
+      gatewaySeqReport(seqTable, *r);
+      seqQueue.commit();
+    }
+  }
+  reportMetrics();
+  if (nowMs() - lastRootAnnounce > ROOT_ANNOUNCE_MS) announceRoot();
+  sharedNodeCount.store(mesh.getNodeList().size());
+}
+
+// ---------- Arranque ----------
+
+void usage(const char* argv0) {
+  fprintf(stderr,
+          "uso: %s [--mesh-port N] [--connect host:puerto] [--node-id N]\n"
+          "          [--broker host] [--mqtt-port N] [--publishers N]\n",
+          argv0);
+}
+
+bool parseOptions(int argc, char** argv) {
+  static const option longOpts[] = {
+      {"mesh-port", required_argument, nullptr, 'm'}, {"connect", required_argument, nullptr, 'c'},
+      {"node-id", required_argument, nullptr, 'n'},   {"broker", required_argument, nullptr, 'b'},
+      {"mqtt-port", required_argument, nullptr, 'p'}, {"publishers", required_argument, nullptr, 'j'},
+      {"help", no_argument, nullptr, 'h'},            {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "m:c:n:b:p:j:h", longOpts, nullptr)) != -1) {
+    switch (c) {
+      case 'm': opts.meshPort = (uint16_t)atoi(optarg); break;
+      case 'c': opts.connect = optarg; break;
+      case 'n': opts.nodeId = (uint32_t)strtoul(optarg, nullptr, 10); break;
+      case 'b': opts.broker = optarg; break;
+      case 'p': opts.mqttPort = (uint16_t)atoi(optarg); break;
+      case 'j': opts.publishers = (unsigned)atoi(optarg); break;
+      default: return false;
+    }
+  }
+  return opts.publishers >= 1 && opts.publishers <= PUBLISHERS_MAX;
+}
+
+void onSignal(int) { running.store(false); }
+
+int main(int argc, char** argv) {
+  if (!parseOptions(argc, argv)) {
+    usage(argv[0]);
+    return 2;
+  }
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  std::thread logThread([] {
+    while (running.load()) {
+      if (!logDrain(LOG_SLOTS)) std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+  });
+  startMs = nowMs();
+  std::random_device rd;
+  uint32_t nodeId = opts.nodeId ? opts.nodeId : (rd() | 1);
+  LOG_I("=== INICIANDO GATEWAY LINUX === nodo %u, %u publicadores", nodeId, opts.publishers);
+
+  Log.setLogLevel(painlessmesh::logger::ERROR);
+  mesh.init(&scheduler, nodeId);
+  mesh.setRoot(true);
+  mesh.setContainsRoot(true);
+  mesh.onReceive(&receivedCallback);
+  mesh.onNewConnection([](uint32_t id) { LOG_I("Nueva conexión mesh, nodeId = %u", id); });
+  mesh.onChangedConnections([]() {
+    announceRoot();
+    topoDirty = true;
+    topoChangedMs = nowMs();
+  });
+  gatewayId.store(nodeId);
+  topology = MeshTopology(rd());
+
+  auto server = std::make_shared<AsyncServer>(ioService, opts.meshPort);
+  painlessmesh::tcp::initServer<MeshConnection, Mesh>(*server, mesh);
+  std::shared_ptr<AsyncClient> uplink;
+  if (!opts.connect.empty()) {
+    size_t colon = opts.connect.rfind(':');
+    std::string host = opts.connect.substr(0, colon);
+    uint16_t port = colon == std::string::npos ? MESH_PORT : (uint16_t)atoi(opts.connect.c_str() + colon + 1);
+    uplink = std::make_shared<AsyncClient>(ioService);
+    painlessmesh::tcp::connect<MeshConnection, Mesh>(*uplink, boost::asio::ip::address::from_string(host), port,
+                                                     mesh);
+    LOG_I("[MESH] Uniéndose a %s:%u", host.c_str(), (unsigned)port);
+  }
+
+  mosquitto_lib_init();
+  for (unsigned i = 0; i < opts.publishers; i++) {
+    publishers.emplace_back(new Publisher());
+    Publisher& p = *publishers.back();
+    p.index = i;
+    char id[48];
+    snprintf(id, sizeof(id), "LinuxGateway-%u-%u", nodeId, i);
+    p.client = mosquitto_new(id, true, &p);
+    mosquitto_connect_callback_set(p.client, onConnect);
+    mosquitto_disconnect_callback_set(p.client, onDisconnect);
+    if (i == 0) mosquitto_message_callback_set(p.client, onControl);
+  }
+  for (auto& p : publishers) p->thread = std::thread(publisherLoop, std::ref(*p));
+  LOG_I("Gateway configurado en el puerto %u - Esperando conexiones mesh...", (unsigned)opts.meshPort);
+
+  uint32_t lastLoopUs = nowUs();
+  lastMetrics = nowMs();
+  while (running.load()) {
+    uint32_t loopUs = nowUs();
+    meshMetrics.loopTime(loopUs - lastLoopUs);
+    lastLoopUs = loopUs;
+    size_t handlers = ioService.poll();
+    scheduler.execute();
+    meshHousekeeping();
+    if (!handlers) usleep(MESH_POLL_US);
+  }
+
+  LOG_I("Deteniendo gateway...");
+  for (auto& p : publishers) {
+    p->thread.join();
+    mosquitto_destroy(p->client);
+  }
+  mosquitto_lib_cleanup();
+  logThread.join();
+  logFlush();
+  return 0;
+}
@@ -0,0 +1,148 @@
+from __future__ import annotations
+
+import argparse
+import json
+import logging
+import sys
+from typing import Any, Dict, Iterable, List, Optional, Tuple
+
+
+logger = logging.getLogger("latencia_analisis")
+logger.setLevel(logging.INFO)
+handler = logging.StreamHandler(sys.stdout)
+handler.setFormatter(logging.Formatter("%(message)s"))
+logger.addHandler(handler)
+
+# Tramos de una respuesta de control, en orden. Los sellos gw_* / t_* / ts
+# son tiempo del mesh (us, uint32); srv_ms y bridge_ms, reloj de pared (ms).
+#   srv_ms -> gw_in     broker (bajada)  \
+#   gw_out -> bridge_ms broker (subida)  / juntos en "broker/backend"
+#   gw_in  -> gw_tx     cola de control en la gateway
+#   gw_tx  -> t_rx      mesh bajada (PING) o gw_tx -> ts[0] (TRACE)
+#   t_rx   -> t_tx      procesamiento en el nodo
+#   t_tx   -> gw_rx     mesh subida
+#   gw_rx  -> gw_out    cola de salida en la gateway (tarea MQTT)
+SEGMENTS = ["gateway entrada", "mesh bajada", "nodo", "mesh subida", "gateway salida", "broker/backend"]
+PERCENTILES = (50, 90, 99)
+
+
+def diff_us(later: int, earlier: int) -> int:
+    """Diferencia entre sellos uint32 con vuelta, como entero con signo."""
+    d = (later - earlier) & 0xFFFFFFFF
+    return d - (1 << 32) if d >= 1 << 31 else d
+
+
+def stamp(rec: Dict[str, Any], key: str) -> Optional[int]:
+    v = rec.get(key)
+    return int(v) if v else None
+
+
+def segments(rec: Dict[str, Any]) -> Tuple[Dict[str, float], List[Tuple[int, int, float]]]:
+    """Tramos en ms de una respuesta y, para TRACE_REPLY, (índice, nodo, ms) por salto."""
+    gw_in, gw_tx = stamp(rec, "gw_in"), stamp(rec, "gw_tx")
+    gw_rx, gw_out = stamp(rec, "gw_rx"), stamp(rec, "gw_out")
+    t_tx = stamp(rec, "t_tx")
+    hops_ms: List[Tuple[int, int, float]] = []
+
+    if rec.get("type") == "TRACE_REPLY" and rec.get("ts"):
+        hops, ts = rec.get("hops", []), rec["ts"]
+        prev = gw_tx
+        for i, (node, t) in enumerate(zip(hops, ts)):
+            if prev and t:
+                hops_ms.append((i, int(node), diff_us(t, prev) / 1000.0))
+            prev = t or None
+        first_rx, last_rx = (ts[0] or None), (ts[-1] or None)
+    else:
+        first_rx = last_rx = stamp(rec, "t_rx")
+
+    out: Dict[str, float] = {}
+    if gw_in and gw_tx:
+        out["gateway entrada"] = diff_us(gw_tx, gw_in) / 1000.0
+    if gw_tx and first_rx:
+        out["mesh bajada"] = diff_us(first_rx, gw_tx) / 1000.0
+    if last_rx and t_tx:
+        out["nodo"] = diff_us(t_tx, last_rx) / 1000.0
+    if t_tx and gw_rx:
+        out["mesh subida"] = diff_us(gw_rx, t_tx) / 1000.0
+    if gw_rx and gw_out:
+        out["gateway salida"] = diff_us(gw_out, gw_rx) / 1000.0
+    srv, bridge = stamp(rec, "srv_ms"), stamp(rec, "bridge_ms")
+    if srv and bridge and gw_in and gw_out:
+        total = ((bridge - srv) & 0xFFFFFFFF)
+        out["broker/backend"] = total - diff_us(gw_out, gw_in) / 1000.0
+    return out, hops_ms
+
+
+def percentile(sorted_values: List[float], p: float) -> float:
+    if not sorted_values:
+        return float("nan")
+    k = (len(sorted_values) - 1) * p / 100.0
+    lo = int(k)
+    hi = min(lo + 1, len(sorted_values) - 1)
+    return sorted_values[lo] + (sorted_values[hi] - sorted_values[lo]) * (k - lo)
+
+
+def print_table(title: str, rows: Iterable[Tuple[str, List[float]]]):
+    header = f"{'':<28}{'n':>6}" + "".join(f"{'p' + str(p):>10}" for p in PERCENTILES) + f"{'max':>10}"
+    logger.info("\n%s (ms)\n%s", title, header)
+    for name, values in rows:
+        v = sorted(values)
+        cols = "".join(f"{percentile(v, p):>10.2f}" for p in PERCENTILES)
+        logger.info("%-28s%6d%s%10.2f", name, len(v), cols, v[-1] if v else float("nan"))
+
+
+def load(path: str) -> List[Dict[str, Any]]:
+    records = []
+    with open(path, encoding="utf-8") as f:
+        for lineno, line in enumerate(f, 1):
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                rec = json.loads(line)
+            except json.JSONDecodeError:
+                logger.warning("Línea %d no es JSON, se omite", lineno)
+                continue
+            if rec.get("type") in ("PONG", "TRACE_REPLY"):
+                records.append(rec)
+    return records
+
+
+def parse_args():
+    p = argparse.ArgumentParser(
+        description="Percentiles de latencia por tramo, nodo y salto a partir del log de Puente.py --latency-log")
+    p.add_argument("log", help="Archivo JSONL con respuestas PONG/TRACE_REPLY")
+    p.add_argument("--por-nodo", action="store_true", help="Tabla adicional por nodo y tramo")
+    return p.parse_args()
+
+
+def main():
+    args = parse_args()
+    records = load(args.log)
+    if not records:
+        logger.info("No hay respuestas PONG/TRACE_REPLY en %s", args.log)
+        return
+
+    by_segment: Dict[str, List[float]] = {s: [] for s in SEGMENTS}
+    by_node: Dict[Tuple[str, str], List[float]] = {}
+    by_hop: Dict[Tuple[int, int], List[float]] = {}
+    for rec in records:
+        segs, hops = segments(rec)
+        node = str(rec.get("from", "?"))
+        for name, ms in segs.items():
+            by_segment[name].append(ms)
+            by_node.setdefault((node, name), []).append(ms)
+        for i, hop_node, ms in hops:
+            by_hop.setdefault((i, hop_node), []).append(ms)
+
+    logger.info("%d respuestas analizadas", len(records))
+    print_table("Por tramo", ((s, by_segment[s]) for s in SEGMENTS if by_segment[s]))
+    if args.por_nodo:
+        rows = sorted(by_node.items(), key=lambda kv: (kv[0][0], SEGMENTS.index(kv[0][1])))
+        print_table("Por nodo", ((f"{n} {s}", v) for (n, s), v in rows))
+    if by_hop:
+        print_table("TRACE por salto", ((f"salto {i} -> {n}", v) for (i, n), v in sorted(by_hop.items())))
+
+
+if __name__ == "__main__":
+    main()
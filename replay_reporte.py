@@ -0,0 +1,105 @@
+from __future__ import annotations
+
+import argparse
+import logging
+import sqlite3
+import sys
+from typing import Dict, List, Optional, Tuple
+
+
+logger = logging.getLogger("replay_reporte")
+logger.setLevel(logging.INFO)
+handler = logging.StreamHandler(sys.stdout)
+handler.setFormatter(logging.Formatter("%(message)s"))
+logger.addHandler(handler)
+
+# Dead-band por defecto de cada sensor (igual que deadband() en NODO_*.cpp)
+DEFAULT_DEADBANDS = {
+    "temperatura": 0.2,
+    "humedad": 1.0,
+    "light": 5.0,
+    "soil_moisture": 2.0,
+}
+
+# Tamaño aproximado por trama: SensorFrame en base64 y JSON equivalente
+FRAME_BYTES = {"bin": 28, "json": 75}
+
+
+def load_trace(db_path: str, campo: str) -> Dict[str, List[Tuple[int, float]]]:
+    """Lee (timestamp, valor) por nodo desde la tabla datos_sensor."""
+    conn = sqlite3.connect(db_path)
+    try:
+        rows = conn.execute(
+            f"SELECT nodeId, timestamp, {campo} FROM datos_sensor "
+            f"WHERE {campo} IS NOT NULL AND timestamp IS NOT NULL ORDER BY nodeId, timestamp"
+        ).fetchall()
+    finally:
+        conn.close()
+
+    trace: Dict[str, List[Tuple[int, float]]] = {}
+    for node_id, ts, value in rows:
+        trace.setdefault(node_id or "unknown", []).append((int(ts), float(value)))
+    return trace
+
+
+def replay(samples: List[Tuple[int, float]], deadband: float, heartbeat: int) -> Dict[str, int]:
+    """Aplica la misma decisión que MeshNodeRuntime::reportReason a una traza."""
+    counts = {"first": 0, "change": 0, "heartbeat": 0, "omitidas": 0}
+    last_value: Optional[float] = None
+    last_ts = 0
+    for ts, value in samples:
+        if last_value is None:
+            reason = "first"
+        elif abs(value - last_value) > deadband:
+            reason = "change"
+        elif ts - last_ts >= heartbeat:
+            reason = "heartbeat"
+        else:
+            counts["omitidas"] += 1
+            continue
+        counts[reason] += 1
+        last_value, last_ts = value, ts
+    return counts
+
+
+def parse_args():
+    p = argparse.ArgumentParser(description="Estima ahorro de send-on-change sobre lecturas grabadas")
+    p.add_argument("--db", default="instance/datos_sensores.db", help="Base SQLite con la tabla datos_sensor")
+    p.add_argument("--campo", default="temperatura", choices=sorted(DEFAULT_DEADBANDS), help="Columna a reproducir")
+    p.add_argument("--deadband", type=float, help="Dead-band (por defecto el del sensor)")
+    p.add_argument("--heartbeat", type=int, default=300, help="Silencio máximo en segundos")
+    p.add_argument("--formato", default="bin", choices=sorted(FRAME_BYTES), help="Formato de trama para estimar bytes")
+    return p.parse_args()
+
+
+def main():
+    args = parse_args()
+    deadband = args.deadband if args.deadband is not None else DEFAULT_DEADBANDS[args.campo]
+    trace = load_trace(args.db, args.campo)
+    if not trace:
+        logger.info("Sin lecturas de %s en %s", args.campo, args.db)
+        return
+
+    frame_bytes = FRAME_BYTES[args.formato]
+    total_in = total_out = 0
+    logger.info("campo=%s dead-band=%.2f heartbeat=%ds formato=%s", args.campo, deadband, args.heartbeat, args.formato)
+    for node_id, samples in sorted(trace.items()):
+        counts = replay(samples, deadband, args.heartbeat)
+        sent = len(samples) - counts["omitidas"]
+        total_in += len(samples)
+        total_out += sent
+        logger.info(
+            "  nodo %s: %d lecturas -> %d tramas (cambio=%d heartbeat=%d) %.1f%% menos",
+            node_id, len(samples), sent, counts["change"], counts["heartbeat"],
+            100.0 * (1 - sent / len(samples)),
+        )
+
+    saved = (total_in - total_out) * frame_bytes
+    logger.info(
+        "Total: %d -> %d tramas, %d bytes ahorrados de %d (%.1f%%)",
+        total_in, total_out, saved, total_in * frame_bytes, 100.0 * saved / (total_in * frame_bytes),
+    )
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,372 @@
+#pragma once
+
+// Arduino-ESP32 mínimo para el simulador del mesh (sim_mesh.cpp). No emula
+// el hardware: da a cada dispositivo virtual su reloj, su Serial, sus pines y
+// su ADC/DHT, todo sobre un reloj virtual común que avanza el simulador.
+//
+// - sim::Device es el contexto de un ESP32; sim::Use lo activa mientras corre
+//   su código. millis()/micros() cuentan desde su arranque.
+// - delay() no detiene el mundo: adelanta sólo el reloj del dispositivo,
+//   como si el resto hubiera seguido mientras él estaba bloqueado.
+// - Las tareas de FreeRTOS (xTaskCreatePinnedToCore) son corrutinas que el
+//   simulador retoma cuando vence su vTaskDelay(); el tiempo que "gastan"
+//   (publish() de MQTT) se carga con sim::charge() y corre su despertar.
+
+#ifndef ARDUINO
+#define ARDUINO 10819
+#endif
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define CHANGE 0x03
+#define SERIAL_8N1 0x800001c
+
+namespace sim {
+
+struct Device {
+  uint32_t index = 0;
+  const char *name = "";
+  uint64_t bootUs = 0;   // instante virtual del arranque
+  uint64_t skewUs = 0;   // delay() bloqueantes: adelanto del reloj propio
+  uint64_t busyUs = 0;   // tiempo gastado por la tarea que corre ahora
+  std::mt19937 rng{1};
+  bool verbose = false;  // imprime su Serial
+  std::string line;
+
+  // Periféricos
+  std::function<double(double sec)> adc;  // cuentas del ADC sin ruido
+  double adcNoise = 25.0;
+  double adcSpikes = 0.01;
+  float temperature = 22.0f;
+  float humidity = 55.0f;
+  double dhtErrors = 0.0;  // transacciones con checksum malo
+  bool gpsFix = false;
+  double lat = 0.0, lon = 0.0;
+  uint8_t pinLevel[40] = {};
+  bool inIsr = false;
+  uint32_t isrUs = 0;
+
+  std::map<std::string, std::vector<uint8_t>> nvs;  // Preferences
+};
+
+inline uint64_t &clockUs() {
+  static uint64_t t = 0;
+  return t;
+}
+
+inline Device &noDevice() {
+  static Device d;
+  return d;
+}
+
+inline Device *&current() {
+  static Device *d = nullptr;
+  return d;
+}
+
+inline Device &device() { return current() ? *current() : noDevice(); }
+
+struct Use {
+  Device *prev;
+  explicit Use(Device &d) : prev(current()) { current() = &d; }
+  ~Use() { current() = prev; }
+};
+
+inline uint64_t localUs() {
+  Device &d = device();
+  return clockUs() + d.skewUs + d.busyUs - d.bootUs;
+}
+
+// Costo de una operación bloqueante dentro de una tarea o del loop
+inline void charge(uint64_t us) { device().busyUs += us; }
+
+// Serial del dispositivo: sólo se imprime si es verbose
+inline void serialWrite(const uint8_t *buf, size_t n) {
+  Device &d = device();
+  if (!d.verbose) return;
+  for (size_t i = 0; i < n; i++) {
+    if (buf[i] != '\n') {
+      d.line += (char)buf[i];
+      continue;
+    }
+    printf("[%9.3f %s] %s\n", clockUs() / 1e6, d.name, d.line.c_str());
+    d.line.clear();
+  }
+}
+
+// ---------- Tareas de FreeRTOS como corrutinas ----------
+
+struct TaskStop {};
+
+struct CoTask {
+  void (*fn)(void *);
+  void *arg;
+  Device *device;
+  ucontext_t ctx;
+  std::vector<char> stack;
+  uint64_t wakeUs;
+  bool finished;
+};
+
+inline std::vector<CoTask *> &tasks() {
+  static std::vector<CoTask *> t;
+  return t;
+}
+inline CoTask *&running() {
+  static CoTask *t = nullptr;
+  return t;
+}
+inline ucontext_t &schedulerContext() {
+  static ucontext_t c;
+  return c;
+}
+inline bool &stopping() {
+  static bool s = false;
+  return s;
+}
+
+inline void taskEntry() {
+  CoTask *t = running();
+  try {
+    t->fn(t->arg);
+  } catch (TaskStop &) {
+  }
+  t->finished = true;
+  swapcontext(&t->ctx, &schedulerContext());
+}
+
+inline CoTask *startTask(void (*fn)(void *), void *arg, size_t stackBytes) {
+  CoTask *t = new CoTask{fn, arg, current(), {}, {}, clockUs(), false};
+  t->stack.resize(std::max<size_t>(stackBytes * 16, 256 * 1024));  // el host usa más pila que el ESP32
+  getcontext(&t->ctx);
+  t->ctx.uc_stack.ss_sp = t->stack.data();
+  t->ctx.uc_stack.ss_size = t->stack.size();
+  t->ctx.uc_link = nullptr;
+  makecontext(&t->ctx, taskEntry, 0);
+  tasks().push_back(t);
+  return t;
+}
+
+// Retoma las tareas cuyo vTaskDelay() venció
+inline void runTasks() {
+  for (CoTask *t : tasks()) {
+    if (t->finished || t->wakeUs > clockUs()) continue;
+    Use use(*t->device);
+    running() = t;
+    swapcontext(&schedulerContext(), &t->ctx);
+    running() = nullptr;
+    t->device->busyUs = 0;
+  }
+}
+
+// Al terminar: cada tarea sale de su vTaskDelay() con TaskStop
+inline void stopTasks() {
+  stopping() = true;
+  for (CoTask *t : tasks()) {
+    if (!t->finished) {
+      Use use(*t->device);
+      running() = t;
+      swapcontext(&schedulerContext(), &t->ctx);
+      running() = nullptr;
+    }
+    delete t;
+  }
+  tasks().clear();
+}
+
+inline void taskDelay(uint32_t ms) {
+  CoTask *t = running();
+  if (!t) {
+    device().skewUs += ms * 1000ULL;
+    return;
+  }
+  t->wakeUs = clockUs() + t->device->busyUs + ms * 1000ULL;
+  swapcontext(&t->ctx, &schedulerContext());
+  if (stopping()) throw TaskStop();
+}
+
+// ---------- DHT22 ----------
+
+// Genera la respuesta completa del sensor al liberar la línea: la ISR recibe
+// cada flanco con micros() del instante en que ocurriría
+inline void dhtWaveform(Device &d, uint8_t pin, void (*isr)(void *), void *arg) {
+  uint16_t h = (uint16_t)lroundf(d.humidity * 10);
+  int16_t tc = (int16_t)lroundf(fabsf(d.temperature) * 10);
+  uint8_t data[5] = {(uint8_t)(h >> 8), (uint8_t)h, (uint8_t)((tc >> 8) | (d.temperature < 0 ? 0x80 : 0)),
+                     (uint8_t)tc, 0};
+  data[4] = (uint8_t)(data[0] + data[1] + data[2] + data[3]);
+  if (std::uniform_real_distribution<double>(0, 1)(d.rng) < d.dhtErrors) data[4] ^= 0x01;
+
+  uint32_t t = (uint32_t)localUs() + 30;
+  auto edge = [&](uint8_t level, uint32_t after) {
+    t += after;
+    d.pinLevel[pin] = level;
+    d.inIsr = true;
+    d.isrUs = t;
+    isr(arg);
+    d.inIsr = false;
+  };
+  edge(LOW, 0);    // respuesta: 80 us en bajo
+  edge(HIGH, 80);  // y 80 us en alto
+  edge(LOW, 80);
+  for (int b = 0; b < 40; b++) {
+    bool one = data[b / 8] & (0x80 >> (b % 8));
+    edge(HIGH, 50);            // cada bit: 50 us en bajo
+    edge(LOW, one ? 70 : 26);  // y el alto dice el valor
+  }
+  edge(HIGH, 50);  // el sensor libera la línea
+}
+
+}  // namespace sim
+
+// ---------- API de Arduino ----------
+
+typedef uint8_t byte;
+
+using std::max;
+using std::min;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+
+enum adc_attenuation_t { ADC_0db, ADC_2_5db, ADC_6db, ADC_11db };
+
+inline unsigned long millis() { return (unsigned long)(uint32_t)(sim::localUs() / 1000); }
+inline unsigned long micros() {
+  sim::Device &d = sim::device();
+  return d.inIsr ? d.isrUs : (unsigned long)(uint32_t)sim::localUs();
+}
+inline void delay(uint32_t ms) { sim::device().skewUs += ms * 1000ULL; }
+inline void delayMicroseconds(uint32_t us) { sim::device().skewUs += us; }
+inline uint32_t esp_random() { return (uint32_t)sim::device().rng(); }
+
+inline void pinMode(uint8_t pin, uint8_t mode) {
+  if (mode == INPUT_PULLUP) sim::device().pinLevel[pin] = HIGH;
+}
+inline void digitalWrite(uint8_t pin, uint8_t val) { sim::device().pinLevel[pin] = val; }
+inline int digitalRead(uint8_t pin) { return sim::device().pinLevel[pin]; }
+inline void analogSetAttenuation(adc_attenuation_t) {}
+
+// Señal del dispositivo + ruido gaussiano + picos (rieles o caída por WiFi)
+inline uint16_t analogRead(uint8_t) {
+  sim::Device &d = sim::device();
+  double v = d.adc ? d.adc(sim::clockUs() / 1e6) : 0;
+  v += std::normal_distribution<double>(0, d.adcNoise)(d.rng);
+  std::uniform_real_distribution<double> u(0, 1);
+  if (u(d.rng) < d.adcSpikes) v = u(d.rng) < 0.5 ? 4095 : v * u(d.rng);
+  return (uint16_t)std::max(0.0, std::min(4095.0, v + 0.5));
+}
+
+// Sólo el DHT usa interrupciones: la transacción se genera al habilitarla
+inline void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int) {
+  sim::dhtWaveform(sim::device(), pin, isr, arg);
+}
+inline void detachInterrupt(uint8_t) {}
+
+class String {
+ public:
+  String() {}
+  String(const char *s) : s_(s ? s : "") {}
+  String(const std::string &s) : s_(s) {}
+  explicit String(int v) : s_(std::to_string(v)) {}
+  explicit String(unsigned v) : s_(std::to_string(v)) {}
+  explicit String(long v) : s_(std::to_string(v)) {}
+  explicit String(unsigned long v) : s_(std::to_string(v)) {}
+
+  const char *c_str() const { return s_.c_str(); }
+  unsigned length() const { return (unsigned)s_.size(); }
+  const std::string &str() const { return s_; }
+
+  String &operator+=(const String &o) {
+    s_ += o.s_;
+    return *this;
+  }
+  String &operator+=(const char *o) {
+    s_ += o;
+    return *this;
+  }
+  String &operator+=(char c) {
+    s_ += c;
+    return *this;
+  }
+  friend String operator+(const String &a, const String &b) { return String(a.s_ + b.s_); }
+  friend String operator+(const String &a, const char *b) { return String(a.s_ + b); }
+  friend String operator+(const char *a, const String &b) { return String(a + b.s_); }
+  bool operator==(const String &o) const { return s_ == o.s_; }
+
+ private:
+  std::string s_;
+};
+
+class HardwareSerial {
+ public:
+  explicit HardwareSerial(int port) : port_(port) {}
+  void begin(unsigned long, uint32_t = SERIAL_8N1, int8_t = -1, int8_t = -1) {}
+  size_t write(const uint8_t *buf, size_t n) {
+    if (port_ == 0) sim::serialWrite(buf, n);
+    return n;
+  }
+  size_t write(uint8_t c) { return write(&c, 1); }
+  void flush() {}
+  int available() { return 0; }  // el GPS no manda sentencias: TinyGPS++ lee del dispositivo
+  int read() { return -1; }
+
+ private:
+  int port_;
+};
+
+static HardwareSerial Serial(0);
+
+struct EspClass {
+  uint32_t getFreeHeap() { return 180000; }
+  uint32_t getMinFreeHeap() { return 150000; }
+  uint32_t getMaxAllocHeap() { return 110000; }
+};
+static EspClass ESP;
+
+// FreeRTOS (1 tick = 1 ms, como CONFIG_FREERTOS_HZ del ESP32)
+typedef sim::CoTask *TaskHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+#define pdPASS 1
+#define pdFAIL 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+inline void vTaskDelay(TickType_t ticks) { sim::taskDelay(ticks); }
+inline BaseType_t xTaskCreatePinnedToCore(void (*fn)(void *), const char *, uint32_t stack, void *arg, int,
+                                          TaskHandle_t *handle, int) {
+  sim::CoTask *t = sim::startTask(fn, arg, stack);
+  if (handle) *handle = t;
+  return pdPASS;
+}
+inline uint32_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+// Reloj RTC de MeshNodeRuntime::rtcUs(): el reloj virtual del dispositivo
+inline int simGettimeofday(struct timeval *tv, void *) {
+  uint64_t us = sim::localUs();
+  tv->tv_sec = (time_t)(us / 1000000);
+  tv->tv_usec = (suseconds_t)(us % 1000000);
+  return 0;
+}
+#define gettimeofday simGettimeofday
@@ -0,0 +1,117 @@
+#pragma once
+
+// ArduinoJson para el simulador: sólo lo que usan los sketches y la gateway
+// para armar mensajes (doc["k"] = v, createNestedObject, serializeJson). Las
+// claves salen en orden de inserción; reasignar una clave la reemplaza.
+
+#include <Arduino.h>
+
+#include <memory>
+
+namespace sim {
+
+struct JsonNode {
+  struct Entry {
+    std::string key;
+    std::string text;                 // valor ya serializado
+    std::shared_ptr<JsonNode> child;  // objeto anidado
+  };
+  std::vector<Entry> entries;
+
+  Entry &slot(const char *key) {
+    for (Entry &e : entries) {
+      if (e.key == key) return e;
+    }
+    entries.push_back(Entry{key, "null", nullptr});
+    return entries.back();
+  }
+
+  void write(std::string &out) const {
+    out += '{';
+    for (size_t i = 0; i < entries.size(); i++) {
+      if (i) out += ',';
+      out += '"';
+      out += entries[i].key;
+      out += "\":";
+      if (entries[i].child) {
+        entries[i].child->write(out);
+      } else {
+        out += entries[i].text;
+      }
+    }
+    out += '}';
+  }
+};
+
+inline std::string jsonString(const char *s) {
+  std::string out = "\"";
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') out += '\\';
+    out += *s;
+  }
+  return out + "\"";
+}
+
+inline std::string jsonNumber(const char *fmt, double v) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), fmt, v);
+  return buf;
+}
+
+inline std::string jsonText(const char *v) { return jsonString(v); }
+inline std::string jsonText(char *v) { return jsonString(v); }
+inline std::string jsonText(const String &v) { return jsonString(v.c_str()); }
+inline std::string jsonText(bool v) { return v ? "true" : "false"; }
+inline std::string jsonText(float v) { return jsonNumber("%.7g", v); }
+inline std::string jsonText(double v) { return jsonNumber("%.9g", v); }
+template <typename T>
+inline std::string jsonText(T v) {
+  return std::to_string(v);
+}
+
+}  // namespace sim
+
+class JsonVariant {
+ public:
+  JsonVariant(sim::JsonNode::Entry &e) : e_(e) {}
+  template <typename T>
+  JsonVariant &operator=(const T &v) {
+    e_.text = sim::jsonText(v);
+    e_.child.reset();
+    return *this;
+  }
+  JsonVariant &operator=(const char *v) {
+    e_.text = sim::jsonText(v);
+    e_.child.reset();
+    return *this;
+  }
+
+ private:
+  sim::JsonNode::Entry &e_;
+};
+
+class JsonObject {
+ public:
+  JsonObject(std::shared_ptr<sim::JsonNode> node = std::make_shared<sim::JsonNode>()) : node_(node) {}
+  JsonVariant operator[](const char *key) { return JsonVariant(node_->slot(key)); }
+  JsonObject createNestedObject(const char *key) {
+    sim::JsonNode::Entry &e = node_->slot(key);
+    e.child = std::make_shared<sim::JsonNode>();
+    return JsonObject(e.child);
+  }
+  const sim::JsonNode &node() const { return *node_; }
+
+ private:
+  std::shared_ptr<sim::JsonNode> node_;
+};
+
+template <size_t N>
+class StaticJsonDocument : public JsonObject {};
+
+template <size_t N>
+size_t serializeJson(const StaticJsonDocument<N> &doc, String &out) {
+  std::string s;
+  doc.node().write(s);
+  out = String(s);
+  return s.size();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+// NVS del ESP32 para el simulador: cada dispositivo guarda sus claves en
+// sim::Device::nvs ("<espacio>/<clave>"), así sobreviven a un reinicio simulado.
+
+#include <Arduino.h>
+
+class Preferences {
+ public:
+  bool begin(const char *name, bool readOnly = false) {
+    ns_ = std::string(name) + "/";
+    if (!readOnly) return true;
+    for (auto &kv : sim::device().nvs) {
+      if (kv.first.compare(0, ns_.size(), ns_) == 0) return true;
+    }
+    return false;  // como en el ESP32: el espacio aún no existe
+  }
+  void end() {}
+
+  size_t putBytes(const char *key, const void *value, size_t len) {
+    const uint8_t *p = (const uint8_t *)value;
+    sim::device().nvs[ns_ + key].assign(p, p + len);
+    return len;
+  }
+  size_t getBytes(const char *key, void *buf, size_t maxLen) {
+    auto &nvs = sim::device().nvs;
+    auto it = nvs.find(ns_ + key);
+    if (it == nvs.end() || it->second.size() > maxLen) return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+
+ private:
+  std::string ns_;
+};
@@ -0,0 +1,179 @@
+#pragma once
+
+// PubSubClient para el simulador, contra un broker local (sim::Broker) en
+// vez de un socket. Respeta lo que condiciona a la gateway:
+//
+// - publish() falla si cabecera + tópico + payload superan el buffer
+//   (256 bytes salvo setBufferSize()), igual que la librería.
+// - beginPublish()/write()/endPublish() escriben sin ese límite.
+// - Cada publish() y connect() consumen tiempo de la tarea que los llama
+//   (sim::charge): con el broker caído, connect() bloquea el timeout del socket.
+// - Los mensajes a tópicos suscritos se entregan en loop() con un buffer
+//   propio del cliente, que el callback puede modificar.
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#include <deque>
+
+#define MQTT_MAX_HEADER_SIZE 5
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+namespace sim {
+
+struct BrokerMessage {
+  uint64_t atUs;  // llegada al broker (reloj global)
+  std::string topic;
+  std::string payload;
+};
+
+struct Broker {
+  bool up = true;
+  uint32_t publishMinUs = 1500;  // publish() en la tarea MQTT, ida al socket
+  uint32_t publishMaxUs = 2500;
+  uint32_t connectUs = 30000;
+  std::vector<std::string> subscribed;     // de la gateway
+  std::deque<BrokerMessage> toGateway;     // publicados por el servidor
+  std::vector<BrokerMessage> fromGateway;  // publicados por la gateway; los consume el simulador
+  uint32_t epoch = 0;                      // cambia en cada caída: corta las sesiones
+
+  static Broker &get() {
+    static Broker b;
+    return b;
+  }
+
+  void setUp(bool on) {
+    if (up && !on) {
+      epoch++;
+      toGateway.clear();
+    }
+    up = on;
+  }
+
+  // Lo que publica app.py: se pierde si la gateway no está suscrita (QoS 0)
+  void publishToGateway(const std::string &topic, const std::string &payload) {
+    if (!up) return;
+    for (auto &s : subscribed) {
+      if (s == topic) toGateway.push_back(BrokerMessage{clockUs(), topic, payload});
+    }
+  }
+};
+
+}  // namespace sim
+
+class PubSubClient {
+ public:
+  typedef std::function<void(char *, uint8_t *, unsigned int)> Callback;
+
+  explicit PubSubClient(WiFiClient &) {}
+
+  PubSubClient &setServer(const char *, uint16_t) { return *this; }
+  PubSubClient &setCallback(Callback cb) {
+    callback_ = cb;
+    return *this;
+  }
+  PubSubClient &setSocketTimeout(uint16_t s) {
+    socketTimeoutS_ = s;
+    return *this;
+  }
+  bool setBufferSize(uint16_t size) {
+    bufferSize_ = size;
+    return true;
+  }
+  uint16_t getBufferSize() const { return bufferSize_; }
+
+  bool connect(const char *) {
+    sim::Broker &b = sim::Broker::get();
+    if (!sim::stationIp() || !b.up) {
+      sim::charge(socketTimeoutS_ * 1000000ULL);
+      state_ = MQTT_CONNECTION_TIMEOUT;
+      return false;
+    }
+    sim::charge(b.connectUs);
+    epoch_ = b.epoch;
+    connected_ = true;
+    state_ = MQTT_CONNECTED;
+    return true;
+  }
+
+  bool connected() {
+    sim::Broker &b = sim::Broker::get();
+    if (connected_ && (!b.up || b.epoch != epoch_)) {
+      connected_ = false;
+      state_ = MQTT_CONNECTION_LOST;
+      b.subscribed.clear();
+    }
+    return connected_;
+  }
+
+  int state() const { return state_; }
+
+  bool subscribe(const char *topic) {
+    if (!connected()) return false;
+    sim::Broker::get().subscribed.push_back(topic);
+    return true;
+  }
+
+  bool loop() {
+    if (!connected()) return false;
+    sim::Broker &b = sim::Broker::get();
+    while (!b.toGateway.empty() && connected_) {
+      sim::BrokerMessage m = b.toGateway.front();
+      b.toGateway.pop_front();
+      if (m.payload.size() + m.topic.size() + MQTT_MAX_HEADER_SIZE + 2 > bufferSize_) continue;
+      std::vector<char> topic(m.topic.begin(), m.topic.end());
+      topic.push_back('\0');
+      std::vector<uint8_t> payload(m.payload.begin(), m.payload.end());
+      payload.push_back(0);
+      if (callback_) callback_(topic.data(), payload.data(), (unsigned)m.payload.size());
+    }
+    return true;
+  }
+
+  bool publish(const char *topic, const uint8_t *payload, unsigned int len, bool = false) {
+    if (!connected()) return false;
+    if (MQTT_MAX_HEADER_SIZE + 2 + strlen(topic) + len > bufferSize_) return false;
+    send(topic, std::string((const char *)payload, len));
+    return true;
+  }
+  bool publish(const char *topic, const char *payload, bool retained = false) {
+    return publish(topic, (const uint8_t *)payload, (unsigned)strlen(payload), retained);
+  }
+
+  bool beginPublish(const char *topic, unsigned int, bool) {
+    if (!connected()) return false;
+    streamTopic_ = topic;
+    stream_.clear();
+    return true;
+  }
+  size_t write(const uint8_t *buf, size_t len) {
+    stream_.append((const char *)buf, len);
+    return len;
+  }
+  int endPublish() {
+    if (!connected()) return 0;
+    send(streamTopic_.c_str(), stream_);
+    return 1;
+  }
+
+ private:
+  void send(const char *topic, const std::string &payload) {
+    sim::Broker &b = sim::Broker::get();
+    sim::Device &d = sim::device();
+    sim::charge(std::uniform_int_distribution<uint32_t>(b.publishMinUs, b.publishMaxUs)(d.rng));
+    b.fromGateway.push_back(sim::BrokerMessage{sim::clockUs() + d.busyUs, topic, payload});
+  }
+
+  Callback callback_;
+  uint16_t bufferSize_ = 256;
+  uint16_t socketTimeoutS_ = 15;
+  bool connected_ = false;
+  uint32_t epoch_ = 0;
+  int state_ = MQTT_DISCONNECTED;
+  std::string streamTopic_;
+  std::string stream_;
+};
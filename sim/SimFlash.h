@@ -0,0 +1,39 @@
+#pragma once
+
+// Flash NOR en RAM con la interfaz de EspPartitionFlash (ReadingLog.h), que
+// fuera del ESP32 no existe: borrar deja 0xFF y escribir sólo baja bits.
+
+#include "../ReadingLog.h"
+
+#define READING_LOG_PARTITION "sim"
+#ifndef READING_LOG_SECTORS
+#define READING_LOG_SECTORS 16
+#endif
+
+class EspPartitionFlash {
+ public:
+  bool begin() {
+    if (mem_.empty()) mem_.assign(READING_LOG_SECTORS * READING_LOG_SECTOR_SIZE, 0xFF);
+    return true;
+  }
+  size_t sectorCount() const { return mem_.size() / READING_LOG_SECTOR_SIZE; }
+  bool read(uint32_t addr, void *buf, size_t len) {
+    if (addr + len > mem_.size()) return false;
+    memcpy(buf, &mem_[addr], len);
+    return true;
+  }
+  bool write(uint32_t addr, const void *buf, size_t len) {
+    if (addr + len > mem_.size()) return false;
+    const uint8_t *p = (const uint8_t *)buf;
+    for (size_t i = 0; i < len; i++) mem_[addr + i] &= p[i];
+    return true;
+  }
+  bool erase(uint32_t sector) {
+    if ((sector + 1) * READING_LOG_SECTOR_SIZE > mem_.size()) return false;
+    memset(&mem_[sector * READING_LOG_SECTOR_SIZE], 0xFF, READING_LOG_SECTOR_SIZE);
+    return true;
+  }
+
+ private:
+  std::vector<uint8_t> mem_;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+// TinyGPS++ para el simulador: no hay sentencias NMEA (Serial2 no entrega
+// bytes); la posición sale de sim::Device (gpsFix, lat, lon).
+
+#include <Arduino.h>
+
+class TinyGPSLocation {
+ public:
+  bool isValid() const { return sim::device().gpsFix; }
+  double lat() const { return sim::device().lat; }
+  double lng() const { return sim::device().lon; }
+};
+
+class TinyGPSInteger {
+ public:
+  uint32_t value() const { return sim::device().gpsFix ? 7 : 0; }
+};
+
+class TinyGPSPlus {
+ public:
+  bool encode(char) { return false; }
+  uint32_t charsProcessed() const { return 0; }
+  TinyGPSLocation location;
+  TinyGPSInteger satellites;
+};
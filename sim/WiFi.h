@@ -0,0 +1,146 @@
+#pragma once
+
+// WiFi del ESP32 para el simulador: estado por dispositivo (canal, BSSID del
+// padre, IP por DHCP, escaneos) y eventos de Arduino. Los eventos se entregan
+// desde mesh.update() del dispositivo, como haría la tarea de eventos.
+//
+// - scanNetworks() síncrono (MeshRejoin.h) bloquea lo que duraría el barrido
+//   y ve el router y, si el root ya arrancó, el SSID del mesh.
+// - scanNetworks(true) (WifiScan.h) termina a los SIM_SCAN_MS con SCAN_DONE.
+// - stationManual() de la gateway obtiene IP a los SIM_DHCP_MS.
+
+#include <Arduino.h>
+
+#define SIM_WIFI_CHANNEL 6
+#define SIM_SCAN_MS 2000
+#define SIM_DHCP_MS 3000
+#define SIM_ROUTER_SSID "Doo"
+#define SIM_MESH_SSID "RED_Nodos"
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+enum wifi_mode_t { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA };
+
+enum WiFiEvent_t {
+  ARDUINO_EVENT_WIFI_STA_START,
+  ARDUINO_EVENT_WIFI_STA_CONNECTED,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+  ARDUINO_EVENT_WIFI_SCAN_DONE,
+};
+struct WiFiEventInfo_t {};
+
+class IPAddress {
+ public:
+  IPAddress(uint32_t a = 0) : a_(a) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : a_(a | b << 8 | c << 16 | (uint32_t)d << 24) {}
+  operator uint32_t() const { return a_; }
+  bool operator==(const IPAddress &o) const { return a_ == o.a_; }
+  bool operator!=(const IPAddress &o) const { return a_ != o.a_; }
+  String toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", a_ & 0xff, (a_ >> 8) & 0xff, (a_ >> 16) & 0xff, a_ >> 24);
+    return String(buf);
+  }
+
+ private:
+  uint32_t a_;
+};
+
+class WiFiClient {};
+
+namespace sim {
+
+struct WifiNetEntry {
+  std::string ssid;
+  int32_t rssi;
+  uint8_t channel;
+};
+
+struct WifiState {
+  uint8_t bssid[6] = {};
+  uint64_t ipAtUs = 0;       // instante en que DHCP entrega la IP (0 = sin pedir)
+  bool ipReported = false;
+  uint64_t scanDoneUs = 0;   // escaneo asíncrono en curso hasta este instante
+  bool scanning = false;
+  std::vector<WifiNetEntry> nets;
+  std::vector<std::function<void(WiFiEvent_t, WiFiEventInfo_t)>> handlers;
+};
+
+inline std::map<Device *, WifiState> &wifiStates() {
+  static std::map<Device *, WifiState> m;
+  return m;
+}
+inline WifiState &wifi() { return wifiStates()[&device()]; }
+
+// El root del mesh ya emite su SSID (lo marca la red simulada)
+inline bool &meshOnAir() {
+  static bool on = false;
+  return on;
+}
+
+inline void wifiEvent(WifiState &w, WiFiEvent_t e) {
+  for (auto &h : w.handlers) h(e, WiFiEventInfo_t{});
+}
+
+// Desde mesh.update(): IP obtenida y escaneos terminados
+inline void wifiDispatch() {
+  WifiState &w = wifi();
+  uint64_t now = clockUs();
+  if (w.ipAtUs && !w.ipReported && now >= w.ipAtUs) {
+    w.ipReported = true;
+    wifiEvent(w, ARDUINO_EVENT_WIFI_STA_CONNECTED);
+    wifiEvent(w, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  }
+  if (w.scanning && now >= w.scanDoneUs) {
+    w.scanning = false;
+    wifiEvent(w, ARDUINO_EVENT_WIFI_SCAN_DONE);
+  }
+}
+
+inline uint32_t stationIp() {
+  WifiState &w = wifi();
+  return w.ipAtUs && clockUs() >= w.ipAtUs ? (uint32_t)IPAddress(10, 21, 139, 50) : 0;
+}
+
+}  // namespace sim
+
+class WiFiClass {
+ public:
+  bool mode(wifi_mode_t) { return true; }
+  bool setSleep(bool) { return true; }
+  void onEvent(std::function<void(WiFiEvent_t, WiFiEventInfo_t)> cb) { sim::wifi().handlers.push_back(cb); }
+  void onEvent(void (*cb)(WiFiEvent_t, WiFiEventInfo_t)) { sim::wifi().handlers.push_back(cb); }
+  uint8_t channel() { return SIM_WIFI_CHANNEL; }
+  uint8_t *BSSID() { return sim::wifi().bssid; }
+  IPAddress localIP() { return IPAddress(sim::stationIp()); }
+
+  int16_t scanNetworks(bool async = false, bool = false, bool = false, uint32_t msPerChan = 300, uint8_t channel = 0,
+                       const char *ssid = nullptr, const uint8_t * = nullptr) {
+    sim::WifiState &w = sim::wifi();
+    w.nets.clear();
+    if (!ssid || strcmp(ssid, SIM_ROUTER_SSID) == 0) w.nets.push_back({SIM_ROUTER_SSID, -55, SIM_WIFI_CHANNEL});
+    if (sim::meshOnAir() && (!ssid || strcmp(ssid, SIM_MESH_SSID) == 0)) {
+      w.nets.push_back({SIM_MESH_SSID, -62, SIM_WIFI_CHANNEL});
+    }
+    if (channel && channel != SIM_WIFI_CHANNEL) w.nets.clear();
+    if (async) {
+      w.scanning = true;
+      w.scanDoneUs = sim::clockUs() + SIM_SCAN_MS * 1000ULL;
+      return WIFI_SCAN_RUNNING;
+    }
+    delay((channel ? 1 : 13) * msPerChan);
+    return (int16_t)w.nets.size();
+  }
+  int16_t scanComplete() {
+    sim::WifiState &w = sim::wifi();
+    return w.scanning ? WIFI_SCAN_RUNNING : (int16_t)w.nets.size();
+  }
+  String SSID(int i) { return String(sim::wifi().nets.at(i).ssid); }
+  int32_t RSSI(int i) { return sim::wifi().nets.at(i).rssi; }
+  int32_t channel(int i) { return sim::wifi().nets.at(i).channel; }
+  void scanDelete() { sim::wifi().nets.clear(); }
+};
+
+static WiFiClass WiFi;
@@ -0,0 +1,552 @@
+#pragma once
+
+// painlessMesh (y el subconjunto de TaskScheduler que trae) para el
+// simulador. Cada SimMesh es el extremo de un dispositivo en una red común
+// (sim::Network) con el reloj virtual:
+//
+// - Topología: árbol fijo (parent[i] < i, el 0 es la gateway). Un nodo se une
+//   a su padre tras el tiempo de asociación, si el padre ya está unido; si no,
+//   reintenta. Un enlace se puede cortar y restablecer (particiones).
+// - Cada salto es un evento: cola por enlace (bits / kbps), latencia con
+//   jitter y pérdida por salto. Por enlace se conserva el orden, como en la
+//   conexión TCP de painlessMesh. Un corte descarta lo que iba en vuelo.
+// - sendSingle() sigue el árbol (sube hasta el ancestro común y baja) y
+//   devuelve false si el destino no está en la componente; sendBroadcast()
+//   inunda la componente.
+// - Los mensajes, newConnection y changedConnections se entregan dentro de
+//   update() del dispositivo. changedConnections llega a toda la componente
+//   afectada tras changedMs y se agrupa si hay varios cambios seguidos.
+// - getNodeTime() es el reloj global más un error de sincronía fijo por nodo.
+// - asNodeTree() de un nodo sólo contiene al root si es alcanzable: lo único
+//   que busca MeshNodeRuntime en él. subConnectionJson() arma el árbol real.
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#include <deque>
+#include <list>
+#include <memory>
+#include <queue>
+
+// ---------- TaskScheduler ----------
+
+#define TASK_MILLISECOND 1UL
+#define TASK_SECOND 1000UL
+#define TASK_MINUTE 60000UL
+#define TASK_FOREVER (-1)
+#define TASK_ONCE 1
+
+class Task {
+ public:
+  Task(unsigned long interval, long iterations, std::function<void()> cb)
+      : interval_(interval), iterations_(iterations), cb_(cb) {}
+
+  // Como TaskScheduler: enable() corre en la próxima pasada, delay()
+  // cuenta desde ahora y setInterval() reinicia el período
+  void enable() {
+    enabled_ = true;
+    delay_ = interval_;
+    prevMs_ = millis() - delay_;
+  }
+  void disable() { enabled_ = false; }
+  bool isEnabled() const { return enabled_; }
+  void delay(unsigned long d = 0) {
+    delay_ = d ? d : interval_;
+    prevMs_ = millis();
+  }
+  void setInterval(unsigned long interval) {
+    interval_ = interval;
+    delay();
+  }
+  unsigned long getInterval() const { return interval_; }
+
+  void run() {
+    if (!enabled_ || iterations_ == 0) return;
+    uint32_t now = millis();
+    if (now - prevMs_ < delay_) return;
+    if (iterations_ > 0) iterations_--;
+    prevMs_ += delay_;
+    delay_ = interval_;
+    cb_();
+  }
+
+ private:
+  unsigned long interval_;
+  long iterations_;
+  std::function<void()> cb_;
+  bool enabled_ = false;
+  uint32_t prevMs_ = 0;
+  uint32_t delay_ = 0;
+};
+
+class Scheduler {
+ public:
+  void addTask(Task &t) { tasks_.push_back(&t); }
+  void deleteTask(Task &t) { tasks_.erase(std::remove(tasks_.begin(), tasks_.end(), &t), tasks_.end()); }
+  void execute() {
+    for (size_t i = 0; i < tasks_.size(); i++) tasks_[i]->run();
+  }
+
+ private:
+  std::vector<Task *> tasks_;
+};
+
+// ---------- painlessMesh ----------
+
+enum MeshDebugType { ERROR = 1, STARTUP = 2, CONNECTION = 4, SYNC = 8, COMMUNICATION = 16, GENERAL = 32 };
+
+struct NodeTree {
+  uint32_t nodeId = 0;
+  bool root = false;
+  std::list<NodeTree> subs;
+};
+
+class SimMesh;
+
+namespace sim {
+
+struct MeshConfig {
+  uint32_t latencyUs = 3000;  // por salto, sin la transmisión
+  uint32_t jitterUs = 2000;
+  uint32_t kbps = 1000;       // TCP sobre WiFi entre ESP32, efectivo
+  double loss = 0.0;          // probabilidad de perder un mensaje por salto
+  uint32_t envelope = 64;     // JSON de painlessMesh + TCP/IP por mensaje
+  uint32_t assocMinMs = 1500;  // asociación con el AP del padre
+  uint32_t assocMaxMs = 4000;
+  uint32_t retryMinMs = 1000;  // padre aún sin unir: reintento
+  uint32_t retryMaxMs = 3000;
+  uint32_t syncErrUs = 1000;   // error de getNodeTime() por nodo, +-
+  uint32_t changedMs = 100;    // propagación de changedConnections
+};
+
+enum MeshDrop { DROP_LOSS, DROP_LINK, DROP_ROUTE, DROP_COUNT };
+
+struct MeshMessage {
+  uint32_t from;
+  uint32_t dest;  // 0 = broadcast
+  std::string payload;
+  uint64_t sentUs;
+};
+
+struct MeshStats {
+  uint64_t originated;      // mensajes enviados por algún dispositivo
+  uint64_t transmissions;   // saltos
+  uint64_t bytes;           // en el aire, con envoltura
+  uint64_t drops[DROP_COUNT];
+  uint64_t noRoute;         // sendSingle() sin camino (devuelve false)
+};
+
+class Network {
+ public:
+  MeshConfig cfg;
+  MeshStats stats = {};
+  // Ganchos del simulador
+  std::function<void(const MeshMessage &)> onOriginate;
+  std::function<void(const MeshMessage &, MeshDrop)> onDrop;
+
+  static Network &get() {
+    static Network n;
+    return n;
+  }
+
+  // parent[i] < i para i > 0; parent[0] = -1 (la gateway)
+  void setTree(const std::vector<int> &parent, uint32_t seed) {
+    size_t n = parent.size();
+    parent_ = parent;
+    children_.assign(n, {});
+    for (size_t i = 1; i < n; i++) children_[parent[i]].push_back((int)i);
+    depth_.assign(n, 0);
+    for (size_t i = 1; i < n; i++) depth_[i] = depth_[parent[i]] + 1;
+    tin_.assign(n, 0);
+    tout_.assign(n, 0);
+    int t = 0;
+    euler(0, t);
+    mesh_.assign(n, nullptr);
+    joined_.assign(n, false);
+    linkUp_.assign(n, true);
+    comp_.resize(n);
+    for (size_t i = 0; i < n; i++) comp_[i] = (int)i;
+    members_.clear();
+    syncErr_.assign(n, 0);
+    busyUs_.assign(2 * n, 0);
+    lastArrivalUs_.assign(2 * n, 0);
+    linkTx_.assign(n, 0);
+    rng_.seed(seed);
+  }
+
+  size_t size() const { return parent_.size(); }
+  int parent(int i) const { return parent_[i]; }
+  int depth(int i) const { return depth_[i]; }
+  bool joined(int i) const { return joined_[i]; }
+  bool linkUp(int i) const { return linkUp_[i]; }
+  uint64_t linkTx(int i) const { return linkTx_[i]; }
+
+  static uint32_t nodeIdOf(int slot) { return (uint32_t)(slot + 1) * 2654435761u ^ 0x5bd1e995u; }
+  int slotOf(uint32_t nodeId) const {
+    auto it = slots_.find(nodeId);
+    return it == slots_.end() ? -1 : it->second;
+  }
+  SimMesh *mesh(int slot) const { return mesh_[slot]; }
+
+  // ¿El nodo alcanza a la gateway? (componente del slot 0)
+  bool reachesRoot(int slot) const { return comp_[slot] == comp_[0] && (slot == 0 || joined_[slot]); }
+  bool sameComponent(int a, int b) const { return comp_[a] == comp_[b]; }
+  const std::vector<uint32_t> &members(int slot) {
+    static const std::vector<uint32_t> none;
+    auto it = members_.find(comp_[slot]);
+    return it == members_.end() ? none : it->second;
+  }
+
+  inline void attach(SimMesh *m, int slot);
+  inline void setLink(int slot, bool up);
+  inline void run(uint64_t nowUs);
+  inline bool unicast(int from, uint32_t dest, const std::string &payload);
+  inline void broadcast(int from, const std::string &payload);
+  inline std::string subConnectionJson(int slot);
+
+ private:
+  enum EventKind { EV_HOP, EV_JOIN };
+  struct Event {
+    uint64_t atUs;
+    uint64_t order;
+    EventKind kind;
+    int to;
+    int from;
+    std::shared_ptr<MeshMessage> msg;
+    bool operator<(const Event &o) const { return atUs != o.atUs ? atUs > o.atUs : order > o.order; }
+  };
+
+  void euler(int i, int &t) {
+    tin_[i] = t++;
+    for (int c : children_[i]) euler(c, t);
+    tout_[i] = t++;
+  }
+  bool ancestor(int a, int b) const { return tin_[a] <= tin_[b] && tout_[b] <= tout_[a]; }
+  bool active(int child) const { return joined_[child] && linkUp_[child]; }
+
+  uint32_t uniform(uint32_t lo, uint32_t hi) { return std::uniform_int_distribution<uint32_t>(lo, hi)(rng_); }
+
+  void push(uint64_t at, EventKind kind, int to, int from, std::shared_ptr<MeshMessage> msg) {
+    events_.push(Event{at, order_++, kind, to, from, msg});
+  }
+
+  int nextHop(int at, int dest) const {
+    if (!ancestor(at, dest)) return parent_[at];
+    int n = dest;
+    while (parent_[n] != at) n = parent_[n];
+    return n;
+  }
+
+  inline void drop(const MeshMessage &m, MeshDrop why);
+  inline void hop(int from, int to, std::shared_ptr<MeshMessage> msg, uint64_t nowUs);
+  inline void arrive(const Event &e, uint64_t nowUs);
+  inline void tryJoin(int slot, uint64_t nowUs);
+  inline void topologyChanged(int a, int b, uint64_t nowUs);
+
+  std::vector<int> parent_, depth_, tin_, tout_, comp_;
+  std::vector<std::vector<int>> children_;
+  std::vector<SimMesh *> mesh_;
+  std::vector<bool> joined_, linkUp_;
+  std::vector<int32_t> syncErr_;
+  std::vector<uint64_t> busyUs_, lastArrivalUs_, linkTx_;
+  std::map<int, std::vector<uint32_t>> members_;
+  std::map<uint32_t, int> slots_;
+  std::priority_queue<Event> events_;
+  uint64_t order_ = 0;
+  std::mt19937 rng_;
+
+  friend class ::SimMesh;
+};
+
+// El tiempo del mesh no empieza en 0 y getNodeTime() (uint32) da la vuelta a
+// los 60 s simulados: las corridas cortas también cruzan una vuelta
+const uint64_t kMeshEpochUs = 287ULL * 0x100000000ULL - 60000000ULL;
+
+}  // namespace sim
+
+class SimMesh {
+ public:
+  void setDebugMsgTypes(uint16_t) {}
+
+  void init(String, String, Scheduler *scheduler, uint16_t, wifi_mode_t = WIFI_AP_STA, uint8_t = 1) {
+    scheduler_ = scheduler;
+    device_ = &sim::device();
+    sim::Network::get().attach(this, (int)device_->index);
+  }
+
+  void onReceive(std::function<void(uint32_t, String &)> cb) { onReceive_ = cb; }
+  void onNewConnection(std::function<void(uint32_t)> cb) { onNew_ = cb; }
+  void onChangedConnections(std::function<void()> cb) { onChanged_ = cb; }
+
+  void setRoot(bool on = true) { root_ = on; }
+  void setContainsRoot(bool = true) {}
+  void setHostname(const char *) {}
+  void stationManual(String, String) { sim::wifi().ipAtUs = sim::clockUs() + SIM_DHCP_MS * 1000ULL; }
+  IPAddress getStationIP() { return IPAddress(sim::stationIp()); }
+
+  uint32_t getNodeId() const { return nodeId_; }
+  uint32_t getNodeTime() const {
+    return (uint32_t)(sim::clockUs() + sim::kMeshEpochUs + sim::Network::get().syncErr_[slot_]);
+  }
+  bool isRoot() const { return root_; }
+
+  std::vector<uint32_t> getNodeList(bool includeSelf = false) {
+    sim::Network &net = sim::Network::get();
+    if (!attached()) return {};
+    const std::vector<uint32_t> &all = net.members(slot_);
+    if (includeSelf) return all;
+    std::vector<uint32_t> out;
+    out.reserve(all.size());
+    for (uint32_t id : all) {
+      if (id != nodeId_) out.push_back(id);
+    }
+    return out;
+  }
+
+  bool isConnected(uint32_t nodeId) {
+    sim::Network &net = sim::Network::get();
+    int s = net.slotOf(nodeId);
+    return attached() && s >= 0 && s != slot_ && net.sameComponent(slot_, s) && net.joined(s);
+  }
+
+  NodeTree asNodeTree() {
+    NodeTree t;
+    t.nodeId = nodeId_;
+    t.root = root_;
+    sim::Network &net = sim::Network::get();
+    if (!root_ && attached() && net.reachesRoot(slot_)) {
+      NodeTree r;
+      r.nodeId = net.mesh(0)->getNodeId();
+      r.root = true;
+      t.subs.push_back(r);
+    }
+    return t;
+  }
+
+  String subConnectionJson(bool = false) { return String(sim::Network::get().subConnectionJson(slot_)); }
+
+  bool sendSingle(uint32_t dest, String &msg) {
+    return attached() && sim::Network::get().unicast(slot_, dest, msg.str());
+  }
+  bool sendBroadcast(String &msg, bool = false) {
+    if (!attached()) return false;
+    sim::Network::get().broadcast(slot_, msg.str());
+    return true;
+  }
+
+  // Eventos de WiFi, conexiones, mensajes y el scheduler del usuario
+  void update() {
+    sim::wifiDispatch();
+    while (!newConns_.empty()) {
+      uint32_t id = newConns_.front();
+      newConns_.pop_front();
+      if (onNew_) onNew_(id);
+    }
+    if (changedPending_ && sim::clockUs() >= changedAtUs_) {
+      changedPending_ = false;
+      if (onChanged_) onChanged_();
+    }
+    while (!inbox_.empty()) {
+      std::pair<uint32_t, std::string> m = std::move(inbox_.front());
+      inbox_.pop_front();
+      String s(m.second);
+      if (onReceive_) onReceive_(m.first, s);
+    }
+    if (scheduler_) scheduler_->execute();
+  }
+
+  size_t inboxSize() const { return inbox_.size(); }
+
+ private:
+  bool attached() const { return slot_ >= 0; }
+
+  void notifyChanged(uint64_t atUs) {
+    if (changedPending_ && changedAtUs_ <= atUs) return;
+    changedPending_ = true;
+    changedAtUs_ = atUs;
+  }
+
+  Scheduler *scheduler_ = nullptr;
+  sim::Device *device_ = nullptr;
+  int slot_ = -1;
+  uint32_t nodeId_ = 0;
+  bool root_ = false;
+  std::function<void(uint32_t, String &)> onReceive_;
+  std::function<void(uint32_t)> onNew_;
+  std::function<void()> onChanged_;
+  std::deque<std::pair<uint32_t, std::string>> inbox_;
+  std::deque<uint32_t> newConns_;
+  bool changedPending_ = false;
+  uint64_t changedAtUs_ = 0;
+
+  friend class sim::Network;
+};
+
+typedef SimMesh painlessMesh;
+
+namespace sim {
+
+inline void Network::attach(SimMesh *m, int slot) {
+  m->slot_ = slot;
+  m->nodeId_ = nodeIdOf(slot);
+  mesh_[slot] = m;
+  slots_[m->nodeId_] = slot;
+  syncErr_[slot] = slot ? (int32_t)uniform(0, 2 * cfg.syncErrUs) - (int32_t)cfg.syncErrUs : 0;
+  uint64_t now = clockUs();
+  if (slot == 0) {
+    joined_[0] = true;  // el root arma el mesh
+    meshOnAir() = true;
+    topologyChanged(0, 0, now);
+    return;
+  }
+  push(now + uniform(cfg.assocMinMs, cfg.assocMaxMs) * 1000ULL, EV_JOIN, slot, -1, nullptr);
+}
+
+inline void Network::tryJoin(int slot, uint64_t nowUs) {
+  int p = parent_[slot];
+  if (!mesh_[p] || !joined_[p]) {
+    push(nowUs + uniform(cfg.retryMinMs, cfg.retryMaxMs) * 1000ULL, EV_JOIN, slot, -1, nullptr);
+    return;
+  }
+  joined_[slot] = true;
+  // El BSSID que MeshRejoin guarda: el del AP del padre
+  uint32_t pid = nodeIdOf(p);
+  uint8_t *bssid = wifiStates()[mesh_[slot]->device_].bssid;
+  bssid[0] = 0x24;
+  bssid[1] = 0x0a;
+  memcpy(bssid + 2, &pid, 4);
+  if (linkUp_[slot]) topologyChanged(slot, p, nowUs);
+}
+
+inline void Network::setLink(int slot, bool up) {
+  if (linkUp_[slot] == up) return;
+  linkUp_[slot] = up;
+  if (joined_[slot]) topologyChanged(slot, parent_[slot], clockUs());
+}
+
+// Recalcula las componentes y avisa a las dos afectadas (una, si se unieron)
+inline void Network::topologyChanged(int a, int b, uint64_t nowUs) {
+  size_t n = size();
+  for (size_t i = 0; i < n; i++) {
+    comp_[i] = (i == 0 || !active((int)i)) ? (int)i : comp_[parent_[i]];
+  }
+  members_.clear();
+  for (size_t i = 0; i < n; i++) {
+    if (mesh_[i] && (i == 0 || joined_[i])) members_[comp_[i]].push_back(nodeIdOf((int)i));
+  }
+  for (auto &kv : members_) std::sort(kv.second.begin(), kv.second.end());
+
+  int ca = comp_[a], cb = comp_[b];
+  for (size_t i = 0; i < n; i++) {
+    if (mesh_[i] && (comp_[i] == ca || comp_[i] == cb)) mesh_[i]->notifyChanged(nowUs + cfg.changedMs * 1000ULL);
+  }
+  if (a != b && active(a)) {
+    mesh_[a]->newConns_.push_back(nodeIdOf(b));
+    mesh_[b]->newConns_.push_back(nodeIdOf(a));
+  }
+}
+
+inline void Network::drop(const MeshMessage &m, MeshDrop why) {
+  stats.drops[why]++;
+  if (onDrop) onDrop(m, why);
+}
+
+// Un salto: espera a que el enlace se libere, transmite y llega tras la
+// latencia; nunca antes que el mensaje anterior por el mismo enlace
+inline void Network::hop(int from, int to, std::shared_ptr<MeshMessage> msg, uint64_t nowUs) {
+  int child = parent_[to] == from ? to : from;
+  if (!active(child)) return drop(*msg, DROP_LINK);
+  size_t dir = 2 * (size_t)child + (to == child ? 1 : 0);
+  uint32_t bytes = (uint32_t)msg->payload.size() + cfg.envelope;
+  uint64_t txUs = bytes * 8ULL * 1000 / cfg.kbps;
+  uint64_t start = std::max(nowUs, busyUs_[dir]);
+  busyUs_[dir] = start + txUs;
+  stats.transmissions++;
+  stats.bytes += bytes;
+  linkTx_[child]++;
+  if (cfg.loss > 0 && std::uniform_real_distribution<double>(0, 1)(rng_) < cfg.loss) return drop(*msg, DROP_LOSS);
+  uint64_t at = start + txUs + cfg.latencyUs + uniform(0, cfg.jitterUs);
+  if (at <= lastArrivalUs_[dir]) at = lastArrivalUs_[dir] + 1;
+  lastArrivalUs_[dir] = at;
+  push(at, EV_HOP, to, from, msg);
+}
+
+inline void Network::arrive(const Event &e, uint64_t nowUs) {
+  int child = parent_[e.to] == e.from ? e.to : e.from;
+  const MeshMessage &m = *e.msg;
+  if (!active(child)) return drop(m, DROP_LINK);  // el enlace cayó con el mensaje en vuelo
+  int origin = slotOf(m.from);
+  if (m.dest == 0) {
+    if (e.to != origin) mesh_[e.to]->inbox_.emplace_back(m.from, m.payload);
+    for (int n : children_[e.to]) {
+      if (n != e.from && active(n)) hop(e.to, n, e.msg, nowUs);
+    }
+    if (e.to != 0 && parent_[e.to] != e.from && active(e.to)) hop(e.to, parent_[e.to], e.msg, nowUs);
+    return;
+  }
+  int dest = slotOf(m.dest);
+  if (e.to == dest) {
+    mesh_[dest]->inbox_.emplace_back(m.from, m.payload);
+    return;
+  }
+  if (!sameComponent(e.to, dest)) return drop(m, DROP_ROUTE);
+  hop(e.to, nextHop(e.to, dest), e.msg, nowUs);
+}
+
+inline void Network::run(uint64_t nowUs) {
+  while (!events_.empty() && events_.top().atUs <= nowUs) {
+    Event e = events_.top();
+    events_.pop();
+    if (e.kind == EV_JOIN) {
+      tryJoin(e.to, e.atUs);
+    } else {
+      arrive(e, e.atUs);
+    }
+  }
+}
+
+inline bool Network::unicast(int from, uint32_t dest, const std::string &payload) {
+  int to = slotOf(dest);
+  if (to < 0 || to == from || !sameComponent(from, to) || !joined_[to] || (from && !joined_[from])) {
+    stats.noRoute++;
+    return false;
+  }
+  auto msg = std::make_shared<MeshMessage>(MeshMessage{nodeIdOf(from), dest, payload, clockUs()});
+  stats.originated++;
+  if (onOriginate) onOriginate(*msg);
+  hop(from, nextHop(from, to), msg, clockUs());
+  return true;
+}
+
+inline void Network::broadcast(int from, const std::string &payload) {
+  auto msg = std::make_shared<MeshMessage>(MeshMessage{nodeIdOf(from), 0, payload, clockUs()});
+  stats.originated++;
+  if (onOriginate) onOriginate(*msg);
+  uint64_t now = clockUs();
+  for (int n : children_[from]) {
+    if (active(n)) hop(from, n, msg, now);
+  }
+  if (from != 0 && active(from)) hop(from, parent_[from], msg, now);
+}
+
+// Como painlessMesh: {"nodeId":N,"root":true,"subs":[{"nodeId":M,"subs":[...]}]}
+inline std::string Network::subConnectionJson(int slot) {
+  std::string out;
+  std::function<void(int)> node = [&](int i) {
+    out += "{\"nodeId\":" + std::to_string(nodeIdOf(i));
+    if (i == 0) out += ",\"root\":true";
+    out += ",\"subs\":[";
+    bool first = true;
+    for (int c : children_[i]) {
+      if (!mesh_[c] || !active(c)) continue;
+      if (!first) out += ',';
+      first = false;
+      node(c);
+    }
+    out += "]}";
+  };
+  node(slot);
+  return out;
+}
+
+}  // namespace sim
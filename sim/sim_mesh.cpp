@@ -0,0 +1,628 @@
+// Simulador del mesh en el host: compila GATEWAY.cpp y las políticas de
+// sensor de los NODO_*.cpp sin cambios, contra las capas de sim/ (Arduino,
+// painlessMesh, WiFi, PubSubClient, ArduinoJson, TinyGPS++, NVS y flash) con
+// un reloj virtual, y corre cientos de nodos en un proceso más rápido que el
+// tiempo real.
+//
+//   g++ -O2 -std=c++11 -Isim sim/sim_mesh.cpp -o sim_mesh && ./sim_mesh [opciones]
+//
+//   --nodes N         nodos sensores, sin la gateway (500)
+//   --fanout K        hijos por nodo en el árbol (4): el padre del nodo i es (i-1)/K
+//   --duration-s S    tiempo simulado (600); después 10 s sin nodos para vaciar lo que va en vuelo
+//   --scenario X      base | lossy | partition | outage
+//   --loss P          pérdida por salto en lossy (0.01)
+//   --ping-ms T       un PING (y cada 5, un TRACE) desde el "servidor" cada T ms (1000)
+//   --boot-spread-s S los nodos arrancan al azar en [0, S) (30)
+//   --seed N
+//   --verbose I       imprime el Serial del dispositivo I (0 = gateway; -DLOG_LEVEL=3 para ver INFO)
+//
+// Escenarios:
+//   base       enlaces sin pérdida. Falla si se pierde o se repite alguna lectura.
+//   lossy      pérdida por salto (en painlessMesh sería un corte de la conexión
+//              TCP): toda lectura perdida debe tener causa y SEQ_STATS no debe
+//              inferir más pérdidas que las reales.
+//   partition  se corta el enlace de la rama más grande con la gateway a
+//              0.4 * duración durante 120 s. Los nodos aislados guardan en
+//              flash (ReadingLog.h) y reenvían al volver; sólo se pierde lo
+//              que iba en vuelo al cortar.
+//   outage     el broker cae a 0.4 * duración durante 60 s. La gateway retiene
+//              en FrameStore; lo que no entra se cuenta como overflow y debe
+//              explicar toda la pérdida.
+//
+// El reporte trae lecturas generadas (por seq de cada nodo), publicadas,
+// repetidas y perdidas por causa, latencia de nodo a broker, PING/TRACE,
+// tráfico del mesh y los contadores de la gateway. Sale con 1 si falla una
+// comprobación del escenario.
+//
+// Límites: el árbol es fijo (un nodo no cambia de padre), la pérdida es de
+// mensajes y no hay reinicios de nodos ni deep sleep (NODE_SLEEP_MODE 0).
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 2  // LOG_LEVEL_WARN: con 500 nodos el INFO es ruido
+#endif
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include <PubSubClient.h>
+#include <TinyGPS++.h>
+#include <WiFi.h>
+#include <painlessMesh.h>
+
+#include <chrono>
+#include <unordered_map>
+
+#include "SimFlash.h"
+#include "../AdcFilter.h"
+#include "../ControlDispatch.h"
+#include "../DeferredLog.h"
+#include "../DhtReader.h"
+#include "../FrameStore.h"
+#include "../MeshNodeRuntime.h"
+#include "../MeshRejoin.h"
+#include "../MeshTopology.h"
+#include "../MqttReconnect.h"
+#include "../SensorFrame.h"
+#include "../SeqWindow.h"
+#include "../SpscQueue.h"
+#include "../WifiScan.h"
+
+// Firmware tal cual: cada archivo en su espacio de nombres. De los sketches
+// sólo se usan las políticas de sensor; sus setup()/loop() manejan un único
+// nodo global y aquí hay uno por dispositivo.
+namespace gw {
+#include "../GATEWAY.cpp"
+}
+namespace temperatura {
+#include "../NODO_TEMPERATURA.cpp"
+}
+namespace humedad {
+#include "../NODO_HUMEDAD.cpp"
+}
+namespace luz {
+#include "../NODO_LUZ.cpp"
+}
+namespace suelo {
+#include "../NODO_HUM_SUELO.cpp"
+}
+
+static int failed = 0;
+
+#define CHECK(cond, ...)             \
+  do {                               \
+    if (!(cond)) {                   \
+      printf("FALLO: " __VA_ARGS__); \
+      printf("\n");                  \
+      failed++;                      \
+    }                                \
+  } while (0)
+
+#define NODE_TICK_MS 10  // cada nodo corre loop() cada 10 ms; la gateway cada 1 ms
+#define QUIESCE_MS 10000
+#define PARTITION_S 120
+#define OUTAGE_S 60
+#define PI_F 3.14159265f
+
+struct Options {
+  uint32_t nodes = 500;
+  uint32_t fanout = 4;
+  uint32_t durationS = 600;
+  std::string scenario = "base";
+  double loss = 0.01;
+  uint32_t pingMs = 1000;
+  uint32_t bootSpreadS = 30;
+  uint32_t seed = 1;
+  int verbose = -1;
+};
+
+// ---------- Nodos ----------
+
+struct SimNode {
+  virtual ~SimNode() {}
+  virtual void begin() = 0;
+  virtual void update() = 0;
+  virtual uint16_t seq() const = 0;
+};
+
+template <typename Sensor>
+struct SensorNode : SimNode {
+  MeshNodeRuntime<Sensor> rt;
+  void begin() override { rt.begin(Sensor::name()); }
+  void update() override { rt.update(); }
+  uint16_t seq() const override { return rt.seq(); }
+};
+
+struct Device {
+  sim::Device dev;
+  SimNode *node = nullptr;  // nullptr en la gateway
+  uint64_t bootUs = 0;
+  uint64_t nextUs = 0;
+  bool booted = false;
+  float phase = 0;  // fase de las señales del ambiente
+};
+
+// Señales lentas con ruido: suficientes para que el dead-band deje pasar
+// una parte de los muestreos, como en el campo
+static void environment(Device &d) {
+  double t = sim::clockUs() / 1e6;
+  d.dev.temperature = 22.0f + 3.0f * sinf(2 * PI_F * (float)(t / 600.0) + d.phase);
+  d.dev.humidity = 55.0f + 10.0f * sinf(2 * PI_F * (float)(t / 900.0) + d.phase);
+}
+
+// El Serial de un dispositivo sólo se formatea si se imprime
+static void drainLog() {
+  if (sim::device().verbose) {
+    logFlush();
+    return;
+  }
+  deferredlog::Ring &ring = deferredlog::ring();
+  while (deferredlog::Record *r = ring.front()) ring.release(r);
+}
+
+// ---------- Contabilidad ----------
+
+enum LossCause { LOST_LINK, LOST_HOP, LOST_ROUTE, LOST_NO_ROOT, LOST_GATEWAY, LOST_UNSENT, LOST_CAUSES };
+static const char *const kLossNames[] = {"enlace caído", "pérdida por salto", "sin ruta",
+                                         "broadcast sin root", "en la gateway", "sin enviar (flash)"};
+
+struct Reading {
+  uint64_t sentUs = 0;  // primer envío al mesh
+  bool sent = false;
+  bool unicast = false;
+  bool backfill = false;
+  int8_t drop = -1;  // MeshDrop del último descarte
+  uint8_t published = 0;
+};
+
+typedef gw::LogHistogram<4, 32> Histogram;
+
+struct Tracker {
+  std::unordered_map<uint64_t, Reading> readings;  // (slot << 16) | seq
+  Histogram latencyUs;                              // lecturas en vivo: envío -> broker
+  Histogram backfillAgeMs;                          // node_age_ms de las reenviadas
+  uint32_t duplicates = 0;
+  uint32_t joins = 0;
+  uint32_t rootAnnounces = 0;
+  std::map<std::string, uint32_t> gatewayTypes;
+  uint32_t metrics = 0;
+
+  std::map<uint32_t, uint64_t> pings, traces;  // seq -> envío
+  Histogram pingUs, traceUs;
+  uint32_t pingsSent = 0, tracesSent = 0, pongs = 0, traceReplies = 0;
+};
+
+static Tracker track;
+
+static uint64_t readingKey(int slot, uint32_t seq) { return ((uint64_t)slot << 16) | (seq & 0xffff); }
+
+// Lectura contenida en un mensaje de un nodo: seq y si es un reenvío del log
+static bool parseReading(const std::string &p, uint32_t &seq, bool &backfill) {
+  const char *m = p.c_str();
+  size_t len = p.size();
+  if (len && m[0] == '#') {
+    SensorFrame f;
+    if (!decodeSensorFrame(m, len, f)) return false;
+    seq = f.seq;
+    backfill = false;
+    return true;
+  }
+  if (controlClassify(m, len) != CTRL_DATA || !controlHas(m, len, "seq")) return false;
+  seq = controlUint(m, len, "seq");
+  backfill = controlHas(m, len, "node_age_ms");
+  return true;
+}
+
+static void onOriginate(const sim::MeshMessage &m) {
+  sim::Network &net = sim::Network::get();
+  int slot = net.slotOf(m.from);
+  if (slot == 0) {
+    if (controlClassify(m.payload.c_str(), m.payload.size()) == CTRL_ROOT) track.rootAnnounces++;
+    return;
+  }
+  uint32_t seq;
+  bool backfill;
+  if (!parseReading(m.payload, seq, backfill)) return;
+  Reading &r = track.readings[readingKey(slot, seq)];
+  if (!r.sent) {
+    r.sent = true;
+    r.sentUs = m.sentUs;
+  }
+  r.backfill |= backfill;
+  r.unicast |= m.dest != 0;
+}
+
+static void onDrop(const sim::MeshMessage &m, sim::MeshDrop why) {
+  sim::Network &net = sim::Network::get();
+  int slot = net.slotOf(m.from);
+  uint32_t seq;
+  bool backfill;
+  if (slot <= 0 || !parseReading(m.payload, seq, backfill)) return;
+  Reading &r = track.readings[readingKey(slot, seq)];
+  // Un broadcast se descarta en ramas que no llevan al root: sólo cuenta
+  // si no llega; la causa se decide al final
+  r.drop = (int8_t)why;
+}
+
+static void consumeBroker() {
+  sim::Broker &b = sim::Broker::get();
+  sim::Network &net = sim::Network::get();
+  for (const sim::BrokerMessage &m : b.fromGateway) {
+    const char *p = m.payload.c_str();
+    size_t len = m.payload.size();
+    if (m.topic == MQTT_TOPIC_METRICS) {
+      track.metrics++;
+      continue;
+    }
+    if (m.topic == MQTT_TOPIC_GATEWAY) {
+      const char *v = controlField(p, len, "type");
+      const char *end = v && *v == '"' ? strchr(v + 1, '"') : nullptr;
+      track.gatewayTypes[end ? std::string(v + 1, end) : std::string("otros")]++;
+      continue;
+    }
+    if (m.topic.compare(0, strlen(MQTT_TOPIC "/"), MQTT_TOPIC "/") != 0) continue;
+    uint32_t from = (uint32_t)strtoul(m.topic.c_str() + strlen(MQTT_TOPIC "/"), nullptr, 10);
+    int slot = net.slotOf(from);
+    ControlType type = controlClassify(p, len);
+    uint32_t seq = controlUint(p, len, "seq");
+    if (type == CTRL_PONG || type == CTRL_TRACE_REPLY) {
+      auto &open = type == CTRL_PONG ? track.pings : track.traces;
+      auto it = open.find(seq);
+      if (it == open.end()) continue;
+      (type == CTRL_PONG ? track.pingUs : track.traceUs).record((uint32_t)(m.atUs - it->second));
+      (type == CTRL_PONG ? track.pongs : track.traceReplies)++;
+      open.erase(it);
+      continue;
+    }
+    if (type == CTRL_JOIN) track.joins++;
+    if (type != CTRL_DATA || slot <= 0 || !controlHas(p, len, "seq")) continue;
+    Reading &r = track.readings[readingKey(slot, seq)];
+    if (r.published++) {
+      track.duplicates++;
+      continue;
+    }
+    if (controlHas(p, len, "node_age_ms")) {
+      track.backfillAgeMs.record(controlUint(p, len, "node_age_ms"));
+    } else if (r.sent && !r.backfill) {
+      track.latencyUs.record((uint32_t)(m.atUs - r.sentUs));
+    }
+  }
+  b.fromGateway.clear();
+}
+
+// ---------- Servidor (app.py) ----------
+
+static void serverTick(std::vector<Device> &devices, uint32_t pingSeq, std::mt19937 &rng) {
+  sim::Network &net = sim::Network::get();
+  sim::Broker &b = sim::Broker::get();
+  bool trace = pingSeq % 5 == 0;
+  // Destino al azar entre los unidos; el TRACE a uno a 3 saltos o más
+  int slot = 0;
+  for (int tries = 0; tries < 50 && !slot; tries++) {
+    int s = 1 + (int)(rng() % (devices.size() - 1));
+    if (net.reachesRoot(s) && (!trace || net.depth(s) >= 3)) slot = s;
+  }
+  // QoS 0: sin la suscripción de la gateway el pedido se pierde en el broker
+  if (!slot || !b.up || std::find(b.subscribed.begin(), b.subscribed.end(), MQTT_TOPIC_CONTROL) == b.subscribed.end()) {
+    return;
+  }
+  uint64_t now = sim::clockUs();
+  char msg[160];
+  snprintf(msg, sizeof(msg), "{\"type\":\"%s\",\"to\":%u,\"from\":0,\"seq\":%u,\"srv_ms\":%u}",
+           trace ? "TRACE" : "PING", sim::Network::nodeIdOf(slot), pingSeq, (uint32_t)(now / 1000));
+  b.publishToGateway(MQTT_TOPIC_CONTROL, msg);
+  if (trace) {
+    track.traces[pingSeq] = now;
+    track.tracesSent++;
+  } else {
+    track.pings[pingSeq] = now;
+    track.pingsSent++;
+  }
+}
+
+// ---------- Reporte ----------
+
+static void printHistogram(const char *name, const Histogram &h, double scale, const char *unit) {
+  if (!h.count()) {
+    printf("  %-22s sin muestras\n", name);
+    return;
+  }
+  printf("  %-22s n=%u p50=%.1f p90=%.1f p99=%.1f max=%.1f %s\n", name, h.count(), h.percentile(0.5) / scale,
+         h.percentile(0.9) / scale, h.percentile(0.99) / scale, h.max() / scale, unit);
+}
+
+static int parseArgs(int argc, char **argv, Options &o) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string k = argv[i];
+    const char *v = argv[i + 1];
+    if (k == "--nodes") o.nodes = (uint32_t)atoi(v);
+    else if (k == "--fanout") o.fanout = (uint32_t)atoi(v);
+    else if (k == "--duration-s") o.durationS = (uint32_t)atoi(v);
+    else if (k == "--scenario") o.scenario = v;
+    else if (k == "--loss") o.loss = atof(v);
+    else if (k == "--ping-ms") o.pingMs = (uint32_t)atoi(v);
+    else if (k == "--boot-spread-s") o.bootSpreadS = (uint32_t)atoi(v);
+    else if (k == "--seed") o.seed = (uint32_t)atoi(v);
+    else if (k == "--verbose") o.verbose = atoi(v);
+    else {
+      printf("opción desconocida: %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (o.scenario != "base" && o.scenario != "lossy" && o.scenario != "partition" && o.scenario != "outage") {
+    printf("escenario desconocido: %s\n", o.scenario.c_str());
+    return 1;
+  }
+  if (!o.nodes || !o.fanout || o.durationS < 60) {
+    printf("--nodes y --fanout deben ser > 0 y --duration-s >= 60\n");
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  Options opt;
+  if ((argc - 1) % 2 || parseArgs(argc, argv, opt)) return 2;
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+
+  // Árbol y red
+  size_t n = opt.nodes + 1;
+  std::vector<int> parent(n, -1);
+  for (size_t i = 1; i < n; i++) parent[i] = (int)((i - 1) / opt.fanout);
+  sim::Network &net = sim::Network::get();
+  net.setTree(parent, opt.seed);
+  if (opt.scenario == "lossy") net.cfg.loss = opt.loss;
+  net.onOriginate = onOriginate;
+  net.onDrop = onDrop;
+
+  // Dispositivos: la gateway en el slot 0, los sensores en orden rotativo
+  std::mt19937 rng(opt.seed);
+  std::vector<Device> devices(n);
+  for (size_t i = 0; i < n; i++) {
+    Device &d = devices[i];
+    d.dev.index = (uint32_t)i;
+    d.dev.rng.seed(opt.seed * 7919u + (uint32_t)i);
+    d.dev.verbose = opt.verbose == (int)i;
+    d.phase = std::uniform_real_distribution<float>(0, 2 * PI_F)(rng);
+    d.bootUs = i ? std::uniform_int_distribution<uint64_t>(0, opt.bootSpreadS * 1000000ULL)(rng) : 0;
+    d.dev.bootUs = d.bootUs;
+    d.nextUs = d.bootUs;
+    d.dev.gpsFix = i % 3 == 0;
+    d.dev.lat = 4.6 + i * 1e-5;
+    d.dev.lon = -74.08 - i * 1e-5;
+    if (!i) {
+      d.dev.name = "gw";
+      continue;
+    }
+    sim::Use use(d.dev);
+    float phase = d.phase;
+    switch (i % 4) {
+      case 1:
+        d.dev.name = "temp";
+        d.node = new SensorNode<temperatura::TemperaturaSensor>();
+        break;
+      case 2:
+        d.dev.name = "hum";
+        d.node = new SensorNode<humedad::HumedadSensor>();
+        break;
+      case 3:
+        d.dev.name = "luz";
+        d.dev.adc = [phase](double t) { return 1500 + 1000 * sin(2 * M_PI * t / 600 + phase); };
+        d.node = new SensorNode<luz::LuzSensor>();
+        break;
+      default:
+        d.dev.name = "suelo";
+        d.dev.adc = [phase](double t) { return 2200 + 600 * sin(2 * M_PI * t / 900 + phase); };
+        d.node = new SensorNode<suelo::HumSueloSensor>();
+        break;
+    }
+  }
+
+  // Escenario
+  const uint64_t endUs = opt.durationS * 1000000ULL;
+  const uint64_t faultUs = endUs * 4 / 10;
+  int cutSlot = 0;
+  if (opt.scenario == "partition") {
+    std::vector<uint32_t> subtree(n, 1);
+    for (size_t i = n - 1; i > 0; i--) subtree[parent[i]] += subtree[i];
+    for (size_t i = 1; i < n; i++) {
+      if (parent[i] == 0 && (!cutSlot || subtree[i] > subtree[cutSlot])) cutSlot = (int)i;
+    }
+    printf("partición: enlace gateway - nodo %d (%u nodos aislados) de %.0f s a %.0f s\n", cutSlot,
+           subtree[cutSlot], faultUs / 1e6, faultUs / 1e6 + PARTITION_S);
+  } else if (opt.scenario == "outage") {
+    printf("broker caído de %.0f s a %.0f s\n", faultUs / 1e6, faultUs / 1e6 + OUTAGE_S);
+  } else if (opt.scenario == "lossy") {
+    printf("pérdida por salto: %.3f\n", net.cfg.loss);
+  }
+  printf("%u nodos, fanout %u, %u s simulados (+%u s de vaciado), escenario %s\n", opt.nodes, opt.fanout,
+         opt.durationS, QUIESCE_MS / 1000, opt.scenario.c_str());
+
+  auto wall0 = std::chrono::steady_clock::now();
+  uint32_t pingSeq = 0;
+  uint64_t nextPingUs = 60 * 1000000ULL;  // tras el arranque
+  bool cut = false, brokerDown = false;
+  Device &gateway = devices[0];
+
+  for (uint64_t t = 0; t <= endUs + QUIESCE_MS * 1000ULL; t += 1000) {
+    sim::clockUs() = t;
+
+    if (opt.scenario == "partition") {
+      bool want = t >= faultUs && t < faultUs + PARTITION_S * 1000000ULL;
+      if (want != cut) net.setLink(cutSlot, !(cut = want));
+    } else if (opt.scenario == "outage") {
+      bool want = t >= faultUs && t < faultUs + OUTAGE_S * 1000000ULL;
+      if (want != brokerDown) sim::Broker::get().setUp(!(brokerDown = want));
+    }
+
+    net.run(t);
+
+    // Gateway: loop() en el núcleo del mesh, después la tarea MQTT
+    if (t >= gateway.nextUs) {
+      sim::Use use(gateway.dev);
+      gateway.dev.skewUs = 0;
+      if (!gateway.booted) {
+        gateway.booted = true;
+        gw::setup();
+      } else {
+        gw::loop();
+      }
+      gateway.nextUs = t + std::max<uint64_t>(1000, gateway.dev.skewUs);
+      drainLog();
+    }
+    sim::runTasks();
+    {
+      sim::Use use(gateway.dev);
+      drainLog();
+    }
+    consumeBroker();
+
+    if (t >= nextPingUs && t < endUs) {
+      nextPingUs += opt.pingMs * 1000ULL;
+      serverTick(devices, ++pingSeq, rng);
+    }
+
+    // Nodos: cada uno en su fase de NODE_TICK_MS; después de endUs sólo la red y la gateway
+    if (t >= endUs) continue;
+    uint32_t phase = (uint32_t)((t / 1000) % NODE_TICK_MS);
+    for (size_t i = phase ? phase : NODE_TICK_MS; i < n; i += NODE_TICK_MS) {
+      Device &d = devices[i];
+      if (t < d.nextUs) continue;
+      sim::Use use(d.dev);
+      d.dev.skewUs = 0;
+      environment(d);
+      if (!d.booted) {
+        d.booted = true;
+        d.node->begin();
+      } else {
+        d.node->update();
+      }
+      d.nextUs = t + std::max<uint64_t>(NODE_TICK_MS * 1000ULL, d.dev.skewUs);
+      drainLog();
+    }
+  }
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+  sim::stopTasks();
+
+  // ---------- Resultados ----------
+
+  uint64_t generated = 0, published = 0, backfilled = 0;
+  uint64_t lost[LOST_CAUSES] = {};
+  for (size_t i = 1; i < n; i++) {
+    uint16_t top = devices[i].node->seq();
+    generated += top;
+    for (uint32_t s = 1; s <= top; s++) {
+      auto it = track.readings.find(readingKey((int)i, s));
+      Reading r = it == track.readings.end() ? Reading() : it->second;
+      if (r.published) {
+        published++;
+        if (r.backfill) backfilled++;
+        continue;
+      }
+      if (!r.sent) {
+        lost[LOST_UNSENT]++;
+      } else if (r.drop == sim::DROP_LINK) {
+        lost[LOST_LINK]++;
+      } else if (r.drop == sim::DROP_LOSS) {
+        lost[LOST_HOP]++;
+      } else if (r.drop == sim::DROP_ROUTE) {
+        lost[LOST_ROUTE]++;
+      } else if (!r.unicast) {
+        lost[LOST_NO_ROOT]++;
+      } else {
+        lost[LOST_GATEWAY]++;
+      }
+    }
+  }
+  uint64_t lostTotal = generated - published;
+
+  const sim::MeshStats &ms = net.stats;
+  int busiest = 1;
+  for (size_t i = 1; i < n; i++) {
+    if (net.linkTx((int)i) > net.linkTx(busiest)) busiest = (int)i;
+  }
+  uint32_t joined = 0;
+  for (size_t i = 1; i < n; i++) joined += net.reachesRoot((int)i);
+
+  printf("\n== %s: %u nodos, %.0f s simulados en %.1f s (%.0fx tiempo real)\n", opt.scenario.c_str(), opt.nodes,
+         (endUs + QUIESCE_MS * 1000ULL) / 1e6, wallS, (endUs + QUIESCE_MS * 1000ULL) / 1e6 / wallS);
+  printf("lecturas: generadas=%llu publicadas=%llu (%.1f/s) reenviadas del log=%llu repetidas=%u perdidas=%llu\n",
+         (unsigned long long)generated, (unsigned long long)published, published / (opt.durationS * 1.0),
+         (unsigned long long)backfilled, track.duplicates, (unsigned long long)lostTotal);
+  for (int c = 0; c < LOST_CAUSES; c++) {
+    if (lost[c]) printf("  perdidas por %-20s %llu\n", kLossNames[c], (unsigned long long)lost[c]);
+  }
+  printHistogram("latencia nodo->broker", track.latencyUs, 1000.0, "ms");
+  printHistogram("antigüedad en flash", track.backfillAgeMs, 1000.0, "s");
+  printf("control: PING %u -> PONG %u, TRACE a >= 3 saltos %u -> TRACE_REPLY %u\n", track.pingsSent, track.pongs,
+         track.tracesSent, track.traceReplies);
+  printHistogram("RTT PING", track.pingUs, 1000.0, "ms");
+  printHistogram("RTT TRACE", track.traceUs, 1000.0, "ms");
+  printf("mesh: unidos al final=%u/%u JOIN publicados=%u mensajes=%llu saltos=%llu bytes=%llu sin ruta=%llu\n",
+         joined, opt.nodes, track.joins, (unsigned long long)ms.originated, (unsigned long long)ms.transmissions,
+         (unsigned long long)ms.bytes, (unsigned long long)ms.noRoute);
+  printf("  descartes: salto=%llu enlace=%llu ruta=%llu; ROOT anunciados=%u; enlace más cargado: nodo %d "
+         "(profundidad %d) %llu mensajes\n",
+         (unsigned long long)ms.drops[sim::DROP_LOSS], (unsigned long long)ms.drops[sim::DROP_LINK],
+         (unsigned long long)ms.drops[sim::DROP_ROUTE], track.rootAnnounces, busiest, net.depth(busiest),
+         (unsigned long long)net.linkTx(busiest));
+
+  SpscStats data = gw::meshLanes.stats(gw::LANE_DATA), ctrl = gw::meshLanes.stats(gw::LANE_CONTROL);
+  const auto &store = gw::frameStore.stats();
+  const gw::ControlTrackerStats &ct = gw::controlTracker.stats();
+  printf("gateway: grandes=%u carril datos max=%u llenas=%u, control max=%u llenas=%u\n", gw::meshTooLarge,
+         data.highWater, data.failures, ctrl.highWater, ctrl.failures);
+  printf("  store: max=%u retenidas=%u entregadas=%u overflow=%u; MQTT intentos=%u fallos=%u\n", store.highWater,
+         store.stored, store.drained, store.overflow, gw::mqttLink.stats().attempts, gw::mqttLink.stats().failures);
+  printf("  control: ok=%u parciales=%u vencidos=%u repetidos=%u limitados=%u resp_repetidas=%u sin_descartar=%u\n",
+         ct.done, ct.partial, ct.timeouts, ct.duplicates, ct.limited, ct.repeated, ct.unchecked);
+  // Un hueco cuenta como pérdida recién al salir de la ventana de SeqWindow.h
+  uint32_t seqLost = 0, seqReceived = 0, seqGaps = 0;
+  gw::seqTable.forEach([&](const SeqEntry &e) {
+    uint64_t valid = e.span >= SEQ_WINDOW_BITS ? ~0ULL : (1ULL << e.span) - 1;
+    seqLost += e.lost;
+    seqReceived += e.received;
+    seqGaps += (uint32_t)__builtin_popcountll(~e.bits & valid);
+  });
+  printf("  SEQ: nodos seguidos=%u/%u sin seguir=%u recibidas=%u perdidas inferidas=%u huecos en ventana=%u\n",
+         (unsigned)gw::seqTable.size(), opt.nodes, gw::seqTable.untracked(), seqReceived, seqLost, seqGaps);
+  printf("  topología: versión=%u nodos=%u%s; publicados:", gw::topology.version(),
+         (unsigned)gw::topology.current().count, gw::topology.current().truncated ? " (truncada)" : "");
+  for (auto &kv : track.gatewayTypes) printf(" %s=%u", kv.first.c_str(), kv.second);
+  printf(" metricas=%u\n", track.metrics);
+
+  // ---------- Comprobaciones ----------
+
+  CHECK(joined == opt.nodes, "%u de %u nodos unidos al final", joined, opt.nodes);
+  CHECK(!track.duplicates, "%u lecturas publicadas más de una vez", track.duplicates);
+  CHECK(generated > opt.nodes, "sólo %llu lecturas generadas", (unsigned long long)generated);
+  CHECK(seqLost <= lostTotal, "SEQ_STATS infiere %u perdidas, hubo %llu", seqLost, (unsigned long long)lostTotal);
+  if (opt.scenario != "lossy") {
+    CHECK(track.pongs == track.pingsSent, "PONG %u de %u PING", track.pongs, track.pingsSent);
+    CHECK(track.traceReplies == track.tracesSent, "TRACE_REPLY %u de %u TRACE", track.traceReplies, track.tracesSent);
+  }
+  if (opt.scenario == "base") {
+    CHECK(!lostTotal, "%llu lecturas perdidas con enlaces sin pérdida", (unsigned long long)lostTotal);
+  } else if (opt.scenario == "lossy") {
+    CHECK(lostTotal == lost[LOST_HOP] + lost[LOST_LINK], "%llu perdidas sin causa en el mesh",
+          (unsigned long long)(lostTotal - lost[LOST_HOP] - lost[LOST_LINK]));
+  } else if (opt.scenario == "partition") {
+    CHECK(backfilled > 0, "ninguna lectura reenviada desde el log de flash");
+    CHECK(!lost[LOST_UNSENT] && !lost[LOST_GATEWAY], "%llu lecturas quedaron en flash, %llu perdidas en la gateway",
+          (unsigned long long)lost[LOST_UNSENT], (unsigned long long)lost[LOST_GATEWAY]);
+    CHECK(lostTotal <= lost[LOST_LINK] + lost[LOST_ROUTE] + lost[LOST_NO_ROOT] && lostTotal < n,
+          "%llu perdidas: más que las que iban en vuelo al cortar", (unsigned long long)lostTotal);
+  } else if (opt.scenario == "outage") {
+    // Con el store lleno también se llena el carril de datos: ambos cuentan
+    CHECK(lostTotal == lost[LOST_GATEWAY] && lostTotal <= store.overflow + data.failures,
+          "%llu perdidas, overflow del store %u, carril de datos lleno %u", (unsigned long long)lostTotal,
+          store.overflow, data.failures);
+  }
+
+  for (Device &d : devices) delete d.node;
+  if (failed) {
+    printf("FALLO: %d comprobaciones\n", failed);
+  } else {
+    printf("OK: escenario %s\n", opt.scenario.c_str());
+  }
+  return failed ? 1 : 0;
+}
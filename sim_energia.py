@@ -0,0 +1,177 @@
+from __future__ import annotations
+
+import argparse
+import json
+import logging
+import sys
+from typing import Any, Dict, List, Optional, Tuple
+
+
+logger = logging.getLogger("sim_energia")
+logger.setLevel(logging.INFO)
+handler = logging.StreamHandler(sys.stdout)
+handler.setFormatter(logging.Formatter("%(message)s"))
+logger.addHandler(handler)
+
+# Modelo de consumo de NODE_SLEEP_MODE (MeshNodeRuntime.h). Por período cada
+# nodo dormido despierta una vez: sin radio (boot + muestreo) o, uno de cada
+# join_every, con radio (boot + unión + envío + linger). Los relevos
+# (NODE_SLEEP_MODE 0) tienen la radio siempre encendida.
+#
+# Latencia de dato: una lectura tomada j despertares después de la última
+# unión espera (join_every - j) períodos; en promedio (join_every - 1) / 2
+# períodos, más el tránsito por los saltos hasta el gateway.
+
+
+def load_topology(path: Optional[str], relays: int, sleepers: int) -> Dict[str, Dict[str, Any]]:
+    """{nodo: {"parent": id, "relay": bool}}; el padre del primer nivel es "gateway".
+
+    Sin archivo: relevos en cadena desde el gateway y dormidos repartidos entre ellos.
+    """
+    if path:
+        with open(path, encoding="utf-8") as f:
+            return json.load(f)["nodes"]
+    nodes: Dict[str, Dict[str, Any]] = {}
+    parent = "gateway"
+    for i in range(relays):
+        nodes[f"r{i + 1}"] = {"parent": parent, "relay": True}
+        parent = f"r{i + 1}"
+    for i in range(sleepers):
+        nodes[f"s{i + 1}"] = {"parent": f"r{i % relays + 1}" if relays else "gateway", "relay": False}
+    return nodes
+
+
+def hops_to_gateway(nodes: Dict[str, Dict[str, Any]], node: str) -> int:
+    hops = 0
+    while node != "gateway":
+        node = nodes[node]["parent"]
+        hops += 1
+        if hops > len(nodes):
+            raise ValueError(f"Ciclo en la topología cerca de {node}")
+    return hops
+
+
+def load_measured(path: str) -> Dict[str, Dict[str, float]]:
+    """Suma los POWER de un log de Puente.py --latency-log, por nodo."""
+    totals: Dict[str, Dict[str, float]] = {}
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            try:
+                rec = json.loads(line)
+            except json.JSONDecodeError:
+                continue
+            if rec.get("type") != "POWER":
+                continue
+            t = totals.setdefault(str(rec.get("from")), {"wakes": 0, "joins": 0, "awake_ms": 0, "radio_ms": 0, "tx_bytes": 0})
+            for k in t:
+                t[k] += rec.get(k, 0)
+    return {n: t for n, t in totals.items() if t["wakes"]}
+
+
+def sleeper_charge_per_cycle(args, hops: int, join_every: int, measured: Optional[Dict[str, float]]) -> Tuple[float, float]:
+    """(mA·s consumidos en join_every períodos, segundos despierto) de un nodo dormido."""
+    if measured:
+        # Promedios reales por despertar, escalados a join_every despertares
+        wakes = measured["wakes"]
+        radio_s = measured["radio_ms"] / 1000.0 / wakes * join_every
+        cpu_s = (measured["awake_ms"] - measured["radio_ms"]) / 1000.0 / wakes * join_every
+        tx_bytes = measured["tx_bytes"] / wakes * join_every
+        awake_s = radio_s + cpu_s + join_every * args.boot_ms / 1000.0
+        charge = (cpu_s + join_every * args.boot_ms / 1000.0) * args.i_cpu_ma + radio_s * args.i_radio_ma
+    else:
+        boot_s = args.boot_ms / 1000.0
+        sample_s = args.sample_ms / 1000.0
+        join_s = (args.join_ms + args.join_ms_por_salto * (hops - 1)) / 1000.0
+        readings = join_every  # la del despertar con radio más las del log
+        tx_bytes = readings * args.bytes_lectura + args.bytes_power
+        tx_s = tx_bytes * 8 / (args.tx_kbps * 1000.0)
+        radio_s = join_s + tx_s + args.linger_ms / 1000.0
+        cpu_s = (join_every - 1) * (boot_s + sample_s) + boot_s
+        awake_s = cpu_s + radio_s
+        charge = cpu_s * args.i_cpu_ma + radio_s * args.i_radio_ma
+    tx_s = tx_bytes * 8 / (args.tx_kbps * 1000.0)
+    charge += tx_s * (args.i_tx_ma - args.i_radio_ma)
+    return charge, awake_s
+
+
+def model(args, nodes, join_every: int, measured: Dict[str, Dict[str, float]]) -> List[Dict[str, Any]]:
+    rows = []
+    capacity_mas = args.bateria_mah * 3600.0 * args.eficiencia
+    for name in sorted(nodes, key=lambda n: (not nodes[n].get("relay"), n)):
+        hops = hops_to_gateway(nodes, name)
+        transit_s = hops * args.ms_por_salto / 1000.0
+        if nodes[name].get("relay"):
+            # Reenvío de las lecturas de los dormidos: despreciable frente a la radio encendida
+            avg_ma = args.i_radio_ma
+            duty = 100.0
+            lat_mean = lat_max = transit_s
+        else:
+            window_s = join_every * args.period
+            charge, awake_s = sleeper_charge_per_cycle(args, hops, join_every, measured.get(name))
+            asleep_s = max(window_s - awake_s, 0.0)
+            avg_ma = (charge + asleep_s * args.i_sleep_ua / 1000.0) / window_s
+            duty = 100.0 * awake_s / window_s
+            lat_mean = (join_every - 1) / 2.0 * args.period + transit_s
+            lat_max = (join_every - 1) * args.period + transit_s
+        rows.append({
+            "nodo": name,
+            "rol": "relevo" if nodes[name].get("relay") else "dormido",
+            "saltos": hops,
+            "I media mA": avg_ma,
+            "despierto %": duty,
+            "vida días": capacity_mas / avg_ma / 86400.0,
+            "lat media s": lat_mean,
+            "lat max s": lat_max,
+        })
+    return rows
+
+
+def parse_args():
+    p = argparse.ArgumentParser(description="Vida de batería y latencia de datos con NODE_SLEEP_MODE")
+    p.add_argument("--topologia", help='JSON {"nodes": {"id": {"parent": "gateway"|id, "relay": bool}}}')
+    p.add_argument("--relevos", type=int, default=2, help="Sin --topologia: relevos en cadena desde el gateway")
+    p.add_argument("--dormidos", type=int, default=6, help="Sin --topologia: nodos dormidos repartidos")
+    p.add_argument("--medido", help="Log de Puente.py --latency-log con mensajes POWER para calibrar por nodo")
+    p.add_argument("--period", type=float, default=300.0, help="SLEEP_PERIOD_S")
+    p.add_argument("--join-every", type=int, nargs="+", default=[1, 3, 6], help="SLEEP_JOIN_EVERY (uno o varios)")
+    p.add_argument("--boot-ms", type=float, default=250.0, help="Arranque tras deep sleep hasta setup()")
+    p.add_argument("--sample-ms", type=float, default=300.0, help="sampleMs() del sensor: 300 ADC, 2100 DHT22")
+    p.add_argument("--join-ms", type=float, default=4000.0, help="Unión al mesh con un salto hasta el root")
+    p.add_argument("--join-ms-por-salto", type=float, default=500.0, help="Demora extra de unión por salto")
+    p.add_argument("--linger-ms", type=float, default=500.0, help="SLEEP_LINGER_MS")
+    p.add_argument("--bytes-lectura", type=int, default=110, help="JSON de una lectura con node_age_ms")
+    p.add_argument("--bytes-power", type=int, default=170, help="Mensaje POWER")
+    p.add_argument("--tx-kbps", type=float, default=1000.0, help="Tasa efectiva de transmisión")
+    p.add_argument("--ms-por-salto", type=float, default=15.0, help="Tránsito por salto del mesh")
+    p.add_argument("--i-sleep-ua", type=float, default=20.0, help="Deep sleep (módulo + regulador)")
+    p.add_argument("--i-cpu-ma", type=float, default=35.0, help="CPU despierta sin radio")
+    p.add_argument("--i-radio-ma", type=float, default=120.0, help="Radio encendida (escucha)")
+    p.add_argument("--i-tx-ma", type=float, default=240.0, help="Radio transmitiendo")
+    p.add_argument("--bateria-mah", type=float, default=2500.0)
+    p.add_argument("--eficiencia", type=float, default=0.8, help="Capacidad útil (autodescarga, corte de tensión)")
+    return p.parse_args()
+
+
+def main():
+    args = parse_args()
+    nodes = load_topology(args.topologia, args.relevos, args.dormidos)
+    measured = load_measured(args.medido) if args.medido else {}
+    if measured:
+        logger.info("Calibrado con POWER de %d nodos: %s", len(measured), ", ".join(sorted(measured)))
+
+    keys = ["saltos", "I media mA", "despierto %", "vida días", "lat media s", "lat max s"]
+    for join_every in args.join_every:
+        rows = model(args, nodes, join_every, measured)
+        logger.info("\nSLEEP_PERIOD_S=%g SLEEP_JOIN_EVERY=%d", args.period, join_every)
+        logger.info("%-10s %-8s" + " %12s" * len(keys), "nodo", "rol", *keys)
+        for r in rows:
+            logger.info("%-10s %-8s %12d" + " %12.3f" * (len(keys) - 1), r["nodo"], r["rol"], *(r[k] for k in keys))
+        sleepers = [r for r in rows if r["rol"] == "dormido"]
+        if sleepers:
+            worst = min(sleepers, key=lambda r: r["vida días"])
+            logger.info("Peor dormido: %s, %.0f días; relevos: %.1f días", worst["nodo"], worst["vida días"],
+                        min((r["vida días"] for r in rows if r["rol"] == "relevo"), default=float("nan")))
+
+
+if __name__ == "__main__":
+    main()
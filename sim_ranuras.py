@@ -0,0 +1,175 @@
+from __future__ import annotations
+
+import argparse
+import heapq
+import logging
+import random
+import statistics
+import sys
+from typing import Dict, List, Tuple
+
+
+logger = logging.getLogger("sim_ranuras")
+logger.setLevel(logging.INFO)
+handler = logging.StreamHandler(sys.stdout)
+handler.setFormatter(logging.Formatter("%(message)s"))
+logger.addHandler(handler)
+
+# Modelo simple del canal compartido: un solo dominio de colisión (peor caso,
+# todos los nodos se escuchan) y sin detección de portadora. Dos tramas que se
+# solapan en el aire se pierden y ambos nodos reintentan tras un backoff
+# aleatorio, como haría la capa de reintentos del mesh.
+
+
+def simulate(nodes: int, slotted: bool, args, seed: int) -> Dict[str, float]:
+    rng = random.Random(seed)
+    period = args.period
+    airtime = args.airtime_ms / 1000.0
+    sync_err = args.sync_error_ms / 1000.0
+
+    # Sin ranuras: todos arrancan casi a la vez (el mismo corte de energía) y
+    # cada reloj deriva unas ppm, así que las fases se cruzan con el tiempo.
+    # Con ranuras: desfase índice*period/n sobre el tiempo del mesh, más el
+    # error de sincronización de painlessMesh y el jitter del scheduler.
+    ids = [rng.getrandbits(32) for _ in range(nodes)]
+
+    # Churn: cada churn_s segundos un nodo sale o vuelve a entrar. Cada nodo
+    # se entera del cambio con un retardo propio (propagación de la topología),
+    # así que durante esa ventana dos nodos pueden calcular la misma ranura.
+    changes: List[Tuple[float, List[int]]] = [(float("-inf"), sorted(range(nodes), key=lambda i: ids[i]))]
+    if args.churn_s > 0:
+        members = set(range(nodes))
+        out: List[int] = []
+        t = args.churn_s
+        while t < args.duration:
+            if out and (rng.random() < 0.5 or len(members) < 2):
+                members.add(out.pop(rng.randrange(len(out))))
+            else:
+                leaving = rng.choice(sorted(members))
+                members.discard(leaving)
+                out.append(leaving)
+            changes.append((t, sorted(members, key=lambda i: ids[i])))
+            t += args.churn_s
+    seen_delay = [[rng.uniform(0, args.propagation_s) for _ in changes] for _ in range(nodes)]
+
+    def view(i: int, t: float) -> List[int]:
+        """Membresía que conoce el nodo i en el instante t."""
+        for j in range(len(changes) - 1, -1, -1):
+            if changes[j][0] + seen_delay[i][j] <= t:
+                return changes[j][1]
+        return changes[0][1]
+
+    def actual(t: float) -> List[int]:
+        for when, m in reversed(changes):
+            if when <= t:
+                return m
+        return changes[0][1]
+
+    events: List[Tuple[float, int, int, float]] = []  # (t, nodo, intento, t_muestra)
+    for i in range(nodes):
+        drift = 1 + rng.uniform(-args.drift_ppm, args.drift_ppm) * 1e-6
+        boot = rng.uniform(0, args.boot_spread_ms / 1000.0)
+        for k in range(int(args.duration / period)):
+            base = k * period
+            if i not in actual(base):
+                continue
+            if slotted:
+                members = view(i, base)
+                index = sum(1 for m in members if ids[m] < ids[i])
+                width = period / max(len(members), 1)
+                t = base + index * width + min(args.guard_ms / 1000.0, width / 4) + rng.gauss(0, sync_err)
+            else:
+                t = (base + boot) * drift
+            t += rng.uniform(0, args.jitter_ms / 1000.0)
+            events.append((t, i, 0, t))
+    heapq.heapify(events)
+
+    busy: List[Tuple[float, float, int]] = []  # en el aire (ini, fin, id), ordenadas por fin
+    next_id = 0
+    attempts: Dict[int, Tuple[int, int, float]] = {}  # id -> (nodo, intento, t_muestra)
+    collided = set()
+    latencies: List[float] = []
+    collisions = retries = drops = 0
+
+    def finish_first():
+        """Cierra la transmisión que termina primero; si chocó, agenda el reintento."""
+        nonlocal collisions, retries, drops
+        _, end, tid = busy.pop(0)
+        node, attempt, sampled = attempts.pop(tid)
+        if tid not in collided:
+            latencies.append(end - sampled)
+            return
+        collided.discard(tid)
+        collisions += 1
+        if attempt < args.max_retries:
+            retries += 1
+            backoff = rng.uniform(0, args.backoff_ms / 1000.0) * (2 ** attempt)
+            heapq.heappush(events, (end + backoff, node, attempt + 1, sampled))
+        else:
+            drops += 1
+
+    # Fines e inicios de transmisión se procesan en orden estricto de tiempo
+    while events or busy:
+        if busy and (not events or busy[0][1] <= events[0][0]):
+            finish_first()
+            continue
+        t, node, attempt, sampled = heapq.heappop(events)
+        tid = next_id
+        next_id += 1
+        attempts[tid] = (node, attempt, sampled)
+        for _, end, other in busy:
+            if end > t:
+                collided.add(other)
+                collided.add(tid)
+        busy.append((t, t + airtime, tid))
+        busy.sort(key=lambda b: b[1])
+
+    frames = len(latencies) + drops
+    lat = sorted(latencies) or [0.0]
+    return {
+        "tramas": frames,
+        "colisiones": collisions,
+        "reintentos": retries,
+        "perdidas": drops,
+        "entrega %": 100.0 * len(latencies) / frames,
+        "lat media ms": statistics.mean(lat) * 1000,
+        "lat p99 ms": lat[int(0.99 * (len(lat) - 1))] * 1000,
+    }
+
+
+def parse_args():
+    p = argparse.ArgumentParser(description="Modelo de colisiones con y sin ranuras de envío (SEND_SLOTTED)")
+    p.add_argument("--nodos", type=int, nargs="+", default=[10, 25, 50, 100, 200])
+    p.add_argument("--period", type=float, default=10.0, help="Período de reporte (s), SEND_INTERVAL_S")
+    p.add_argument("--duration", type=float, default=3600.0, help="Tiempo simulado (s)")
+    p.add_argument("--airtime-ms", type=float, default=1.5, help="Tiempo en el aire por trama")
+    p.add_argument("--boot-spread-ms", type=float, default=200.0, help="Dispersión del arranque sin ranuras")
+    p.add_argument("--drift-ppm", type=float, default=40.0, help="Deriva del reloj de cada nodo")
+    p.add_argument("--jitter-ms", type=float, default=2.0, help="Jitter del scheduler (loop ocupado)")
+    p.add_argument("--sync-error-ms", type=float, default=1.0, help="Error (sigma) de la sincronía del mesh")
+    p.add_argument("--guard-ms", type=float, default=20.0, help="SLOT_GUARD_MS")
+    p.add_argument("--churn-s", type=float, default=60.0, help="Cada cuánto entra/sale un nodo (0 = estático)")
+    p.add_argument("--propagation-s", type=float, default=2.0, help="Retardo máximo en que un nodo ve el cambio")
+    p.add_argument("--backoff-ms", type=float, default=10.0, help="Backoff base de reintento")
+    p.add_argument("--max-retries", type=int, default=3)
+    p.add_argument("--seed", type=int, default=1)
+    return p.parse_args()
+
+
+def main():
+    args = parse_args()
+    keys = None
+    rows = []
+    for n in args.nodos:
+        for slotted in (False, True):
+            r = simulate(n, slotted, args, args.seed + n)
+            keys = keys or list(r)
+            rows.append((n, "ranuras" if slotted else "libre", r))
+
+    logger.info("%6s %-8s" + " %12s" * len(keys), "nodos", "modo", *keys)
+    for n, mode, r in rows:
+        logger.info("%6d %-8s" + " %12.1f" * len(keys), n, mode, *(r[k] for k in keys))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,284 @@
+from __future__ import annotations
+
+import argparse
+import heapq
+import logging
+import math
+import random
+import statistics
+import sys
+from typing import Dict, Generator, List, Optional, Tuple
+
+
+logger = logging.getLogger("sim_rearranque")
+logger.setLevel(logging.INFO)
+handler = logging.StreamHandler(sys.stdout)
+handler.setFormatter(logging.Formatter("%(message)s"))
+logger.addHandler(handler)
+
+# Arranque en frío simultáneo de todo el mesh (corte de energía, despliegue de
+# firmware), con y sin el reingreso dirigido de MeshRejoin.h.
+#
+# Modelo:
+#   - Nodos al azar en un área, alcance de radio fijo; el gateway en una esquina.
+#   - Un nodo sólo puede colgarse de un AP ya unido al mesh (o del gateway),
+#     en su alcance y con lugar (max_conn). Cada AP atiende una asociación a la
+#     vez; después viene la sincronía de painlessMesh.
+#   - Sin NVS: el gateway levanta su AP en el canal por defecto y, al
+#     conectarse al router, lo mueve al canal del router. Todo lo unido hasta
+#     ahí se cae y vuelve a escanear. Cada búsqueda de painlessMesh es un
+#     barrido de todos los canales.
+#   - Con NVS: el gateway arranca ya en el canal del router. Cada nodo escanea
+#     primero el canal guardado buscando a su padre anterior y después
+#     cualquier AP del mesh en ese canal. Tras REJOIN_DIRECTED_TRIES pasa al
+#     barrido completo (acotado); luego painlessMesh busca en ese canal.
+#
+# "ttf" es el instante en que el nodo tiene camino al gateway por primera vez
+# (cuando envía el JOIN); "asentado" es su última unión, tras las caídas.
+
+CHANNELS = 13
+
+
+class Sim:
+    def __init__(self, args, nvs: bool, pos: List[Tuple[float, float]], saved_parent: List[int]):
+        self.args = args
+        self.nvs = nvs
+        self.pos = pos
+        self.n = len(pos) - 1  # índice 0 = gateway
+        self.saved_parent = saved_parent
+        self.rng = random.Random(args.seed + (1 if nvs else 0))
+        self.now = 0.0
+        self.events: List[Tuple[float, int, int]] = []
+        self.seq = 0
+        self.ap_up = [False] * (self.n + 1)      # AP visible y unido al mesh
+        self.parent: List[Optional[int]] = [None] * (self.n + 1)
+        self.children = [0] * (self.n + 1)
+        self.assoc_free_at = [0.0] * (self.n + 1)
+        self.epoch = [0] * (self.n + 1)          # cambia en cada caída del nodo
+        self.gw_channel = args.default_channel if not nvs else args.router_channel
+        self.ttf: Dict[int, float] = {}
+        self.settled: Dict[int, float] = {}
+        self.scan_ms: Dict[int, float] = {}
+        self.drops = 0
+
+    # ---------- Visibilidad ----------
+
+    def in_range(self, a: int, b: int) -> bool:
+        (x1, y1), (x2, y2) = self.pos[a], self.pos[b]
+        return math.hypot(x1 - x2, y1 - y2) <= self.args.range
+
+    def hops(self, i: int) -> int:
+        h = 0
+        while i:
+            i = self.parent[i]
+            h += 1
+        return h
+
+    def candidates(self, i: int, channel: Optional[int]) -> List[int]:
+        """APs unidos en alcance con lugar libre; channel None = todos los canales."""
+        if channel is not None and channel != self.gw_channel:
+            return []
+        out = [j for j in range(self.n + 1)
+               if j != i and self.ap_up[j] and self.in_range(i, j) and self.children[j] < self.args.max_conn]
+        return sorted(out, key=lambda j: math.dist(self.pos[i], self.pos[j]))
+
+    # ---------- Eventos ----------
+
+    def drop(self, i: int):
+        """El nodo i pierde su enlace: también se caen sus descendientes."""
+        if not self.ap_up[i] and self.parent[i] is None:
+            return
+        if self.parent[i] is not None:
+            self.children[self.parent[i]] -= 1
+        self.parent[i] = None
+        self.ap_up[i] = False
+        self.epoch[i] += 1
+        self.drops += 1
+        for j in range(1, self.n + 1):
+            if self.parent[j] == i:
+                self.drop(j)
+
+    def node(self, i: int) -> Generator[float, None, None]:
+        a = self.args
+        yield a.boot_ms + self.rng.uniform(0, a.boot_jitter_ms)
+        channel: Optional[int] = None
+        preferred: Optional[int] = None
+        start = self.now
+        if self.nvs:
+            # MeshRejoin::begin(): canal guardado, luego barrido acotado
+            for _ in range(a.directed_tries):
+                yield a.scan_ms_per_chan
+                if self.saved_parent[i] in self.candidates(i, a.router_channel):
+                    channel, preferred = a.router_channel, self.saved_parent[i]
+                    break
+                yield a.scan_ms_per_chan
+                if self.candidates(i, a.router_channel):
+                    channel = a.router_channel
+                    break
+            for _ in range(0 if channel else a.full_tries):
+                yield a.scan_ms_per_chan * CHANNELS
+                if self.candidates(i, None):
+                    channel = self.gw_channel
+                    break
+            channel = channel or a.router_channel
+        self.scan_ms[i] = self.now - start
+
+        # painlessMesh: buscar, asociarse, sincronizar; repetir si se cae
+        while True:
+            if self.parent[i] is not None:
+                yield a.poll_ms
+                continue
+            if preferred is None:
+                yield a.scan_ms_per_chan * (1 if self.nvs else CHANNELS)
+            found = self.candidates(i, channel if self.nvs else None)
+            if preferred in found:
+                found.remove(preferred)
+                found.insert(0, preferred)
+            preferred = None
+            if not found:
+                yield a.rescan_ms
+                continue
+            p = found[0]
+            self.children[p] += 1
+            p_epoch = self.epoch[p]
+            begin = max(self.now, self.assoc_free_at[p])
+            self.assoc_free_at[p] = begin + a.assoc_ms
+            yield begin + a.assoc_ms - self.now + a.sync_ms
+            if self.epoch[p] != p_epoch or not self.ap_up[p]:
+                self.children[p] -= 1
+                continue
+            self.parent[i] = p
+            self.ap_up[i] = True
+            t = self.now + self.hops(i) * a.hop_ms
+            self.ttf.setdefault(i, t)
+            self.settled[i] = t
+
+    def gateway(self) -> Generator[float, None, None]:
+        a = self.args
+        yield a.boot_ms
+        self.ap_up[0] = True
+        yield a.router_ms
+        if self.gw_channel != a.router_channel:
+            # painlessMesh mueve el AP al canal del router: el mesh se cae entero
+            self.gw_channel = a.router_channel
+            for j in range(1, self.n + 1):
+                if self.parent[j] == 0:
+                    self.drop(j)
+        while True:
+            yield 1e9
+
+    def run(self):
+        procs = {0: self.gateway()}
+        procs.update({i: self.node(i) for i in range(1, self.n + 1)})
+        for i, p in procs.items():
+            self.push(next(p), i)
+        while self.events:
+            t, _, i = heapq.heappop(self.events)
+            if t > self.args.duration * 1000:
+                break
+            self.now = t
+            self.push(next(procs[i]), i)
+
+    def push(self, delay: float, i: int):
+        self.seq += 1
+        heapq.heappush(self.events, (self.now + delay, self.seq, i))
+
+
+def layout(args) -> Tuple[List[Tuple[float, float]], List[int]]:
+    """Posiciones conectadas y el padre de cada nodo en el árbol previo (el AP más cercano con menos saltos)."""
+    for attempt in range(1000):
+        rng = random.Random(args.seed * 1000 + attempt)
+        pos = [(0.0, 0.0)] + [(rng.uniform(0, args.side), rng.uniform(0, args.side)) for _ in range(args.nodos)]
+        depth = {0: 0}
+        parent = [0] * len(pos)
+        frontier = [0]
+        while frontier:
+            nxt = []
+            for j in frontier:
+                for i in range(1, len(pos)):
+                    if i not in depth and math.dist(pos[i], pos[j]) <= args.range:
+                        depth[i] = depth[j] + 1
+                        parent[i] = j
+                        nxt.append(i)
+            frontier = nxt
+        if len(depth) == len(pos):
+            return pos, parent
+    raise SystemExit("No se encontró una disposición conectada; aumente --range o reduzca --side")
+
+
+def summary(sim: Sim) -> Dict[str, float]:
+    ttf = sorted(sim.ttf.values())
+    settled = sorted(sim.settled.values())
+
+    def pct(v: List[float], p: float) -> float:
+        return v[min(len(v) - 1, int(p / 100 * len(v)))] / 1000 if v else float("nan")
+
+    return {
+        "unidos": len(ttf),
+        "ttf p50 s": pct(ttf, 50),
+        "ttf p90 s": pct(ttf, 90),
+        "ttf max s": ttf[-1] / 1000 if ttf else float("nan"),
+        "asentado s": settled[-1] / 1000 if settled else float("nan"),
+        "caídas": sim.drops,
+        "escaneo ms": statistics.mean(sim.scan_ms.values()) if sim.scan_ms else 0.0,
+    }
+
+
+def parse_args():
+    p = argparse.ArgumentParser(description="Arranque en frío simultáneo del mesh, con y sin reingreso dirigido (NVS)")
+    p.add_argument("--nodos", type=int, default=50)
+    p.add_argument("--side", type=float, default=120.0, help="Lado del área (m)")
+    p.add_argument("--range", type=float, default=35.0, help="Alcance de radio (m)")
+    p.add_argument("--max-conn", type=int, default=4, help="Conexiones por AP de painlessMesh")
+    p.add_argument("--boot-ms", type=float, default=1200.0, help="Arranque hasta mesh.init (incluye delay(1000))")
+    p.add_argument("--boot-jitter-ms", type=float, default=300.0)
+    p.add_argument("--scan-ms-per-chan", type=float, default=120.0, help="REJOIN_SCAN_MS_PER_CHAN")
+    p.add_argument("--directed-tries", type=int, default=2, help="REJOIN_DIRECTED_TRIES")
+    p.add_argument("--full-tries", type=int, default=1, help="REJOIN_FULL_TRIES")
+    p.add_argument("--rescan-ms", type=float, default=1000.0, help="Pausa de painlessMesh entre búsquedas")
+    p.add_argument("--assoc-ms", type=float, default=700.0, help="Asociación WiFi + TCP con el padre")
+    p.add_argument("--sync-ms", type=float, default=300.0, help="Sincronía de nodos y tiempo")
+    p.add_argument("--hop-ms", type=float, default=15.0)
+    p.add_argument("--poll-ms", type=float, default=200.0)
+    p.add_argument("--router-ms", type=float, default=4000.0, help="Gateway: barrido + asociación + DHCP con el router")
+    p.add_argument("--default-channel", type=int, default=1)
+    p.add_argument("--router-channel", type=int, default=6)
+    p.add_argument("--duration", type=float, default=300.0, help="Tiempo simulado (s)")
+    p.add_argument("--seed", type=int, default=1)
+    p.add_argument("--max-asentado-s", type=float, default=20.0,
+                   help="Con NVS, todo el mesh debe estar unido antes de esto")
+    return p.parse_args()
+
+
+def main():
+    args = parse_args()
+    pos, saved_parent = layout(args)
+    results = {}
+    for nvs in (False, True):
+        sim = Sim(args, nvs, pos, saved_parent)
+        sim.run()
+        results["con NVS" if nvs else "sin NVS"] = summary(sim)
+
+    keys = list(next(iter(results.values())))
+    logger.info("%-8s" + " %11s" * len(keys), "modo", *keys)
+    for mode, r in results.items():
+        logger.info("%-8s" + " %11.2f" * len(keys), mode, *(r[k] for k in keys))
+
+    base, nvs = results["sin NVS"], results["con NVS"]
+    failures = []
+    if nvs["unidos"] < args.nodos:
+        failures.append(f"con NVS sólo se unieron {nvs['unidos']:.0f}/{args.nodos} nodos")
+    if not nvs["asentado s"] <= args.max_asentado_s:
+        failures.append(f"con NVS el mesh se asentó en {nvs['asentado s']:.1f} s (> {args.max_asentado_s:.0f} s)")
+    if not nvs["ttf p90 s"] < base["ttf p90 s"]:
+        failures.append("el reingreso dirigido no mejora el p90 del tiempo a la primera trama")
+    for f in failures:
+        logger.info("FALLO: %s", f)
+    if not failures:
+        logger.info("OK: %d nodos unidos con NVS, asentado en %.1f s (sin NVS %.1f s)",
+                    args.nodos, nvs["asentado s"], base["asentado s"])
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())